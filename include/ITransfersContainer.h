@@ -18,6 +18,7 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <limits>
 #include <vector>
 #include "crypto/hash.h"
@@ -93,6 +94,8 @@ public:
     IncludeDefault = IncludeKeyUnlocked
   };
 
+  typedef std::function<bool(const TransactionOutputInformation&)> OutputVisitor;
+
   virtual size_t transfersCount() const = 0;
   virtual size_t transactionsCount() const = 0;
   virtual uint64_t balance(uint32_t flags = IncludeDefault) const = 0;
@@ -104,6 +107,18 @@ public:
   virtual std::vector<TransactionOutputInformation> getTransactionInputs(const Crypto::Hash& transactionHash, uint32_t flags) const = 0;
   virtual void getUnconfirmedTransactions(std::vector<Crypto::Hash>& transactions) const = 0;
   virtual std::vector<TransactionSpentOutputInformation> getSpentOutputs() const = 0;
+  // Calls the visitor for the outputs with amounts from minAmount to maxAmount in ascending order of amounts, unconfirmed
+  // ones last, without copying them. The container stays locked meanwhile, so the visitor must not call it. The visit
+  // stops when the visitor returns false.
+  virtual void visitOutputs(uint64_t minAmount, uint64_t maxAmount, uint32_t flags, const OutputVisitor& visitor) const = 0;
+  // Returns the number of unlocked key outputs with amounts from minAmount to maxAmount in logarithmic time.
+  virtual size_t unlockedKeyOutputsCount(uint64_t minAmount, uint64_t maxAmount) const = 0;
+  // Calls the visitor for the unlocked key outputs with amounts from minAmount to maxAmount found at the given positions
+  // of their ascending order of amounts, skipping the positions past unlockedKeyOutputsCount(). Each position is found in
+  // logarithmic time. The container stays locked meanwhile, so the visitor must not call it. The visit stops when the
+  // visitor returns false.
+  virtual void visitUnlockedKeyOutputs(uint64_t minAmount, uint64_t maxAmount, const std::vector<size_t>& positions,
+    const OutputVisitor& visitor) const = 0;
 };
 
 }
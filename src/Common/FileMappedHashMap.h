@@ -0,0 +1,306 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "Common/FileMappedVector.h"
+
+namespace Common {
+
+// Open addressing hash map stored in a FileMappedVector of cache line sized slots.
+// Erased slots become tombstones instead of shifting their neighbours, so an insert or erase never
+// moves an existing entry. Slots are updated in place and pages reach the disk in no particular
+// order, so a slot written after the last flush() may be torn by a crash. Crash consistency is up
+// to the owner: flush() makes every entry written before it durable, the owner then records a clean
+// flag and, after a crash, erases the entries written since the last flush.
+// Growing rewrites the table into a temporary file which then replaces the old one.
+template<class Key, class Value, class Hash = std::hash<Key>>
+class FileMappedHashMap {
+public:
+  static const uint64_t INITIAL_CAPACITY = 1024;
+
+  FileMappedHashMap() {
+  }
+
+  FileMappedHashMap(const FileMappedHashMap&) = delete;
+  FileMappedHashMap& operator=(const FileMappedHashMap&) = delete;
+
+  void open(const std::string& path) {
+    assert(!isOpened());
+
+    m_path = path;
+    boost::system::error_code ignore;
+    boost::filesystem::remove(temporaryPath(), ignore);
+
+    if (!boost::filesystem::exists(path) && !boost::filesystem::exists(path + ".bak")) {
+      replace(INITIAL_CAPACITY, false);
+      return;
+    }
+
+    m_slots.open(path, FileMappedVectorOpenMode::OPEN, sizeof(Header));
+    m_slots.setAutoFlush(false);
+    if (m_slots.size() == 0 || (m_slots.size() & (m_slots.size() - 1)) != 0) {
+      m_slots.close();
+      throw std::runtime_error("FileMappedHashMap::open() invalid capacity in " + path);
+    }
+  }
+
+  void close() {
+    m_slots.close();
+  }
+
+  bool isOpened() const {
+    return m_slots.isOpened();
+  }
+
+  uint64_t size() const {
+    return header().count;
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  uint64_t capacity() const {
+    return m_slots.size();
+  }
+
+  const Value* find(const Key& key) const {
+    uint64_t index = findSlot(key);
+    return index == capacity() ? nullptr : &m_slots[index].value;
+  }
+
+  const Value& at(const Key& key) const {
+    const Value* value = find(key);
+    if (value == nullptr) {
+      throw std::out_of_range("FileMappedHashMap::at() key not found");
+    }
+
+    return *value;
+  }
+
+  size_t count(const Key& key) const {
+    return findSlot(key) == capacity() ? 0 : 1;
+  }
+
+  // Returns false and leaves the map unchanged if the key is already present
+  bool insert(const Key& key, const Value& value) {
+    if ((header().count + header().erased + 1) * 4 > capacity() * 3) {
+      replace(header().count * 2 + 2 > capacity() ? capacity() * 2 : capacity(), true);
+    }
+
+    uint64_t mask = capacity() - 1;
+    uint64_t freeIndex = capacity();
+    for (uint64_t index = m_hash(key) & mask;; index = (index + 1) & mask) {
+      const Slot& slot = m_slots[index];
+      if (slot.state == OCCUPIED_SLOT) {
+        if (slot.key == key) {
+          return false;
+        }
+      } else if (slot.state == ERASED_SLOT) {
+        if (freeIndex == capacity()) {
+          freeIndex = index;
+        }
+      } else {
+        if (freeIndex == capacity()) {
+          freeIndex = index;
+        } else {
+          --header().erased;
+        }
+
+        break;
+      }
+    }
+
+    store(m_slots[freeIndex], key, value);
+    ++header().count;
+    return true;
+  }
+
+  size_t erase(const Key& key) {
+    uint64_t index = findSlot(key);
+    if (index == capacity()) {
+      return 0;
+    }
+
+    m_slots[index].state = ERASED_SLOT;
+    --header().count;
+    ++header().erased;
+    return 1;
+  }
+
+  void clear() {
+    replace(INITIAL_CAPACITY, false);
+  }
+
+  // Erases every entry for which predicate(key, value) is true. Counters are recomputed from the
+  // slots, so this also repairs a header that was not flushed together with the slots.
+  template<class Predicate>
+  uint64_t eraseIf(Predicate predicate) {
+    uint64_t erasedCount = 0;
+    Header& counters = header();
+    counters.count = 0;
+    counters.erased = 0;
+    for (uint64_t index = 0; index < capacity(); ++index) {
+      Slot& slot = m_slots[index];
+      if (slot.state == OCCUPIED_SLOT && predicate(slot.key, slot.value)) {
+        slot.state = ERASED_SLOT;
+        ++erasedCount;
+      }
+
+      if (slot.state == OCCUPIED_SLOT) {
+        ++counters.count;
+      } else if (slot.state == ERASED_SLOT) {
+        ++counters.erased;
+      }
+    }
+
+    return erasedCount;
+  }
+
+  template<class F>
+  void forEach(F func) const {
+    for (uint64_t index = 0; index < capacity(); ++index) {
+      const Slot& slot = m_slots[index];
+      if (slot.state == OCCUPIED_SLOT) {
+        func(slot.key, slot.value);
+      }
+    }
+  }
+
+  void flush() {
+    m_slots.flush();
+  }
+
+private:
+  enum : uint8_t {
+    EMPTY_SLOT = 0,
+    OCCUPIED_SLOT = 1,
+    ERASED_SLOT = 2
+  };
+
+  struct alignas(64) Slot {
+    Key key;
+    Value value;
+    uint8_t state;
+  };
+
+  struct Header {
+    uint64_t count;
+    uint64_t erased;
+    uint64_t reserved[4];
+  };
+
+  // FileMappedVector keeps size and capacity after the prefix, so slots start at offset 64
+  // and a slot never crosses a page boundary
+  static_assert(sizeof(Slot) == 64, "FileMappedHashMap slot must fit a cache line");
+  static_assert(sizeof(Header) + 2 * sizeof(uint64_t) == sizeof(Slot), "FileMappedHashMap slots must be cache line aligned");
+
+  FileMappedVector<Slot> m_slots;
+  std::string m_path;
+  Hash m_hash;
+
+  Header& header() {
+    return *reinterpret_cast<Header*>(m_slots.prefix());
+  }
+
+  const Header& header() const {
+    return *reinterpret_cast<const Header*>(m_slots.prefix());
+  }
+
+  std::string temporaryPath() const {
+    return m_path + ".tmp";
+  }
+
+  uint64_t findSlot(const Key& key) const {
+    uint64_t mask = capacity() - 1;
+    for (uint64_t index = m_hash(key) & mask;; index = (index + 1) & mask) {
+      const Slot& slot = m_slots[index];
+      if (slot.state == EMPTY_SLOT) {
+        return capacity();
+      }
+
+      if (slot.state == OCCUPIED_SLOT && slot.key == key) {
+        return index;
+      }
+    }
+  }
+
+  static void store(Slot& slot, const Key& key, const Value& value) {
+    slot.key = key;
+    slot.value = value;
+    slot.state = OCCUPIED_SLOT;
+  }
+
+  void replace(uint64_t newCapacity, bool keepEntries) {
+    assert((newCapacity & (newCapacity - 1)) == 0);
+
+    std::string tmpPath = temporaryPath();
+    boost::filesystem::remove(tmpPath);
+    {
+      FileMappedVector<Slot> slots(tmpPath, FileMappedVectorOpenMode::CREATE, sizeof(Header));
+      slots.setAutoFlush(false);
+      slots.reserve(newCapacity);
+
+      Slot emptySlot;
+      std::memset(&emptySlot, 0, sizeof(emptySlot));
+      for (uint64_t i = 0; i < newCapacity; ++i) {
+        slots.push_back(emptySlot);
+      }
+
+      Header& counters = *reinterpret_cast<Header*>(slots.prefix());
+      std::memset(&counters, 0, sizeof(counters));
+
+      if (keepEntries) {
+        uint64_t mask = newCapacity - 1;
+        forEach([&](const Key& key, const Value& value) {
+          uint64_t index = m_hash(key) & mask;
+          while (slots[index].state != EMPTY_SLOT) {
+            index = (index + 1) & mask;
+          }
+
+          store(slots[index], key, value);
+          ++counters.count;
+        });
+      }
+
+      slots.flush();
+    }
+
+    if (m_slots.isOpened()) {
+      m_slots.close();
+    }
+
+    boost::filesystem::rename(tmpPath, m_path);
+    m_slots.open(m_path, FileMappedVectorOpenMode::OPEN, sizeof(Header));
+    m_slots.setAutoFlush(false);
+  }
+};
+
+template<class Key, class Value, class Hash>
+const uint64_t FileMappedHashMap<Key, Value, Hash>::INITIAL_CAPACITY;
+
+}
@@ -291,12 +291,16 @@ public:
   uint8_t* suffix();
   uint64_t suffixSize() const;
   void resizeSuffix(uint64_t newSuffixSize);
+  // Unlike resizeSuffix() it grows the file in place instead of copying it, a failure can leave a part of the data appended
+  void appendSuffix(const uint8_t* data, uint64_t size);
 
   void rename(const std::string& newPath, std::error_code& ec);
   void rename(const std::string& newPath);
 
   template<class F>
   void atomicUpdate(F&& func);
+  // Moves the file of other in place of the vector file, other is left closed
+  void replace(FileMappedVector& other);
 
 private:
   std::string m_path;
@@ -743,6 +747,22 @@ void FileMappedVector<T>::resizeSuffix(uint64_t newSuffixSize) {
   }
 }
 
+template<class T>
+void FileMappedVector<T>::appendSuffix(const uint8_t* data, uint64_t size) {
+  assert(isOpened());
+
+  if (m_file.path() != m_path) {
+    throw std::runtime_error("Vector is mapped to a .bak file due to earlier errors");
+  }
+
+  uint64_t offset = m_file.size();
+  m_file.resize(offset + size);
+  m_suffixSize += size;
+
+  std::copy(data, data + size, m_file.data() + offset);
+  m_file.flush(m_file.data() + offset, size);
+}
+
 template<class T>
 void FileMappedVector<T>::rename(const std::string& newPath, std::error_code& ec) {
   m_file.rename(newPath, ec);
@@ -789,13 +809,8 @@ void FileMappedVector<T>::atomicUpdate0(uint64_t newCapacity, uint64_t newPrefix
     throw std::runtime_error("Vector is mapped to a .bak file due to earlier errors");
   }
 
-  boost::filesystem::path bakPath = m_path + ".bak";
   boost::filesystem::path tmpPath = boost::filesystem::unique_path(m_path + ".tmp.%%%%-%%%%");
 
-  if (boost::filesystem::exists(bakPath)) {
-    boost::filesystem::remove(bakPath);
-  }
-
   Tools::ScopeExit tmpFileDeleter([&tmpPath] {
     boost::system::error_code ignore;
     boost::filesystem::remove(tmpPath, ignore);
@@ -807,11 +822,28 @@ void FileMappedVector<T>::atomicUpdate0(uint64_t newCapacity, uint64_t newPrefix
   func(tmpVector);
   tmpVector.flush();
 
+  replace(tmpVector);
+  tmpFileDeleter.cancel();
+}
+
+template<class T>
+void FileMappedVector<T>::replace(FileMappedVector& other) {
+  assert(other.isOpened());
+
+  if (m_file.path() != m_path) {
+    throw std::runtime_error("Vector is mapped to a .bak file due to earlier errors");
+  }
+
+  boost::filesystem::path bakPath = m_path + ".bak";
+  if (boost::filesystem::exists(bakPath)) {
+    boost::filesystem::remove(bakPath);
+  }
+
   // Swap files
   std::error_code ec;
   std::error_code ignore;
   m_file.rename(bakPath.string());
-  tmpVector.rename(m_path, ec);
+  other.rename(m_path, ec);
   if (ec) {
     // Try to restore and ignore errors
     m_file.rename(m_path, ignore);
@@ -819,11 +851,10 @@ void FileMappedVector<T>::atomicUpdate0(uint64_t newCapacity, uint64_t newPrefix
   }
 
   m_path = bakPath.string();
-  swap(tmpVector);
-  tmpFileDeleter.cancel();
+  swap(other);
 
   // Remove .bak file and ignore errors
-  tmpVector.close(ignore);
+  other.close(ignore);
   boost::system::error_code boostError;
   boost::filesystem::remove(bakPath, boostError);
 }
@@ -0,0 +1,114 @@
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "RecursiveSharedMutex.h"
+
+#include <cassert>
+#include <unordered_map>
+
+namespace Tools {
+
+namespace {
+
+// shared lock depth of the current thread in every mutex it holds shared
+std::unordered_map<const RecursiveSharedMutex*, size_t>& sharedDepths() {
+  static thread_local std::unordered_map<const RecursiveSharedMutex*, size_t> depths;
+  return depths;
+}
+
+}
+
+RecursiveSharedMutex::RecursiveSharedMutex() : m_owner(std::thread::id()), m_exclusiveDepth(0) {
+}
+
+void RecursiveSharedMutex::lock() {
+  if (ownedByCurrentThread()) {
+    ++m_exclusiveDepth;
+    return;
+  }
+
+  assert(sharedDepths().count(this) == 0);
+  m_mutex.lock();
+  m_owner = std::this_thread::get_id();
+  m_exclusiveDepth = 1;
+}
+
+bool RecursiveSharedMutex::try_lock() {
+  if (ownedByCurrentThread()) {
+    ++m_exclusiveDepth;
+    return true;
+  }
+
+  if (sharedDepths().count(this) != 0 || !m_mutex.try_lock()) {
+    return false;
+  }
+
+  m_owner = std::this_thread::get_id();
+  m_exclusiveDepth = 1;
+  return true;
+}
+
+void RecursiveSharedMutex::unlock() {
+  assert(ownedByCurrentThread());
+  if (--m_exclusiveDepth == 0) {
+    m_owner = std::thread::id();
+    m_mutex.unlock();
+  }
+}
+
+void RecursiveSharedMutex::lock_shared() {
+  if (ownedByCurrentThread()) {
+    ++m_exclusiveDepth;
+    return;
+  }
+
+  size_t& depth = sharedDepth();
+  if (depth == 0) {
+    m_mutex.lock_shared();
+  }
+
+  ++depth;
+}
+
+void RecursiveSharedMutex::unlock_shared() {
+  if (ownedByCurrentThread()) {
+    unlock();
+    return;
+  }
+
+  releaseSharedDepth();
+}
+
+bool RecursiveSharedMutex::ownedByCurrentThread() const {
+  return m_owner == std::this_thread::get_id();
+}
+
+size_t& RecursiveSharedMutex::sharedDepth() {
+  return sharedDepths()[this];
+}
+
+void RecursiveSharedMutex::releaseSharedDepth() {
+  auto& depths = sharedDepths();
+  auto it = depths.find(this);
+  assert(it != depths.end() && it->second != 0);
+  if (--it->second == 0) {
+    depths.erase(it);
+    m_mutex.unlock_shared();
+  }
+}
+
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+#include <boost/thread/shared_mutex.hpp>
+
+namespace Tools {
+
+// Reader/writer mutex which a thread may lock again while it holds it. A thread holding it exclusively
+// may also take it shared, that only nests in the exclusive lock. A thread holding it shared only must
+// not lock it exclusively, it would wait for itself.
+// Satisfies Lockable for std::lock_guard and has lock_shared/unlock_shared for boost::shared_lock.
+class RecursiveSharedMutex {
+public:
+  RecursiveSharedMutex();
+
+  RecursiveSharedMutex(const RecursiveSharedMutex&) = delete;
+  RecursiveSharedMutex& operator=(const RecursiveSharedMutex&) = delete;
+
+  void lock();
+  bool try_lock();
+  void unlock();
+
+  void lock_shared();
+  void unlock_shared();
+
+  bool ownedByCurrentThread() const;
+
+private:
+  boost::shared_mutex m_mutex;
+  std::atomic<std::thread::id> m_owner;
+  size_t m_exclusiveDepth; // changed by the owner only
+
+  size_t& sharedDepth();
+  void releaseSharedDepth();
+};
+
+}
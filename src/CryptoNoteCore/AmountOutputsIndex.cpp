@@ -0,0 +1,130 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "AmountOutputsIndex.h"
+
+#include <cassert>
+
+namespace CryptoNote {
+
+size_t AmountOutputsIndex::OutputKeyHash::operator()(const OutputKey& key) const {
+  // the map masks the low bits, so both words are mixed into all of them
+  uint64_t hash = key.amount * 0x9E3779B97F4A7C15ULL + key.index;
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  return static_cast<size_t>(hash);
+}
+
+void AmountOutputsIndex::open(const std::string& path) {
+  m_positions.open(path);
+  m_counts.clear();
+}
+
+void AmountOutputsIndex::close() {
+  m_positions.close();
+  m_counts.clear();
+}
+
+bool AmountOutputsIndex::isOpened() const {
+  return m_positions.isOpened();
+}
+
+void AmountOutputsIndex::clear() {
+  m_positions.clear();
+  m_counts.clear();
+}
+
+void AmountOutputsIndex::flush() {
+  m_positions.flush();
+}
+
+uint64_t AmountOutputsIndex::size(uint64_t amount) const {
+  std::lock_guard<std::mutex> lock(m_countsLock);
+  auto it = m_counts.find(amount);
+  if (it != m_counts.end()) {
+    return it->second;
+  }
+
+  uint64_t count = 0;
+  if (contains(amount, 0)) {
+    // contains(low) holds and contains(high) does not
+    uint64_t low = 0;
+    uint64_t high = 1;
+    while (contains(amount, high)) {
+      low = high;
+      high *= 2;
+    }
+
+    while (high - low > 1) {
+      uint64_t middle = low + (high - low) / 2;
+      if (contains(amount, middle)) {
+        low = middle;
+      } else {
+        high = middle;
+      }
+    }
+
+    count = high;
+  }
+
+  m_counts[amount] = count;
+  return count;
+}
+
+bool AmountOutputsIndex::find(uint64_t amount, uint64_t index, uint64_t& position) const {
+  const uint64_t* value = m_positions.find({ amount, index });
+  if (value == nullptr) {
+    return false;
+  }
+
+  position = *value;
+  return true;
+}
+
+uint64_t AmountOutputsIndex::push(uint64_t amount, uint64_t position) {
+  uint64_t index = size(amount);
+  bool inserted = m_positions.insert({ amount, index }, position);
+  assert(inserted);
+  (void)inserted;
+
+  std::lock_guard<std::mutex> lock(m_countsLock);
+  m_counts[amount] = index + 1;
+  return index;
+}
+
+void AmountOutputsIndex::pop(uint64_t amount) {
+  uint64_t count = size(amount);
+  assert(count != 0);
+  m_positions.erase({ amount, count - 1 });
+
+  std::lock_guard<std::mutex> lock(m_countsLock);
+  m_counts[amount] = count - 1;
+}
+
+void AmountOutputsIndex::truncate(uint64_t position) {
+  m_positions.eraseIf([position](const OutputKey&, uint64_t value) { return value >= position; });
+
+  std::lock_guard<std::mutex> lock(m_countsLock);
+  m_counts.clear();
+}
+
+bool AmountOutputsIndex::contains(uint64_t amount, uint64_t index) const {
+  return m_positions.find({ amount, index }) != nullptr;
+}
+
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Common/FileMappedHashMap.h"
+
+namespace CryptoNote
+{
+  // Positions of outputs in their journal by amount and global output index, kept in a file mapped hash map.
+  // Outputs of an amount are pushed and popped at the end only, so the indexes of an amount are always
+  // 0..count-1. A count is found by a galloping search over the map the first time the amount is used.
+  // Crash consistency is up to the owner, see FileMappedHashMap: after a crash it calls truncate().
+  class AmountOutputsIndex {
+
+  public:
+
+    void open(const std::string& path);
+    void close();
+    bool isOpened() const;
+    void clear();
+    void flush();
+
+    uint64_t size(uint64_t amount) const;
+    bool find(uint64_t amount, uint64_t index, uint64_t& position) const;
+
+    // Returns the global index of the output
+    uint64_t push(uint64_t amount, uint64_t position);
+    void pop(uint64_t amount);
+
+    // Erases the outputs at journal positions from position on
+    void truncate(uint64_t position);
+
+  private:
+
+    struct OutputKey {
+      uint64_t amount;
+      uint64_t index;
+
+      bool operator==(const OutputKey& other) const {
+        return amount == other.amount && index == other.index;
+      }
+    };
+
+    struct OutputKeyHash {
+      size_t operator()(const OutputKey& key) const;
+    };
+
+    Common::FileMappedHashMap<OutputKey, uint64_t, OutputKeyHash> m_positions;
+    mutable std::mutex m_countsLock;
+    mutable std::unordered_map<uint64_t, uint64_t> m_counts;
+
+    bool contains(uint64_t amount, uint64_t index) const;
+  };
+}
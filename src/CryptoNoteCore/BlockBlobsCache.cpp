@@ -0,0 +1,67 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "BlockBlobsCache.h"
+
+#include <cassert>
+
+namespace CryptoNote {
+
+BlockBlobsCache::BlockBlobsCache(size_t capacity) : m_capacity(capacity) {
+  assert(capacity > 0);
+}
+
+std::shared_ptr<const BlockBlobs> BlockBlobsCache::find(const Crypto::Hash& id) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_index.find(id);
+  if (it == m_index.end()) {
+    return nullptr;
+  }
+
+  m_entries.splice(m_entries.end(), m_entries, it->second);
+  return *it->second;
+}
+
+void BlockBlobsCache::insert(const std::shared_ptr<const BlockBlobs>& blobs) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_index.find(blobs->id);
+  if (it != m_index.end()) {
+    *it->second = blobs;
+    m_entries.splice(m_entries.end(), m_entries, it->second);
+    return;
+  }
+
+  if (m_entries.size() == m_capacity) {
+    m_index.erase(m_entries.front()->id);
+    m_entries.pop_front();
+  }
+
+  m_index.emplace(blobs->id, m_entries.insert(m_entries.end(), blobs));
+}
+
+void BlockBlobsCache::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.clear();
+  m_index.clear();
+}
+
+size_t BlockBlobsCache::size() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "crypto/hash.h"
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+
+namespace CryptoNote
+{
+  // A block and its transactions encoded as stored in the block store, with the hashes needed
+  // to serve them to wallets. Responses are filled by copying these, without serializing or hashing.
+  struct BlockBlobs {
+    Crypto::Hash id;
+    uint64_t timestamp;
+    std::string block;
+    // transactions other than the base transaction, in block order
+    std::vector<Crypto::Hash> transactionHashes;
+    std::vector<std::string> transactions;
+    std::vector<TransactionPrefix> transactionPrefixes;
+  };
+
+  // Recently served BlockBlobs, keyed by block hash, evicting the least recently used ones.
+  // Thread safe: Blockchain readers share its lock and fill the cache concurrently.
+  class BlockBlobsCache {
+
+  public:
+
+    explicit BlockBlobsCache(size_t capacity);
+
+    std::shared_ptr<const BlockBlobs> find(const Crypto::Hash& id);
+    void insert(const std::shared_ptr<const BlockBlobs>& blobs);
+    void clear();
+
+    size_t size() const;
+
+  private:
+
+    typedef std::list<std::shared_ptr<const BlockBlobs>> Entries;
+
+    size_t m_capacity;
+    mutable std::mutex m_mutex;
+    Entries m_entries; // least recently used first
+    std::unordered_map<Crypto::Hash, Entries::iterator> m_index;
+  };
+}
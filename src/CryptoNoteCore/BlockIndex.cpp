@@ -17,30 +17,78 @@
 
 #include "BlockIndex.h"
 
-#include <boost/utility/value_init.hpp>
-
-#include "CryptoNoteSerialization.h"
-#include "Serialization/SerializationOverloads.h"
+#include <algorithm>
+#include <cassert>
 
 namespace CryptoNote {
+  void BlockIndex::open(const std::string& idsPath, const std::string& heightsPath) {
+    m_ids.open(idsPath);
+    m_ids.setAutoFlush(false);
+    m_heights.open(heightsPath);
+  }
+
+  void BlockIndex::close() {
+    std::error_code ignore;
+    if (m_ids.isOpened()) {
+      m_ids.close(ignore);
+    }
+
+    if (m_heights.isOpened()) {
+      m_heights.close();
+    }
+  }
+
+  bool BlockIndex::isOpened() const {
+    return m_ids.isOpened();
+  }
+
+  void BlockIndex::flush() {
+    m_ids.flush();
+    m_heights.flush();
+  }
+
+  void BlockIndex::pop() {
+    assert(!m_ids.empty());
+    m_heights.erase(m_ids.back());
+    m_ids.pop_back();
+  }
+
+  bool BlockIndex::push(const Crypto::Hash& h) {
+    if (!m_heights.insert(h, static_cast<uint32_t>(m_ids.size()))) {
+      return false;
+    }
+
+    m_ids.push_back(h);
+    return true;
+  }
+
+  void BlockIndex::clear() {
+    m_ids.clear();
+    m_heights.clear();
+  }
+
+  void BlockIndex::truncate(uint32_t height) {
+    while (m_ids.size() > height) {
+      m_ids.pop_back();
+    }
+
+    m_heights.eraseIf([height](const Crypto::Hash&, uint32_t value) { return value >= height; });
+  }
+
   Crypto::Hash BlockIndex::getBlockId(uint32_t height) const {
-    assert(height < m_container.size());
+    assert(height < m_ids.size());
 
-    return m_container[static_cast<size_t>(height)];
+    return m_ids[height];
   }
 
   std::vector<Crypto::Hash> BlockIndex::getBlockIds(uint32_t startBlockIndex, uint32_t maxCount) const {
     std::vector<Crypto::Hash> result;
-    if (startBlockIndex >= m_container.size()) {
+    if (startBlockIndex >= m_ids.size()) {
       return result;
     }
 
-    size_t count = std::min(static_cast<size_t>(maxCount), m_container.size() - static_cast<size_t>(startBlockIndex));
-    result.reserve(count);
-    for (size_t i = 0; i < count; ++i) {
-      result.push_back(m_container[startBlockIndex + i]);
-    }
-
+    uint64_t count = std::min(static_cast<uint64_t>(maxCount), m_ids.size() - startBlockIndex);
+    result.assign(m_ids.begin() + startBlockIndex, m_ids.begin() + startBlockIndex + count);
     return result;
   }
 
@@ -55,7 +103,7 @@ namespace CryptoNote {
   }
 
   std::vector<Crypto::Hash> BlockIndex::buildSparseChain(const Crypto::Hash& startBlockId) const {
-    assert(m_index.count(startBlockId) > 0);
+    assert(hasBlock(startBlockId));
 
     uint32_t startBlockHeight;
     getBlockHeight(startBlockId, startBlockHeight);
@@ -63,26 +111,18 @@ namespace CryptoNote {
     std::vector<Crypto::Hash> result;
     size_t sparseChainEnd = static_cast<size_t>(startBlockHeight + 1);
     for (size_t i = 1; i <= sparseChainEnd; i *= 2) {
-      result.emplace_back(m_container[sparseChainEnd - i]);
+      result.emplace_back(m_ids[sparseChainEnd - i]);
     }
 
-    if (result.back() != m_container[0]) {
-      result.emplace_back(m_container[0]);
+    if (result.back() != m_ids[0]) {
+      result.emplace_back(m_ids[0]);
     }
 
     return result;
   }
 
   Crypto::Hash BlockIndex::getTailId() const {
-    assert(!m_container.empty());
-    return m_container.back();
-  }
-
-  void BlockIndex::serialize(ISerializer& s) {
-    if (s.type() == ISerializer::INPUT) {
-      readSequence<Crypto::Hash>(std::back_inserter(m_container), "index", s);
-    } else {
-      writeSequence<Crypto::Hash>(m_container.begin(), m_container.end(), "index", s);
-    }
+    assert(!m_ids.empty());
+    return m_ids.back();
   }
 }
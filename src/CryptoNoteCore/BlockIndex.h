@@ -15,54 +15,55 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
 
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/random_access_index.hpp>
+#pragma once
 
-#include "crypto/hash.h"
+#include <cstdint>
+#include <string>
 #include <vector>
 
+#include "Common/FileMappedHashMap.h"
+#include "Common/FileMappedVector.h"
+#include "crypto/hash.h"
+
 namespace CryptoNote
 {
-  class ISerializer;
-
+  // Main chain block hashes by height in a file mapped array and heights by hash in a file mapped
+  // hash map, both used as they are found on open. Crash consistency is up to the owner, see
+  // FileMappedHashMap: after a crash it calls truncate() with the last durable height.
   class BlockIndex {
 
   public:
 
-    BlockIndex() : 
-      m_index(m_container.get<1>()) {}
+    void open(const std::string& idsPath, const std::string& heightsPath);
+    void close();
+    bool isOpened() const;
+    void flush();
 
-    void pop() {
-      m_container.pop_back();
-    }
+    void pop();
 
     // returns true if new element was inserted, false if already exists
-    bool push(const Crypto::Hash& h) {
-      auto result = m_container.push_back(h);
-      return result.second;
-    }
+    bool push(const Crypto::Hash& h);
 
     bool hasBlock(const Crypto::Hash& h) const {
-      return m_index.find(h) != m_index.end();
+      return m_heights.count(h) != 0;
     }
 
     bool getBlockHeight(const Crypto::Hash& h, uint32_t& height) const {
-      auto hi = m_index.find(h);
-      if (hi == m_index.end())
+      const uint32_t* value = m_heights.find(h);
+      if (value == nullptr)
         return false;
 
-      height = static_cast<uint32_t>(std::distance(m_container.begin(), m_container.project<0>(hi)));
+      height = *value;
       return true;
     }
 
     uint32_t size() const {
-      return static_cast<uint32_t>(m_container.size());
+      return m_ids.isOpened() ? static_cast<uint32_t>(m_ids.size()) : 0;
     }
 
-    void clear() {
-      m_container.clear();
-    }
+    void clear();
+    // keeps the blocks below height
+    void truncate(uint32_t height);
 
     Crypto::Hash getBlockId(uint32_t height) const;
     std::vector<Crypto::Hash> getBlockIds(uint32_t startBlockIndex, uint32_t maxCount) const;
@@ -70,20 +71,10 @@ namespace CryptoNote
     std::vector<Crypto::Hash> buildSparseChain(const Crypto::Hash& startBlockId) const;
     Crypto::Hash getTailId() const;
 
-    void serialize(ISerializer& s);
-
   private:
 
-    typedef boost::multi_index_container <
-      Crypto::Hash,
-      boost::multi_index::indexed_by<
-        boost::multi_index::random_access<>,
-        boost::multi_index::hashed_unique<boost::multi_index::identity<Crypto::Hash>>
-      >
-    > ContainerT;
-
-    ContainerT m_container;
-    ContainerT::nth_index<1>::type& m_index;
+    Common::FileMappedVector<Crypto::Hash> m_ids;
+    Common::FileMappedHashMap<Crypto::Hash, uint32_t> m_heights;
 
   };
 }
@@ -0,0 +1,100 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "BlockMetadataIndex.h"
+
+namespace CryptoNote {
+
+void BlockMetadataIndex::open(const std::string& path) {
+  m_rows.open(path);
+  m_rows.setAutoFlush(false);
+}
+
+void BlockMetadataIndex::close() {
+  std::error_code ignore;
+  if (m_rows.isOpened()) {
+    m_rows.close(ignore);
+  }
+}
+
+bool BlockMetadataIndex::isOpened() const {
+  return m_rows.isOpened();
+}
+
+void BlockMetadataIndex::flush() {
+  m_rows.flush();
+}
+
+void BlockMetadataIndex::push(uint64_t timestamp, uint64_t blockCumulativeSize, difficulty_type cumulativeDifficulty, uint64_t alreadyGeneratedCoins, uint64_t baseTransactionAmount) {
+  uint64_t previousSum = m_rows.empty() ? 0 : m_rows.back().baseTransactionAmountSum;
+  m_rows.push_back({ timestamp, blockCumulativeSize, cumulativeDifficulty, alreadyGeneratedCoins, previousSum + baseTransactionAmount });
+}
+
+void BlockMetadataIndex::pop() {
+  assert(!m_rows.empty());
+  m_rows.pop_back();
+}
+
+void BlockMetadataIndex::clear() {
+  m_rows.clear();
+}
+
+void BlockMetadataIndex::reserve(uint32_t count) {
+  m_rows.reserve(count);
+}
+
+void BlockMetadataIndex::truncate(uint32_t height) {
+  while (m_rows.size() > height) {
+    m_rows.pop_back();
+  }
+}
+
+uint64_t BlockMetadataIndex::baseTransactionAmountSum(uint32_t startHeight, uint32_t endHeight) const {
+  assert(startHeight <= endHeight && endHeight <= m_rows.size());
+  if (startHeight == endHeight) {
+    return 0;
+  }
+
+  uint64_t before = startHeight == 0 ? 0 : m_rows[startHeight - 1].baseTransactionAmountSum;
+  return m_rows[endHeight - 1].baseTransactionAmountSum - before;
+}
+
+void BlockMetadataIndex::getTimestamps(uint32_t startHeight, uint32_t endHeight, std::vector<uint64_t>& timestamps) const {
+  assert(startHeight <= endHeight && endHeight <= m_rows.size());
+  timestamps.reserve(timestamps.size() + endHeight - startHeight);
+  for (uint32_t height = startHeight; height < endHeight; ++height) {
+    timestamps.push_back(m_rows[height].timestamp);
+  }
+}
+
+void BlockMetadataIndex::getCumulativeDifficulties(uint32_t startHeight, uint32_t endHeight, std::vector<difficulty_type>& difficulties) const {
+  assert(startHeight <= endHeight && endHeight <= m_rows.size());
+  difficulties.reserve(difficulties.size() + endHeight - startHeight);
+  for (uint32_t height = startHeight; height < endHeight; ++height) {
+    difficulties.push_back(m_rows[height].cumulativeDifficulty);
+  }
+}
+
+void BlockMetadataIndex::getBlockCumulativeSizes(uint32_t startHeight, uint32_t endHeight, std::vector<size_t>& sizes) const {
+  assert(startHeight <= endHeight && endHeight <= m_rows.size());
+  sizes.reserve(sizes.size() + endHeight - startHeight);
+  for (uint32_t height = startHeight; height < endHeight; ++height) {
+    sizes.push_back(m_rows[height].blockCumulativeSize);
+  }
+}
+
+}
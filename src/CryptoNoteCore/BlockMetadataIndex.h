@@ -0,0 +1,94 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Common/FileMappedVector.h"
+#include "CryptoNoteCore/Difficulty.h"
+
+namespace CryptoNote
+{
+  // Per-block values used by difficulty, block size and fee windows, one row per block in a file mapped
+  // array which is used as it is found on open. Coinbase amounts are kept as prefix sums so that the sum
+  // over any range is a subtraction. Crash consistency is up to the owner: after a crash it calls
+  // truncate() with the last durable height.
+  class BlockMetadataIndex {
+
+  public:
+
+    void open(const std::string& path);
+    void close();
+    bool isOpened() const;
+    void flush();
+
+    void push(uint64_t timestamp, uint64_t blockCumulativeSize, difficulty_type cumulativeDifficulty, uint64_t alreadyGeneratedCoins, uint64_t baseTransactionAmount);
+    void pop();
+    void clear();
+    void reserve(uint32_t count);
+    // keeps the rows of blocks below height
+    void truncate(uint32_t height);
+
+    uint32_t size() const {
+      return m_rows.isOpened() ? static_cast<uint32_t>(m_rows.size()) : 0;
+    }
+
+    uint64_t timestamp(uint32_t height) const {
+      assert(height < m_rows.size());
+      return m_rows[height].timestamp;
+    }
+
+    uint64_t blockCumulativeSize(uint32_t height) const {
+      assert(height < m_rows.size());
+      return m_rows[height].blockCumulativeSize;
+    }
+
+    difficulty_type cumulativeDifficulty(uint32_t height) const {
+      assert(height < m_rows.size());
+      return m_rows[height].cumulativeDifficulty;
+    }
+
+    uint64_t alreadyGeneratedCoins(uint32_t height) const {
+      assert(height < m_rows.size());
+      return m_rows[height].alreadyGeneratedCoins;
+    }
+
+    // sum of coinbase output amounts of blocks [startHeight, endHeight)
+    uint64_t baseTransactionAmountSum(uint32_t startHeight, uint32_t endHeight) const;
+
+    // append values of blocks [startHeight, endHeight) to the output vector
+    void getTimestamps(uint32_t startHeight, uint32_t endHeight, std::vector<uint64_t>& timestamps) const;
+    void getCumulativeDifficulties(uint32_t startHeight, uint32_t endHeight, std::vector<difficulty_type>& difficulties) const;
+    void getBlockCumulativeSizes(uint32_t startHeight, uint32_t endHeight, std::vector<size_t>& sizes) const;
+
+  private:
+
+    struct Row {
+      uint64_t timestamp;
+      uint64_t blockCumulativeSize;
+      difficulty_type cumulativeDifficulty;
+      uint64_t alreadyGeneratedCoins;
+      uint64_t baseTransactionAmountSum; // inclusive prefix sum
+    };
+
+    Common::FileMappedVector<Row> m_rows;
+  };
+}
@@ -24,14 +24,23 @@
 #include <numeric>
 #include <cstdio>
 #include <cmath>
+#include <map>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
 #include "Common/Math.h"
 #include "Common/int-util.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/ScopeExit.h"
 #include "Common/ShuffleGenerator.h"
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
 #include "Rpc/CoreRpcServerCommandsDefinitions.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
 #include "Serialization/BinarySerializationTools.h"
+#include "System/MemoryMappedFile.h"
 #include "CryptoNoteTools.h"
 #include "TransactionExtra.h"
 
@@ -40,6 +49,21 @@ using namespace Common;
 
 namespace {
 
+// a crash costs at most this many blocks replayed into the chain index
+const uint32_t CHAIN_INDEX_FLUSH_INTERVAL = 1000;
+
+// blocks near the tip are requested by every syncing wallet, a few sync batches worth are kept encoded
+const size_t BLOCK_BLOBS_CACHE_SIZE = 200;
+
+// tables of ring members take 2.5 KB each, enough to keep the keys of the pool and a few recent blocks
+const size_t RING_KEY_CACHE_SIZE = 8192;
+
+// ring signatures verified by a thread at once, the batch shares one field inversion
+const size_t RING_SIGNATURE_BATCH_SIZE = 16;
+
+// marks heights of the minimal fee cache that have not been computed
+const uint64_t UNKNOWN_MINIMAL_FEE = std::numeric_limits<uint64_t>::max();
+
 std::string appendPath(const std::string& path, const std::string& fileName) {
   std::string result = path;
   if (!result.empty()) {
@@ -62,172 +86,15 @@ bool operator<(const Crypto::KeyImage& keyImage1, const Crypto::KeyImage& keyIma
 }
 }
 
-#define CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER 1
 #define CURRENT_BLOCKCHAININDICES_STORAGE_ARCHIVE_VER 1
+#define CURRENT_CHAININDEX_STATE_VER 4
 
 namespace CryptoNote {
-class BlockCacheSerializer;
 class BlockchainIndicesSerializer;
 }
 
 namespace CryptoNote {
 
-template<typename K, typename V, typename Hash>
-bool serialize(google::sparse_hash_map<K, V, Hash>& value, Common::StringView name, CryptoNote::ISerializer& serializer) {
-  return serializeMap(value, name, serializer, [&value](size_t size) { value.resize(size); });
-}
-
-template<typename K, typename Hash>
-bool serialize(google::sparse_hash_set<K, Hash>& value, Common::StringView name, CryptoNote::ISerializer& serializer) {
-  size_t size = value.size();
-  if (!serializer.beginArray(size, name)) {
-    return false;
-  }
-
-  if (serializer.type() == ISerializer::OUTPUT) {
-    for (auto& key : value) {
-      serializer(const_cast<K&>(key), "");
-    }
-  } else {
-    value.resize(size);
-    while (size--) {
-      K key;
-      serializer(key, "");
-      value.insert(key);
-    }
-  }
-
-  serializer.endArray();
-  return true;
-}
-
-// custom serialization to speedup cache loading
-bool serialize(std::vector<std::pair<Blockchain::TransactionIndex, uint16_t>>& value, Common::StringView name, CryptoNote::ISerializer& s) {
-  const size_t elementSize = sizeof(std::pair<Blockchain::TransactionIndex, uint16_t>);
-  size_t size = value.size() * elementSize;
-
-  if (!s.beginArray(size, name)) {
-    return false;
-  }
-
-  if (s.type() == CryptoNote::ISerializer::INPUT) {
-    if (size % elementSize != 0) {
-      throw std::runtime_error("Invalid vector size");
-    }
-    value.resize(size / elementSize);
-  }
-
-  if (size) {
-    s.binary(value.data(), size, "");
-  }
-
-  s.endArray();
-  return true;
-}
-
-void serialize(Blockchain::TransactionIndex& value, ISerializer& s) {
-  s(value.block, "block");
-  s(value.transaction, "tx");
-}
-
-class BlockCacheSerializer {
-
-public:
-  BlockCacheSerializer(Blockchain& bs, const Crypto::Hash lastBlockHash, ILogger& logger) :
-    m_bs(bs), m_lastBlockHash(lastBlockHash), m_loaded(false), logger(logger, "BlockCacheSerializer") {
-  }
-
-  void load(const std::string& filename) {
-    try {
-      std::ifstream stdStream(filename, std::ios::binary);
-      if (!stdStream) {
-        return;
-      }
-
-      StdInputStream stream(stdStream);
-      BinaryInputStreamSerializer s(stream);
-      CryptoNote::serialize(*this, s);
-    } catch (std::exception& e) {
-      logger(WARNING) << "loading failed: " << e.what();
-    }
-  }
-
-  bool save(const std::string& filename) {
-    try {
-      std::ofstream file(filename, std::ios::binary);
-      if (!file) {
-        return false;
-      }
-
-      StdOutputStream stream(file);
-      BinaryOutputStreamSerializer s(stream);
-      CryptoNote::serialize(*this, s);
-    } catch (std::exception&) {
-      return false;
-    }
-
-    return true;
-  }
-
-  void serialize(ISerializer& s) {
-    auto start = std::chrono::steady_clock::now();
-
-    uint8_t version = CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER;
-    s(version, "version");
-
-    // ignore old versions, do rebuild
-    if (version < CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER)
-      return;
-
-    std::string operation;
-    if (s.type() == ISerializer::INPUT) {
-      operation = "- loading ";
-      Crypto::Hash blockHash;
-      s(blockHash, "last_block");
-
-      if (blockHash != m_lastBlockHash) {
-        return;
-      }
-
-    } else {
-      operation = "- saving ";
-      s(m_lastBlockHash, "last_block");
-    }
-
-    logger(INFO) << operation << "block index...";
-    s(m_bs.m_blockIndex, "block_index");
-
-    logger(INFO) << operation << "transaction map...";
-    s(m_bs.m_transactionMap, "transactions");
-
-    logger(INFO) << operation << "spent keys...";
-    s(m_bs.m_spent_keys, "spent_keys");
-
-    logger(INFO) << operation << "outputs...";
-    s(m_bs.m_outputs, "outputs");
-
-    logger(INFO) << operation << "multi-signature outputs...";
-    s(m_bs.m_multisignatureOutputs, "multisig_outputs");
-
-    auto dur = std::chrono::steady_clock::now() - start;
-
-    logger(INFO) << "Serialization time: " << std::chrono::duration_cast<std::chrono::milliseconds>(dur).count() << "ms";
-
-    m_loaded = true;
-  }
-
-  bool loaded() const {
-    return m_loaded;
-  }
-
-private:
-
-  LoggerRef logger;
-  bool m_loaded;
-  Blockchain& m_bs;
-  Crypto::Hash m_lastBlockHash;
-};
-
 class BlockchainIndicesSerializer {
 
 public:
@@ -324,12 +191,15 @@ Blockchain::Blockchain(const Currency& currency, tx_memory_pool& tx_pool, ILogge
 logger(logger, "Blockchain"),
 m_currency(currency),
 m_tx_pool(tx_pool),
+m_switchingChain(false),
 m_current_block_cumul_sz_limit(0),
 m_is_in_checkpoint_zone(false),
 m_upgradeDetectorV2(currency, m_blocks, BLOCK_MAJOR_VERSION_2, logger),
 m_upgradeDetectorV3(currency, m_blocks, BLOCK_MAJOR_VERSION_3, logger),
 m_upgradeDetectorV4(currency, m_blocks, BLOCK_MAJOR_VERSION_4, logger),
 m_upgradeDetectorV5(currency, m_blocks, BLOCK_MAJOR_VERSION_5, logger),
+m_blockBlobs(BLOCK_BLOBS_CACHE_SIZE),
+m_ringKeys(RING_KEY_CACHE_SIZE),
 m_checkpoints(logger),
 m_paymentIdIndex(blockchainIndexesEnabled),
 m_timestampIndex(blockchainIndexesEnabled),
@@ -337,9 +207,13 @@ m_generatedTransactionsIndex(blockchainIndexesEnabled),
 m_orthanBlocksIndex(blockchainIndexesEnabled),
 m_blockchainIndexesEnabled(blockchainIndexesEnabled) {
 
-  m_outputs.set_deleted_key(0);
-  Crypto::KeyImage nullImage = boost::value_initialized<decltype(nullImage)>();
-  m_spent_keys.set_deleted_key(nullImage);
+  m_chainIndexState = boost::value_initialized<ChainIndexState>();
+
+  publishTipSnapshot();
+}
+
+Blockchain::~Blockchain() {
+  stopVerificationWorkers();
 }
 
 bool Blockchain::addObserver(IBlockchainStorageObserver* observer) {
@@ -410,22 +284,151 @@ bool Blockchain::checkTransactionSize(size_t blobSize) {
 }
 
 bool Blockchain::haveTransaction(const Crypto::Hash &id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  return m_transactionMap.find(id) != m_transactionMap.end();
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  return m_transactionMap.count(id) != 0;
 }
 
 bool Blockchain::have_tx_keyimg_as_spent(const Crypto::KeyImage &key_im) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  return  m_spent_keys.find(key_im) != m_spent_keys.end();
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  return m_spent_keys.contains(key_im);
+}
+
+std::shared_ptr<const BlockchainTipSnapshot> Blockchain::getTipSnapshot() const {
+  return std::atomic_load(&m_tipSnapshot);
+}
+
+// The tip as the calling thread sees it: the published one, unless the thread is switching the chain.
+std::shared_ptr<const BlockchainTipSnapshot> Blockchain::currentTip() {
+  if (m_blockchain_lock.ownedByCurrentThread() && m_switchingChain) {
+    if (!m_switchTipSnapshot) {
+      m_switchTipSnapshot = buildTipSnapshot();
+    }
+
+    return m_switchTipSnapshot;
+  }
+
+  return getTipSnapshot();
+}
+
+// Precondition: m_blockchain_lock is locked or the object is not shared yet.
+void Blockchain::publishTipSnapshot() {
+  truncateMinimalFees();
+
+  if (m_switchingChain) {
+    m_switchTipSnapshot.reset();
+    return;
+  }
+
+  std::atomic_store(&m_tipSnapshot, buildTipSnapshot());
+}
+
+// Precondition: m_blockchain_lock is locked or the object is not shared yet.
+std::shared_ptr<const BlockchainTipSnapshot> Blockchain::buildTipSnapshot() {
+  std::shared_ptr<BlockchainTipSnapshot> snapshot = std::make_shared<BlockchainTipSnapshot>();
+  snapshot->height = static_cast<uint32_t>(m_blocks.size());
+  snapshot->transactionsCount = m_transactionMap.isOpened() ? m_transactionMap.size() : 0;
+  if (m_blocks.empty()) {
+    snapshot->tailId = NULL_HASH;
+    snapshot->cumulativeDifficulty = 0;
+    snapshot->alreadyGeneratedCoins = 0;
+    snapshot->minimalFee = 0;
+    snapshot->tailTimestamp = 0;
+    snapshot->tailReward = 0;
+    snapshot->tailDifficulty = 0;
+    snapshot->tailMajorVersion = 0;
+    snapshot->tailMinorVersion = 0;
+  } else {
+    const BlockEntryHeader& tail = m_blocks.backHeader();
+    snapshot->tailId = m_blockIndex.getTailId();
+    snapshot->cumulativeDifficulty = tail.cumulativeDifficulty;
+    snapshot->alreadyGeneratedCoins = tail.alreadyGeneratedCoins;
+    snapshot->minimalFee = getMinimalFee(snapshot->height - 1);
+    snapshot->tailTimestamp = tail.timestamp;
+    snapshot->tailReward = tail.baseTransactionAmount;
+    snapshot->tailDifficulty = m_blocks.size() == 1 ? tail.cumulativeDifficulty :
+      tail.cumulativeDifficulty - m_blocks.header(snapshot->height - 2).cumulativeDifficulty;
+    snapshot->tailMajorVersion = tail.majorVersion;
+    snapshot->tailMinorVersion = tail.minorVersion;
+  }
+
+  // depends on the upgrade detectors, which are updated after the block itself
+  snapshot->nextDifficulty = computeDifficultyForNextBlock();
+
+  return snapshot;
+}
+
+// Precondition: m_blockchain_lock is locked or the object is not shared yet.
+void Blockchain::truncateMinimalFees() {
+  std::lock_guard<std::mutex> lk(m_minimalFeesLock);
+  // below a month of blocks the averaging windows of getMinimalFee() are cut short by the chain length
+  if (m_blocks.size() < m_currency.expectedNumberOfBlocksPerDay() * 7 * 4) {
+    m_minimalFees.clear();
+  } else if (m_minimalFees.size() > m_blocks.size()) {
+    m_minimalFees.resize(m_blocks.size());
+  }
+}
+
+Blockchain::BlockEntryHeader Blockchain::makeBlockEntryHeader(const BlockEntry& block, const Crypto::Hash& blockHash) {
+  BlockEntryHeader header;
+  header.hash = blockHash;
+  header.timestamp = block.bl.timestamp;
+  header.blockCumulativeSize = block.block_cumulative_size;
+  header.cumulativeDifficulty = block.cumulative_difficulty;
+  header.alreadyGeneratedCoins = block.already_generated_coins;
+  header.baseTransactionAmount = get_outs_money_amount(block.bl.baseTransaction);
+  header.transactionsCount = static_cast<uint32_t>(block.transactions.size());
+  header.majorVersion = block.bl.majorVersion;
+  header.minorVersion = block.bl.minorVersion;
+  return header;
+}
+
+// Moves blocks from the SwappedVector files used by previous versions into the block store.
+// The legacy files are left in place, they are not read once the block store is populated.
+bool Blockchain::importLegacyBlocks(const std::string& config_folder) {
+  std::string blocksFileName = appendPath(config_folder, m_currency.blocksFileName());
+  std::string blockIndexesFileName = appendPath(config_folder, m_currency.blockIndexesFileName());
+  if (!boost::filesystem::exists(blocksFileName) || !boost::filesystem::exists(blockIndexesFileName)) {
+    return true;
+  }
+
+  SwappedVector<BlockEntry> legacyBlocks;
+  if (!legacyBlocks.open(blocksFileName, blockIndexesFileName, 1024)) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open " << blocksFileName;
+    return false;
+  }
+
+  if (legacyBlocks.empty()) {
+    return true;
+  }
+
+  logger(INFO, BRIGHT_WHITE) << "Importing " << legacyBlocks.size() << " blocks from " << blocksFileName << " into block store...";
+  try {
+    for (uint64_t i = 0; i < legacyBlocks.size(); ++i) {
+      if (i % 10000 == 0) {
+        logger(INFO, BRIGHT_WHITE) << "Height " << i << " of " << legacyBlocks.size();
+      }
+
+      const BlockEntry& block = legacyBlocks[i];
+      m_blocks.push_back(block, makeBlockEntryHeader(block, get_block_hash(block.bl)));
+    }
+
+    m_blocks.flush();
+  } catch (std::exception& e) {
+    logger(ERROR, BRIGHT_RED) << "Failed to import legacy blocks: " << e.what();
+    m_blocks.clear();
+    return false;
+  }
+
+  return true;
 }
 
 uint32_t Blockchain::getCurrentBlockchainHeight() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  return static_cast<uint32_t>(m_blocks.size());
+  return currentTip()->height;
 }
 
 bool Blockchain::init(const std::string& config_folder, bool load_existing) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  startVerificationWorkers();
   if (!config_folder.empty() && !Tools::create_directories_if_necessary(config_folder)) {
     logger(ERROR, BRIGHT_RED) << "Failed to create data directory: " << m_config_folder;
     return false;
@@ -433,25 +436,34 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
 
   m_config_folder = config_folder;
 
-  if (!m_blocks.open(appendPath(config_folder, m_currency.blocksFileName()), appendPath(config_folder, m_currency.blockIndexesFileName()), 1024)) {
+  if (!m_blocks.open(appendPath(config_folder, m_currency.blockStoreFileName()), appendPath(config_folder, m_currency.blockStoreIndexFileName()))) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open block store";
+    return false;
+  }
+
+  if (load_existing && m_blocks.empty() && !importLegacyBlocks(config_folder)) {
+    return false;
+  }
+
+  if (!openChainIndex()) {
     return false;
   }
 
   if (load_existing && !m_blocks.empty()) {
     logger(INFO, BRIGHT_WHITE) << "Loading blockchain...";
-    BlockCacheSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
-    loader.load(appendPath(config_folder, m_currency.blocksCacheFileName()));
-
-    if (!loader.loaded()) {
-      logger(WARNING, BRIGHT_YELLOW) << "No actual blockchain cache found, rebuilding internal structures...";
-      rebuildCache();
+    if (!loadChainIndex()) {
+      return false;
     }
 
+    publishTipSnapshot();
+
     if (m_blockchainIndexesEnabled) {
       loadBlockchainIndices();
     }
   } else {
     m_blocks.clear();
+    clearChainIndex();
+    publishTipSnapshot();
   }
 
   if (m_blocks.empty()) {
@@ -489,25 +501,25 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
   if (!checkUpgradeHeight(m_upgradeDetectorV2)) {
     uint32_t upgradeHeight = m_upgradeDetectorV2.upgradeHeight();
     assert(upgradeHeight != UpgradeDetectorBase::UNDEF_HEIGHT);
-    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1].bl.majorVersion) <<
+    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks.header(upgradeHeight + 1).majorVersion) <<
       " expected=" << static_cast<int>(m_upgradeDetectorV2.targetVersion()) << ". Rollback blockchain to height=" << upgradeHeight;
     rollbackBlockchainTo(upgradeHeight);
     reinitUpgradeDetectors = true;
   } else if (!checkUpgradeHeight(m_upgradeDetectorV3)) {
     uint32_t upgradeHeight = m_upgradeDetectorV3.upgradeHeight();
-    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1].bl.majorVersion) <<
+    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks.header(upgradeHeight + 1).majorVersion) <<
       " expected=" << static_cast<int>(m_upgradeDetectorV3.targetVersion()) << ". Rollback blockchain to height=" << upgradeHeight;
     rollbackBlockchainTo(upgradeHeight);
     reinitUpgradeDetectors = true;
   } else if (!checkUpgradeHeight(m_upgradeDetectorV4)) {
     uint32_t upgradeHeight = m_upgradeDetectorV4.upgradeHeight();
-    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1].bl.majorVersion) <<
+    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks.header(upgradeHeight + 1).majorVersion) <<
       " expected=" << static_cast<int>(m_upgradeDetectorV4.targetVersion()) << ". Rollback blockchain to height=" << upgradeHeight;
     rollbackBlockchainTo(upgradeHeight);
     reinitUpgradeDetectors = true;
 	} else if (!checkUpgradeHeight(m_upgradeDetectorV5)) {
     uint32_t upgradeHeight = m_upgradeDetectorV5.upgradeHeight();
-    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1].bl.majorVersion) <<
+    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks.header(upgradeHeight + 1).majorVersion) <<
       " expected=" << static_cast<int>(m_upgradeDetectorV5.targetVersion()) << ". Rollback blockchain to height=" << upgradeHeight;
     rollbackBlockchainTo(upgradeHeight);
     reinitUpgradeDetectors = true;
@@ -519,9 +531,10 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
   }
 
   update_next_cumulative_size_limit();
+  publishTipSnapshot();
 
-  uint64_t timestamp_diff = time(NULL) - m_blocks.back().bl.timestamp;
-  if (!m_blocks.back().bl.timestamp) {
+  uint64_t timestamp_diff = time(NULL) - m_blocks.backHeader().timestamp;
+  if (!m_blocks.backHeader().timestamp) {
     timestamp_diff = time(NULL) - 1341378000;
   }
 
@@ -534,69 +547,350 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
 
 void Blockchain::rebuildCache() {
   std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
-  m_blockIndex.clear();
-  m_transactionMap.clear();
-  m_spent_keys.clear();
-  m_outputs.clear();
-  m_multisignatureOutputs.clear();
+  clearChainIndex();
+  m_blockMetadata.reserve(static_cast<uint32_t>(m_blocks.size()));
   for (uint32_t b = 0; b < m_blocks.size(); ++b) {
     if (b % 1000 == 0) {
       logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
     }
-    const BlockEntry& block = m_blocks[b];
-    Crypto::Hash blockHash = get_block_hash(block.bl);
-    m_blockIndex.push(blockHash);
-    for (uint16_t t = 0; t < block.transactions.size(); ++t) {
-      const TransactionEntry& transaction = block.transactions[t];
-      Crypto::Hash transactionHash = getObjectHash(transaction.tx);
-      TransactionIndex transactionIndex = { b, t };
-      m_transactionMap.insert(std::make_pair(transactionHash, transactionIndex));
-
-      // process inputs
-      for (auto& i : transaction.tx.inputs) {
-        if (i.type() == typeid(KeyInput)) {
-          m_spent_keys.insert(::boost::get<KeyInput>(i).keyImage);
-        } else if (i.type() == typeid(MultisignatureInput)) {
-          auto out = ::boost::get<MultisignatureInput>(i);
-          m_multisignatureOutputs[out.amount][out.outputIndex].isUsed = true;
-        }
+
+    indexBlock(b);
+  }
+
+  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
+  logger(INFO, BRIGHT_WHITE) << "Rebuilding internal structures took: " << duration.count();
+}
+
+std::string Blockchain::chainIndexFileName(const char* suffix) const {
+  return appendPath(m_config_folder, m_currency.chainIndexFileName() + suffix);
+}
+
+bool Blockchain::openChainIndex() {
+  for (int attempt = 0;; ++attempt) {
+    try {
+      m_blockIndex.open(chainIndexFileName(".blockids"), chainIndexFileName(".blockheights"));
+      m_blockMetadata.open(chainIndexFileName(".blockmetadata"));
+      m_transactionMap.open(chainIndexFileName(".transactions"));
+      m_spent_keys.open(chainIndexFileName(".spentkeys"));
+      m_randomOutputs.open(chainIndexFileName(".outputs"), chainIndexFileName(".outputpositions"));
+      m_multisignatureOutputsJournal.open(chainIndexFileName(".msigoutputs"));
+      m_multisignatureOutputsJournal.setAutoFlush(false);
+      m_multisignatureOutputs.open(chainIndexFileName(".msigoutputpositions"));
+      break;
+    } catch (std::exception& e) {
+      closeChainIndex();
+      if (attempt > 0) {
+        logger(ERROR, BRIGHT_RED) << "Failed to open chain index: " << e.what();
+        return false;
       }
 
-      // process outputs
-      for (uint16_t o = 0; o < transaction.tx.outputs.size(); ++o) {
-        const auto& out = transaction.tx.outputs[o];
-        if (out.target.type() == typeid(KeyOutput)) {
-          m_outputs[out.amount].push_back(std::make_pair<>(transactionIndex, o));
-        } else if (out.target.type() == typeid(MultisignatureOutput)) {
-          MultisignatureOutputUsage usage = { transactionIndex, o, false };
-          m_multisignatureOutputs[out.amount].push_back(usage);
-        }
+      // damaged files are recreated, the index is then rebuilt from the block store
+      logger(WARNING, BRIGHT_YELLOW) << "Failed to open chain index, recreating it: " << e.what();
+      boost::system::error_code ignore;
+      for (const char* suffix : { ".blockids", ".blockheights", ".blockmetadata", ".transactions", ".spentkeys", ".spentkeys.buckets",
+          ".spentkeys.bloom", ".outputs", ".outputpositions", ".msigoutputs", ".msigoutputpositions", ".state" }) {
+        boost::filesystem::remove(chainIndexFileName(suffix), ignore);
+        boost::filesystem::remove(chainIndexFileName(suffix) + ".bak", ignore);
       }
     }
   }
 
+  m_chainIndexState = boost::value_initialized<ChainIndexState>();
+  System::MemoryMappedFile stateFile;
+  std::error_code ec;
+  stateFile.open(chainIndexFileName(".state"), ec);
+  if (!ec && stateFile.size() == sizeof(ChainIndexState)) {
+    std::memcpy(&m_chainIndexState, stateFile.data(), sizeof(ChainIndexState));
+  }
+
+  return true;
+}
+
+void Blockchain::closeChainIndex() {
+  std::error_code ignore;
+  if (m_blockIndex.isOpened()) {
+    m_blockIndex.close();
+  }
+
+  if (m_blockMetadata.isOpened()) {
+    m_blockMetadata.close();
+  }
+
+  if (m_transactionMap.isOpened()) {
+    m_transactionMap.close();
+  }
+
+  if (m_spent_keys.isOpened()) {
+    m_spent_keys.close();
+  }
+
+  if (m_randomOutputs.isOpened()) {
+    m_randomOutputs.close();
+  }
+
+  if (m_multisignatureOutputsJournal.isOpened()) {
+    m_multisignatureOutputsJournal.close(ignore);
+  }
+
+  if (m_multisignatureOutputs.isOpened()) {
+    m_multisignatureOutputs.close();
+  }
+}
+
+void Blockchain::clearChainIndex() {
+  m_chainIndexState = boost::value_initialized<ChainIndexState>();
+  saveChainIndexState();
+
+  m_blockIndex.clear();
+  m_blockMetadata.clear();
+  m_transactionMap.clear();
+  m_spent_keys.clear();
+  m_randomOutputs.clear();
+  m_multisignatureOutputsJournal.clear();
+  m_multisignatureOutputs.clear();
+}
+
+// Brings the chain index in line with the block store. Every part of it lives in a file mapped file
+// and is used as it is found: after a clean shutdown nothing is read or replayed, after a crash only
+// the entries above the last flushed height are dropped and the blocks from there on are replayed.
+bool Blockchain::loadChainIndex() {
+  uint32_t height = m_chainIndexState.height;
+  if (m_chainIndexState.version != CURRENT_CHAININDEX_STATE_VER || height == 0 || height > m_blocks.size() ||
+      m_blocks.header(height - 1).hash != m_chainIndexState.tailId || m_blockIndex.size() < height || m_blockMetadata.size() < height) {
+    logger(WARNING, BRIGHT_YELLOW) << "No actual chain index found, rebuilding internal structures...";
+    rebuildCache();
+    return flushChainIndex();
+  }
+
+  std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+  if (!m_chainIndexState.clean) {
+    logger(WARNING, BRIGHT_YELLOW) << "Chain index was not closed properly, replaying blocks from height " << height << "...";
+    verifyBlockStoreTail(height);
+    recoverChainIndex();
+  }
+
+  for (uint32_t b = height; b < m_blocks.size(); ++b) {
+    indexBlock(b);
+  }
+
   std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
-  logger(INFO, BRIGHT_WHITE) << "Rebuilding internal structures took: " << duration.count();
+  logger(INFO, BRIGHT_WHITE) << "Loading chain index took: " << duration.count();
+
+  return flushChainIndex();
 }
 
-bool Blockchain::storeCache() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+// Blocks above the last flushed height may be partially written after a crash.
+// The block store is cut at the first block which does not decode or does not link to its parent.
+void Blockchain::verifyBlockStoreTail(uint32_t height) {
+  for (uint32_t b = height; b < m_blocks.size(); ++b) {
+    bool valid = false;
+    try {
+      const BlockEntry& block = m_blocks[b];
+      const BlockEntryHeader& header = m_blocks.header(b);
+      valid = block.height == b && block.transactions.size() == block.bl.transactionHashes.size() + 1 &&
+        block.bl.previousBlockHash == m_blocks.header(b - 1).hash && get_block_hash(block.bl) == header.hash;
+      for (size_t t = 1; valid && t < block.transactions.size(); ++t) {
+        valid = getObjectHash(block.transactions[t].tx) == block.bl.transactionHashes[t - 1];
+      }
+    } catch (std::exception&) {
+    }
 
-  logger(INFO, BRIGHT_WHITE) << "Saving blockchain at height " << m_blocks.size() - 1 << "...";
-  BlockCacheSerializer ser(*this, getTailId(), logger.getLogger());
-  if (!ser.save(appendPath(m_config_folder, m_currency.blocksCacheFileName()))) {
-    logger(ERROR, BRIGHT_RED) << "Failed to save blockchain cache";
+    if (!valid) {
+      logger(WARNING, BRIGHT_YELLOW) << "Block store is damaged at height " << b << ", dropping " << m_blocks.size() - b << " blocks";
+      while (m_blocks.size() > b) {
+        m_blocks.pop_back();
+      }
+
+      break;
+    }
+  }
+}
+
+// Drops every chain index entry written for blocks at or above the flushed height
+void Blockchain::recoverChainIndex() {
+  uint32_t height = m_chainIndexState.height;
+  m_blockIndex.truncate(height);
+  m_blockMetadata.truncate(height);
+  m_transactionMap.eraseIf([height](const Crypto::Hash&, const TransactionIndex& index) { return index.block >= height; });
+  m_spent_keys.truncate(m_chainIndexState.keyImagesCount);
+  m_randomOutputs.truncate(m_chainIndexState.outputsCount, height);
+
+  while (m_multisignatureOutputsJournal.size() > m_chainIndexState.multisignatureOutputsCount ||
+      (!m_multisignatureOutputsJournal.empty() && m_multisignatureOutputsJournal.back().block >= height)) {
+    m_multisignatureOutputsJournal.pop_back();
+  }
+
+  m_multisignatureOutputs.truncate(m_multisignatureOutputsJournal.size());
+  for (uint64_t i = 0; i < m_multisignatureOutputsJournal.size(); ++i) {
+    MultisignatureOutputRecord& record = m_multisignatureOutputsJournal[i];
+    if (record.isUsed && record.usedHeight >= height) {
+      record.isUsed = 0;
+    }
+  }
+}
+
+// Adds a block of the block store to the chain index
+void Blockchain::indexBlock(uint32_t height) {
+  markChainIndexDirty();
+
+  const BlockEntryHeader& header = m_blocks.header(height);
+  m_blockIndex.push(header.hash);
+  m_blockMetadata.push(header.timestamp, header.blockCumulativeSize, header.cumulativeDifficulty, header.alreadyGeneratedCoins, header.baseTransactionAmount);
+  indexBlockTransactions(height);
+}
+
+void Blockchain::indexBlockTransactions(uint32_t height) {
+  markChainIndexDirty();
+
+  const BlockEntry& block = m_blocks[height];
+  for (uint16_t t = 0; t < block.transactions.size(); ++t) {
+    const TransactionEntry& transaction = block.transactions[t];
+    TransactionIndex transactionIndex = { height, t };
+    m_transactionMap.insert(getObjectHash(transaction.tx), transactionIndex);
+
+    // process inputs
+    for (auto& i : transaction.tx.inputs) {
+      if (i.type() == typeid(KeyInput)) {
+        m_spent_keys.insert(::boost::get<KeyInput>(i).keyImage);
+      } else if (i.type() == typeid(MultisignatureInput)) {
+        const MultisignatureInput& in = ::boost::get<MultisignatureInput>(i);
+        MultisignatureOutputRecord* output = findMultisignatureOutput(in.amount, in.outputIndex);
+        assert(output != nullptr);
+        setMultisignatureOutputUsed(*output, true, height);
+      }
+    }
+
+    // process outputs
+    for (uint16_t o = 0; o < transaction.tx.outputs.size(); ++o) {
+      const auto& out = transaction.tx.outputs[o];
+      if (out.target.type() == typeid(KeyOutput)) {
+        pushKeyOutput(transaction.tx, transactionIndex, o);
+      } else if (out.target.type() == typeid(MultisignatureOutput)) {
+        pushMultisignatureOutput(out.amount, transactionIndex, o);
+      }
+    }
+  }
+}
+
+// Makes the block store and the chain index durable up to the current height
+bool Blockchain::flushChainIndex() {
+  try {
+    m_blocks.flush();
+    m_blockIndex.flush();
+    m_blockMetadata.flush();
+    m_transactionMap.flush();
+    m_spent_keys.flush();
+    m_randomOutputs.flush();
+    m_multisignatureOutputsJournal.flush();
+    m_multisignatureOutputs.flush();
+  } catch (std::exception& e) {
+    logger(ERROR, BRIGHT_RED) << "Failed to flush chain index: " << e.what();
+    return false;
+  }
+
+  m_chainIndexState.version = CURRENT_CHAININDEX_STATE_VER;
+  m_chainIndexState.height = static_cast<uint32_t>(m_blocks.size());
+  m_chainIndexState.tailId = m_blocks.empty() ? NULL_HASH : m_blocks.backHeader().hash;
+  m_chainIndexState.outputsCount = m_randomOutputs.journalSize();
+  m_chainIndexState.multisignatureOutputsCount = m_multisignatureOutputsJournal.size();
+  m_chainIndexState.keyImagesCount = m_spent_keys.size();
+  m_chainIndexState.clean = 1;
+  return saveChainIndexState();
+}
+
+bool Blockchain::saveChainIndexState() {
+  std::string stateFileName = chainIndexFileName(".state");
+  try {
+    System::MemoryMappedFile stateFile;
+    stateFile.create(stateFileName + ".tmp", sizeof(ChainIndexState), true);
+    std::memcpy(stateFile.data(), &m_chainIndexState, sizeof(ChainIndexState));
+    stateFile.flush(stateFile.data(), stateFile.size());
+    stateFile.rename(stateFileName);
+  } catch (std::exception& e) {
+    logger(ERROR, BRIGHT_RED) << "Failed to save chain index state: " << e.what();
     return false;
   }
 
   return true;
 }
 
+// Called before the first change of the chain index after a flush
+void Blockchain::markChainIndexDirty() {
+  if (m_chainIndexState.clean) {
+    m_chainIndexState.clean = 0;
+    saveChainIndexState();
+  }
+}
+
+// Called before entries of the block are removed from the chain index
+void Blockchain::lowerChainIndexHeight(const BlockEntry& block) {
+  uint32_t height = block.height;
+  if (height >= m_chainIndexState.height) {
+    return;
+  }
+
+  // spent key images of the block are the last ones in the store
+  uint64_t blockKeyImages = 0;
+  for (const TransactionEntry& transaction : block.transactions) {
+    for (const auto& input : transaction.tx.inputs) {
+      if (input.type() == typeid(KeyInput)) {
+        ++blockKeyImages;
+      }
+    }
+  }
+
+  // journal records past the flushed counts belong to blocks above the old height and may be torn
+  m_chainIndexState.height = height;
+  m_chainIndexState.tailId = height == 0 ? NULL_HASH : m_blocks.header(height - 1).hash;
+  m_chainIndexState.outputsCount = std::min(m_chainIndexState.outputsCount, m_randomOutputs.journalSize());
+  m_chainIndexState.multisignatureOutputsCount = std::min(m_chainIndexState.multisignatureOutputsCount, m_multisignatureOutputsJournal.size());
+  m_chainIndexState.keyImagesCount = std::min(m_chainIndexState.keyImagesCount, m_spent_keys.size() - std::min(blockKeyImages, m_spent_keys.size()));
+  m_chainIndexState.clean = 0;
+  saveChainIndexState();
+}
+
+uint32_t Blockchain::pushKeyOutput(const Transaction& transaction, TransactionIndex transactionIndex, uint16_t outputIndex) {
+  const TransactionOutput& output = transaction.outputs[outputIndex];
+  const Crypto::PublicKey& key = boost::get<KeyOutput>(output.target).key;
+  RandomOutputsIndex::Output record = { output.amount, transaction.unlockTime, key, transactionIndex.block, transactionIndex.transaction, outputIndex };
+  return static_cast<uint32_t>(m_randomOutputs.push(record));
+}
+
+uint32_t Blockchain::pushMultisignatureOutput(uint64_t amount, TransactionIndex transactionIndex, uint16_t outputIndex) {
+  MultisignatureOutputRecord record = { amount, transactionIndex.block, transactionIndex.transaction, outputIndex, 0, 0 };
+  m_multisignatureOutputsJournal.push_back(record);
+  return static_cast<uint32_t>(m_multisignatureOutputs.push(amount, m_multisignatureOutputsJournal.size() - 1));
+}
+
+Blockchain::MultisignatureOutputRecord* Blockchain::findMultisignatureOutput(uint64_t amount, uint32_t index) {
+  uint64_t position;
+  if (!m_multisignatureOutputs.find(amount, index, position)) {
+    return nullptr;
+  }
+
+  return &m_multisignatureOutputsJournal[position];
+}
+
+void Blockchain::setMultisignatureOutputUsed(MultisignatureOutputRecord& output, bool isUsed, uint32_t height) {
+  output.usedHeight = height;
+  output.isUsed = isUsed ? 1 : 0;
+}
+
+bool Blockchain::storeCache() {
+  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+
+  logger(INFO, BRIGHT_WHITE) << "Saving blockchain at height " << m_blocks.size() - 1 << "...";
+  return flushChainIndex();
+}
+
 bool Blockchain::deinit() {
   storeCache();
   if (m_blockchainIndexesEnabled) {
     storeBlockchainIndices();
   }
+  m_blocks.close();
+  closeChainIndex();
+  stopVerificationWorkers();
   assert(m_messageQueueList.empty());
   return true;
 }
@@ -604,43 +898,40 @@ bool Blockchain::deinit() {
 bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   m_blocks.clear();
-  m_blockIndex.clear();
-  m_transactionMap.clear();
-
-  m_spent_keys.clear();
+  clearChainIndex();
   m_alternative_chains.clear();
-  m_outputs.clear();
 
   m_paymentIdIndex.clear();
   m_timestampIndex.clear();
   m_generatedTransactionsIndex.clear();
   m_orthanBlocksIndex.clear();
 
+  publishTipSnapshot();
+
   block_verification_context bvc = boost::value_initialized<block_verification_context>();
   addNewBlock(b, bvc);
   return bvc.m_added_to_main_chain && !bvc.m_verification_failed;
 }
 
 Crypto::Hash Blockchain::getTailId(uint32_t& height) {
-  assert(!m_blocks.empty());
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  height = getCurrentBlockchainHeight() - 1;
-  return getTailId();
+  std::shared_ptr<const BlockchainTipSnapshot> tip = currentTip();
+  assert(tip->height > 0);
+  height = tip->height - 1;
+  return tip->tailId;
 }
 
 Crypto::Hash Blockchain::getTailId() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  return m_blocks.empty() ? NULL_HASH : m_blockIndex.getTailId();
+  return currentTip()->tailId;
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   assert(m_blockIndex.size() != 0);
   return doBuildSparseChain(m_blockIndex.getTailId());
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain(const Crypto::Hash& startBlockId) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   assert(haveBlock(startBlockId));
   return doBuildSparseChain(startBlockId);
 }
@@ -677,13 +968,13 @@ std::vector<Crypto::Hash> Blockchain::doBuildSparseChain(const Crypto::Hash& sta
 }
 
 Crypto::Hash Blockchain::getBlockIdByHeight(uint32_t height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   assert(height < m_blockIndex.size());
   return m_blockIndex.getBlockId(height);
 }
 
 bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   uint32_t height = 0;
 
@@ -704,12 +995,16 @@ bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
 }
 
 bool Blockchain::getBlockHeight(const Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lock(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lock(m_blockchain_lock);
   return m_blockIndex.getBlockHeight(blockId, blockHeight);
 }
 
 difficulty_type Blockchain::getDifficultyForNextBlock() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  return currentTip()->nextDifficulty;
+}
+
+difficulty_type Blockchain::computeDifficultyForNextBlock() {
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   std::vector<uint64_t> timestamps;
   std::vector<difficulty_type> cumulative_difficulties;
   uint8_t BlockMajorVersion = getBlockMajorVersionForHeight(static_cast<uint32_t>(m_blocks.size()));
@@ -719,31 +1014,40 @@ difficulty_type Blockchain::getDifficultyForNextBlock() {
   if (offset == 0) {
     ++offset;
   }
-  for (; offset < m_blocks.size(); offset++) {
-    timestamps.push_back(m_blocks[offset].bl.timestamp);
-    cumulative_difficulties.push_back(m_blocks[offset].cumulative_difficulty);
+  uint32_t height = m_blockMetadata.size();
+  if (offset < height) {
+    m_blockMetadata.getTimestamps(static_cast<uint32_t>(offset), height, timestamps);
+    m_blockMetadata.getCumulativeDifficulties(static_cast<uint32_t>(offset), height, cumulative_difficulties);
   }
   return m_currency.nextDifficulty(static_cast<uint32_t>(m_blocks.size()), BlockMajorVersion, timestamps, cumulative_difficulties);
 }
 
 difficulty_type Blockchain::getAvgDifficultyForHeight(uint32_t height, size_t window) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   size_t offset;
   offset = height - std::min(height, std::min<uint32_t>(m_blocks.size(), window));
   if (offset == 0) {
     ++offset;
   }
-  difficulty_type cumulDiffForPeriod = m_blocks[height].cumulative_difficulty - m_blocks[offset].cumulative_difficulty;
+  difficulty_type cumulDiffForPeriod = m_blockMetadata.cumulativeDifficulty(height) - m_blockMetadata.cumulativeDifficulty(static_cast<uint32_t>(offset));
   return cumulDiffForPeriod / std::min<uint32_t>(m_blocks.size(), window);
 }
 
 uint64_t Blockchain::getBlockTimestamp(uint32_t height) {
-  assert(height < m_blocks.size());
-  return m_blocks[height].bl.timestamp;
+  assert(height < m_blockMetadata.size());
+  return m_blockMetadata.timestamp(height);
 }
 
 uint64_t Blockchain::getMinimalFee(uint32_t height) {
-	std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+	{
+		std::lock_guard<std::mutex> lk(m_minimalFeesLock);
+		if (height < m_minimalFees.size() && m_minimalFees[height] != UNKNOWN_MINIMAL_FEE) {
+			return m_minimalFees[height];
+		}
+	}
+
+	boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+	uint32_t requestedHeight = height;
 
 	if (height == 0 || m_blocks.size() <= 1) {
 	    return 0;
@@ -755,6 +1059,9 @@ uint64_t Blockchain::getMinimalFee(uint32_t height) {
 	if (height < 3) {
 		height = 3;
 	}
+	if (height >= m_blockMetadata.size()) {
+		return 0;
+	}
 	size_t window = std::min(height, std::min<uint32_t>(m_blocks.size(), m_currency.expectedNumberOfBlocksPerDay()));
 	if (window == 0) {
 		++window;
@@ -768,7 +1075,7 @@ uint64_t Blockchain::getMinimalFee(uint32_t height) {
 	uint64_t avgDifficultyCurrent = getAvgDifficultyForHeight(height, window * 7 * 4);
 	
 	// historical reference moving average difficulty
-	uint64_t avgDifficultyHistorical = m_blocks[height].cumulative_difficulty / height;
+	uint64_t avgDifficultyHistorical = m_blockMetadata.cumulativeDifficulty(height) / height;
 
 	/*
 	* Total reward with transaction fees is used as the level of usage metric
@@ -776,27 +1083,28 @@ uint64_t Blockchain::getMinimalFee(uint32_t height) {
 	*/
 
 	// calculate average reward for ~last day
-	std::vector<uint64_t> rewards;
-	rewards.reserve(window);
-	for (; offset < height; offset++) {
-		rewards.push_back(get_outs_money_amount(m_blocks[offset].bl.baseTransaction));
-	}
-	uint64_t avgRewardCurrent = std::accumulate(rewards.begin(), rewards.end(), 0ULL) / rewards.size();
-	rewards.shrink_to_fit();
+	uint64_t avgRewardCurrent = m_blockMetadata.baseTransactionAmountSum(static_cast<uint32_t>(offset), height) / (height - offset);
 
 	// historical reference moving average reward
-	uint64_t avgRewardHistorical = m_blocks[height].already_generated_coins / height;
+	uint64_t avgRewardHistorical = m_blockMetadata.alreadyGeneratedCoins(height) / height;
+
+	uint64_t fee = m_currency.getMinimalFee(avgDifficultyCurrent, avgRewardCurrent, avgDifficultyHistorical, avgRewardHistorical, height);
+
+	// heights past the tail are clamped to it, their fee changes with every block
+	if (requestedHeight < m_blocks.size() && m_blocks.size() >= m_currency.expectedNumberOfBlocksPerDay() * 7 * 4) {
+		std::lock_guard<std::mutex> feesLock(m_minimalFeesLock);
+		if (m_minimalFees.size() <= requestedHeight) {
+			m_minimalFees.resize(requestedHeight + 1, UNKNOWN_MINIMAL_FEE);
+		}
+
+		m_minimalFees[requestedHeight] = fee;
+	}
 
-	return m_currency.getMinimalFee(avgDifficultyCurrent, avgRewardCurrent, avgDifficultyHistorical, avgRewardHistorical, height);
+	return fee;
 }
 
 uint64_t Blockchain::getCoinsInCirculation() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  if (m_blocks.empty()) {
-    return 0;
-  } else {
-    return m_blocks.back().already_generated_coins;
-  }
+  return currentTip()->alreadyGeneratedCoins;
 }
 
 uint8_t Blockchain::getBlockMajorVersionForHeight(uint32_t height) const {
@@ -940,6 +1248,16 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
     }
   }
 
+  // readers keep the old tip until the switch commits or is rolled back, then it is published once
+  assert(!m_switchingChain);
+  m_switchingChain = true;
+  auto publishSwitchedTip = [this] {
+    m_switchingChain = false;
+    m_switchTipSnapshot.reset();
+    publishTipSnapshot();
+  };
+  Tools::ScopeExit publishOnFailure(publishSwitchedTip);
+
   //disconnecting old chain
   std::list<Block> disconnected_chain;
   for (size_t i = m_blocks.size() - 1; i >= split_height; i--) {
@@ -996,6 +1314,9 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
     m_alternative_chains.erase(ch_ent);
   }
 
+  publishOnFailure.cancel();
+  publishSwitchedTip();
+
   sendMessage(BlockchainMessage(ChainSwitchMessage(std::move(blocksFromCommonRoot))));
 
   logger(INFO, BRIGHT_GREEN) << "REORGANIZE SUCCESS! on height: " << split_height << ", new blockchain size: " << m_blocks.size();
@@ -1012,7 +1333,7 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
   // if the alt chain isn't long enough to calculate the difficulty target
   // based on its blocks alone, need to get more blocks from the main chain
   if (alt_chain.size() < m_currency.difficultyBlocksCountByBlockVersion(BlockMajorVersion)) {
-    std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+    boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
     size_t main_chain_stop_offset = alt_chain.size() ? alt_chain.front()->second.height : bei.height;
     size_t main_chain_count = m_currency.difficultyBlocksCountByBlockVersion(BlockMajorVersion) - std::min(m_currency.difficultyBlocksCountByBlockVersion(BlockMajorVersion), alt_chain.size());
     main_chain_count = std::min(main_chain_count, main_chain_stop_offset);
@@ -1022,9 +1343,9 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
       ++main_chain_start_offset; //skip genesis block
 
     // get difficulties and timestamps from relevant main chain blocks
-    for (; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset) {
-      timestamps.push_back(m_blocks[main_chain_start_offset].bl.timestamp);
-      cumulative_difficulties.push_back(m_blocks[main_chain_start_offset].cumulative_difficulty);
+    if (main_chain_start_offset < main_chain_stop_offset) {
+      m_blockMetadata.getTimestamps(static_cast<uint32_t>(main_chain_start_offset), static_cast<uint32_t>(main_chain_stop_offset), timestamps);
+      m_blockMetadata.getCumulativeDifficulties(static_cast<uint32_t>(main_chain_start_offset), static_cast<uint32_t>(main_chain_stop_offset), cumulative_difficulties);
     }
 
     // make sure we haven't accidentally grabbed too many blocks... ???
@@ -1131,7 +1452,7 @@ bool Blockchain::validate_miner_transaction(const Block& b, uint32_t height, siz
 }
 
 bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (!(from_height < m_blocks.size())) {
     logger(ERROR, BRIGHT_RED)
       << "Internal error: get_backward_blocks_sizes called with from_height="
@@ -1139,15 +1460,13 @@ bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>&
     return false;
   }
   size_t start_offset = (from_height + 1) - std::min((from_height + 1), count);
-  for (size_t i = start_offset; i != from_height + 1; i++) {
-    sz.push_back(m_blocks[i].block_cumulative_size);
-  }
+  m_blockMetadata.getBlockCumulativeSizes(static_cast<uint32_t>(start_offset), static_cast<uint32_t>(from_height + 1), sz);
 
   return true;
 }
 
 bool Blockchain::get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (!m_blocks.size()) {
     return true;
   }
@@ -1163,12 +1482,12 @@ bool Blockchain::complete_timestamps_vector(uint8_t blockMajorVersion, uint64_t
   if (timestamps.size() >= m_currency.timestampCheckWindow(blockMajorVersion))
     return true;
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   size_t need_elements = m_currency.timestampCheckWindow(blockMajorVersion) - timestamps.size();
   if (!(start_top_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: passed start_height = " << start_top_height << " not less then m_blocks.size()=" << m_blocks.size(); return false; }
   size_t stop_offset = start_top_height > need_elements ? start_top_height - need_elements : 0;
   do {
-    timestamps.push_back(m_blocks[start_top_height].bl.timestamp);
+    timestamps.push_back(m_blockMetadata.timestamp(static_cast<uint32_t>(start_top_height)));
     if (start_top_height == 0)
       break;
     --start_top_height;
@@ -1307,7 +1626,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
       return false;
     }
 
-    bei.cumulative_difficulty = alt_chain.size() ? it_prev->second.cumulative_difficulty : m_blocks[mainPrevHeight].cumulative_difficulty;
+    bei.cumulative_difficulty = alt_chain.size() ? it_prev->second.cumulative_difficulty : m_blocks.header(mainPrevHeight).cumulativeDifficulty;
     bei.cumulative_difficulty += current_diff;
 
 #ifdef _DEBUG
@@ -1335,11 +1654,11 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
         bvc.m_verification_failed = true;
       }
       return r;
-    } else if (m_blocks.back().cumulative_difficulty < bei.cumulative_difficulty) //check if difficulty bigger then in main chain
+    } else if (m_blocks.backHeader().cumulativeDifficulty < bei.cumulative_difficulty) //check if difficulty bigger then in main chain
     {
       //do reorganize!
       logger(INFO, BRIGHT_GREEN) <<
-        "###### REORGANIZE on height: " << alt_chain.front()->second.height << " of " << m_blocks.size() - 1 << " with cum_difficulty " << m_blocks.back().cumulative_difficulty
+        "###### REORGANIZE on height: " << alt_chain.front()->second.height << " of " << m_blocks.size() - 1 << " with cum_difficulty " << m_blocks.backHeader().cumulativeDifficulty
         << ENDL << " alternative blockchain size: " << alt_chain.size() << " with cum_difficulty " << bei.cumulative_difficulty;
       bool r = switch_to_alternative_blockchain(alt_chain, false);
       if (r) {
@@ -1371,21 +1690,24 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks, std::list<Transaction>& txs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (start_offset >= m_blocks.size())
     return false;
   for (size_t i = start_offset; i < start_offset + count && i < m_blocks.size(); i++) {
-    blocks.push_back(m_blocks[i].bl);
-    std::list<Crypto::Hash> missed_ids;
-    getTransactions(m_blocks[i].bl.transactionHashes, txs, missed_ids);
-    if (!(!missed_ids.size())) { logger(ERROR, BRIGHT_RED) << "have missed transactions in own block in main blockchain"; return false; }
+    // the transactions are taken from the decoded block instead of being looked up one by one
+    BlockEntry block = m_blocks[i];
+    for (size_t t = 1; t < block.transactions.size(); ++t) {
+      txs.push_back(std::move(block.transactions[t].tx));
+    }
+
+    blocks.push_back(std::move(block.bl));
   }
 
   return true;
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (start_offset >= m_blocks.size()) {
     return false;
   }
@@ -1397,8 +1719,87 @@ bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Bloc
   return true;
 }
 
+bool Blockchain::getBlockBlobs(uint32_t start_offset, uint32_t count, std::vector<std::shared_ptr<const BlockBlobs>>& blocks) {
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  if (start_offset >= m_blocks.size()) {
+    return false;
+  }
+
+  for (uint32_t i = start_offset; i < start_offset + count && i < m_blocks.size(); i++) {
+    std::shared_ptr<const BlockBlobs> blobs = m_blockBlobs.find(m_blocks.header(i).hash);
+    if (!blobs) {
+      blobs = loadBlockBlobs(i);
+      if (!blobs) {
+        return false;
+      }
+
+      m_blockBlobs.insert(blobs);
+    }
+
+    blocks.push_back(std::move(blobs));
+  }
+
+  return true;
+}
+
+// Slices the block and transaction blobs out of the stored BlockEntry. Transactions are parsed only
+// to find where they end; their hashes are the ones listed in the block.
+std::shared_ptr<const BlockBlobs> Blockchain::loadBlockBlobs(uint32_t height) {
+  std::shared_ptr<BlockBlobs> blobs = std::make_shared<BlockBlobs>();
+  try {
+    size_t size;
+    const uint8_t* data = m_blocks.rawItem(height, size);
+    MemoryInputStream stream(data, size);
+    BinaryInputStreamSerializer archive(stream);
+
+    Block block;
+    archive(block, "block");
+    blobs->block.assign(reinterpret_cast<const char*>(data), stream.getPosition());
+
+    BlockEntry entry;
+    archive(entry.height, "height");
+    archive(entry.block_cumulative_size, "block_cumulative_size");
+    archive(entry.cumulative_difficulty, "cumulative_difficulty");
+    archive(entry.already_generated_coins, "already_generated_coins");
+
+    size_t transactionCount;
+    archive.beginArray(transactionCount, "transactions");
+    if (transactionCount != block.transactionHashes.size() + 1) {
+      logger(ERROR, BRIGHT_RED) << "Block " << height << " in block store has " << transactionCount << " transactions, expected " << block.transactionHashes.size() + 1;
+      return nullptr;
+    }
+
+    blobs->transactions.reserve(block.transactionHashes.size());
+    blobs->transactionPrefixes.reserve(block.transactionHashes.size());
+    for (size_t i = 0; i < transactionCount; ++i) {
+      size_t begin = stream.getPosition();
+      TransactionEntry transaction;
+      archive(transaction.tx, "tx");
+      size_t end = stream.getPosition();
+      archive(transaction.m_global_output_indexes, "indexes");
+
+      // the base transaction is a part of the block blob
+      if (i != 0) {
+        blobs->transactions.emplace_back(reinterpret_cast<const char*>(data) + begin, end - begin);
+        blobs->transactionPrefixes.emplace_back(std::move(static_cast<TransactionPrefix&>(transaction.tx)));
+      }
+    }
+
+    archive.endArray();
+
+    blobs->id = m_blocks.header(height).hash;
+    blobs->timestamp = block.timestamp;
+    blobs->transactionHashes = std::move(block.transactionHashes);
+  } catch (std::exception& e) {
+    logger(ERROR, BRIGHT_RED) << "Failed to read block " << height << " from block store: " << e.what();
+    return nullptr;
+  }
+
+  return blobs;
+}
+
 bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp) { //Deprecated. Should be removed with CryptoNoteProtocolHandler.
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   rsp.current_blockchain_height = getCurrentBlockchainHeight();
   std::list<Block> blocks;
   getBlocks(arg.blocks, blocks, rsp.missed_ids);
@@ -1429,7 +1830,7 @@ bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTI
 }
 
 bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   for (auto& alt_bl : m_alternative_chains) {
     blocks.push_back(alt_bl.second.bl);
   }
@@ -1438,89 +1839,39 @@ bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
 }
 
 uint32_t Blockchain::getAlternativeBlocksCount() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return static_cast<uint32_t>(m_alternative_chains.size());
 }
 
-bool Blockchain::add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  const Transaction& tx = transactionByIndex(amount_outs[i].first).tx;
-  if (!(tx.outputs.size() > amount_outs[i].second)) {
-    logger(ERROR, BRIGHT_RED) << "internal error: in global outs index, transaction out index="
-      << amount_outs[i].second << " more than transaction outputs = " << tx.outputs.size() << ", for tx id = " << getObjectHash(tx); return false;
-  }
-  if (!(tx.outputs[amount_outs[i].second].target.type() == typeid(KeyOutput))) { logger(ERROR, BRIGHT_RED) << "unknown tx out type"; return false; }
-
-  //check if transaction is unlocked
-  if (!is_tx_spendtime_unlocked(tx.unlockTime))
-    return false;
-
-  COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry& oen = *result_outs.outs.insert(result_outs.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry());
-  oen.global_amount_index = static_cast<uint32_t>(i);
-  oen.out_key = boost::get<KeyOutput>(tx.outputs[amount_outs[i].second].target).key;
-  return true;
-}
-
-size_t Blockchain::find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  if (amount_outs.empty()) {
-    return 0;
-  }
-
-  size_t i = amount_outs.size();
-  do {
-    --i;
-    if (amount_outs[i].first.block + m_currency.minedMoneyUnlockWindow() <= getCurrentBlockchainHeight()) {
-      return i + 1;
-    }
-  } while (i != 0);
-
-  return 0;
-}
-
+// Runs without m_blockchain_lock: the chain height comes from the tip snapshot and outputs
+// are read from the random outputs index only
 bool Blockchain::getRandomOutsByAmount(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  uint32_t height = getTipSnapshot()->height;
+  //it is not good idea to use top fresh outs, because it increases possibility of transaction canceling on split
+  uint32_t heightLimit = height + 1 > m_currency.minedMoneyUnlockWindow() ? height + 1 - static_cast<uint32_t>(m_currency.minedMoneyUnlockWindow()) : 0;
+  auto isUnlocked = [this, height](uint64_t unlockTime) { return isSpendtimeUnlocked(unlockTime, height); };
 
+  std::vector<std::pair<uint32_t, Crypto::PublicKey>> outputs;
   for (uint64_t amount : req.amounts) {
     COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs = *res.outs.insert(res.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount());
     result_outs.amount = amount;
-    auto it = m_outputs.find(amount);
-    if (it == m_outputs.end()) {
+
+    outputs.clear();
+    if (!m_randomOutputs.select(amount, req.outs_count, heightLimit, isUnlocked, outputs)) {
       logger(ERROR, BRIGHT_RED) <<
         "COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS: not outs for amount " << amount << ", wallet should use some real outs when it lookup for some mix, so, at least one out for this amount should exist";
       continue;//actually this is strange situation, wallet should use some real outs when it lookup for some mix, so, at least one out for this amount should exist
     }
 
-    std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs = it->second;
-    //it is not good idea to use top fresh outs, because it increases possibility of transaction canceling on split
-    //lets find upper bound of not fresh outs
-    size_t up_index_limit = find_end_of_allowed_index(amount_outs);
-    if (!(up_index_limit <= amount_outs.size())) { logger(ERROR, BRIGHT_RED) << "internal error: find_end_of_allowed_index returned wrong index=" << up_index_limit << ", with amount_outs.size = " << amount_outs.size(); return false; }
-
-	if(amount_outs.size() > req.outs_count)
-    {
-      std::set<size_t> used;
-      size_t try_count = 0;
-      for(uint64_t j = 0; j != req.outs_count && try_count < up_index_limit;)
-      {
-	    // triangular distribution over [a,b) with a=0, mode c=b=up_index_limit
-        uint64_t r = Crypto::rand<uint64_t>() % ((uint64_t)1 << 53);
-        double frac = std::sqrt((double)r / ((uint64_t)1 << 53));
-        size_t i = (size_t)(frac*up_index_limit);
-        if(used.count(i))
-          continue;
-        bool added = add_out_to_get_random_outs(amount_outs, result_outs, amount, i);
-        used.insert(i);
-        if(added)
-          ++j;
-        ++try_count;
-      }
-    }else
-    {
-      for(size_t i = 0; i != up_index_limit; i++)
-        add_out_to_get_random_outs(amount_outs, result_outs, amount, i);
+    result_outs.outs.reserve(outputs.size());
+    for (const auto& output : outputs) {
+      COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry entry;
+      entry.global_amount_index = output.first;
+      entry.out_key = output.second;
+      result_outs.outs.push_back(entry);
     }
   }
+
   return true;
 }
 
@@ -1528,7 +1879,7 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
   assert(!qblock_ids.empty());
   assert(qblock_ids.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   uint32_t blockIndex;
   // assert above guarantees that method returns true
   m_blockIndex.findSupplement(qblock_ids, blockIndex);
@@ -1536,24 +1887,24 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
 }
 
 uint64_t Blockchain::blockDifficulty(size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (!(i < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "wrong block index i = " << i << " at Blockchain::block_difficulty()"; return false; }
   if (i == 0)
-    return m_blocks[i].cumulative_difficulty;
+    return m_blocks.header(i).cumulativeDifficulty;
 
-  return m_blocks[i].cumulative_difficulty - m_blocks[i - 1].cumulative_difficulty;
+  return m_blocks.header(i).cumulativeDifficulty - m_blocks.header(i - 1).cumulativeDifficulty;
 }
 
 uint64_t Blockchain::blockCumulativeDifficulty(size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (!(i < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "wrong block index i = " << i << " at Blockchain::block_difficulty()"; return false; }
 
-  return m_blocks[i].cumulative_difficulty;
+  return m_blocks.header(i).cumulativeDifficulty;
 }
 
 void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (start_index >= m_blocks.size()) {
     logger(INFO, BRIGHT_WHITE) <<
       "Wrong starter index set: " << start_index << ", expected max index " << m_blocks.size() - 1;
@@ -1561,9 +1912,9 @@ void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
   }
 
   for (size_t i = start_index; i != m_blocks.size() && i != end_index; i++) {
-    ss << "height " << i << ", timestamp " << m_blocks[i].bl.timestamp << ", cumul_dif " << m_blocks[i].cumulative_difficulty << ", cumul_size " << m_blocks[i].block_cumulative_size
-      << "\nid\t\t" << get_block_hash(m_blocks[i].bl)
-      << "\ndifficulty\t\t" << blockDifficulty(i) << ", nonce " << m_blocks[i].bl.nonce << ", tx_count " << m_blocks[i].bl.transactionHashes.size() << ENDL;
+    ss << "height " << i << ", timestamp " << m_blocks.header(i).timestamp << ", cumul_dif " << m_blocks.header(i).cumulativeDifficulty << ", cumul_size " << m_blocks.header(i).blockCumulativeSize
+      << "\nid\t\t" << m_blocks.header(i).hash
+      << "\ndifficulty\t\t" << blockDifficulty(i) << ", nonce " << m_blocks[i].bl.nonce << ", tx_count " << m_blocks.header(i).transactionsCount - 1 << ENDL;
   }
   logger(DEBUGGING) <<
     "Current blockchain:" << ENDL << ss.str();
@@ -1573,7 +1924,7 @@ void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
 
 void Blockchain::print_blockchain_index() {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   std::vector<Crypto::Hash> blockIds = m_blockIndex.getBlockIds(0, std::numeric_limits<uint32_t>::max());
   logger(INFO, BRIGHT_WHITE) << "Current blockchain index:";
@@ -1587,14 +1938,14 @@ void Blockchain::print_blockchain_index() {
 
 void Blockchain::print_blockchain_outs(const std::string& file) {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  for (const outputs_container::value_type& v : m_outputs) {
-    const std::vector<std::pair<TransactionIndex, uint16_t>>& vals = v.second;
-    if (!vals.empty()) {
-      ss << "amount: " << v.first << ENDL;
-      for (size_t i = 0; i != vals.size(); i++) {
-        ss << "\t" << getObjectHash(transactionByIndex(vals[i].first).tx) << ": " << vals[i].second << ENDL;
-      }
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  // the journal holds all amounts interleaved, outputs of an amount follow each other in global index order
+  std::map<uint64_t, std::vector<RandomOutputsIndex::Output>> outputs;
+  m_randomOutputs.forEach([&outputs](const RandomOutputsIndex::Output& output) { outputs[output.amount].push_back(output); });
+  for (const auto& v : outputs) {
+    ss << "amount: " << v.first << ENDL;
+    for (const RandomOutputsIndex::Output& output : v.second) {
+      ss << "\t" << getObjectHash(transactionByIndex({ output.height, output.transaction }).tx) << ": " << output.outputIndex << ENDL;
     }
   }
 
@@ -1613,7 +1964,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
   assert(!remoteBlockIds.empty());
   assert(remoteBlockIds.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   totalBlockCount = getCurrentBlockchainHeight();
   startBlockIndex = findBlockchainSupplement(remoteBlockIds);
 
@@ -1621,7 +1972,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
 }
 
 bool Blockchain::haveBlock(const Crypto::Hash& id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (m_blockIndex.hasBlock(id))
     return true;
 
@@ -1632,19 +1983,18 @@ bool Blockchain::haveBlock(const Crypto::Hash& id) {
 }
 
 size_t Blockchain::getTotalTransactions() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  return m_transactionMap.size();
+  return currentTip()->transactionsCount;
 }
 
 bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  auto it = m_transactionMap.find(tx_id);
-  if (it == m_transactionMap.end()) {
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  const TransactionIndex* transactionIndex = m_transactionMap.find(tx_id);
+  if (transactionIndex == nullptr) {
     logger(WARNING, YELLOW) << "warning: get_tx_outputs_gindexs failed to find transaction with id = " << tx_id;
     return false;
   }
 
-  const TransactionEntry& tx = transactionByIndex(it->second);
+  const TransactionEntry& tx = transactionByIndex(*transactionIndex);
   if (!(tx.m_global_output_indexes.size())) { logger(ERROR, BRIGHT_RED) << "internal error: global indexes for transaction " << tx_id << " is empty"; return false; }
   indexs.resize(tx.m_global_output_indexes.size());
   for (size_t i = 0; i < tx.m_global_output_indexes.size(); ++i) {
@@ -1655,18 +2005,18 @@ bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, st
 }
 
 bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  auto it = m_multisignatureOutputs.find(amount);
-  if (it == m_multisignatureOutputs.end()) {
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  if (gindex > std::numeric_limits<uint32_t>::max()) {
     return false;
   }
 
-  if (it->second.size() <= gindex) {
+  const MultisignatureOutputRecord* output = findMultisignatureOutput(amount, static_cast<uint32_t>(gindex));
+  if (output == nullptr) {
     return false;
   }
 
-  auto msigUsage = it->second[gindex];
-  auto& targetOut = transactionByIndex(msigUsage.transactionIndex).tx.outputs[msigUsage.outputIndex].target;
+  TransactionEntry transaction = transactionByIndex({ output->block, output->transaction });
+  const TransactionOutputTarget& targetOut = transaction.tx.outputs[output->outputIndex].target;
   if (targetOut.type() != typeid(MultisignatureOutput)) {
     return false;
   }
@@ -1678,7 +2028,7 @@ bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, Multis
 
 
 bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t& max_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   if (tail)
     tail->id = getTailId(tail->height);
@@ -1691,15 +2041,17 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t& max_use
 }
 
 bool Blockchain::haveTransactionKeyImagesAsSpent(const Transaction &tx) {
+  std::vector<Crypto::KeyImage> keyImages;
+  keyImages.reserve(tx.inputs.size());
   for (const auto& in : tx.inputs) {
     if (in.type() == typeid(KeyInput)) {
-      if (have_tx_keyimg_as_spent(boost::get<KeyInput>(in).keyImage)) {
-        return true;
-      }
+      keyImages.push_back(boost::get<KeyInput>(in).keyImage);
     }
   }
 
-  return false;
+  std::vector<bool> spent;
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  return m_spent_keys.contains(keyImages, spent) != 0;
 }
 
 bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height) {
@@ -1707,12 +2059,33 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t* pmax_us
   return checkTransactionInputs(tx, tx_prefix_hash, pmax_used_block_height);
 }
 
-bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height) {
+bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height, std::vector<RingSignatureCheck>* deferredChecks) {
   size_t inputIndex = 0;
   if (pmax_used_block_height) {
     *pmax_used_block_height = 0;
   }
 
+  // all key images are looked up in one batch before any ring is checked
+  std::vector<Crypto::KeyImage> keyImages;
+  keyImages.reserve(tx.inputs.size());
+  for (const auto& txin : tx.inputs) {
+    if (txin.type() == typeid(KeyInput)) {
+      keyImages.push_back(boost::get<KeyInput>(txin).keyImage);
+    }
+  }
+
+  std::vector<bool> spent;
+  if (m_spent_keys.contains(keyImages, spent) != 0) {
+    auto image = std::find(spent.begin(), spent.end(), true);
+    logger(DEBUGGING) <<
+      "Key image already spent in blockchain: " << Common::podToHex(keyImages[image - spent.begin()]);
+    return false;
+  }
+
+  // without a caller collecting them, ring signatures of all inputs are verified together after the loop
+  std::vector<RingSignatureCheck> ringSignatureChecks;
+  std::vector<RingSignatureCheck>& checks = deferredChecks != NULL ? *deferredChecks : ringSignatureChecks;
+
   Crypto::Hash transactionHash = getObjectHash(tx);
   for (const auto& txin : tx.inputs) {
     assert(inputIndex < tx.signatures.size());
@@ -1721,13 +2094,7 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Has
       const KeyInput& in_to_key = boost::get<KeyInput>(txin);
       if (!(!in_to_key.outputIndexes.empty())) { logger(ERROR, BRIGHT_RED) << "empty in_to_key.outputIndexes in transaction with id " << getObjectHash(tx); return false; }
 
-      if (have_tx_keyimg_as_spent(in_to_key.keyImage)) {
-        logger(DEBUGGING) <<
-          "Key image already spent in blockchain: " << Common::podToHex(in_to_key.keyImage);
-        return false;
-      }
-
-      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height)) {
+      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], checks, pmax_used_block_height)) {
         logger(INFO, BRIGHT_WHITE) <<
           "Failed to check ring signature for tx " << transactionHash;
         return false;
@@ -1747,13 +2114,24 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Has
     }
   }
 
+  size_t failedCheck = 0;
+  if (!ringSignatureChecks.empty() && !checkRingSignatures(ringSignatureChecks, failedCheck)) {
+    logger(INFO, BRIGHT_WHITE) <<
+      "Failed to check ring signature for tx " << transactionHash;
+    return false;
+  }
+
   return true;
 }
 
 bool Blockchain::is_tx_spendtime_unlocked(uint64_t unlock_time) {
+  return isSpendtimeUnlocked(unlock_time, getCurrentBlockchainHeight());
+}
+
+bool Blockchain::isSpendtimeUnlocked(uint64_t unlock_time, uint32_t height) const {
   if (unlock_time < m_currency.maxBlockHeight()) {
     //interpret as block index
-    if (getCurrentBlockchainHeight() - 1 + m_currency.lockedTxAllowedDeltaBlocks() >= unlock_time)
+    if (height - 1 + m_currency.lockedTxAllowedDeltaBlocks() >= unlock_time)
       return true;
     else
       return false;
@@ -1769,14 +2147,14 @@ bool Blockchain::is_tx_spendtime_unlocked(uint64_t unlock_time) {
   return false;
 }
 
-bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, std::vector<RingSignatureCheck>& ringSignatureChecks, uint32_t* pmax_related_block_height) {
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   struct outputs_visitor {
-    std::vector<const Crypto::PublicKey *>& m_results_collector;
+    std::vector<Crypto::PublicKey>& m_results_collector;
     Blockchain& m_bch;
     LoggerRef logger;
-    outputs_visitor(std::vector<const Crypto::PublicKey *>& results_collector, Blockchain& bch, ILogger& logger) :m_results_collector(results_collector), m_bch(bch), logger(logger, "outputs_visitor") {
+    outputs_visitor(std::vector<Crypto::PublicKey>& results_collector, Blockchain& bch, ILogger& logger) :m_results_collector(results_collector), m_bch(bch), logger(logger, "outputs_visitor") {
     }
 
     bool handle_output(const Transaction& tx, const TransactionOutput& out, size_t transactionOutputIndex) {
@@ -1793,7 +2171,8 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
         return false;
       }
 
-      m_results_collector.push_back(&boost::get<KeyOutput>(out.target).key);
+      // transactions are decoded for the visit only, the key is copied
+      m_results_collector.push_back(boost::get<KeyOutput>(out.target).key);
       return true;
     }
   };
@@ -1807,7 +2186,7 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
   }
 
   //check ring signature
-  std::vector<const Crypto::PublicKey *> output_keys;
+  std::vector<Crypto::PublicKey> output_keys;
   outputs_visitor vi(output_keys, *this, logger.getLogger());
   if (!scanOutputKeysForIndexes(txin, vi, pmax_related_block_height)) {
     logger(INFO, BRIGHT_WHITE) <<
@@ -1827,11 +2206,189 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
     return true;
   }
 
-  bool check_tx_ring_signature = Crypto::check_ring_signature(tx_prefix_hash, txin.keyImage, output_keys, sig.data());
-  if (!check_tx_ring_signature) {
-    logger(ERROR) << "Failed to check ring signature for keyImage: " << txin.keyImage;
+  RingSignatureCheck check;
+  check.prefixHash = tx_prefix_hash;
+  check.keyImage = txin.keyImage;
+  check.outputKeys = std::move(output_keys);
+
+  check.signatures = sig.data();
+  check.transactionIndex = 0;
+  ringSignatureChecks.push_back(std::move(check));
+  return true;
+}
+
+void Blockchain::expectLongHashes(const std::vector<Crypto::Hash>& blockHashes) {
+  std::lock_guard<std::mutex> lk(m_longHashesLock);
+  // hashes of blocks which never reached pushBlock are not needed anymore
+  m_precomputedLongHashes.clear();
+  m_expectedLongHashes.clear();
+  m_expectedLongHashes.insert(blockHashes.begin(), blockHashes.end());
+}
+
+void Blockchain::addPrecomputedLongHash(const Crypto::Hash& blockHash, const Crypto::Hash& longHash) {
+  {
+    std::lock_guard<std::mutex> lk(m_longHashesLock);
+    if (m_expectedLongHashes.erase(blockHash) == 0) {
+      return;
+    }
+
+    m_precomputedLongHashes[blockHash] = longHash;
+  }
+
+  m_longHashesChanged.notify_all();
+}
+
+void Blockchain::cancelPrecomputedLongHash(const Crypto::Hash& blockHash) {
+  {
+    std::lock_guard<std::mutex> lk(m_longHashesLock);
+    m_expectedLongHashes.erase(blockHash);
   }
-  return check_tx_ring_signature;
+
+  m_longHashesChanged.notify_all();
+}
+
+// Called without the pool and blockchain locks, so the P2P thread does not block other users of the chain while it waits.
+void Blockchain::waitPrecomputedLongHash(const Crypto::Hash& blockHash) {
+  std::unique_lock<std::mutex> lk(m_longHashesLock);
+  m_longHashesChanged.wait(lk, [&] { return m_expectedLongHashes.count(blockHash) == 0; });
+}
+
+// Never waits, a hash still expected here was expected again after waitPrecomputedLongHash and is computed by the caller.
+bool Blockchain::takePrecomputedLongHash(const Crypto::Hash& blockHash, Crypto::Hash& longHash) {
+  std::lock_guard<std::mutex> lk(m_longHashesLock);
+  if (m_expectedLongHashes.erase(blockHash) != 0) {
+    return false;
+  }
+
+  auto it = m_precomputedLongHashes.find(blockHash);
+  if (it == m_precomputedLongHashes.end()) {
+    return false;
+  }
+
+  longHash = it->second;
+  m_precomputedLongHashes.erase(it);
+  return true;
+}
+
+// Verifies independent ring signatures in batches on all available cores, failedCheck is set to the index of a failed check.
+// Keys of ring members are shared through m_ringKeys, so rings checked on mempool admission are cheaper to check in a block.
+bool Blockchain::checkRingSignatures(const std::vector<RingSignatureCheck>& checks, size_t& failedCheck) {
+  std::atomic<size_t> nextBatch(0);
+  std::atomic<bool> failed(false);
+  std::atomic<size_t> failedIndex(checks.size());
+  size_t batchCount = (checks.size() + RING_SIGNATURE_BATCH_SIZE - 1) / RING_SIGNATURE_BATCH_SIZE;
+
+  auto checkingFunction = [&] {
+    std::vector<std::vector<const Crypto::PublicKey*>> keys(RING_SIGNATURE_BATCH_SIZE);
+    std::vector<Crypto::ring_signature_check> batch;
+    for (size_t b = nextBatch++; b < batchCount && !failed; b = nextBatch++) {
+      size_t first = b * RING_SIGNATURE_BATCH_SIZE;
+      size_t last = std::min(first + RING_SIGNATURE_BATCH_SIZE, checks.size());
+      batch.clear();
+      for (size_t i = first; i < last; ++i) {
+        const RingSignatureCheck& check = checks[i];
+        std::vector<const Crypto::PublicKey*>& checkKeys = keys[i - first];
+        checkKeys.clear();
+        for (const Crypto::PublicKey& key : check.outputKeys) {
+          checkKeys.push_back(&key);
+        }
+
+        Crypto::ring_signature_check ringSignature;
+        ringSignature.prefix_hash = check.prefixHash;
+        ringSignature.image = check.keyImage;
+        ringSignature.pubs = checkKeys.data();
+        ringSignature.pubs_count = checkKeys.size();
+        ringSignature.sig = check.signatures;
+        batch.push_back(ringSignature);
+      }
+
+      size_t failedInBatch = 0;
+      if (!Crypto::check_ring_signatures(batch, &m_ringKeys, &failedInBatch)) {
+        failedIndex = first + failedInBatch;
+        failed = true;
+      }
+    }
+  };
+
+  std::mutex doneLock;
+  std::condition_variable doneChanged;
+  size_t pendingTasks = 0;
+  if (m_verificationTasks) {
+    size_t helpers = std::min(m_verificationWorkers.size(), batchCount - 1);
+    for (size_t i = 0; i < helpers; ++i) {
+      {
+        std::lock_guard<std::mutex> lk(doneLock);
+        ++pendingTasks;
+      }
+
+      bool pushed = m_verificationTasks->push([&] {
+        checkingFunction();
+        std::lock_guard<std::mutex> lk(doneLock);
+        if (--pendingTasks == 0) {
+          doneChanged.notify_one();
+        }
+      });
+
+      if (!pushed) {
+        std::lock_guard<std::mutex> lk(doneLock);
+        --pendingTasks;
+        break;
+      }
+    }
+  }
+
+  // the calling thread takes part in checking too, helpers which start after all batches are taken return at once
+  checkingFunction();
+  {
+    std::unique_lock<std::mutex> lk(doneLock);
+    doneChanged.wait(lk, [&] { return pendingTasks == 0; });
+  }
+
+  if (failed) {
+    failedCheck = failedIndex;
+    logger(ERROR) << "Failed to check ring signature for keyImage: " << checks[failedCheck].keyImage;
+    return false;
+  }
+
+  return true;
+}
+
+// Started once by init and joined by deinit, so checking a block or a transaction does not create threads.
+void Blockchain::startVerificationWorkers() {
+  if (m_verificationTasks) {
+    return;
+  }
+
+  size_t workers = std::thread::hardware_concurrency();
+  if (workers == 0) {
+    workers = 2;
+  }
+
+  // the thread asking for checks is one of the workers
+  --workers;
+  m_verificationTasks.reset(new BlockingQueue<std::function<void()>>(std::max<size_t>(workers, 1)));
+  for (size_t i = 0; i < workers; ++i) {
+    m_verificationWorkers.emplace_back([this] {
+      std::function<void()> task;
+      while (m_verificationTasks->pop(task)) {
+        task();
+      }
+    });
+  }
+}
+
+void Blockchain::stopVerificationWorkers() {
+  if (!m_verificationTasks) {
+    return;
+  }
+
+  m_verificationTasks->close();
+  for (auto& worker : m_verificationWorkers) {
+    worker.join();
+  }
+
+  m_verificationWorkers.clear();
+  m_verificationTasks.reset();
 }
 
 uint64_t Blockchain::get_adjusted_time() {
@@ -1848,9 +2405,7 @@ bool Blockchain::check_block_timestamp_main(const Block& b) {
 
   std::vector<uint64_t> timestamps;
   size_t offset = m_blocks.size() <= m_currency.timestampCheckWindow(b.majorVersion) ? 0 : m_blocks.size() - m_currency.timestampCheckWindow(b.majorVersion);
-  for (; offset != m_blocks.size(); ++offset) {
-    timestamps.push_back(m_blocks[offset].bl.timestamp);
-  }
+  m_blockMetadata.getTimestamps(static_cast<uint32_t>(offset), m_blockMetadata.size(), timestamps);
 
   return check_block_timestamp(std::move(timestamps), b);
 }
@@ -1975,6 +2530,8 @@ bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc)
 
   bool add_result;
 
+  waitPrecomputedLongHash(id);
+
   { //to avoid deadlock lets lock tx_pool for whole add/reorganize process
     std::lock_guard<decltype(m_tx_pool)> poolLock(m_tx_pool);
     std::lock_guard<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock);
@@ -2009,8 +2566,8 @@ bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc)
   return add_result;
 }
 
-const Blockchain::TransactionEntry& Blockchain::transactionByIndex(TransactionIndex index) {
-  return m_blocks[index.block].transactions[index.transaction];
+Blockchain::TransactionEntry Blockchain::transactionByIndex(TransactionIndex index) {
+  return std::move(m_blocks[index.block].transactions[index.transaction]);
 }
 
 bool Blockchain::pushBlock(const Block& blockData, block_verification_context& bvc) {
@@ -2025,6 +2582,7 @@ bool Blockchain::pushBlock(const Block& blockData, block_verification_context& b
     return false;
   }
 
+  m_tx_pool.on_blockchain_inc(m_blocks.size(), getTailId());
   return true;
 }
 
@@ -2095,7 +2653,14 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
       return false;
     }
   } else {
-    if (!m_currency.checkProofOfWork(m_cn_context, blockData, currentDifficulty, proof_of_work)) {
+    bool proofOfWorkValid;
+    if (takePrecomputedLongHash(blockHash, proof_of_work)) {
+      proofOfWorkValid = m_currency.checkProofOfWork(blockData, currentDifficulty, proof_of_work);
+    } else {
+      proofOfWorkValid = m_currency.checkProofOfWork(m_cn_context, blockData, currentDifficulty, proof_of_work);
+    }
+
+    if (!proofOfWorkValid) {
       logger(INFO, BRIGHT_WHITE) <<
         "Block " << blockHash << ", has too weak proof of work: " << proof_of_work << ", expected difficulty: " << currentDifficulty;
       bvc.m_verification_failed = true;
@@ -2116,6 +2681,8 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
 
   BlockEntry block;
   block.bl = blockData;
+  // set before the first transaction is pushed, popping them on a failure lowers the chain index to this height
+  block.height = static_cast<uint32_t>(m_blocks.size());
   block.transactions.resize(1);
   block.transactions[0].tx = blockData.baseTransaction;
   TransactionIndex transactionIndex = { static_cast<uint32_t>(m_blocks.size()), static_cast<uint16_t>(0) };
@@ -2124,6 +2691,8 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   size_t coinbase_blob_size = getObjectBinarySize(blockData.baseTransaction);
   size_t cumulative_block_size = coinbase_blob_size;
   uint64_t fee_summary = 0;
+  // output keys and key images are checked in order, ring signatures of the whole block are verified afterwards in parallel
+  std::vector<RingSignatureCheck> ringSignatureChecks;
   for (size_t i = 0; i < transactions.size(); ++i) {
     const Crypto::Hash& tx_id = blockData.transactionHashes[i];
     block.transactions.resize(block.transactions.size() + 1);
@@ -2133,7 +2702,8 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
 
     blob_size = toBinaryArray(block.transactions.back().tx).size();
     fee = getInputAmount(block.transactions.back().tx) - getOutputAmount(block.transactions.back().tx);
-    if (!checkTransactionInputs(block.transactions.back().tx)) {
+    size_t firstCheck = ringSignatureChecks.size();
+    if (!checkTransactionInputs(transactions[i], getObjectHash(static_cast<const TransactionPrefix&>(transactions[i])), NULL, &ringSignatureChecks)) {
       logger(INFO, BRIGHT_WHITE) <<
         "Block " << blockHash << " has at least one transaction with wrong inputs: " << tx_id;
       bvc.m_verification_failed = true;
@@ -2143,6 +2713,10 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
       return false;
     }
 
+    for (size_t check = firstCheck; check < ringSignatureChecks.size(); ++check) {
+      ringSignatureChecks[check].transactionIndex = i;
+    }
+
     ++transactionIndex.transaction;
     pushTransaction(block, tx_id, transactionIndex);
 
@@ -2150,14 +2724,24 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     fee_summary += fee;
   }
 
+  size_t failedCheck = 0;
+  if (!ringSignatureChecks.empty() && !checkRingSignatures(ringSignatureChecks, failedCheck)) {
+    logger(INFO, BRIGHT_WHITE) <<
+      "Block " << blockHash << " has at least one transaction with wrong inputs: " << blockData.transactionHashes[ringSignatureChecks[failedCheck].transactionIndex];
+    bvc.m_verification_failed = true;
+    popTransactions(block, minerTransactionHash);
+    return false;
+  }
+
   if (!checkCumulativeBlockSize(blockHash, cumulative_block_size, m_blocks.size())) {
     bvc.m_verification_failed = true;
+    popTransactions(block, minerTransactionHash);
     return false;
   }
 
   int64_t emissionChange = 0;
   uint64_t reward = 0;
-  uint64_t already_generated_coins = m_blocks.empty() ? 0 : m_blocks.back().already_generated_coins;
+  uint64_t already_generated_coins = m_blocks.empty() ? 0 : m_blocks.backHeader().alreadyGeneratedCoins;
   if (!validate_miner_transaction(blockData, static_cast<uint32_t>(m_blocks.size()), cumulative_block_size, already_generated_coins, fee_summary, reward, emissionChange)) {
     logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " has invalid miner transaction";
     bvc.m_verification_failed = true;
@@ -2165,12 +2749,11 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     return false;
   }
 
-  block.height = static_cast<uint32_t>(m_blocks.size());
   block.block_cumulative_size = cumulative_block_size;
   block.cumulative_difficulty = currentDifficulty;
   block.already_generated_coins = already_generated_coins + emissionChange;
   if (m_blocks.size() > 0) {
-    block.cumulative_difficulty += m_blocks.back().cumulative_difficulty;
+    block.cumulative_difficulty += m_blocks.backHeader().cumulativeDifficulty;
   }
 
   pushBlock(block);
@@ -2193,6 +2776,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   m_upgradeDetectorV5.blockPushed();
 
   update_next_cumulative_size_limit();
+  publishTipSnapshot();
 
   return true;
 }
@@ -2200,14 +2784,20 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
 bool Blockchain::pushBlock(BlockEntry& block) {
   Crypto::Hash blockHash = get_block_hash(block.bl);
 
-  m_blocks.push_back(block);
+  BlockEntryHeader header = makeBlockEntryHeader(block, blockHash);
+  m_blocks.push_back(block, header);
   m_blockIndex.push(blockHash);
+  m_blockMetadata.push(header.timestamp, header.blockCumulativeSize, header.cumulativeDifficulty, header.alreadyGeneratedCoins, header.baseTransactionAmount);
 
   m_timestampIndex.add(block.bl.timestamp, blockHash);
   m_generatedTransactionsIndex.add(block.bl);
 
   assert(m_blockIndex.size() == m_blocks.size());
 
+  if (m_blocks.size() % CHAIN_INDEX_FLUSH_INTERVAL == 0) {
+    flushChainIndex();
+  }
+
   return true;
 }
 
@@ -2218,9 +2808,10 @@ void Blockchain::popBlock() {
     return;
   }
 
-  std::vector<Transaction> transactions(m_blocks.back().transactions.size() - 1);
-  for (size_t i = 0; i < m_blocks.back().transactions.size() - 1; ++i) {
-    transactions[i] = m_blocks.back().transactions[1 + i].tx;
+  BlockEntry block = m_blocks.back();
+  std::vector<Transaction> transactions(block.transactions.size() - 1);
+  for (size_t i = 0; i < block.transactions.size() - 1; ++i) {
+    transactions[i] = std::move(block.transactions[1 + i].tx);
   }
 
   saveTransactions(transactions);
@@ -2230,11 +2821,15 @@ void Blockchain::popBlock() {
   m_upgradeDetectorV3.blockPopped();
   m_upgradeDetectorV4.blockPopped();
   m_upgradeDetectorV5.blockPopped();
+
+  publishTipSnapshot();
+  m_tx_pool.on_blockchain_dec(m_blocks.size(), m_blockIndex.getTailId());
 }
 
 bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transactionHash, TransactionIndex transactionIndex) {
-  auto result = m_transactionMap.insert(std::make_pair(transactionHash, transactionIndex));
-  if (!result.second) {
+  markChainIndexDirty();
+
+  if (!m_transactionMap.insert(transactionHash, transactionIndex)) {
     logger(ERROR, BRIGHT_RED) <<
       "Duplicate transaction was pushed to blockchain.";
     return false;
@@ -2251,8 +2846,7 @@ bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transact
 
   for (size_t i = 0; i < transaction.tx.inputs.size(); ++i) {
     if (transaction.tx.inputs[i].type() == typeid(KeyInput)) {
-      auto result = m_spent_keys.insert(::boost::get<KeyInput>(transaction.tx.inputs[i]).keyImage);
-      if (!result.second) {
+      if (!m_spent_keys.insert(::boost::get<KeyInput>(transaction.tx.inputs[i]).keyImage)) {
         logger(ERROR, BRIGHT_RED) <<
           "Double spending transaction was pushed to blockchain.";
         for (size_t j = 0; j < i; ++j) {
@@ -2268,22 +2862,18 @@ bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transact
   for (const auto& inv : transaction.tx.inputs) {
     if (inv.type() == typeid(MultisignatureInput)) {
       const MultisignatureInput& in = ::boost::get<MultisignatureInput>(inv);
-      auto& amountOutputs = m_multisignatureOutputs[in.amount];
-      amountOutputs[in.outputIndex].isUsed = true;
+      MultisignatureOutputRecord* output = findMultisignatureOutput(in.amount, in.outputIndex);
+      assert(output != nullptr);
+      setMultisignatureOutputUsed(*output, true, transactionIndex.block);
     }
   }
 
   transaction.m_global_output_indexes.resize(transaction.tx.outputs.size());
   for (uint16_t output = 0; output < transaction.tx.outputs.size(); ++output) {
     if (transaction.tx.outputs[output].target.type() == typeid(KeyOutput)) {
-      auto& amountOutputs = m_outputs[transaction.tx.outputs[output].amount];
-      transaction.m_global_output_indexes[output] = static_cast<uint32_t>(amountOutputs.size());
-      amountOutputs.push_back(std::make_pair<>(transactionIndex, output));
+      transaction.m_global_output_indexes[output] = pushKeyOutput(transaction.tx, transactionIndex, output);
     } else if (transaction.tx.outputs[output].target.type() == typeid(MultisignatureOutput)) {
-      auto& amountOutputs = m_multisignatureOutputs[transaction.tx.outputs[output].amount];
-      transaction.m_global_output_indexes[output] = static_cast<uint32_t>(amountOutputs.size());
-      MultisignatureOutputUsage outputUsage = { transactionIndex, output, false };
-      amountOutputs.push_back(outputUsage);
+      transaction.m_global_output_indexes[output] = pushMultisignatureOutput(transaction.tx.outputs[output].amount, transactionIndex, output);
     }
   }
 
@@ -2293,94 +2883,95 @@ bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transact
 }
 
 void Blockchain::popTransaction(const Transaction& transaction, const Crypto::Hash& transactionHash) {
+  markChainIndexDirty();
+
   TransactionIndex transactionIndex = m_transactionMap.at(transactionHash);
   for (size_t outputIndex = 0; outputIndex < transaction.outputs.size(); ++outputIndex) {
     const TransactionOutput& output = transaction.outputs[transaction.outputs.size() - 1 - outputIndex];
+    uint16_t expectedOutputIndex = static_cast<uint16_t>(transaction.outputs.size() - 1 - outputIndex);
     if (output.target.type() == typeid(KeyOutput)) {
-      auto amountOutputs = m_outputs.find(output.amount);
-      if (amountOutputs == m_outputs.end()) {
+      uint64_t amountSize = m_randomOutputs.size(output.amount);
+      if (amountSize == 0) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - cannot find specific amount in outputs map.";
         continue;
       }
 
-      if (amountOutputs->second.empty()) {
+      RandomOutputsIndex::Output last;
+      if (!m_randomOutputs.get(output.amount, amountSize - 1, last)) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - output array for specific amount is empty.";
         continue;
       }
 
-      if (amountOutputs->second.back().first.block != transactionIndex.block || amountOutputs->second.back().first.transaction != transactionIndex.transaction) {
+      if (last.height != transactionIndex.block || last.transaction != transactionIndex.transaction) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - invalid transaction index.";
         continue;
       }
 
-      if (amountOutputs->second.back().second != transaction.outputs.size() - 1 - outputIndex) {
+      if (last.outputIndex != expectedOutputIndex) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - invalid output index.";
         continue;
       }
 
-      amountOutputs->second.pop_back();
-      if (amountOutputs->second.empty()) {
-        m_outputs.erase(amountOutputs);
-      }
+      m_randomOutputs.pop(output.amount);
     } else if (output.target.type() == typeid(MultisignatureOutput)) {
-      auto amountOutputs = m_multisignatureOutputs.find(output.amount);
-      if (amountOutputs == m_multisignatureOutputs.end()) {
+      uint64_t amountSize = m_multisignatureOutputs.size(output.amount);
+      if (amountSize == 0) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - cannot find specific amount in outputs map.";
         continue;
       }
 
-      if (amountOutputs->second.empty()) {
+      const MultisignatureOutputRecord* last = findMultisignatureOutput(output.amount, static_cast<uint32_t>(amountSize - 1));
+      if (last == nullptr) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - output array for specific amount is empty.";
         continue;
       }
 
-      if (amountOutputs->second.back().isUsed) {
+      if (last->isUsed) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - attempting to remove used output.";
         continue;
       }
 
-      if (amountOutputs->second.back().transactionIndex.block != transactionIndex.block || amountOutputs->second.back().transactionIndex.transaction != transactionIndex.transaction) {
+      if (last->block != transactionIndex.block || last->transaction != transactionIndex.transaction) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - invalid transaction index.";
         continue;
       }
 
-      if (amountOutputs->second.back().outputIndex != transaction.outputs.size() - 1 - outputIndex) {
+      if (last->outputIndex != expectedOutputIndex) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - invalid output index.";
         continue;
       }
 
-      amountOutputs->second.pop_back();
-      if (amountOutputs->second.empty()) {
-        m_multisignatureOutputs.erase(amountOutputs);
-      }
+      m_multisignatureOutputs.pop(output.amount);
+      m_multisignatureOutputsJournal.pop_back();
     }
   }
 
   for (auto& input : transaction.inputs) {
     if (input.type() == typeid(KeyInput)) {
-      size_t count = m_spent_keys.erase(::boost::get<KeyInput>(input).keyImage);
-      if (count != 1) {
+      if (!m_spent_keys.erase(::boost::get<KeyInput>(input).keyImage)) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - cannot find spent key.";
       }
     } else if (input.type() == typeid(MultisignatureInput)) {
       const MultisignatureInput& in = ::boost::get<MultisignatureInput>(input);
-      auto& amountOutputs = m_multisignatureOutputs[in.amount];
-      if (!amountOutputs[in.outputIndex].isUsed) {
+      MultisignatureOutputRecord* output = findMultisignatureOutput(in.amount, in.outputIndex);
+      if (output == nullptr || !output->isUsed) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - multisignature output not marked as used.";
       }
 
-      amountOutputs[in.outputIndex].isUsed = false;
+      if (output != nullptr) {
+        setMultisignatureOutputUsed(*output, false, 0);
+      }
     }
   }
 
@@ -2394,6 +2985,8 @@ void Blockchain::popTransaction(const Transaction& transaction, const Crypto::Ha
 }
 
 void Blockchain::popTransactions(const BlockEntry& block, const Crypto::Hash& minerTransactionHash) {
+  lowerChainIndexHeight(block);
+
   for (size_t i = 0; i < block.transactions.size() - 1; ++i) {
     popTransaction(block.transactions[block.transactions.size() - 1 - i].tx, block.bl.transactionHashes[block.transactions.size() - 2 - i]);
   }
@@ -2403,36 +2996,35 @@ void Blockchain::popTransactions(const BlockEntry& block, const Crypto::Hash& mi
 
 bool Blockchain::validateInput(const MultisignatureInput& input, const Crypto::Hash& transactionHash, const Crypto::Hash& transactionPrefixHash, const std::vector<Crypto::Signature>& transactionSignatures) {
   assert(input.signatureCount == transactionSignatures.size());
-  MultisignatureOutputsContainer::const_iterator amountOutputs = m_multisignatureOutputs.find(input.amount);
-  if (amountOutputs == m_multisignatureOutputs.end()) {
+  if (m_multisignatureOutputs.size(input.amount) == 0) {
     logger(DEBUGGING) <<
       "Transaction << " << transactionHash << " contains multisignature input with invalid amount.";
     return false;
   }
 
-  if (input.outputIndex >= amountOutputs->second.size()) {
+  const MultisignatureOutputRecord* outputRecord = findMultisignatureOutput(input.amount, input.outputIndex);
+  if (outputRecord == nullptr) {
     logger(DEBUGGING) <<
       "Transaction << " << transactionHash << " contains multisignature input with invalid outputIndex.";
     return false;
   }
 
-  const MultisignatureOutputUsage& outputIndex = amountOutputs->second[input.outputIndex];
-  if (outputIndex.isUsed) {
+  if (outputRecord->isUsed) {
     logger(DEBUGGING) <<
       "Transaction << " << transactionHash << " contains double spending multisignature input.";
     return false;
   }
 
-  const Transaction& outputTransaction = m_blocks[outputIndex.transactionIndex.block].transactions[outputIndex.transactionIndex.transaction].tx;
+  const Transaction outputTransaction = transactionByIndex({ outputRecord->block, outputRecord->transaction }).tx;
   if (!is_tx_spendtime_unlocked(outputTransaction.unlockTime)) {
     logger(DEBUGGING) <<
       "Transaction << " << transactionHash << " contains multisignature input which points to a locked transaction.";
     return false;
   }
 
-  assert(outputTransaction.outputs[outputIndex.outputIndex].amount == input.amount);
-  assert(outputTransaction.outputs[outputIndex.outputIndex].target.type() == typeid(MultisignatureOutput));
-  const MultisignatureOutput& output = ::boost::get<MultisignatureOutput>(outputTransaction.outputs[outputIndex.outputIndex].target);
+  assert(outputTransaction.outputs[outputRecord->outputIndex].amount == input.amount);
+  assert(outputTransaction.outputs[outputRecord->outputIndex].target.type() == typeid(MultisignatureOutput));
+  const MultisignatureOutput& output = ::boost::get<MultisignatureOutput>(outputTransaction.outputs[outputRecord->outputIndex].target);
   if (input.signatureCount != output.requiredSignatureCount) {
     logger(DEBUGGING) <<
       "Transaction << " << transactionHash << " contains multisignature input with invalid signature count.";
@@ -2479,6 +3071,9 @@ void Blockchain::rollbackBlockchainTo(uint32_t height) {
   while (height + 1 < m_blocks.size()) {
     removeLastBlock();
   }
+
+  publishTipSnapshot();
+  m_tx_pool.on_blockchain_dec(m_blocks.size(), getTailId());
 }
 
 void Blockchain::removeLastBlock() {
@@ -2488,15 +3083,18 @@ void Blockchain::removeLastBlock() {
     return;
   }
 
-  logger(DEBUGGING) << "Removing last block with height " << m_blocks.back().height;
-  popTransactions(m_blocks.back(), getObjectHash(m_blocks.back().bl.baseTransaction));
+  const BlockEntry block = m_blocks.back();
+  logger(DEBUGGING) << "Removing last block with height " << block.height;
+  popTransactions(block, getObjectHash(block.bl.baseTransaction));
 
-  Crypto::Hash blockHash = getBlockIdByHeight(m_blocks.back().height);
-  m_timestampIndex.remove(m_blocks.back().bl.timestamp, blockHash);
-  m_generatedTransactionsIndex.remove(m_blocks.back().bl);
+  Crypto::Hash blockHash = getBlockIdByHeight(block.height);
+  m_timestampIndex.remove(m_blocks.backHeader().timestamp, blockHash);
+  m_generatedTransactionsIndex.remove(block.bl);
 
   m_blocks.pop_back();
   m_blockIndex.pop();
+  m_blockMetadata.pop();
+  truncateMinimalFees();
 
   assert(m_blockIndex.size() == m_blocks.size());
 }
@@ -2505,7 +3103,7 @@ bool Blockchain::checkUpgradeHeight(const UpgradeDetector& upgradeDetector) {
   uint32_t upgradeHeight = upgradeDetector.upgradeHeight();
   if (upgradeHeight != UpgradeDetectorBase::UNDEF_HEIGHT && upgradeHeight + 1 < m_blocks.size()) {
     logger(INFO) << "Checking block version at " << upgradeHeight + 1;
-    if (m_blocks[upgradeHeight + 1].bl.majorVersion != upgradeDetector.targetVersion()) {
+    if (m_blocks.header(upgradeHeight + 1).majorVersion != upgradeDetector.targetVersion()) {
       return false;
     }
   }
@@ -2514,45 +3112,54 @@ bool Blockchain::checkUpgradeHeight(const UpgradeDetector& upgradeDetector) {
 }
 
 bool Blockchain::getLowerBound(uint64_t timestamp, uint64_t startOffset, uint32_t& height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   assert(startOffset < m_blocks.size());
 
-  auto bound = std::lower_bound(m_blocks.begin() + startOffset, m_blocks.end(), timestamp - m_currency.blockFutureTimeLimit(),
-    [](const BlockEntry& b, uint64_t timestamp) { return b.bl.timestamp < timestamp; });
+  // binary search over the header timestamps, blocks are not decoded
+  uint64_t first = startOffset;
+  uint64_t last = m_blocks.size();
+  while (first < last) {
+    uint64_t middle = first + (last - first) / 2;
+    if (m_blocks.header(middle).timestamp < timestamp - m_currency.blockFutureTimeLimit()) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
+  }
 
-  if (bound == m_blocks.end()) {
+  if (first == m_blocks.size()) {
     return false;
   }
 
-  height = static_cast<uint32_t>(std::distance(m_blocks.begin(), bound));
+  height = static_cast<uint32_t>(first);
   return true;
 }
 
 std::vector<Crypto::Hash> Blockchain::getBlockIds(uint32_t startHeight, uint32_t maxCount) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_blockIndex.getBlockIds(startHeight, maxCount);
 }
 
 bool Blockchain::getBlockContainingTransaction(const Crypto::Hash& txId, Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  auto it = m_transactionMap.find(txId);
-  if (it == m_transactionMap.end()) {
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  const TransactionIndex* transactionIndex = m_transactionMap.find(txId);
+  if (transactionIndex == nullptr) {
     return false;
   } else {
-    blockHeight = m_blocks[it->second.block].height;
+    blockHeight = transactionIndex->block;
     blockId = getBlockIdByHeight(blockHeight);
     return true;
   }
 }
 
 bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& generatedCoins) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   // try to find block in main chain
   uint32_t height = 0;
   if (m_blockIndex.getBlockHeight(hash, height)) {
-    generatedCoins = m_blocks[height].already_generated_coins;
+    generatedCoins = m_blocks.header(height).alreadyGeneratedCoins;
     return true;
   }
 
@@ -2568,12 +3175,12 @@ bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& ge
 }
 
 bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   // try to find block in main chain
   uint32_t height = 0;
   if (m_blockIndex.getBlockHeight(hash, height)) {
-    size = m_blocks[height].block_cumulative_size;
+    size = m_blocks.header(height).blockCumulativeSize;
     return true;
   }
 
@@ -2589,20 +3196,18 @@ bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
 }
 
 bool Blockchain::getMultisigOutputReference(const MultisignatureInput& txInMultisig, std::pair<Crypto::Hash, size_t>& outputReference) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  MultisignatureOutputsContainer::const_iterator amountIter = m_multisignatureOutputs.find(txInMultisig.amount);
-  if (amountIter == m_multisignatureOutputs.end()) {
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  if (m_multisignatureOutputs.size(txInMultisig.amount) == 0) {
     logger(DEBUGGING) << "Transaction contains multisignature input with invalid amount.";
     return false;
   }
-  if (amountIter->second.size() <= txInMultisig.outputIndex) {
+  const MultisignatureOutputRecord* output = findMultisignatureOutput(txInMultisig.amount, txInMultisig.outputIndex);
+  if (output == nullptr) {
     logger(DEBUGGING) << "Transaction contains multisignature input with invalid outputIndex.";
     return false;
   }
-  const MultisignatureOutputUsage& outputIndex = amountIter->second[txInMultisig.outputIndex];
-  const Transaction& outputTransaction = m_blocks[outputIndex.transactionIndex.block].transactions[outputIndex.transactionIndex.transaction].tx;
-  outputReference.first = getObjectHash(outputTransaction);
-  outputReference.second = outputIndex.outputIndex;
+  outputReference.first = getObjectHash(transactionByIndex({ output->block, output->transaction }).tx);
+  outputReference.second = output->outputIndex;
   return true;
 }
 
@@ -2656,22 +3261,22 @@ bool Blockchain::loadBlockchainIndices() {
 }
 
 bool Blockchain::getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTransactions) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_generatedTransactionsIndex.find(height, generatedTransactions);
 }
 
 bool Blockchain::getOrphanBlockIdsByHeight(uint32_t height, std::vector<Crypto::Hash>& blockHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_orthanBlocksIndex.find(height, blockHashes);
 }
 
 bool Blockchain::getBlockIdsByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t blocksNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& blocksNumberWithinTimestamps) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_timestampIndex.find(timestampBegin, timestampEnd, blocksNumberLimit, hashes, blocksNumberWithinTimestamps);
 }
 
 bool Blockchain::getTransactionIdsByPaymentId(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_paymentIdIndex.find(paymentId, transactionHashes);
 }
 
@@ -2719,6 +3324,7 @@ void Blockchain::sendMessage(const BlockchainMessage& message) {
 }
 
 bool Blockchain::isBlockInMainChain(const Crypto::Hash& blockId) {
+  boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_blockIndex.hasBlock(blockId);
 }
 
@@ -20,17 +20,30 @@
 #pragma once
 
 #include <atomic>
-
-#include "google/sparse_hash_set"
-#include "google/sparse_hash_map"
-
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+#include "Common/BlockingQueue.h"
+#include "Common/FileMappedHashMap.h"
+#include "Common/FileMappedVector.h"
 #include "Common/ObserverManager.h"
+#include "Common/RecursiveSharedMutex.h"
 #include "Common/Util.h"
+#include "CryptoNoteCore/AmountOutputsIndex.h"
+#include "CryptoNoteCore/BlockBlobsCache.h"
 #include "CryptoNoteCore/BlockIndex.h"
+#include "CryptoNoteCore/BlockMetadataIndex.h"
 #include "CryptoNoteCore/Checkpoints.h"
 #include "CryptoNoteCore/Currency.h"
 #include "CryptoNoteCore/IBlockchainStorageObserver.h"
 #include "CryptoNoteCore/ITransactionValidator.h"
+#include "CryptoNoteCore/KeyImageStore.h"
+#include "CryptoNoteCore/MappedBlockStore.h"
+#include "CryptoNoteCore/RandomOutputsIndex.h"
 #include "CryptoNoteCore/SwappedVector.h"
 #include "CryptoNoteCore/UpgradeDetector.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
@@ -50,12 +63,34 @@ namespace CryptoNote {
   struct NOTIFY_RESPONSE_GET_OBJECTS_request;
   struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_request;
   struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_response;
-  struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount;
 
   using CryptoNote::BlockInfo;
+
+  // Immutable view of the main chain tip. A new instance is published every time
+  // a block is pushed or popped, so queries answered from the tip alone don't need
+  // m_blockchain_lock. Every other read takes it shared. A chain switch publishes
+  // the tip once, after it commits.
+  struct BlockchainTipSnapshot {
+    uint32_t height; // number of blocks in main chain
+    Crypto::Hash tailId;
+    difficulty_type cumulativeDifficulty;
+    uint64_t alreadyGeneratedCoins;
+    size_t transactionsCount;
+    difficulty_type nextDifficulty; // required of the block built on the tail
+    uint64_t minimalFee; // minimal transaction fee at the tail height
+
+    // tail block header, zero while the chain is empty
+    uint64_t tailTimestamp;
+    uint64_t tailReward;
+    difficulty_type tailDifficulty;
+    uint8_t tailMajorVersion;
+    uint8_t tailMinorVersion;
+  };
+
   class Blockchain : public CryptoNote::ITransactionValidator {
   public:
     Blockchain(const Currency& currency, tx_memory_pool& tx_pool, Logging::ILogger& logger, bool blockchainIndexesEnabled);
+    ~Blockchain();
 
     bool addObserver(IBlockchainStorageObserver* observer);
     bool removeObserver(IBlockchainStorageObserver* observer);
@@ -76,6 +111,8 @@ namespace CryptoNote {
     void setCheckpoints(Checkpoints&& chk_pts) { m_checkpoints = chk_pts; }
     bool getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks, std::list<Transaction>& txs);
     bool getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks);
+    // Main chain blocks from start_offset in their stored encoding, for serving them without reserialization
+    bool getBlockBlobs(uint32_t start_offset, uint32_t count, std::vector<std::shared_ptr<const BlockBlobs>>& blocks);
     bool getAlternativeBlocks(std::list<Block>& blocks);
     uint32_t getAlternativeBlocksCount();
     Crypto::Hash getBlockIdByHeight(uint32_t height);
@@ -87,6 +124,7 @@ namespace CryptoNote {
     bool haveTransaction(const Crypto::Hash &id);
     bool haveTransactionKeyImagesAsSpent(const Transaction &tx);
 
+    std::shared_ptr<const BlockchainTipSnapshot> getTipSnapshot() const;
     uint32_t getCurrentBlockchainHeight(); //TODO rename to getCurrentBlockchainSize
     Crypto::Hash getTailId();
     Crypto::Hash getTailId(uint32_t& height);
@@ -126,6 +164,12 @@ namespace CryptoNote {
     bool isInCheckpointZone(const uint32_t height);
     uint64_t getAvgDifficultyForHeight(uint32_t height, size_t window);
 
+    // Long hashes computed ahead of pushBlock by other threads. addNewBlock waits for an expected hash
+    // before it takes the pool and blockchain locks, pushBlock takes it without waiting.
+    void expectLongHashes(const std::vector<Crypto::Hash>& blockHashes);
+    void addPrecomputedLongHash(const Crypto::Hash& blockHash, const Crypto::Hash& longHash);
+    void cancelPrecomputedLongHash(const Crypto::Hash& blockHash);
+
     template<class visitor_t> bool scanOutputKeysForIndexes(const KeyInput& tx_in_to_key, visitor_t& vis, uint32_t* pmax_related_block_height = NULL);
 
     bool addMessageQueue(MessageQueue<BlockchainMessage>& messageQueue);
@@ -133,7 +177,7 @@ namespace CryptoNote {
 
     template<class t_ids_container, class t_blocks_container, class t_missed_container>
     bool getBlocks(const t_ids_container& block_ids, t_blocks_container& blocks, t_missed_container& missed_bs) {
-      std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
+      boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
       for (const auto& bl_id : block_ids) {
         try {
@@ -154,14 +198,14 @@ namespace CryptoNote {
 
     template<class t_ids_container, class t_tx_container, class t_missed_container>
     void getBlockchainTransactions(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs) {
-      std::lock_guard<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock);
+      boost::shared_lock<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock);
 
       for (const auto& tx_id : txs_ids) {
-        auto it = m_transactionMap.find(tx_id);
-        if (it == m_transactionMap.end()) {
+        const TransactionIndex* transactionIndex = m_transactionMap.find(tx_id);
+        if (transactionIndex == nullptr) {
           missed_txs.push_back(tx_id);
         } else {
-          txs.push_back(transactionByIndex(it->second).tx);
+          txs.push_back(transactionByIndex(*transactionIndex).tx);
         }
       }
     }
@@ -202,18 +246,6 @@ namespace CryptoNote {
 
   private:
 
-    struct MultisignatureOutputUsage {
-      TransactionIndex transactionIndex;
-      uint16_t outputIndex;
-      bool isUsed;
-
-      void serialize(ISerializer& s) {
-        s(transactionIndex, "txindex");
-        s(outputIndex, "outindex");
-        s(isUsed, "used");
-      }
-    };
-
     struct TransactionEntry {
       Transaction tx;
       std::vector<uint32_t> m_global_output_indexes;
@@ -242,38 +274,104 @@ namespace CryptoNote {
       }
     };
 
-    typedef google::sparse_hash_set<Crypto::KeyImage> key_images_container;
+    // Ring signature collected during serial input checks and verified later, possibly on another thread.
+    // Output keys are copied since block store items may be evicted before the check runs.
+    struct RingSignatureCheck {
+      Crypto::Hash prefixHash;
+      Crypto::KeyImage keyImage;
+      std::vector<Crypto::PublicKey> outputKeys;
+      const Crypto::Signature* signatures;
+      size_t transactionIndex;
+    };
+
+    // Fixed-size summary of a BlockEntry kept in the block store index, readable without decoding the block
+    struct BlockEntryHeader {
+      Crypto::Hash hash;
+      uint64_t timestamp;
+      uint64_t blockCumulativeSize;
+      difficulty_type cumulativeDifficulty;
+      uint64_t alreadyGeneratedCoins;
+      uint64_t baseTransactionAmount;
+      uint32_t transactionsCount;
+      uint8_t majorVersion;
+      uint8_t minorVersion;
+    };
+
+    // Multisignature outputs journal is appended in the order outputs are pushed to the chain, so popping
+    // a block pops exactly its own records from the end. Key outputs are kept the same way by RandomOutputsIndex.
+    struct MultisignatureOutputRecord {
+      uint64_t amount;
+      uint32_t block;
+      uint16_t transaction;
+      uint16_t outputIndex;
+      uint32_t usedHeight;
+      uint8_t isUsed;
+    };
+
+    // Durable position of the file mapped chain index. Every entry written for blocks below height is
+    // on disk. When clean is not set the files may also hold entries of later blocks, which are dropped
+    // and replayed from the block store on start.
+    struct ChainIndexState {
+      uint32_t version;
+      uint32_t height;
+      Crypto::Hash tailId;
+      uint64_t outputsCount;
+      uint64_t multisignatureOutputsCount;
+      uint64_t keyImagesCount;
+      uint8_t clean;
+    };
+
+    typedef KeyImageStore key_images_container;
     typedef std::unordered_map<Crypto::Hash, BlockEntry> blocks_ext_by_hash;
-    typedef google::sparse_hash_map<uint64_t, std::vector<std::pair<TransactionIndex, uint16_t>>> outputs_container; //Crypto::Hash - tx hash, size_t - index of out in transaction
-    typedef google::sparse_hash_map<uint64_t, std::vector<MultisignatureOutputUsage>> MultisignatureOutputsContainer;
 
     const Currency& m_currency;
     tx_memory_pool& m_tx_pool;
-    std::recursive_mutex m_blockchain_lock; // TODO: add here reader/writer lock
+    // Taken exclusively by writers and shared by readers, except for the tip snapshot ones. The index
+    // files are remapped as the chain grows, so no read may run while a block is pushed or popped.
+    Tools::RecursiveSharedMutex m_blockchain_lock;
+    std::shared_ptr<const BlockchainTipSnapshot> m_tipSnapshot; // accessed only with std::atomic_load/atomic_store
+    // While a chain switch is in progress the tip is not published. The switching thread reads the tip
+    // it works on from m_switchTipSnapshot, built on demand and dropped on every pushed or popped block.
+    bool m_switchingChain;
+    std::shared_ptr<const BlockchainTipSnapshot> m_switchTipSnapshot;
+    // Minimal fee by height, filled on demand. Entries are kept only while they depend on nothing above their height.
+    std::vector<uint64_t> m_minimalFees;
+    std::mutex m_minimalFeesLock;
     Crypto::cn_context m_cn_context;
+    std::mutex m_longHashesLock;
+    std::condition_variable m_longHashesChanged;
+    std::unordered_map<Crypto::Hash, Crypto::Hash> m_precomputedLongHashes;
+    std::unordered_set<Crypto::Hash> m_expectedLongHashes;
     Tools::ObserverManager<IBlockchainStorageObserver> m_observerManager;
 
     key_images_container m_spent_keys;
     size_t m_current_block_cumul_sz_limit;
     blocks_ext_by_hash m_alternative_chains; // Crypto::Hash -> block_extended_info
-    outputs_container m_outputs;
+    RandomOutputsIndex m_randomOutputs;
+    BlockBlobsCache m_blockBlobs;
+    Crypto::ring_key_cache m_ringKeys;
+    // ring signature checks run on these threads together with the thread which asked for them
+    std::unique_ptr<BlockingQueue<std::function<void()>>> m_verificationTasks;
+    std::vector<std::thread> m_verificationWorkers;
 
     std::string m_config_folder;
     Checkpoints m_checkpoints;
     std::atomic<bool> m_is_in_checkpoint_zone;
 
-    typedef SwappedVector<BlockEntry> Blocks;
+    typedef MappedBlockStore<BlockEntry, BlockEntryHeader> Blocks;
     typedef std::unordered_map<Crypto::Hash, uint32_t> BlockMap;
-    typedef std::unordered_map<Crypto::Hash, TransactionIndex> TransactionMap;
+    typedef Common::FileMappedHashMap<Crypto::Hash, TransactionIndex> TransactionMap;
     typedef BasicUpgradeDetector<Blocks> UpgradeDetector;
 
-    friend class BlockCacheSerializer;
     friend class BlockchainIndicesSerializer;
 
     Blocks m_blocks;
     CryptoNote::BlockIndex m_blockIndex;
+    BlockMetadataIndex m_blockMetadata;
     TransactionMap m_transactionMap;
-    MultisignatureOutputsContainer m_multisignatureOutputs;
+    AmountOutputsIndex m_multisignatureOutputs; // positions in m_multisignatureOutputsJournal
+    Common::FileMappedVector<MultisignatureOutputRecord> m_multisignatureOutputsJournal;
+    ChainIndexState m_chainIndexState;
     UpgradeDetector m_upgradeDetectorV2;
     UpgradeDetector m_upgradeDetectorV3;
 	UpgradeDetector m_upgradeDetectorV4;
@@ -291,6 +389,30 @@ namespace CryptoNote {
 
     void rebuildCache();
     bool storeCache();
+    void publishTipSnapshot();
+    std::shared_ptr<const BlockchainTipSnapshot> buildTipSnapshot();
+    std::shared_ptr<const BlockchainTipSnapshot> currentTip();
+    difficulty_type computeDifficultyForNextBlock();
+    void truncateMinimalFees();
+    bool importLegacyBlocks(const std::string& config_folder);
+    static BlockEntryHeader makeBlockEntryHeader(const BlockEntry& block, const Crypto::Hash& blockHash);
+    std::string chainIndexFileName(const char* suffix) const;
+    bool openChainIndex();
+    void closeChainIndex();
+    void clearChainIndex();
+    bool loadChainIndex();
+    void verifyBlockStoreTail(uint32_t height);
+    void recoverChainIndex();
+    void indexBlock(uint32_t height);
+    void indexBlockTransactions(uint32_t height);
+    bool flushChainIndex();
+    bool saveChainIndexState();
+    void markChainIndexDirty();
+    void lowerChainIndexHeight(const BlockEntry& block);
+    uint32_t pushKeyOutput(const Transaction& transaction, TransactionIndex transactionIndex, uint16_t outputIndex);
+    uint32_t pushMultisignatureOutput(uint64_t amount, TransactionIndex transactionIndex, uint16_t outputIndex);
+    MultisignatureOutputRecord* findMultisignatureOutput(uint64_t amount, uint32_t index);
+    void setMultisignatureOutputUsed(MultisignatureOutputRecord& output, bool isUsed, uint32_t height);
     bool switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::iterator>& alt_chain, bool discard_disconnected_chain);
     bool handle_alternative_block(const Block& b, const Crypto::Hash& id, block_verification_context& bvc, bool sendNewAlternativeBlockMessage = true);
     difficulty_type get_next_difficulty_for_alternative_chain(const std::list<blocks_ext_by_hash::iterator>& alt_chain, BlockEntry& bei);
@@ -298,9 +420,8 @@ namespace CryptoNote {
     bool validate_miner_transaction(const Block& b, uint32_t height, size_t cumulativeBlockSize, uint64_t alreadyGeneratedCoins, uint64_t fee, uint64_t& reward, int64_t& emissionChange);
     bool rollback_blockchain_switching(std::list<Block>& original_chain, size_t rollback_height);
     bool get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count);
-    bool add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount& result_outs, uint64_t amount, size_t i);
     bool is_tx_spendtime_unlocked(uint64_t unlock_time);
-    size_t find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs);
+    bool isSpendtimeUnlocked(uint64_t unlock_time, uint32_t height) const;
     bool check_block_timestamp_main(const Block& b);
     bool check_block_timestamp(std::vector<uint64_t> timestamps, const Block& b);
     uint64_t get_adjusted_time();
@@ -311,10 +432,16 @@ namespace CryptoNote {
     std::vector<Crypto::Hash> doBuildSparseChain(const Crypto::Hash& startBlockId) const;
     bool getBlockCumulativeSize(const Block& block, size_t& cumulativeSize);
     bool update_next_cumulative_size_limit();
-    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height = NULL);
+    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, std::vector<RingSignatureCheck>& ringSignatureChecks, uint32_t* pmax_related_block_height = NULL);
+    bool checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height = NULL, std::vector<RingSignatureCheck>* deferredChecks = NULL);
+    bool checkRingSignatures(const std::vector<RingSignatureCheck>& checks, size_t& failedCheck);
+    void startVerificationWorkers();
+    void stopVerificationWorkers();
+    void waitPrecomputedLongHash(const Crypto::Hash& blockHash);
+    bool takePrecomputedLongHash(const Crypto::Hash& blockHash, Crypto::Hash& longHash);
     bool checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height = NULL);
-    const TransactionEntry& transactionByIndex(TransactionIndex index);
+    TransactionEntry transactionByIndex(TransactionIndex index);
+    std::shared_ptr<const BlockBlobs> loadBlockBlobs(uint32_t height);
     bool pushBlock(const Block& blockData, block_verification_context& bvc);
     bool pushBlock(const Block& blockData, const std::vector<Transaction>& transactions, block_verification_context& bvc);
     bool pushBlock(BlockEntry& block);
@@ -336,6 +463,7 @@ namespace CryptoNote {
     void sendMessage(const BlockchainMessage& message);
 
     friend class LockedBlockchainStorage;
+    friend class SharedLockedBlockchainStorage;
   };
 
   class LockedBlockchainStorage: boost::noncopyable {
@@ -351,45 +479,59 @@ namespace CryptoNote {
   private:
 
     Blockchain& m_bc;
-    std::lock_guard<std::recursive_mutex> m_lock;
+    std::lock_guard<Tools::RecursiveSharedMutex> m_lock;
+  };
+
+  // Like LockedBlockchainStorage, for callers which only read: other readers run meanwhile.
+  class SharedLockedBlockchainStorage: boost::noncopyable {
+  public:
+
+    SharedLockedBlockchainStorage(Blockchain& bc)
+      : m_bc(bc), m_lock(bc.m_blockchain_lock) {}
+
+    Blockchain* operator -> () {
+      return &m_bc;
+    }
+
+  private:
+
+    Blockchain& m_bc;
+    boost::shared_lock<Tools::RecursiveSharedMutex> m_lock;
   };
 
   template<class visitor_t> bool Blockchain::scanOutputKeysForIndexes(const KeyInput& tx_in_to_key, visitor_t& vis, uint32_t* pmax_related_block_height) {
-    std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
-    auto it = m_outputs.find(tx_in_to_key.amount);
-    if (it == m_outputs.end() || !tx_in_to_key.outputIndexes.size())
+    boost::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+    uint64_t amountSize = m_randomOutputs.size(tx_in_to_key.amount);
+    if (amountSize == 0 || !tx_in_to_key.outputIndexes.size())
       return false;
 
     std::vector<uint32_t> absolute_offsets = relative_output_offsets_to_absolute(tx_in_to_key.outputIndexes);
-    std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs_vec = it->second;
     size_t count = 0;
     for (uint64_t i : absolute_offsets) {
-      if(i >= amount_outs_vec.size() ) {
-        logger(Logging::INFO) << "Wrong index in transaction inputs: " << i << ", expected maximum " << amount_outs_vec.size() - 1;
+      RandomOutputsIndex::Output output;
+      if(i >= amountSize || !m_randomOutputs.get(tx_in_to_key.amount, i, output)) {
+        logger(Logging::INFO) << "Wrong index in transaction inputs: " << i << ", expected maximum " << amountSize - 1;
         return false;
       }
 
-      //auto tx_it = m_transactionMap.find(amount_outs_vec[i].first);
-      //if (!(tx_it != m_transactionMap.end())) { logger(ERROR, BRIGHT_RED) << "Wrong transaction id in output indexes: " << Common::podToHex(amount_outs_vec[i].first); return false; }
-
-      const TransactionEntry& tx = transactionByIndex(amount_outs_vec[i].first);
+      const TransactionEntry& tx = transactionByIndex({ output.height, output.transaction });
 
-      if (!(amount_outs_vec[i].second < tx.tx.outputs.size())) {
+      if (!(output.outputIndex < tx.tx.outputs.size())) {
         logger(Logging::ERROR, Logging::BRIGHT_RED)
             << "Wrong index in transaction outputs: "
-            << amount_outs_vec[i].second << ", expected less then "
+            << output.outputIndex << ", expected less then "
             << tx.tx.outputs.size();
         return false;
       }
 
-      if (!vis.handle_output(tx.tx, tx.tx.outputs[amount_outs_vec[i].second], amount_outs_vec[i].second)) {
+      if (!vis.handle_output(tx.tx, tx.tx.outputs[output.outputIndex], output.outputIndex)) {
         logger(Logging::INFO) << "Failed to handle_output for output no = " << count << ", with absolute offset " << i;
         return false;
       }
 
       if(count++ == absolute_offsets.size()-1 && pmax_related_block_height) {
-        if (*pmax_related_block_height < amount_outs_vec[i].first.block) {
-          *pmax_related_block_height = amount_outs_vec[i].first.block;
+        if (*pmax_related_block_height < output.height) {
+          *pmax_related_block_height = output.height;
         }
       }
     }
@@ -17,6 +17,7 @@
 
 #include "Core.h"
 
+#include <algorithm>
 #include <sstream>
 #include <unordered_set>
 #include <boost/utility/value_init.hpp>
@@ -25,6 +26,7 @@
 #include "../Common/CommandLine.h"
 #include "../Common/Util.h"
 #include "../Common/Math.h"
+#include "../Common/ScopeExit.h"
 #include "../Common/StringTools.h"
 #include "../crypto/crypto.h"
 #include "../CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
@@ -74,7 +76,8 @@ logger(logger, "core"),
 m_mempool(currency, m_blockchain, *this, m_timeProvider, logger, blockchainIndexesEnabled),
 m_blockchain(currency, m_mempool, logger, blockchainIndexesEnabled),
 m_miner(new miner(currency, *this, logger)),
-m_starter_message_showed(false) {
+m_starter_message_showed(false),
+m_proofOfWorkGeneration(0) {
   set_cryptonote_protocol(pprotocol);
   m_blockchain.addObserver(this);
     m_mempool.addObserver(this);
@@ -173,6 +176,7 @@ bool core::load_state_data() {
 
 bool core::deinit() {
   m_miner->stop();
+  waitProofOfWorkWorkers();
   m_mempool.deinit();
   m_blockchain.deinit();
   return true;
@@ -450,7 +454,7 @@ bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficu
   uint64_t already_generated_coins;
 
   {
-    LockedBlockchainStorage blockchainLock(m_blockchain);
+    SharedLockedBlockchainStorage blockchainLock(m_blockchain);
     height = m_blockchain.getCurrentBlockchainHeight();
     diffic = m_blockchain.getDifficultyForNextBlock();
     if (!(diffic)) {
@@ -669,6 +673,124 @@ bool core::handle_incoming_block_blob(const BinaryArray& block_blob, block_verif
   return handle_incoming_block(b, bvc, control_miner, relay_block);
 }
 
+// Long hashes of downloaded blocks are computed by worker threads while the blocks are committed one by one,
+// pushBlock picks them up instead of hashing under the blockchain lock.
+// A new batch supersedes the previous one: its workers finish the blocks they are hashing and exit, nobody waits for them.
+void core::precomputeProofOfWork(const std::vector<BinaryArray>& blockBlobs) {
+  uint64_t generation = ++m_proofOfWorkGeneration;
+  pruneProofOfWorkWorkers();
+
+  auto blocks = std::make_shared<std::vector<std::pair<Block, Crypto::Hash>>>();
+  blocks->reserve(blockBlobs.size());
+  for (const BinaryArray& blob : blockBlobs) {
+    Block b;
+    if (blob.size() > m_currency.maxBlockBlobSize() || !fromBinaryArray(b, blob)) {
+      // reported when the block is handled
+      continue;
+    }
+
+    if (m_blockchain.isInCheckpointZone(get_block_height(b))) {
+      continue;
+    }
+
+    Crypto::Hash blockHash = get_block_hash(b);
+    blocks->emplace_back(std::move(b), blockHash);
+  }
+
+  std::vector<Crypto::Hash> blockHashes;
+  blockHashes.reserve(blocks->size());
+  for (const auto& block : *blocks) {
+    blockHashes.push_back(block.second);
+  }
+
+  // also drops the expectations of the superseded batch when there is nothing to hash
+  m_blockchain.expectLongHashes(blockHashes);
+  if (blocks->empty()) {
+    return;
+  }
+
+  size_t workers = std::thread::hardware_concurrency();
+  if (workers == 0) {
+    workers = 2;
+  }
+
+  // blocks are taken in order, so the ones needed first by the committing thread are hashed first.
+  // Every worker takes up to SLOW_HASH_MAX_WAYS consecutive blocks and hashes them together,
+  // short batches keep all workers busy when there are few blocks.
+  size_t batchSize = std::min<size_t>((blocks->size() + workers - 1) / workers, Crypto::SLOW_HASH_MAX_WAYS);
+  workers = std::min(workers, (blocks->size() + batchSize - 1) / batchSize);
+
+  auto nextBlock = std::make_shared<std::atomic<size_t>>(0);
+  auto hashingFunction = [this, blocks, nextBlock, batchSize, generation] {
+    auto superseded = [this, generation] { return m_proofOfWorkGeneration.load() != generation; };
+    size_t begin = nextBlock->fetch_add(batchSize);
+
+    // a failed worker gives up its batch and the blocks nobody took yet, pushBlock hashes them itself instead of waiting.
+    // Expectations of a superseded batch were already replaced, the same blocks may be expected again by the new one.
+    Tools::ScopeExit cancelRemainingHashes([this, blocks, nextBlock, batchSize, &begin, superseded] {
+      if (superseded()) {
+        return;
+      }
+
+      for (; begin < blocks->size(); begin = nextBlock->fetch_add(batchSize)) {
+        for (size_t i = begin; i < std::min(begin + batchSize, blocks->size()); ++i) {
+          m_blockchain.cancelPrecomputedLongHash((*blocks)[i].second);
+        }
+      }
+    });
+
+    try {
+      Crypto::cn_context context;
+      BinaryArray blobs[Crypto::SLOW_HASH_MAX_WAYS];
+      const void* blobData[Crypto::SLOW_HASH_MAX_WAYS];
+      size_t blobSizes[Crypto::SLOW_HASH_MAX_WAYS];
+      size_t blockIndexes[Crypto::SLOW_HASH_MAX_WAYS];
+      Crypto::Hash longHashes[Crypto::SLOW_HASH_MAX_WAYS];
+
+      for (; begin < blocks->size() && !superseded(); begin = nextBlock->fetch_add(batchSize)) {
+        size_t end = std::min(begin + batchSize, blocks->size());
+        size_t count = 0;
+        for (size_t i = begin; i < end; ++i) {
+          if (get_block_longhash_blob((*blocks)[i].first, blobs[count])) {
+            blobData[count] = blobs[count].data();
+            blobSizes[count] = blobs[count].size();
+            blockIndexes[count] = i;
+            ++count;
+          } else {
+            m_blockchain.cancelPrecomputedLongHash((*blocks)[i].second);
+          }
+        }
+
+        Crypto::cn_slow_hash_multi(context, blobData, blobSizes, count, longHashes);
+        for (size_t i = 0; i < count; ++i) {
+          m_blockchain.addPrecomputedLongHash((*blocks)[blockIndexes[i]].second, longHashes[i]);
+        }
+      }
+    } catch (std::exception& e) {
+      logger(WARNING) << "Failed to precompute proof of work: " << e.what();
+    }
+  };
+
+  for (size_t i = 0; i < workers; ++i) {
+    m_proofOfWorkWorkers.push_back(std::async(std::launch::async, hashingFunction));
+  }
+}
+
+void core::waitProofOfWorkWorkers() {
+  ++m_proofOfWorkGeneration;
+  for (auto& worker : m_proofOfWorkWorkers) {
+    worker.wait();
+  }
+
+  m_proofOfWorkWorkers.clear();
+}
+
+void core::pruneProofOfWorkWorkers() {
+  m_proofOfWorkWorkers.erase(std::remove_if(m_proofOfWorkWorkers.begin(), m_proofOfWorkWorkers.end(), [](const std::future<void>& worker) {
+    return worker.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }), m_proofOfWorkWorkers.end());
+}
+
 bool core::handle_incoming_block(const Block& b, block_verification_context& bvc, bool control_miner, bool relay_block) {
   if (control_miner) {
     pause_mining();
@@ -754,7 +876,7 @@ std::vector<Crypto::Hash> core::buildSparseChain() {
 }
 
 std::vector<Crypto::Hash> core::buildSparseChain(const Crypto::Hash& startBlockId) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
   assert(m_blockchain.haveBlock(startBlockId));
   return m_blockchain.buildSparseChain(startBlockId);
 }
@@ -764,7 +886,7 @@ bool core::handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_R
 }
 
 Crypto::Hash core::getBlockIdByHeight(uint32_t height) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
   if (height < m_blockchain.getCurrentBlockchainHeight()) {
     return m_blockchain.getBlockIdByHeight(height);
   } else {
@@ -835,7 +957,7 @@ void core::poolUpdated() {
 bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
   uint32_t& resStartHeight, uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockFullInfo>& entries) {
 
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
 
   uint32_t currentHeight = lbs->getCurrentBlockchainHeight();
   uint32_t startOffset = 0;
@@ -863,26 +985,18 @@ bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t
     return true;
   }
 
-  std::list<Block> blocks;
-  lbs->getBlocks(startFullOffset, blocksLeft, blocks);
+  std::vector<std::shared_ptr<const BlockBlobs>> blocks;
+  lbs->getBlockBlobs(startFullOffset, blocksLeft, blocks);
 
-  for (auto& b : blocks) {
+  for (const auto& b : blocks) {
     BlockFullInfo item;
 
-    item.block_id = get_block_hash(b);
+    item.block_id = b->id;
 
-    if (b.timestamp >= timestamp) {
-      // query transactions
-      std::list<Transaction> txs;
-      std::list<Crypto::Hash> missedTxs;
-      lbs->getTransactions(b.transactionHashes, txs, missedTxs);
-
-      // fill data
+    if (b->timestamp >= timestamp) {
       block_complete_entry& completeEntry = item;
-      completeEntry.block = asString(toBinaryArray(b));
-      for (auto& tx : txs) {
-        completeEntry.txs.push_back(asString(toBinaryArray(tx)));
-      }
+      completeEntry.block = b->block;
+      completeEntry.txs = b->transactions;
     }
 
     entries.push_back(std::move(item));
@@ -892,7 +1006,7 @@ bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t
 }
 
 bool core::findStartAndFullOffsets(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& startOffset, uint32_t& startFullOffset) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
 
   if (knownBlockIds.empty()) {
     logger(ERROR, BRIGHT_RED) << "knownBlockIds is empty";
@@ -915,7 +1029,7 @@ bool core::findStartAndFullOffsets(const std::vector<Crypto::Hash>& knownBlockId
 std::vector<Crypto::Hash> core::findIdsForShortBlocks(uint32_t startOffset, uint32_t startFullOffset) {
   assert(startOffset <= startFullOffset);
 
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
 
   std::vector<Crypto::Hash> result;
   if (startOffset < startFullOffset) {
@@ -927,7 +1041,7 @@ std::vector<Crypto::Hash> core::findIdsForShortBlocks(uint32_t startOffset, uint
 
 bool core::queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& resStartHeight,
   uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockShortInfo>& entries) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
 
   resCurrentHeight = lbs->getCurrentBlockchainHeight();
   resStartHeight = 0;
@@ -951,27 +1065,21 @@ bool core::queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint6
     return true;
   }
 
-  std::list<Block> blocks;
-  lbs->getBlocks(resFullOffset, blocksLeft, blocks);
+  std::vector<std::shared_ptr<const BlockBlobs>> blocks;
+  lbs->getBlockBlobs(resFullOffset, blocksLeft, blocks);
 
-  for (auto& b : blocks) {
+  for (const auto& b : blocks) {
     BlockShortInfo item;
 
-    item.blockId = get_block_hash(b);
-
-    if (b.timestamp >= timestamp) {
-      std::list<Transaction> txs;
-      std::list<Crypto::Hash> missedTxs;
-      lbs->getTransactions(b.transactionHashes, txs, missedTxs);
-
-      item.block = asString(toBinaryArray(b));
+    item.blockId = b->id;
 
-      for (const auto& tx: txs) {
-        TransactionPrefixInfo info;
-        info.txPrefix = tx;
-        info.txHash = getObjectHash(tx);
+    if (b->timestamp >= timestamp) {
+      item.block = b->block;
 
-        item.txPrefixes.push_back(std::move(info));
+      item.txPrefixes.resize(b->transactions.size());
+      for (size_t i = 0; i < b->transactions.size(); ++i) {
+        item.txPrefixes[i].txHash = b->transactionHashes[i];
+        item.txPrefixes[i].txPrefix = b->transactionPrefixes[i];
       }
     }
 
@@ -1127,7 +1235,7 @@ std::vector<Crypto::Hash> core::getTransactionHashesByPaymentId(const Crypto::Ha
 }
 
 uint64_t core::getMinimalFee() {
-  return getMinimalFeeForHeight(get_current_blockchain_height() - 1);
+  return m_blockchain.getTipSnapshot()->minimalFee;
 }
 
 uint64_t core::getMinimalFeeForHeight(uint32_t height) {
@@ -1149,6 +1257,10 @@ uint64_t core::getTotalGeneratedAmount() {
   return m_blockchain.getCoinsInCirculation();
 }
 
+std::shared_ptr<const BlockchainTipSnapshot> core::getTipSnapshot() const {
+  return m_blockchain.getTipSnapshot();
+}
+
 uint8_t core::getBlockMajorVersionForHeight(uint32_t height) const {
   return m_blockchain.getBlockMajorVersionForHeight(height);
 }
@@ -1493,7 +1605,7 @@ bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash&
 
 std::unique_ptr<IBlock> core::getBlock(const Crypto::Hash& blockId) {
   std::lock_guard<decltype(m_mempool)> lk(m_mempool);
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
 
   std::unique_ptr<BlockWithTransactions> blockPtr(new BlockWithTransactions());
   if (!lbs->getBlockByHash(blockId, blockPtr->block)) {
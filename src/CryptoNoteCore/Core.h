@@ -18,6 +18,7 @@
 #pragma once
 
 #include <ctime>
+#include <future>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 #include "BlockchainExplorerData.h"
@@ -52,6 +53,7 @@ namespace CryptoNote {
      bool on_idle() override;
      virtual bool handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_context& tvc, bool keeped_by_block, bool loose_check) override; //Deprecated. Should be removed with CryptoNoteProtocolHandler.
      bool handle_incoming_block_blob(const BinaryArray& block_blob, block_verification_context& bvc, bool control_miner, bool relay_block) override;
+     virtual void precomputeProofOfWork(const std::vector<BinaryArray>& blockBlobs) override;
      virtual i_cryptonote_protocol* get_protocol() override {return m_pprotocol;}
      const Currency& currency() const { return m_currency; }
 
@@ -168,6 +170,8 @@ namespace CryptoNote {
 
      uint64_t getNextBlockDifficulty();
      uint64_t getTotalGeneratedAmount();
+     // Tip summary published with every block pushed or popped, reading it takes no lock.
+     std::shared_ptr<const BlockchainTipSnapshot> getTipSnapshot() const;
      uint8_t getBlockMajorVersionForHeight(uint32_t height) const;
      bool f_getMixin(const Transaction& transaction, uint64_t& mixin);
 
@@ -200,6 +204,8 @@ namespace CryptoNote {
      virtual void blockchainUpdated() override;
      virtual void txDeletedFromPool() override;
      void poolUpdated();
+     void waitProofOfWorkWorkers();
+     void pruneProofOfWorkWorkers();
 
      bool findStartAndFullOffsets(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& startOffset, uint32_t& startFullOffset);
      std::vector<Crypto::Hash> findIdsForShortBlocks(uint32_t startOffset, uint32_t startFullOffset);
@@ -219,5 +225,7 @@ namespace CryptoNote {
      std::atomic<bool> m_starter_message_showed;
      Tools::ObserverManager<ICoreObserver> m_observerManager;
 	 time_t start_time;
+     std::vector<std::future<void>> m_proofOfWorkWorkers;
+     std::atomic<uint64_t> m_proofOfWorkGeneration;
    };
 }
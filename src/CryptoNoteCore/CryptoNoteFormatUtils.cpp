@@ -18,6 +18,7 @@
 
 #include "CryptoNoteFormatUtils.h"
 
+#include <cstring>
 #include <set>
 #include <Logging/LoggerRef.h>
 #include <Common/Varint.h>
@@ -516,19 +517,39 @@ bool get_aux_block_header_hash(const Block& b, Hash& res) {
   return getObjectHash(blob, res);
 }
 
-bool get_block_longhash(cn_context &context, const Block& b, Hash& res) {
-  BinaryArray bd;
+// the data hashed by the proof of work of the block
+bool get_block_longhash_blob(const Block& b, BinaryArray& blob) {
+  blob.clear();
   if (b.majorVersion == BLOCK_MAJOR_VERSION_1 || b.majorVersion >= BLOCK_MAJOR_VERSION_4) {
-    if (!get_block_hashing_blob(b, bd)) {
-      return false;
-    }
+    return get_block_hashing_blob(b, blob);
   } else if (b.majorVersion == BLOCK_MAJOR_VERSION_2 || b.majorVersion == BLOCK_MAJOR_VERSION_3) {
-    if (!get_parent_block_hashing_blob(b, bd)) {
-      return false;
-    }
-  } else {
+    return get_parent_block_hashing_blob(b, blob);
+  }
+
+  return false;
+}
+
+bool get_block_longhash_blob(const Block& b, BinaryArray& blob, size_t& nonceOffset) {
+  if (!get_block_longhash_blob(b, blob)) {
     return false;
   }
+
+  // both layouts start with varint major and minor versions and timestamp, the previous block hash and the nonce
+  bool parentBlockLayout = b.majorVersion == BLOCK_MAJOR_VERSION_2 || b.majorVersion == BLOCK_MAJOR_VERSION_3;
+  uint8_t majorVersion = parentBlockLayout ? b.parentBlock.majorVersion : b.majorVersion;
+  uint8_t minorVersion = parentBlockLayout ? b.parentBlock.minorVersion : b.minorVersion;
+  nonceOffset = Tools::get_varint_data(majorVersion).size() + Tools::get_varint_data(minorVersion).size() +
+    Tools::get_varint_data(b.timestamp).size() + sizeof(Crypto::Hash);
+
+  return nonceOffset + sizeof(b.nonce) <= blob.size() && memcmp(blob.data() + nonceOffset, &b.nonce, sizeof(b.nonce)) == 0;
+}
+
+bool get_block_longhash(cn_context &context, const Block& b, Hash& res) {
+  BinaryArray bd;
+  if (!get_block_longhash_blob(b, bd)) {
+    return false;
+  }
+
   cn_slow_hash(context, bd.data(), bd.size(), res);
   return true;
 }
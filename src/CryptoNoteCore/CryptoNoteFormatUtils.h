@@ -74,6 +74,10 @@ bool get_parent_block_hashing_blob(const Block& b, BinaryArray& blob);
 bool get_aux_block_header_hash(const Block& b, Crypto::Hash& res);
 bool get_block_hash(const Block& b, Crypto::Hash& res);
 Crypto::Hash get_block_hash(const Block& b);
+bool get_block_longhash_blob(const Block& b, BinaryArray& blob);
+// As above, also giving the offset of the 4 nonce bytes in the blob. Changing the nonce of the block changes
+// only these bytes, so miners patch them in place instead of serializing the block for every nonce.
+bool get_block_longhash_blob(const Block& b, BinaryArray& blob, size_t& nonceOffset);
 bool get_block_longhash(Crypto::cn_context &context, const Block& b, Crypto::Hash& res);
 bool get_inputs_money_amount(const Transaction& tx, uint64_t& money);
 uint64_t get_outs_money_amount(const Transaction& tx);
@@ -83,6 +83,9 @@ namespace CryptoNote {
 			m_blocksFileName = "testnet_" + m_blocksFileName;
 			m_blocksCacheFileName = "testnet_" + m_blocksCacheFileName;
 			m_blockIndexesFileName = "testnet_" + m_blockIndexesFileName;
+			m_blockStoreFileName = "testnet_" + m_blockStoreFileName;
+			m_blockStoreIndexFileName = "testnet_" + m_blockStoreIndexFileName;
+			m_chainIndexFileName = "testnet_" + m_chainIndexFileName;
 			m_txPoolFileName = "testnet_" + m_txPoolFileName;
 			m_blockchainIndicesFileName = "testnet_" + m_blockchainIndicesFileName;
 		}
@@ -707,6 +710,14 @@ namespace CryptoNote {
 			return false;
 		}
 
+		return checkProofOfWorkV1(block, currentDiffic, proofOfWork);
+	}
+
+	bool Currency::checkProofOfWorkV1(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const {
+		if (BLOCK_MAJOR_VERSION_2 == block.majorVersion || BLOCK_MAJOR_VERSION_3 == block.majorVersion) {
+			return false;
+		}
+
 		return check_hash(proofOfWork, currentDiffic);
 	}
 
@@ -720,6 +731,14 @@ namespace CryptoNote {
 			return false;
 		}
 
+		return checkProofOfWorkV2(block, currentDiffic, proofOfWork);
+	}
+
+	bool Currency::checkProofOfWorkV2(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const {
+		if (block.majorVersion < BLOCK_MAJOR_VERSION_2) {
+			return false;
+		}
+
 		if (!check_hash(proofOfWork, currentDiffic)) {
 			return false;
 		}
@@ -767,6 +786,22 @@ namespace CryptoNote {
 		return false;
 	}
 
+	bool Currency::checkProofOfWork(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const {
+		switch (block.majorVersion) {
+		case BLOCK_MAJOR_VERSION_1:
+		case BLOCK_MAJOR_VERSION_4:
+		case BLOCK_MAJOR_VERSION_5:
+			return checkProofOfWorkV1(block, currentDiffic, proofOfWork);
+
+		case BLOCK_MAJOR_VERSION_2:
+		case BLOCK_MAJOR_VERSION_3:
+			return checkProofOfWorkV2(block, currentDiffic, proofOfWork);
+		}
+
+		logger(ERROR, BRIGHT_RED) << "Unknown block major version: " << block.majorVersion << "." << block.minorVersion;
+		return false;
+	}
+
 	size_t Currency::getApproximateMaximumInputCount(size_t transactionSize, size_t outputCount, size_t mixinCount) const {
 		const size_t KEY_IMAGE_SIZE = sizeof(Crypto::KeyImage);
 		const size_t OUTPUT_KEY_SIZE = sizeof(decltype(KeyOutput::key));
@@ -852,6 +887,9 @@ namespace CryptoNote {
 		blocksFileName(parameters::CRYPTONOTE_BLOCKS_FILENAME);
 		blocksCacheFileName(parameters::CRYPTONOTE_BLOCKSCACHE_FILENAME);
 		blockIndexesFileName(parameters::CRYPTONOTE_BLOCKINDEXES_FILENAME);
+		blockStoreFileName(parameters::CRYPTONOTE_BLOCKSTORE_FILENAME);
+		blockStoreIndexFileName(parameters::CRYPTONOTE_BLOCKSTOREINDEX_FILENAME);
+		chainIndexFileName(parameters::CRYPTONOTE_CHAININDEX_FILENAME);
 		txPoolFileName(parameters::CRYPTONOTE_POOLDATA_FILENAME);
 		blockchainIndicesFileName(parameters::CRYPTONOTE_BLOCKCHAIN_INDICES_FILENAME);
 
@@ -129,6 +129,9 @@ public:
   const std::string& blocksFileName() const { return m_blocksFileName; }
   const std::string& blocksCacheFileName() const { return m_blocksCacheFileName; }
   const std::string& blockIndexesFileName() const { return m_blockIndexesFileName; }
+  const std::string& blockStoreFileName() const { return m_blockStoreFileName; }
+  const std::string& blockStoreIndexFileName() const { return m_blockStoreIndexFileName; }
+  const std::string& chainIndexFileName() const { return m_chainIndexFileName; }
   const std::string& txPoolFileName() const { return m_txPoolFileName; }
   const std::string& blockchainIndicesFileName() const { return m_blockchainIndicesFileName; }
 
@@ -168,7 +171,11 @@ public:
 
   bool checkProofOfWorkV1(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork) const;
   bool checkProofOfWorkV2(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork) const;
+  bool checkProofOfWorkV1(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const;
+  bool checkProofOfWorkV2(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const;
   bool checkProofOfWork(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork) const;
+  // same checks for a long hash which was already computed with get_block_longhash
+  bool checkProofOfWork(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const;
 
   size_t getApproximateMaximumInputCount(size_t transactionSize, size_t outputCount, size_t mixinCount) const;
 
@@ -246,6 +253,9 @@ private:
   std::string m_blocksFileName;
   std::string m_blocksCacheFileName;
   std::string m_blockIndexesFileName;
+  std::string m_blockStoreFileName;
+  std::string m_blockStoreIndexFileName;
+  std::string m_chainIndexFileName;
   std::string m_txPoolFileName;
   std::string m_blockchainIndicesFileName;
 
@@ -332,6 +342,9 @@ public:
   CurrencyBuilder& blocksFileName(const std::string& val) { m_currency.m_blocksFileName = val; return *this; }
   CurrencyBuilder& blocksCacheFileName(const std::string& val) { m_currency.m_blocksCacheFileName = val; return *this; }
   CurrencyBuilder& blockIndexesFileName(const std::string& val) { m_currency.m_blockIndexesFileName = val; return *this; }
+  CurrencyBuilder& blockStoreFileName(const std::string& val) { m_currency.m_blockStoreFileName = val; return *this; }
+  CurrencyBuilder& blockStoreIndexFileName(const std::string& val) { m_currency.m_blockStoreIndexFileName = val; return *this; }
+  CurrencyBuilder& chainIndexFileName(const std::string& val) { m_currency.m_chainIndexFileName = val; return *this; }
   CurrencyBuilder& txPoolFileName(const std::string& val) { m_currency.m_txPoolFileName = val; return *this; }
   CurrencyBuilder& blockchainIndicesFileName(const std::string& val) { m_currency.m_blockchainIndicesFileName = val; return *this; }
   
@@ -0,0 +1,292 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "KeyImageStore.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace CryptoNote {
+
+namespace {
+
+const uint64_t INITIAL_BUCKET_COUNT = 256;
+const uint64_t BUCKETS_PER_BLOOM_BLOCK = 8;
+const unsigned BLOOM_HASH_COUNT = 6;
+
+uint64_t imageWord(const Crypto::KeyImage& image, size_t index) {
+  uint64_t word;
+  std::memcpy(&word, reinterpret_cast<const uint8_t*>(&image) + index * sizeof(uint64_t), sizeof(word));
+  return word;
+}
+
+uint32_t imageTag(const Crypto::KeyImage& image) {
+  return static_cast<uint32_t>(imageWord(image, 1));
+}
+
+uint64_t bloomBlockCount(uint64_t bucketCount) {
+  return std::max<uint64_t>(bucketCount / BUCKETS_PER_BLOOM_BLOCK, 1);
+}
+
+}
+
+KeyImageStore::KeyImageStore() : m_buckets(nullptr), m_bucketMask(0), m_bloom(nullptr), m_bloomMask(0) {
+}
+
+void KeyImageStore::open(const std::string& path) {
+  m_images.open(path, Common::FileMappedVectorOpenMode::OPEN_OR_CREATE, sizeof(uint64_t) * 2);
+  m_images.setAutoFlush(false);
+  m_bucketFile.open(path + ".buckets", Common::FileMappedVectorOpenMode::OPEN_OR_CREATE, sizeof(IndexHeader));
+  m_bucketFile.setAutoFlush(false);
+  m_bloomFile.open(path + ".bloom", Common::FileMappedVectorOpenMode::OPEN_OR_CREATE, sizeof(IndexHeader));
+  m_bloomFile.setAutoFlush(false);
+
+  if (isIndexValid()) {
+    m_buckets = m_bucketFile.data();
+    m_bucketMask = m_bucketFile.size() - 1;
+    m_bloom = m_bloomFile.data();
+    m_bloomMask = m_bloomFile.size() - 1;
+    return;
+  }
+
+  uint64_t bucketCount = INITIAL_BUCKET_COUNT;
+  while (bucketCount * MAX_BUCKET_LOAD < m_images.size() * 2) {
+    bucketCount *= 2;
+  }
+
+  rebuildIndex(bucketCount);
+}
+
+void KeyImageStore::close() {
+  std::error_code ignore;
+  m_images.close(ignore);
+  m_bucketFile.close(ignore);
+  m_bloomFile.close(ignore);
+  m_buckets = nullptr;
+  m_bloom = nullptr;
+}
+
+bool KeyImageStore::isOpened() const {
+  return m_images.isOpened();
+}
+
+bool KeyImageStore::contains(const Crypto::KeyImage& image) const {
+  return mayContain(image) && findPosition(image) != nullptr;
+}
+
+size_t KeyImageStore::contains(const std::vector<Crypto::KeyImage>& images, std::vector<bool>& found) const {
+  found.assign(images.size(), false);
+
+  std::vector<size_t> candidates;
+  candidates.reserve(images.size());
+  for (size_t i = 0; i < images.size(); ++i) {
+    if (mayContain(images[i])) {
+      candidates.push_back(i);
+    }
+  }
+
+  size_t foundCount = 0;
+  for (size_t i : candidates) {
+    if (findPosition(images[i]) != nullptr) {
+      found[i] = true;
+      ++foundCount;
+    }
+  }
+
+  return foundCount;
+}
+
+bool KeyImageStore::insert(const Crypto::KeyImage& image) {
+  if (contains(image)) {
+    return false;
+  }
+
+  if (m_images.size() + indexHeader().erasedCount + 1 > (m_bucketMask + 1) * MAX_BUCKET_LOAD) {
+    // erased slots are dropped by the rebuild, grow only if live images need it
+    uint64_t bucketCount = m_bucketMask + 1;
+    rebuildIndex((m_images.size() + 1) * 2 > bucketCount * MAX_BUCKET_LOAD ? bucketCount * 2 : bucketCount);
+  }
+
+  if (m_images.size() >= ERASED_POSITION) {
+    throw std::runtime_error("KeyImageStore is full");
+  }
+
+  uint32_t position = static_cast<uint32_t>(m_images.size());
+  m_images.push_back(image);
+  addToIndex(image, position);
+  indexHeader().imageCount = m_images.size();
+  return true;
+}
+
+bool KeyImageStore::erase(const Crypto::KeyImage& image) {
+  uint32_t* slot = const_cast<uint32_t*>(findPosition(image));
+  if (slot == nullptr) {
+    return false;
+  }
+
+  uint32_t position = *slot;
+  *slot = ERASED_POSITION;
+  ++indexHeader().erasedCount;
+
+  uint32_t last = static_cast<uint32_t>(m_images.size() - 1);
+  if (position != last) {
+    Crypto::KeyImage moved = m_images[last];
+    uint32_t* movedSlot = const_cast<uint32_t*>(findPosition(moved));
+    assert(movedSlot != nullptr);
+    *movedSlot = position;
+    m_images[position] = moved;
+  }
+
+  m_images.pop_back();
+  indexHeader().imageCount = m_images.size();
+  return true;
+}
+
+void KeyImageStore::truncate(uint64_t count) {
+  while (m_images.size() > count) {
+    m_images.pop_back();
+  }
+
+  // slots written after the last flush may be torn, so the index is rebuilt even if no image was dropped
+  rebuildIndex(m_bucketMask + 1);
+}
+
+void KeyImageStore::clear() {
+  m_images.clear();
+  rebuildIndex(INITIAL_BUCKET_COUNT);
+}
+
+void KeyImageStore::flush() {
+  m_images.flush();
+  m_bucketFile.flush();
+  m_bloomFile.flush();
+}
+
+bool KeyImageStore::mayContain(const Crypto::KeyImage& image) const {
+  const uint64_t* block = m_bloom[(imageWord(image, 0) >> 32) & m_bloomMask].words;
+  uint64_t bits = imageWord(image, 2);
+  for (unsigned i = 0; i < BLOOM_HASH_COUNT; ++i, bits >>= 9) {
+    unsigned bit = static_cast<unsigned>(bits & 511);
+    if ((block[bit / 64] & (uint64_t(1) << (bit % 64))) == 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+const uint32_t* KeyImageStore::findPosition(const Crypto::KeyImage& image) const {
+  uint32_t tag = imageTag(image);
+  for (uint64_t index = imageWord(image, 0) & m_bucketMask;; index = (index + 1) & m_bucketMask) {
+    const Bucket& bucket = m_buckets[index];
+    bool hasEmptySlot = false;
+    for (uint32_t i = 0; i < BUCKET_SIZE; ++i) {
+      uint32_t position = bucket.positions[i];
+      if (position == EMPTY_POSITION) {
+        hasEmptySlot = true;
+      } else if (position != ERASED_POSITION && bucket.tags[i] == tag && m_images[position] == image) {
+        return &bucket.positions[i];
+      }
+    }
+
+    // inserts always take the first bucket with a free slot, so the probe sequence ends here
+    if (hasEmptySlot) {
+      return nullptr;
+    }
+  }
+}
+
+void KeyImageStore::addToIndex(const Crypto::KeyImage& image, uint32_t position) {
+  for (uint64_t index = imageWord(image, 0) & m_bucketMask;; index = (index + 1) & m_bucketMask) {
+    Bucket& bucket = m_buckets[index];
+    uint32_t slot = 0;
+    while (slot < BUCKET_SIZE && bucket.positions[slot] != EMPTY_POSITION && bucket.positions[slot] != ERASED_POSITION) {
+      ++slot;
+    }
+
+    if (slot < BUCKET_SIZE) {
+      if (bucket.positions[slot] == ERASED_POSITION) {
+        --indexHeader().erasedCount;
+      }
+
+      bucket.tags[slot] = imageTag(image);
+      bucket.positions[slot] = position;
+      break;
+    }
+  }
+
+  uint64_t* block = m_bloom[(imageWord(image, 0) >> 32) & m_bloomMask].words;
+  uint64_t bits = imageWord(image, 2);
+  for (unsigned i = 0; i < BLOOM_HASH_COUNT; ++i, bits >>= 9) {
+    unsigned bit = static_cast<unsigned>(bits & 511);
+    block[bit / 64] |= uint64_t(1) << (bit % 64);
+  }
+}
+
+KeyImageStore::IndexHeader& KeyImageStore::indexHeader() {
+  return *reinterpret_cast<IndexHeader*>(m_bucketFile.prefix());
+}
+
+// The index files are written together with the images, so after a flush they describe exactly
+// the images found on open. Missing or resized files are rebuilt.
+bool KeyImageStore::isIndexValid() {
+  uint64_t bucketCount = m_bucketFile.size();
+  return bucketCount >= INITIAL_BUCKET_COUNT && (bucketCount & (bucketCount - 1)) == 0 &&
+    m_bloomFile.size() == bloomBlockCount(bucketCount) && indexHeader().imageCount == m_images.size();
+}
+
+void KeyImageStore::rebuildIndex(uint64_t bucketCount) {
+  assert((bucketCount & (bucketCount - 1)) == 0);
+
+  Bucket emptyBucket;
+  std::memset(emptyBucket.tags, 0, sizeof(emptyBucket.tags));
+  for (uint32_t i = 0; i < BUCKET_SIZE; ++i) {
+    emptyBucket.positions[i] = EMPTY_POSITION;
+  }
+
+  m_bucketFile.clear();
+  m_bucketFile.reserve(bucketCount);
+  for (uint64_t i = 0; i < bucketCount; ++i) {
+    m_bucketFile.push_back(emptyBucket);
+  }
+
+  m_buckets = m_bucketFile.data();
+  m_bucketMask = bucketCount - 1;
+
+  BloomBlock emptyBlock;
+  std::memset(&emptyBlock, 0, sizeof(emptyBlock));
+  uint64_t blockCount = bloomBlockCount(bucketCount);
+  m_bloomFile.clear();
+  m_bloomFile.reserve(blockCount);
+  for (uint64_t i = 0; i < blockCount; ++i) {
+    m_bloomFile.push_back(emptyBlock);
+  }
+
+  m_bloom = m_bloomFile.data();
+  m_bloomMask = blockCount - 1;
+
+  indexHeader().erasedCount = 0;
+  for (uint64_t position = 0; position < m_images.size(); ++position) {
+    addToIndex(m_images[position], static_cast<uint32_t>(position));
+  }
+
+  indexHeader().imageCount = m_images.size();
+}
+
+}
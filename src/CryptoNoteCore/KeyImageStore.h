@@ -0,0 +1,108 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Common/FileMappedVector.h"
+#include "crypto/crypto.h"
+
+namespace CryptoNote
+{
+  // Set of spent key images. The images themselves are kept in a file mapped array in insertion order;
+  // lookups go through an index kept in two more file mapped arrays next to it:
+  //  - a blocked Bloom filter (one cache line per image) which answers most "not spent" queries,
+  //  - open addressing buckets of one cache line each, holding 32-bit tags and array positions.
+  // The index is used as it is found on open and rebuilt only if it does not match the images.
+  // Key images are uniformly distributed, so their prefix words are used as hashes directly.
+  // Erase moves the last image into the erased position, so images of the most recently inserted
+  // block stay at the end of the array. Crash consistency is up to the owner: flush() makes every
+  // change durable, after a crash truncate() drops the images of unflushed blocks and rebuilds the index.
+  class KeyImageStore {
+
+  public:
+
+    KeyImageStore();
+    KeyImageStore(const KeyImageStore&) = delete;
+    KeyImageStore& operator=(const KeyImageStore&) = delete;
+
+    void open(const std::string& path);
+    void close();
+    bool isOpened() const;
+
+    uint64_t size() const {
+      return m_images.size();
+    }
+
+    bool contains(const Crypto::KeyImage& image) const;
+
+    // Looks up all images at once. Bloom filter blocks of every image are read before any bucket
+    // is probed, so cache misses of independent lookups overlap. Returns the number of images found.
+    size_t contains(const std::vector<Crypto::KeyImage>& images, std::vector<bool>& found) const;
+
+    // Returns false if the image is already present
+    bool insert(const Crypto::KeyImage& image);
+    bool erase(const Crypto::KeyImage& image);
+
+    // keeps the first count inserted images and rebuilds the index
+    void truncate(uint64_t count);
+    void clear();
+    void flush();
+
+  private:
+
+    static const uint32_t BUCKET_SIZE = 8;
+    static const uint32_t MAX_BUCKET_LOAD = 6;
+    static const uint32_t EMPTY_POSITION = UINT32_MAX;
+    static const uint32_t ERASED_POSITION = UINT32_MAX - 1;
+
+    struct Bucket {
+      uint32_t tags[BUCKET_SIZE];
+      uint32_t positions[BUCKET_SIZE];
+    };
+
+    struct BloomBlock {
+      uint64_t words[8]; // 512 bits, one cache line
+    };
+
+    // Prefix of the bucket file. With the size and capacity FileMappedVector keeps after it,
+    // buckets and Bloom blocks start at offset 64 and stay on cache lines.
+    struct IndexHeader {
+      uint64_t imageCount;
+      uint64_t erasedCount;
+      uint64_t reserved[4];
+    };
+
+    Common::FileMappedVector<Crypto::KeyImage> m_images;
+    Common::FileMappedVector<Bucket> m_bucketFile;
+    Common::FileMappedVector<BloomBlock> m_bloomFile;
+    Bucket* m_buckets;
+    uint64_t m_bucketMask;
+    BloomBlock* m_bloom;
+    uint64_t m_bloomMask;
+
+    IndexHeader& indexHeader();
+    bool isIndexValid();
+    bool mayContain(const Crypto::KeyImage& image) const;
+    const uint32_t* findPosition(const Crypto::KeyImage& image) const;
+    void addToIndex(const Crypto::KeyImage& image, uint32_t position);
+    void rebuildIndex(uint64_t bucketCount);
+  };
+}
@@ -0,0 +1,431 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "Common/FileMappedVector.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/VectorOutputStream.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/BinaryOutputStreamSerializer.h"
+#include "System/MemoryMappedFile.h"
+#include "crypto/hash.h"
+
+// Append-only storage for serialized items. Item bodies are written into memory-mapped
+// segment files that are never remapped or copied once created; a file-mapped index keeps
+// the location and checksum of every item together with a fixed-size POD header supplied by
+// the caller. Headers are read in place, items are decoded straight from the mapping on every
+// access and returned by value, so reads never change the store and any number of threads may
+// read while nobody writes.
+//
+// flush() records how many items are durable in the index prefix. Items written after that
+// are verified against their checksums on open and the index is cut at the first torn one.
+template<class T, class H> class MappedBlockStore {
+public:
+  typedef T value_type;
+  typedef H header_type;
+
+  static const uint64_t SEGMENT_SIZE = 64 * 1024 * 1024;
+
+  // items are decoded on access, so iterators hand out copies
+  struct ItemPointer {
+    T item;
+
+    const T* operator->() const {
+      return &item;
+    }
+  };
+
+  class const_iterator {
+  public:
+    typedef ptrdiff_t difference_type;
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef ItemPointer pointer;
+    typedef T reference;
+    typedef T value_type;
+
+    const_iterator() {
+    }
+
+    const_iterator(const MappedBlockStore* store, size_t index) : m_store(store), m_index(index) {
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return m_index != other.m_index;
+    }
+
+    bool operator<(const const_iterator& other) const {
+      return m_index < other.m_index;
+    }
+
+    bool operator<=(const const_iterator& other) const {
+      return m_index <= other.m_index;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return m_index == other.m_index;
+    }
+
+    bool operator>(const const_iterator& other) const {
+      return m_index > other.m_index;
+    }
+
+    bool operator>=(const const_iterator& other) const {
+      return m_index >= other.m_index;
+    }
+
+    const_iterator& operator++() {
+      ++m_index;
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator i = *this;
+      ++m_index;
+      return i;
+    }
+
+    const_iterator& operator--() {
+      --m_index;
+      return *this;
+    }
+
+    const_iterator operator--(int) {
+      const_iterator i = *this;
+      --m_index;
+      return i;
+    }
+
+    const_iterator& operator+=(difference_type n) {
+      m_index += n;
+      return *this;
+    }
+
+    const_iterator& operator-=(difference_type n) {
+      m_index -= n;
+      return *this;
+    }
+
+    const_iterator operator+(difference_type n) const {
+      return const_iterator(m_store, m_index + n);
+    }
+
+    friend const_iterator operator+(difference_type n, const const_iterator& i) {
+      return const_iterator(i.m_store, n + i.m_index);
+    }
+
+    difference_type operator-(const const_iterator& other) const {
+      return m_index - other.m_index;
+    }
+
+    const_iterator operator-(difference_type n) const {
+      return const_iterator(m_store, m_index - n);
+    }
+
+    T operator*() const {
+      return (*m_store)[m_index];
+    }
+
+    ItemPointer operator->() const {
+      return ItemPointer{ (*m_store)[m_index] };
+    }
+
+    T operator[](difference_type offset) const {
+      return (*m_store)[m_index + offset];
+    }
+
+    size_t index() const {
+      return m_index;
+    }
+
+  private:
+    const MappedBlockStore* m_store;
+    size_t m_index;
+  };
+
+  MappedBlockStore();
+  MappedBlockStore(const MappedBlockStore&) = delete;
+  ~MappedBlockStore();
+  MappedBlockStore& operator=(const MappedBlockStore&) = delete;
+
+  bool open(const std::string& segmentFileName, const std::string& indexFileName);
+  void close();
+  void flush();
+
+  bool empty() const;
+  uint64_t size() const;
+  const_iterator begin() const;
+  const_iterator end() const;
+  T operator[](uint64_t index) const;
+  T front() const;
+  T back() const;
+  const H& header(uint64_t index) const;
+  // The item as serialized by push_back, valid until the item is popped or the store is closed
+  const uint8_t* rawItem(uint64_t index, size_t& itemSize) const;
+  const H& backHeader() const;
+  void clear();
+  void pop_back();
+  void push_back(const T& item, const H& header);
+
+private:
+  struct IndexEntry {
+    uint32_t segment;
+    uint32_t size;
+    uint64_t offset;
+    Crypto::Hash checksum;
+    H header;
+  };
+
+  std::string m_segmentFileName;
+  std::vector<std::unique_ptr<System::MemoryMappedFile>> m_segments;
+  // the prefix holds the number of items made durable by the last flush()
+  Common::FileMappedVector<IndexEntry> m_index;
+
+  std::string segmentPath(size_t segment) const;
+  System::MemoryMappedFile& prepareSegment(size_t segment, uint64_t minSize);
+  uint64_t& flushedCount();
+  bool isWritten(const IndexEntry& entry) const;
+  static Crypto::Hash checksum(const uint8_t* data, size_t size, const H& header);
+};
+
+template<class T, class H> const uint64_t MappedBlockStore<T, H>::SEGMENT_SIZE;
+
+template<class T, class H> MappedBlockStore<T, H>::MappedBlockStore() {
+}
+
+template<class T, class H> MappedBlockStore<T, H>::~MappedBlockStore() {
+  close();
+}
+
+template<class T, class H> bool MappedBlockStore<T, H>::open(const std::string& segmentFileName, const std::string& indexFileName) {
+  try {
+    m_segmentFileName = segmentFileName;
+    m_segments.clear();
+    for (size_t segment = 0; boost::filesystem::exists(segmentPath(segment)); ++segment) {
+      std::unique_ptr<System::MemoryMappedFile> file(new System::MemoryMappedFile());
+      file->open(segmentPath(segment));
+      m_segments.emplace_back(std::move(file));
+    }
+
+    m_index.open(indexFileName, Common::FileMappedVectorOpenMode::OPEN_OR_CREATE, sizeof(uint64_t));
+    // durability is provided by explicit flush() calls, flushing every push costs an fsync
+    m_index.setAutoFlush(false);
+
+    // segments are created at full size, so only the checksum tells whether the data of an item
+    // written after the last flush reached the disk before a crash
+    uint64_t flushed = std::min(flushedCount(), m_index.size());
+    for (uint64_t index = flushed; index < m_index.size(); ++index) {
+      if (!isWritten(m_index[index])) {
+        while (m_index.size() > index) {
+          m_index.pop_back();
+        }
+
+        break;
+      }
+    }
+
+    flushedCount() = flushed;
+  } catch (std::exception&) {
+    return false;
+  }
+
+  return true;
+}
+
+template<class T, class H> void MappedBlockStore<T, H>::close() {
+  std::error_code ignore;
+  for (auto& segment : m_segments) {
+    segment->close(ignore);
+  }
+
+  m_segments.clear();
+  if (m_index.isOpened()) {
+    m_index.flush();
+    m_index.close(ignore);
+  }
+}
+
+template<class T, class H> void MappedBlockStore<T, H>::flush() {
+  for (auto& segment : m_segments) {
+    segment->flush(segment->data(), segment->size());
+  }
+
+  m_index.flush();
+  if (flushedCount() != m_index.size()) {
+    flushedCount() = m_index.size();
+    m_index.flush();
+  }
+}
+
+template<class T, class H> bool MappedBlockStore<T, H>::empty() const {
+  return size() == 0;
+}
+
+template<class T, class H> uint64_t MappedBlockStore<T, H>::size() const {
+  return m_index.isOpened() ? m_index.size() : 0;
+}
+
+template<class T, class H> typename MappedBlockStore<T, H>::const_iterator MappedBlockStore<T, H>::begin() const {
+  return const_iterator(this, 0);
+}
+
+template<class T, class H> typename MappedBlockStore<T, H>::const_iterator MappedBlockStore<T, H>::end() const {
+  return const_iterator(this, size());
+}
+
+template<class T, class H> T MappedBlockStore<T, H>::operator[](uint64_t index) const {
+  if (index >= size()) {
+    throw std::runtime_error("MappedBlockStore::operator[]");
+  }
+
+  const IndexEntry& entry = m_index[index];
+  T item;
+  Common::MemoryInputStream stream(m_segments[entry.segment]->data() + entry.offset, entry.size);
+  CryptoNote::BinaryInputStreamSerializer archive(stream);
+  serialize(item, archive);
+  return item;
+}
+
+template<class T, class H> T MappedBlockStore<T, H>::front() const {
+  return operator[](0);
+}
+
+template<class T, class H> T MappedBlockStore<T, H>::back() const {
+  return operator[](size() - 1);
+}
+
+template<class T, class H> const H& MappedBlockStore<T, H>::header(uint64_t index) const {
+  return m_index[index].header;
+}
+
+template<class T, class H> const uint8_t* MappedBlockStore<T, H>::rawItem(uint64_t index, size_t& itemSize) const {
+  if (index >= size()) {
+    throw std::runtime_error("MappedBlockStore::rawItem");
+  }
+
+  const IndexEntry& entry = m_index[index];
+  itemSize = entry.size;
+  return m_segments[entry.segment]->data() + entry.offset;
+}
+
+template<class T, class H> const H& MappedBlockStore<T, H>::backHeader() const {
+  return m_index.back().header;
+}
+
+template<class T, class H> void MappedBlockStore<T, H>::clear() {
+  m_index.clear();
+  flushedCount() = 0;
+  m_index.flush();
+}
+
+template<class T, class H> void MappedBlockStore<T, H>::pop_back() {
+  if (empty()) {
+    throw std::runtime_error("MappedBlockStore::pop_back");
+  }
+
+  m_index.pop_back();
+  if (flushedCount() > m_index.size()) {
+    // the next item overwrites the data of the popped one, it must not be taken for a flushed item after a crash
+    flushedCount() = m_index.size();
+    m_index.flush();
+  }
+}
+
+template<class T, class H> void MappedBlockStore<T, H>::push_back(const T& item, const H& header) {
+  std::vector<uint8_t> data;
+
+  {
+    Common::VectorOutputStream stream(data);
+    CryptoNote::BinaryOutputStreamSerializer archive(stream);
+    serialize(const_cast<T&>(item), archive);
+  }
+
+  IndexEntry entry;
+  entry.segment = 0;
+  entry.offset = 0;
+  if (!m_index.empty()) {
+    const IndexEntry& last = m_index.back();
+    entry.segment = last.segment;
+    entry.offset = last.offset + last.size;
+  }
+
+  if (entry.segment < m_segments.size() && entry.offset + data.size() > m_segments[entry.segment]->size()) {
+    ++entry.segment;
+    entry.offset = 0;
+  }
+
+  System::MemoryMappedFile& segment = prepareSegment(entry.segment, data.size());
+  if (!data.empty()) {
+    std::memcpy(segment.data() + entry.offset, data.data(), data.size());
+  }
+
+  entry.size = static_cast<uint32_t>(data.size());
+  entry.checksum = checksum(data.data(), data.size(), header);
+  entry.header = header;
+  m_index.push_back(entry);
+}
+
+template<class T, class H> std::string MappedBlockStore<T, H>::segmentPath(size_t segment) const {
+  return m_segmentFileName + "." + std::to_string(segment);
+}
+
+template<class T, class H> System::MemoryMappedFile& MappedBlockStore<T, H>::prepareSegment(size_t segment, uint64_t minSize) {
+  if (segment < m_segments.size()) {
+    if (m_segments[segment]->size() >= minSize) {
+      return *m_segments[segment];
+    }
+
+    // segment is left over from popped items and too small for the new one, recreate it
+    m_segments.resize(segment);
+  }
+
+  while (m_segments.size() <= segment) {
+    std::unique_ptr<System::MemoryMappedFile> file(new System::MemoryMappedFile());
+    file->create(segmentPath(m_segments.size()), std::max(SEGMENT_SIZE, minSize), true);
+    m_segments.emplace_back(std::move(file));
+  }
+
+  return *m_segments[segment];
+}
+
+template<class T, class H> uint64_t& MappedBlockStore<T, H>::flushedCount() {
+  return *reinterpret_cast<uint64_t*>(m_index.prefix());
+}
+
+template<class T, class H> bool MappedBlockStore<T, H>::isWritten(const IndexEntry& entry) const {
+  if (entry.segment >= m_segments.size() || entry.offset + entry.size > m_segments[entry.segment]->size()) {
+    return false;
+  }
+
+  return checksum(m_segments[entry.segment]->data() + entry.offset, entry.size, entry.header) == entry.checksum;
+}
+
+template<class T, class H> Crypto::Hash MappedBlockStore<T, H>::checksum(const uint8_t* data, size_t size, const H& header) {
+  Crypto::Hash hashes[2];
+  hashes[0] = Crypto::cn_fast_hash(data, size);
+  hashes[1] = Crypto::cn_fast_hash(&header, sizeof(header));
+  return Crypto::cn_fast_hash(hashes, sizeof(hashes));
+}
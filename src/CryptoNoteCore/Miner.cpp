@@ -29,6 +29,11 @@
 #include <boost/limits.hpp>
 #include <boost/utility/value_init.hpp>
 
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #include "crypto/crypto.h"
 #include "Common/CommandLine.h"
 #include "Common/StringTools.h"
@@ -42,11 +47,27 @@ using namespace Logging;
 namespace CryptoNote
 {
 
+namespace {
+
+  bool pinCurrentThread(unsigned cpu) {
+#if defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+    return false;
+#endif
+  }
+
+}
+
   miner::miner(const Currency& currency, IMinerHandler& handler, Logging::ILogger& log) :
     m_currency(currency),
     logger(log, "miner"),
     m_stop(true),
     m_template(boost::value_initialized<Block>()),
+    m_template_nonce_offset(0),
     m_template_no(0),
     m_diffic(0),
     m_handler(handler),
@@ -57,6 +78,11 @@ namespace CryptoNote
     m_hashes(0),
     m_do_print_hashrate(false),
     m_do_mining(false),
+    m_pin_threads(false),
+    m_huge_pages_threads(0),
+    m_transparent_huge_pages_threads(0),
+    m_last_huge_pages_threads(0),
+    m_last_transparent_huge_pages_threads(0),
     m_current_hash_rate(0),
     m_update_block_template_interval(5),
     m_update_merge_hr_interval(2)
@@ -85,6 +111,11 @@ namespace CryptoNote
       }
     }
 
+    if (!get_block_longhash_blob(m_template, m_template_blob, m_template_nonce_offset)) {
+      logger(ERROR) << "Failed to get hashing blob of block template";
+      return false;
+    }
+
     m_diffic = di;
     ++m_template_no;
     m_starter_nonce = Crypto::rand<uint32_t>();
@@ -157,7 +188,17 @@ namespace CryptoNote
       if(m_do_print_hashrate) {
         uint64_t total_hr = std::accumulate(m_last_hash_rates.begin(), m_last_hash_rates.end(), static_cast<uint64_t>(0));
         float hr = static_cast<float>(total_hr)/static_cast<float>(m_last_hash_rates.size());
-        std::cout << "hashrate: " << std::setprecision(4) << std::fixed << hr << ENDL;
+        std::cout << "hashrate: " << std::setprecision(4) << std::fixed << hr << ", huge pages on " << m_huge_pages_threads <<
+          ", transparent huge pages requested on " << m_transparent_huge_pages_threads << " of " << m_threads_total << " threads" << ENDL;
+      }
+
+      uint32_t hugePagesThreads = m_huge_pages_threads;
+      uint32_t transparentHugePagesThreads = m_transparent_huge_pages_threads;
+      if (hugePagesThreads != m_last_huge_pages_threads || transparentHugePagesThreads != m_last_transparent_huge_pages_threads) {
+        m_last_huge_pages_threads = hugePagesThreads;
+        m_last_transparent_huge_pages_threads = transparentHugePagesThreads;
+        logger(INFO) << "Hashrate " << m_current_hash_rate << " H/s, scratchpads on huge pages in " << hugePagesThreads <<
+          ", on transparent huge pages if the kernel finds them in " << transparentHugePagesThreads << " of " << m_threads_total << " threads";
       }
     }
     
@@ -194,6 +235,8 @@ namespace CryptoNote
       logger(INFO) << "Loaded " << m_extra_messages.size() << " extra messages, current index " << m_config.current_extra_message_index;
     }
 
+    m_pin_threads = config.miningPinThreads;
+
     if(!config.startMining.empty()) {
       if (!m_currency.parseAccountAddressString(config.startMining, m_mine_address)) {
         logger(ERROR) << "Target account address " << config.startMining << " has wrong format, starting daemon canceled";
@@ -368,8 +411,25 @@ namespace CryptoNote
     uint32_t nonce = m_starter_nonce + th_local_index;
     difficulty_type local_diff = 0;
     uint32_t local_template_ver = 0;
+
+    if (m_pin_threads) {
+      unsigned cpuCount = std::thread::hardware_concurrency();
+      if (cpuCount == 0 || !pinCurrentThread(th_local_index % cpuCount)) {
+        logger(WARNING) << "Failed to pin miner thread [" << th_local_index << "] to a CPU";
+      }
+    }
+
+    // created after pinning, the scratchpads get faulted in on the NUMA node of this thread
     Crypto::cn_context context;
+    bool pagesChecked = false;
+    bool hugePages = false;
+    bool transparentHugePages = false;
     Block b;
+    size_t nonceOffset = 0;
+    BinaryArray blobs[Crypto::SLOW_HASH_MAX_WAYS];
+    const void* blobData[Crypto::SLOW_HASH_MAX_WAYS];
+    size_t blobSizes[Crypto::SLOW_HASH_MAX_WAYS];
+    Crypto::Hash hashes[Crypto::SLOW_HASH_MAX_WAYS];
 
     while(!m_stop)
     {
@@ -383,6 +443,12 @@ namespace CryptoNote
         std::unique_lock<std::mutex> lk(m_template_lock);
         b = m_template;
         local_diff = m_diffic;
+        nonceOffset = m_template_nonce_offset;
+        for (size_t i = 0; i < Crypto::SLOW_HASH_MAX_WAYS; ++i) {
+          blobs[i] = m_template_blob;
+          blobData[i] = blobs[i].data();
+          blobSizes[i] = blobs[i].size();
+        }
         lk.unlock();
 
         local_template_ver = m_template_no;
@@ -396,16 +462,33 @@ namespace CryptoNote
         continue;
       }
 
-      b.nonce = nonce;
-      Crypto::Hash h;
-      if (!m_stop && !get_block_longhash(context, b, h)) {
-        logger(ERROR) << "Failed to get block long hash";
-        m_stop = true;
+      // nonces of a round are hashed together, see cn_slow_hash_multi. Only the nonce bytes of the
+      // hashing blob change between nonces, so they are patched in place
+      for (size_t i = 0; i < Crypto::SLOW_HASH_MAX_WAYS; ++i) {
+        uint32_t wayNonce = nonce + static_cast<uint32_t>(i) * m_threads_total;
+        memcpy(blobs[i].data() + nonceOffset, &wayNonce, sizeof(wayNonce));
       }
 
-      if (!m_stop && check_hash(h, local_diff))
-      {
+      Crypto::cn_slow_hash_multi(context, blobData, blobSizes, Crypto::SLOW_HASH_MAX_WAYS, hashes);
+
+      if (!pagesChecked) {
+        pagesChecked = true;
+        hugePages = context.hugePages();
+        transparentHugePages = context.transparentHugePages();
+        if (hugePages) {
+          ++m_huge_pages_threads;
+        } else if (transparentHugePages) {
+          ++m_transparent_huge_pages_threads;
+        }
+      }
+
+      for (size_t i = 0; i < Crypto::SLOW_HASH_MAX_WAYS && !m_stop; ++i) {
+        if (!check_hash(hashes[i], local_diff)) {
+          continue;
+        }
+
         //we lucky!
+        b.nonce = nonce + static_cast<uint32_t>(i) * m_threads_total;
         ++m_config.current_extra_message_index;
 
         logger(INFO, GREEN) << "Found block for difficulty: " << local_diff;
@@ -416,11 +499,20 @@ namespace CryptoNote
           //success update, lets update config
           Common::saveStringToFile(m_config_folder_path + "/" + CryptoNote::parameters::MINER_CONFIG_FILE_NAME, storeToJson(m_config));
         }
+
+        // the template is replaced after a block is found, the rest of the round is stale
+        break;
       }
 
-      nonce += m_threads_total;
-      ++m_hashes;
+      nonce += static_cast<uint32_t>(Crypto::SLOW_HASH_MAX_WAYS) * m_threads_total;
+      m_hashes += Crypto::SLOW_HASH_MAX_WAYS;
+    }
+    if (hugePages) {
+      --m_huge_pages_threads;
+    } else if (transparentHugePages) {
+      --m_transparent_huge_pages_threads;
     }
+
     logger(INFO) << "Miner thread stopped ["<< th_local_index << "]";
     return true;
   }
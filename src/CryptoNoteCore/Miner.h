@@ -74,6 +74,8 @@ namespace CryptoNote {
     std::atomic<bool> m_stop;
     std::mutex m_template_lock;
     Block m_template;
+    BinaryArray m_template_blob;
+    size_t m_template_nonce_offset;
     std::atomic<uint32_t> m_template_no;
     std::atomic<uint32_t> m_starter_nonce;
     difficulty_type m_diffic;
@@ -99,5 +101,10 @@ namespace CryptoNote {
     std::list<uint64_t> m_last_hash_rates;
     bool m_do_print_hashrate;
     bool m_do_mining;
+    bool m_pin_threads;
+    std::atomic<uint32_t> m_huge_pages_threads;
+    std::atomic<uint32_t> m_transparent_huge_pages_threads;
+    uint32_t m_last_huge_pages_threads;
+    uint32_t m_last_transparent_huge_pages_threads;
   };
 }
@@ -0,0 +1,169 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "RandomOutputsIndex.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace CryptoNote {
+
+void RandomOutputsIndex::open(const std::string& journalPath, const std::string& positionsPath) {
+  std::lock_guard<boost::shared_mutex> lock(m_mutex);
+  m_journal.open(journalPath);
+  m_journal.setAutoFlush(false);
+  m_positions.open(positionsPath);
+}
+
+void RandomOutputsIndex::close() {
+  std::lock_guard<boost::shared_mutex> lock(m_mutex);
+  std::error_code ignore;
+  if (m_journal.isOpened()) {
+    m_journal.close(ignore);
+  }
+
+  if (m_positions.isOpened()) {
+    m_positions.close();
+  }
+}
+
+bool RandomOutputsIndex::isOpened() const {
+  return m_journal.isOpened();
+}
+
+void RandomOutputsIndex::clear() {
+  std::lock_guard<boost::shared_mutex> lock(m_mutex);
+  m_journal.clear();
+  m_positions.clear();
+}
+
+void RandomOutputsIndex::flush() {
+  std::lock_guard<boost::shared_mutex> lock(m_mutex);
+  m_journal.flush();
+  m_positions.flush();
+}
+
+uint64_t RandomOutputsIndex::push(const Output& output) {
+  std::lock_guard<boost::shared_mutex> lock(m_mutex);
+  assert(m_positions.size(output.amount) == 0 || at(output.amount, m_positions.size(output.amount) - 1).height <= output.height);
+  m_journal.push_back(output);
+  return m_positions.push(output.amount, m_journal.size() - 1);
+}
+
+void RandomOutputsIndex::pop(uint64_t amount) {
+  std::lock_guard<boost::shared_mutex> lock(m_mutex);
+  assert(!m_journal.empty() && m_journal.back().amount == amount);
+  m_positions.pop(amount);
+  m_journal.pop_back();
+}
+
+void RandomOutputsIndex::truncate(uint64_t count, uint32_t height) {
+  std::lock_guard<boost::shared_mutex> lock(m_mutex);
+  while (m_journal.size() > count || (!m_journal.empty() && m_journal.back().height >= height)) {
+    m_journal.pop_back();
+  }
+
+  m_positions.truncate(m_journal.size());
+}
+
+uint64_t RandomOutputsIndex::journalSize() const {
+  boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+  return m_journal.size();
+}
+
+uint64_t RandomOutputsIndex::size(uint64_t amount) const {
+  boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+  return m_positions.size(amount);
+}
+
+bool RandomOutputsIndex::get(uint64_t amount, uint64_t index, Output& output) const {
+  boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+  uint64_t position;
+  if (!m_positions.find(amount, index, position)) {
+    return false;
+  }
+
+  output = m_journal[position];
+  return true;
+}
+
+bool RandomOutputsIndex::select(uint64_t amount, uint64_t count, uint32_t heightLimit, const std::function<bool(uint64_t)>& isUnlocked,
+  std::vector<std::pair<uint32_t, Crypto::PublicKey>>& outputs) const {
+  boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+  uint64_t amountSize = m_positions.size(amount);
+  if (amountSize == 0) {
+    return false;
+  }
+
+  // outputs are appended block by block, so heights never decrease
+  uint64_t limit = 0;
+  for (uint64_t high = amountSize; limit < high;) {
+    uint64_t middle = limit + (high - limit) / 2;
+    if (at(amount, middle).height < heightLimit) {
+      limit = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  if (amountSize <= count) {
+    for (uint64_t i = 0; i < limit; ++i) {
+      const Output& output = at(amount, i);
+      if (isUnlocked(output.unlockTime)) {
+        outputs.emplace_back(static_cast<uint32_t>(i), output.key);
+      }
+    }
+
+    return true;
+  }
+
+  std::unordered_set<uint64_t> used;
+  uint64_t tryCount = 0;
+  for (uint64_t j = 0; j != count && tryCount < limit;) {
+    // triangular distribution over [a,b) with a=0, mode c=b=limit
+    uint64_t r = Crypto::rand<uint64_t>() % ((uint64_t)1 << 53);
+    double frac = std::sqrt((double)r / ((uint64_t)1 << 53));
+    uint64_t i = (uint64_t)(frac * limit);
+    if (!used.insert(i).second) {
+      continue;
+    }
+
+    ++tryCount;
+    const Output& output = at(amount, i);
+    if (isUnlocked(output.unlockTime)) {
+      outputs.emplace_back(static_cast<uint32_t>(i), output.key);
+      ++j;
+    }
+  }
+
+  return true;
+}
+
+const RandomOutputsIndex::Output& RandomOutputsIndex::at(uint64_t amount, uint64_t index) const {
+  uint64_t position;
+  if (!m_positions.find(amount, index, position)) {
+    throw std::runtime_error("RandomOutputsIndex: output position not found");
+  }
+
+  return m_journal[position];
+}
+
+}
@@ -0,0 +1,94 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/thread/shared_mutex.hpp>
+
+#include "Common/FileMappedVector.h"
+#include "CryptoNoteCore/AmountOutputsIndex.h"
+#include "crypto/crypto.h"
+
+namespace CryptoNote
+{
+  // Key outputs of every amount in global index order, with the data needed to offer them as mixins and to
+  // find the transaction of a ring member. Outputs are kept in a file mapped journal in the order they are
+  // pushed to the chain, so popping a block pops exactly its own outputs from the end; a file mapped
+  // AmountOutputsIndex locates them by amount and global index. Nothing is loaded on open.
+  // Mixin selection reads only this table and never touches block storage. Readers share a lock that
+  // writers hold just for the time of a push or pop, so selection does not wait for block processing.
+  class RandomOutputsIndex {
+
+  public:
+
+    struct Output {
+      uint64_t amount;
+      uint64_t unlockTime;
+      Crypto::PublicKey key;
+      uint32_t height;
+      uint16_t transaction;
+      uint16_t outputIndex;
+    };
+
+    void open(const std::string& journalPath, const std::string& positionsPath);
+    void close();
+    bool isOpened() const;
+    void clear();
+    void flush();
+
+    // Returns the global index of the output within its amount
+    uint64_t push(const Output& output);
+    void pop(uint64_t amount);
+
+    // Keeps the first count outputs of the journal and drops the outputs of blocks from height on,
+    // then erases the positions of dropped outputs. Used to recover from a crash.
+    void truncate(uint64_t count, uint32_t height);
+
+    uint64_t journalSize() const;
+    uint64_t size(uint64_t amount) const;
+    bool get(uint64_t amount, uint64_t index, Output& output) const;
+
+    // Picks up to count outputs of amount created below heightLimit, drawn from a triangular distribution
+    // which favours recent outputs. All such outputs are returned when the amount has no more than count.
+    // Outputs for which isUnlocked(unlockTime) is false are skipped. Returns false if the amount is unknown.
+    bool select(uint64_t amount, uint64_t count, uint32_t heightLimit, const std::function<bool(uint64_t)>& isUnlocked,
+      std::vector<std::pair<uint32_t, Crypto::PublicKey>>& outputs) const;
+
+    // Calls visitor(output) for every output in journal order
+    template<class Visitor>
+    void forEach(Visitor visitor) const {
+      boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+      for (uint64_t i = 0; i < m_journal.size(); ++i) {
+        visitor(m_journal[i]);
+      }
+    }
+
+  private:
+
+    mutable boost::shared_mutex m_mutex;
+    Common::FileMappedVector<Output> m_journal;
+    AmountOutputsIndex m_positions;
+
+    const Output& at(uint64_t amount, uint64_t index) const;
+  };
+}
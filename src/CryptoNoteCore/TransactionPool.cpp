@@ -99,8 +99,6 @@ namespace CryptoNote {
 
   using CryptoNote::BlockInfo;
 
-  std::unordered_set<Crypto::Hash> m_validated_transactions;
-
   //---------------------------------------------------------------------------------
   tx_memory_pool::tx_memory_pool(
     const CryptoNote::Currency& currency,
@@ -210,6 +208,7 @@ namespace CryptoNote {
       }
       m_paymentIdIndex.add(tx);
       m_timestampIndex.add(txd.receiveTime, txd.id);
+      m_uncheckedTransactions.insert(id);
     }
 
     tvc.m_added_to_pool = true;
@@ -279,53 +278,50 @@ namespace CryptoNote {
   }
 
   //---------------------------------------------------------------------------------
-  void tx_memory_pool::get_difference(const std::vector<Crypto::Hash>& known_tx_ids, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids) const {
+  void tx_memory_pool::get_difference(const std::vector<Crypto::Hash>& known_tx_ids, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids) {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
-    std::unordered_set<Crypto::Hash> ready_tx_ids;
-    for (const auto& tx : m_transactions) {
-      TransactionCheckInfo checkInfo(tx);
-	  if (m_validated_transactions.find(tx.id) != m_validated_transactions.end()) {
-		  ready_tx_ids.insert(tx.id);
-		  logger(DEBUGGING) << "MemPool - tx " << tx.id << " loaded from cache";
-	  }
-	  else if (is_transaction_ready_to_go(tx.tx, checkInfo)) {
-		  ready_tx_ids.insert(tx.id);
-		  m_validated_transactions.insert(tx.id);
-		  logger(DEBUGGING) << "MemPool - tx " << tx.id << " added to cache";
-	  }
-    }
+    updateReadiness();
 
     std::unordered_set<Crypto::Hash> known_set(known_tx_ids.begin(), known_tx_ids.end());
-    for (auto it = ready_tx_ids.begin(), e = ready_tx_ids.end(); it != e;) {
-      auto known_it = known_set.find(*it);
+    new_tx_ids.clear();
+    for (const auto& id : m_readyTransactions) {
+      auto known_it = known_set.find(id);
       if (known_it != known_set.end()) {
         known_set.erase(known_it);
-        it = ready_tx_ids.erase(it);
-      }
-      else {
-        ++it;
+      } else {
+        new_tx_ids.push_back(id);
       }
     }
 
-    new_tx_ids.assign(ready_tx_ids.begin(), ready_tx_ids.end());
     deleted_tx_ids.assign(known_set.begin(), known_set.end());
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash& top_block_id) {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
-    if (!m_validated_transactions.empty()) {
-      logger(DEBUGGING) << "MemPool - Block height incremented, cleared " << m_validated_transactions.size() << " cached transaction hashes. New height: " << new_block_height << " Top block: " << top_block_id;
-      m_validated_transactions.clear();
-	}
+    m_spendCheckTransactions.insert(m_readyTransactions.begin(), m_readyTransactions.end());
+    m_readyTransactions.clear();
+    for (const auto& txd : m_transactions) {
+      if (m_spendCheckTransactions.count(txd.id) == 0) {
+        m_uncheckedTransactions.insert(txd.id);
+      }
+    }
+
+    logger(DEBUGGING) << "MemPool - Block height incremented, " << m_spendCheckTransactions.size() << " ready transactions to check for spent key images, " <<
+      m_uncheckedTransactions.size() << " to check in full. New height: " << new_block_height << " Top block: " << top_block_id;
     return true;
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::on_blockchain_dec(uint64_t new_block_height, const Crypto::Hash& top_block_id) {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
-    if (!m_validated_transactions.empty()) {
-      logger(DEBUGGING, YELLOW) << "MemPool - Block height decremented " << m_validated_transactions.size() << " cached transaction hashes. New height: " << new_block_height << " Top block: " << top_block_id;
-      m_validated_transactions.clear();
-	}
+    // outputs a ready transaction refers to may have been popped with the block
+    m_readyTransactions.clear();
+    m_spendCheckTransactions.clear();
+    for (const auto& txd : m_transactions) {
+      m_uncheckedTransactions.insert(txd.id);
+    }
+
+    logger(DEBUGGING, YELLOW) << "MemPool - Block height decremented, " << m_uncheckedTransactions.size() << " transactions to check in full. New height: " <<
+      new_block_height << " Top block: " << top_block_id;
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -363,6 +359,36 @@ namespace CryptoNote {
     return true;
   }
   //---------------------------------------------------------------------------------
+  void tx_memory_pool::updateReadiness() {
+    for (const auto& id : m_spendCheckTransactions) {
+      auto it = m_transactions.find(id);
+      if (it != m_transactions.end() && !m_validator.haveSpentKeyImages(it->tx)) {
+        m_readyTransactions.insert(id);
+      }
+    }
+
+    m_spendCheckTransactions.clear();
+
+    for (const auto& id : m_uncheckedTransactions) {
+      auto it = m_transactions.find(id);
+      if (it == m_transactions.end()) {
+        continue;
+      }
+
+      TransactionCheckInfo checkInfo(*it);
+      if (is_transaction_ready_to_go(it->tx, checkInfo)) {
+        m_readyTransactions.insert(id);
+      }
+
+      // keep the check state, so a transaction failed at this tail is not checked in full again
+      m_transactions.modify(it, [&checkInfo](TransactionCheckInfo& item) {
+        item = checkInfo;
+      });
+    }
+
+    m_uncheckedTransactions.clear();
+  }
+  //---------------------------------------------------------------------------------
   std::string tx_memory_pool::print_pool(bool short_format) const {
     std::stringstream ss;
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
@@ -400,6 +426,7 @@ namespace CryptoNote {
     max_total_size = std::min(max_total_size, maxCumulativeSize) - m_currency.minerTxBlobReservedSize();
 
     BlockTemplate blockTemplate;
+    updateReadiness();
 
     for (auto it = m_fee_index.rbegin(); it != m_fee_index.rend() && it->fee == 0; ++it) {
       const auto& txd = *it;
@@ -408,39 +435,19 @@ namespace CryptoNote {
         continue;
       }
 
-      TransactionCheckInfo checkInfo(txd);
-      if (is_transaction_ready_to_go(txd.tx, checkInfo) && blockTemplate.addTransaction(txd.id, txd.tx)) {
+      if (m_readyTransactions.count(txd.id) != 0 && blockTemplate.addTransaction(txd.id, txd.tx)) {
         total_size += txd.blobSize;
         logger(DEBUGGING) << "Fusion transaction " << txd.id << " included to block template";
       }
     }
 
-    for (auto i = m_fee_index.begin(); i != m_fee_index.end(); ++i) {
-      const auto& txd = *i;
-
+    for (const auto& txd : m_fee_index) {
       size_t blockSizeLimit = (txd.fee == 0) ? median_size : max_total_size;
       if (blockSizeLimit < total_size + txd.blobSize) {
         continue;
       }
 
-      TransactionCheckInfo checkInfo(txd);
-	  bool ready = false;
-	  if (m_validated_transactions.find(txd.id) != m_validated_transactions.end()) {
-		  ready = true;
-		  logger(DEBUGGING) << "Fill block template - tx added from cache: " << txd.id;
-	  }
-	  else if (is_transaction_ready_to_go(txd.tx, checkInfo)) {
-		  ready = true;
-		  m_validated_transactions.insert(txd.id);
-		  logger(DEBUGGING) << "Fill block template - tx added to cache: " << txd.id;
-	  }
-
-      // update item state
-      m_fee_index.modify(i, [&checkInfo](TransactionCheckInfo& item) {
-        item = checkInfo;
-      });
-
-      if (ready && blockTemplate.addTransaction(txd.id, txd.tx)) {
+      if (m_readyTransactions.count(txd.id) != 0 && blockTemplate.addTransaction(txd.id, txd.tx)) {
         total_size += txd.blobSize;
         fee += txd.fee;
         logger(DEBUGGING) << "Transaction " << txd.id << " included to block template";
@@ -476,6 +483,13 @@ namespace CryptoNote {
       buildIndices();
     }
 
+    m_readyTransactions.clear();
+    m_spendCheckTransactions.clear();
+    m_uncheckedTransactions.clear();
+    for (const auto& txd : m_transactions) {
+      m_uncheckedTransactions.insert(txd.id);
+    }
+
     removeExpiredTransactions();
 
     // Ignore deserialization error
@@ -588,10 +602,9 @@ namespace CryptoNote {
     removeTransactionInputs(i->id, i->tx, i->keptByBlock);
     m_paymentIdIndex.remove(i->tx);
     m_timestampIndex.remove(i->receiveTime, i->id);
-    if (m_validated_transactions.find(i->id) != m_validated_transactions.end()) {
-      m_validated_transactions.erase(i->id);
-      logger(DEBUGGING) << "Removing transaction from MemPool cache " << i->id << ". Cache size: " << m_validated_transactions.size();
-    }
+    m_readyTransactions.erase(i->id);
+    m_spendCheckTransactions.erase(i->id);
+    m_uncheckedTransactions.erase(i->id);
     return m_transactions.erase(i);
   }
 
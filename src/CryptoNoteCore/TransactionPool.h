@@ -115,7 +115,7 @@ namespace CryptoNote {
     bool fill_block_template(Block &bl, size_t median_size, size_t maxCumulativeSize, uint64_t already_generated_coins, size_t &total_size, uint64_t &fee);
 
     void get_transactions(std::list<Transaction>& txs) const;
-    void get_difference(const std::vector<Crypto::Hash>& known_tx_ids, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids) const;
+    void get_difference(const std::vector<Crypto::Hash>& known_tx_ids, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids);
     size_t get_transactions_count() const;
     std::string print_pool(bool short_format) const;
 	
@@ -200,6 +200,7 @@ namespace CryptoNote {
     tx_container_t::iterator removeTransaction(tx_container_t::iterator i);
     bool removeExpiredTransactions();
     bool is_transaction_ready_to_go(const Transaction& tx, TransactionCheckInfo& txd) const;
+    void updateReadiness();
 
     void buildIndices();
 
@@ -219,6 +220,13 @@ namespace CryptoNote {
     tx_container_t::nth_index<1>::type& m_fee_index;
     std::unordered_map<Crypto::Hash, uint64_t> m_recentlyDeletedTransactions;
 
+    // Every pooled transaction is in at most one of these sets. Those in none of them failed their last check and
+    // wait for the chain to change. A pushed block can only spend inputs of a ready transaction, so such a
+    // transaction just has its key images looked up again; anything else is evaluated in full.
+    std::unordered_set<Crypto::Hash> m_readyTransactions;
+    std::unordered_set<Crypto::Hash> m_spendCheckTransactions;
+    std::unordered_set<Crypto::Hash> m_uncheckedTransactions;
+
     Logging::LoggerRef logger;
 
     PaymentIdIndex m_paymentIdIndex;
@@ -420,7 +420,17 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
 
 int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& context, const std::vector<block_complete_entry>& blocks) {
 
+  // proof of work is computed in the background while blocks are committed below
+  std::vector<BinaryArray> blockBlobs;
+  blockBlobs.reserve(blocks.size());
   for (const block_complete_entry& block_entry : blocks) {
+    blockBlobs.push_back(asBinaryArray(block_entry.block));
+  }
+
+  m_core.precomputeProofOfWork(blockBlobs);
+
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    const block_complete_entry& block_entry = blocks[i];
     if (m_stop) {
       break;
     }
@@ -443,7 +453,7 @@ int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& conte
 
     // process block
     block_verification_context bvc = boost::value_initialized<block_verification_context>();
-    m_core.handle_incoming_block_blob(asBinaryArray(block_entry.block), bvc, false, false);
+    m_core.handle_incoming_block_blob(blockBlobs[i], bvc, false, false);
 
     if (bvc.m_verification_failed) {
       logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection";
@@ -43,6 +43,7 @@
 #include "version.h"
 
 #include <Logging/LoggerManager.h>
+#include <System/DispatcherGroup.h>
 
 #if defined(WIN32)
 #include <crtdbg.h>
@@ -60,6 +61,7 @@ namespace
   const command_line::arg_descriptor<bool>        arg_os_version  = {"os-version", ""};
   const command_line::arg_descriptor<std::string> arg_log_file    = {"log-file", "", ""};
   const command_line::arg_descriptor<int>         arg_log_level   = {"log-level", "", 2}; // info level
+  const command_line::arg_descriptor<bool>        arg_log_async   = {"log-async", "Write log messages from a background thread, dropping them when it falls behind"};
   const command_line::arg_descriptor<bool>        arg_console     = {"no-console", "Disable daemon console commands"};
   const command_line::arg_descriptor<bool>        arg_restricted_rpc = {"restricted-rpc", "Restrict RPC to view only commands to prevent abuse"};
   const command_line::arg_descriptor<bool>        arg_enable_blockchain_indexes = { "enable-blockchain-indexes", "Enable blockchain indexes", false };
@@ -84,9 +86,12 @@ void print_genesis_tx_hex(const po::variables_map& vm, LoggerManager& logManager
   return;
 }
 
-JsonValue buildLoggerConfiguration(Level level, const std::string& logfile) {
+JsonValue buildLoggerConfiguration(Level level, const std::string& logfile, bool async) {
   JsonValue loggerConfiguration(JsonValue::OBJECT);
   loggerConfiguration.insert("globalLevel", static_cast<int64_t>(level));
+  if (async) {
+    loggerConfiguration.insert("async", JsonValue::OBJECT);
+  }
 
   JsonValue& cfgLoggers = loggerConfiguration.insert("loggers", JsonValue::ARRAY);
 
@@ -128,6 +133,7 @@ int main(int argc, char* argv[])
 
     command_line::add_arg(desc_cmd_sett, arg_log_file);
     command_line::add_arg(desc_cmd_sett, arg_log_level);
+    command_line::add_arg(desc_cmd_sett, arg_log_async);
     command_line::add_arg(desc_cmd_sett, arg_console);
 	command_line::add_arg(desc_cmd_sett, arg_restricted_rpc);
     command_line::add_arg(desc_cmd_sett, arg_testnet_on);
@@ -199,7 +205,7 @@ int main(int argc, char* argv[])
     Level cfgLogLevel = static_cast<Level>(static_cast<int>(Logging::ERROR) + command_line::get_arg(vm, arg_log_level));
 
     // configure logging
-    logManager.configure(buildLoggerConfiguration(cfgLogLevel, cfgLogFile));
+    logManager.configure(buildLoggerConfiguration(cfgLogLevel, cfgLogFile, command_line::get_arg(vm, arg_log_async)));
 
     logger(INFO) << CryptoNote::CRYPTONOTE_NAME << " v" << PROJECT_VERSION_LONG;
 
@@ -291,6 +297,10 @@ int main(int argc, char* argv[])
     }
 
     System::Dispatcher dispatcher;
+    std::unique_ptr<System::DispatcherGroup> rpcLoops;
+    if (rpcConfig.threads != 0) {
+      rpcLoops.reset(new System::DispatcherGroup(rpcConfig.threads));
+    }
 
     CryptoNote::CryptoNoteProtocolHandler cprotocol(currency, dispatcher, ccore, nullptr, logManager);
     CryptoNote::NodeServer p2psrv(dispatcher, cprotocol, logManager);
@@ -341,8 +351,7 @@ int main(int argc, char* argv[])
       dch.start_handling();
     }
 
-    logger(INFO) << "Starting core rpc server on address " << rpcConfig.getBindAddress();
-    rpcServer.start(rpcConfig.bindIp, rpcConfig.bindPort);
+    // the rpc worker loops read these settings as soon as the server is started
     rpcServer.restrictRPC(command_line::get_arg(vm, arg_restricted_rpc));
     rpcServer.enableCors(command_line::get_arg(vm, arg_enable_cors));
 	if (command_line::has_arg(vm, arg_set_fee_address)) {
@@ -367,6 +376,8 @@ int main(int argc, char* argv[])
         rpcServer.setContactInfo(contact_str);
       }
     }
+    logger(INFO) << "Starting core rpc server on address " << rpcConfig.getBindAddress();
+    rpcServer.start(rpcConfig.bindIp, rpcConfig.bindPort, "", "", rpcLoops.get());
     logger(INFO) << "Core rpc server started ok";
 
     Tools::SignalHandler::install([&dch, &p2psrv] {
@@ -38,6 +38,7 @@ namespace CryptoNote {
 
   private:
     friend class HttpParser;
+    friend class HttpRequestParser;
 
     std::string method;
     std::string url;
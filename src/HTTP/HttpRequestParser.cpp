@@ -0,0 +1,296 @@
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2017-2018 Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "HttpRequestParser.h"
+
+#include <cstring>
+#include <system_error>
+
+#include "HttpParserErrorCodes.h"
+
+namespace {
+
+using CryptoNote::error::HttpParserErrorCodes;
+
+void throwError(HttpParserErrorCodes code) {
+  throw std::system_error(make_error_code(code));
+}
+
+char toLower(char c) {
+  return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool equalsIgnoreCase(Common::StringView left, Common::StringView right) {
+  if (left.getSize() != right.getSize()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < left.getSize(); ++i) {
+    if (toLower(left[i]) != toLower(right[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool isSpace(char c) {
+  return c == ' ' || c == '\t';
+}
+
+Common::StringView trim(Common::StringView value) {
+  size_t begin = 0;
+  size_t end = value.getSize();
+  while (begin < end && isSpace(value[begin])) {
+    ++begin;
+  }
+
+  while (end > begin && isSpace(value[end - 1])) {
+    --end;
+  }
+
+  return value.range(begin, end);
+}
+
+// Looks for token in a comma separated header value such as "keep-alive, Upgrade".
+bool hasToken(Common::StringView value, Common::StringView token) {
+  size_t begin = 0;
+  while (begin <= value.getSize()) {
+    size_t end = begin;
+    while (end < value.getSize() && value[end] != ',') {
+      ++end;
+    }
+
+    if (equalsIgnoreCase(trim(value.range(begin, end)), token)) {
+      return true;
+    }
+
+    begin = end + 1;
+  }
+
+  return false;
+}
+
+size_t parseContentLength(Common::StringView value, size_t maxBodySize) {
+  if (value.isEmpty()) {
+    throwError(CryptoNote::error::UNEXPECTED_SYMBOL);
+  }
+
+  size_t length = 0;
+  for (size_t i = 0; i < value.getSize(); ++i) {
+    if (value[i] < '0' || value[i] > '9') {
+      throwError(CryptoNote::error::UNEXPECTED_SYMBOL);
+    }
+
+    length = length * 10 + static_cast<size_t>(value[i] - '0');
+    if (length > maxBodySize) {
+      throwError(CryptoNote::error::BODY_TOO_LARGE);
+    }
+  }
+
+  return length;
+}
+
+}
+
+namespace CryptoNote {
+
+const size_t HttpRequestParser::MAX_HEAD_SIZE;
+const size_t HttpRequestParser::DEFAULT_MAX_BODY_SIZE;
+
+HttpRequestParser::HttpRequestParser(size_t maxBodySize) : m_maxBodySize(maxBodySize) {
+  reset();
+}
+
+void HttpRequestParser::reset() {
+  m_scanned = 0;
+  m_headSize = 0;
+  m_bodySize = 0;
+  m_minorVersion = 1;
+  m_keepAlive = true;
+  m_headerRanges.clear();
+  m_headers.clear();
+}
+
+bool HttpRequestParser::parse(const uint8_t* data, size_t size) {
+  const char* text = reinterpret_cast<const char*>(data);
+  if (m_headSize == 0) {
+    // the head ends with an empty line, only the bytes received since the last call are searched for it
+    const char* end = text + size;
+    const char* position = text + m_scanned;
+    for (;;) {
+      position = static_cast<const char*>(std::memchr(position, '\n', end - position));
+      if (position == nullptr) {
+        break;
+      }
+
+      if (position - text >= 3 && position[-1] == '\r' && position[-2] == '\n' && position[-3] == '\r') {
+        break;
+      }
+
+      ++position;
+    }
+
+    if (position == nullptr) {
+      if (size >= MAX_HEAD_SIZE) {
+        throwError(error::HEADERS_TOO_LARGE);
+      }
+
+      m_scanned = size;
+      return false;
+    }
+
+    m_headSize = static_cast<size_t>(position - text) + 1;
+    if (m_headSize > MAX_HEAD_SIZE) {
+      throwError(error::HEADERS_TOO_LARGE);
+    }
+
+    parseHead(text);
+  }
+
+  if (size < m_headSize + m_bodySize) {
+    return false;
+  }
+
+  m_method = view(text, m_methodRange);
+  m_url = view(text, m_urlRange);
+  m_body = Common::StringView(text + m_headSize, m_bodySize);
+  m_headers.clear();
+  for (const auto& range : m_headerRanges) {
+    m_headers.push_back({view(text, range.first), view(text, range.second)});
+  }
+
+  return true;
+}
+
+Common::StringView HttpRequestParser::getHeader(Common::StringView name) const {
+  for (const Header& header : m_headers) {
+    if (equalsIgnoreCase(header.name, name)) {
+      return header.value;
+    }
+  }
+
+  return Common::StringView::NIL;
+}
+
+void HttpRequestParser::fillRequest(HttpRequest& request) const {
+  request.method.assign(m_method.getData(), m_method.getSize());
+  request.url.assign(m_url.getData(), m_url.getSize());
+  request.body.assign(m_body.getData(), m_body.getSize());
+  request.headers.clear();
+}
+
+void HttpRequestParser::parseHead(const char* head) {
+  size_t position = 0;
+
+  // tolerate empty lines left over after a previous request's body
+  while (head[position] == '\r' && head[position + 1] == '\n' && position + 4 < m_headSize) {
+    position += 2;
+  }
+
+  size_t lineEnd = position;
+  while (head[lineEnd] != '\r') {
+    ++lineEnd;
+  }
+
+  Common::StringView requestLine(head + position, lineEnd - position);
+  size_t methodEnd = requestLine.find(' ');
+  if (methodEnd == Common::StringView::INVALID || methodEnd == 0) {
+    throwError(error::UNEXPECTED_SYMBOL);
+  }
+
+  size_t urlEnd = requestLine.unhead(methodEnd + 1).find(' ');
+  if (urlEnd == Common::StringView::INVALID || urlEnd == 0) {
+    throwError(error::UNEXPECTED_SYMBOL);
+  }
+
+  urlEnd += methodEnd + 1;
+  Common::StringView version = requestLine.unhead(urlEnd + 1);
+  if (version.getSize() != 8 || !version.beginsWith("HTTP/1.") || version[7] < '0' || version[7] > '9') {
+    throwError(error::UNEXPECTED_SYMBOL);
+  }
+
+  m_methodRange = Range(position, methodEnd);
+  m_urlRange = Range(position + methodEnd + 1, urlEnd - methodEnd - 1);
+  m_minorVersion = static_cast<unsigned>(version[7] - '0');
+
+  position = lineEnd + 2;
+  while (position + 2 < m_headSize) {
+    lineEnd = position;
+    while (head[lineEnd] != '\r') {
+      ++lineEnd;
+    }
+
+    parseHeader(head, position, lineEnd);
+    position = lineEnd + 2;
+  }
+
+  bool hasContentLength = false;
+  bool close = false;
+  bool keepAlive = false;
+  for (const auto& range : m_headerRanges) {
+    Common::StringView name = view(head, range.first);
+    Common::StringView value = view(head, range.second);
+    if (equalsIgnoreCase(name, "content-length")) {
+      size_t bodySize = parseContentLength(value, m_maxBodySize);
+      if (hasContentLength && bodySize != m_bodySize) {
+        throwError(error::UNEXPECTED_SYMBOL);
+      }
+
+      hasContentLength = true;
+      m_bodySize = bodySize;
+    } else if (equalsIgnoreCase(name, "transfer-encoding")) {
+      // chunked bodies are not supported, guessing their length would desynchronize pipelined requests
+      throwError(error::UNEXPECTED_SYMBOL);
+    } else if (equalsIgnoreCase(name, "connection")) {
+      close = close || hasToken(value, "close");
+      keepAlive = keepAlive || hasToken(value, "keep-alive");
+    }
+  }
+
+  m_keepAlive = m_minorVersion == 0 ? keepAlive && !close : !close;
+}
+
+void HttpRequestParser::parseHeader(const char* head, size_t begin, size_t end) {
+  Common::StringView line(head + begin, end - begin);
+  size_t colon = line.find(':');
+  if (colon == Common::StringView::INVALID) {
+    throwError(error::UNEXPECTED_SYMBOL);
+  }
+
+  if (colon == 0) {
+    throwError(error::EMPTY_HEADER);
+  }
+
+  Common::StringView name = line.head(colon);
+  for (size_t i = 0; i < name.getSize(); ++i) {
+    if (isSpace(name[i])) {
+      throwError(error::UNEXPECTED_SYMBOL);
+    }
+  }
+
+  Common::StringView value = trim(line.unhead(colon + 1));
+  size_t valueBegin = value.isEmpty() ? end : static_cast<size_t>(value.getData() - head);
+  m_headerRanges.emplace_back(Range(begin, colon), Range(valueBegin, value.getSize()));
+}
+
+Common::StringView HttpRequestParser::view(const char* data, const Range& range) const {
+  return Common::StringView(data + range.first, range.second);
+}
+
+}
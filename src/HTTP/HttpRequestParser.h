@@ -0,0 +1,93 @@
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2017-2018 Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <Common/StringView.h>
+
+#include "HttpRequest.h"
+
+namespace CryptoNote {
+
+// Incremental HTTP/1.x request parser working on a byte buffer owned by the caller.
+// Nothing is copied: after a successful parse the method, url, headers and body are views into that buffer.
+class HttpRequestParser {
+public:
+  struct Header {
+    Common::StringView name;
+    Common::StringView value;
+  };
+
+  static const size_t MAX_HEAD_SIZE = 64 * 1024;
+  static const size_t DEFAULT_MAX_BODY_SIZE = 64 * 1024 * 1024;
+
+  explicit HttpRequestParser(size_t maxBodySize = DEFAULT_MAX_BODY_SIZE);
+
+  // Parses the request which starts at data. Returns false while the request is incomplete, the next call has to pass
+  // the same bytes followed by whatever has arrived since, the buffer may be moved in between. Bytes already scanned
+  // are not scanned again. Throws std::system_error with HttpParserErrorCodes on malformed or oversized requests.
+  bool parse(const uint8_t* data, size_t size);
+
+  // Forgets the parsed request, the next parse starts a new one.
+  void reset();
+
+  // The accessors below are valid after parse returned true and until the buffer passed to it changes.
+  size_t getRequestSize() const { return m_headSize + m_bodySize; }
+  Common::StringView getMethod() const { return m_method; }
+  Common::StringView getUrl() const { return m_url; }
+  Common::StringView getBody() const { return m_body; }
+  unsigned getMinorVersion() const { return m_minorVersion; }
+  const std::vector<Header>& getHeaders() const { return m_headers; }
+  // Case insensitive, returns Common::StringView::NIL if the header is absent.
+  Common::StringView getHeader(Common::StringView name) const;
+  // HTTP/1.1 keeps the connection unless it sent "Connection: close", HTTP/1.0 closes it unless "Connection: keep-alive".
+  bool isKeepAlive() const { return m_keepAlive; }
+
+  // Copies method, url and body into request, reusing its storage. The request gets no headers, they stay here.
+  void fillRequest(HttpRequest& request) const;
+
+private:
+  typedef std::pair<size_t, size_t> Range;
+
+  void parseHead(const char* head);
+  void parseHeader(const char* head, size_t begin, size_t end);
+  Common::StringView view(const char* data, const Range& range) const;
+
+  size_t m_maxBodySize;
+  size_t m_scanned;
+  size_t m_headSize;
+  size_t m_bodySize;
+  unsigned m_minorVersion;
+  bool m_keepAlive;
+
+  Range m_methodRange;
+  Range m_urlRange;
+  std::vector<std::pair<Range, Range>> m_headerRanges;
+
+  Common::StringView m_method;
+  Common::StringView m_url;
+  Common::StringView m_body;
+  std::vector<Header> m_headers;
+};
+
+}
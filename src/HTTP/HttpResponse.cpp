@@ -85,13 +85,24 @@ void HttpResponse::setBody(const std::string& b) {
   }
 }
 
-std::ostream& HttpResponse::printHttpResponse(std::ostream& os) const {
-  os << "HTTP/1.1 " << getStatusString(status) << "\r\n";
-
-  for (auto pair: headers) {
-    os << pair.first << ": " << pair.second << "\r\n";
+void HttpResponse::writeHead(std::string& head) const {
+  head += "HTTP/1.1 ";
+  head += getStatusString(status);
+  head += "\r\n";
+
+  for (const auto& pair: headers) {
+    head += pair.first;
+    head += ": ";
+    head += pair.second;
+    head += "\r\n";
   }
-  os << "\r\n";
+  head += "\r\n";
+}
+
+std::ostream& HttpResponse::printHttpResponse(std::ostream& os) const {
+  std::string head;
+  writeHead(head);
+  os << head;
 
   if (!body.empty()) {
     os << body;
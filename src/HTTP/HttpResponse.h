@@ -45,6 +45,10 @@ namespace CryptoNote {
     HTTP_STATUS getStatus() const { return status; }
     const std::string& getBody() const { return body; }
 
+    // Appends the status line and the headers including the empty line ending them, the body can then be sent from
+    // getBody() without being copied next to them.
+    void writeHead(std::string& head) const;
+
   private:
     friend std::ostream& operator<<(std::ostream& os, const HttpResponse& resp);
     std::ostream& printHttpResponse(std::ostream& os) const;
@@ -34,8 +34,6 @@
 #include "HTTP/HttpResponse.h"
 #include "Rpc/JsonRpc.h"
 #include "Common/JsonValue.h"
-#include "Serialization/JsonInputValueSerializer.h"
-#include "Serialization/JsonOutputStreamSerializer.h"
 
 namespace CryptoNote {
 
@@ -72,13 +70,24 @@ void JsonRpcServer::processRequest(const CryptoNote::HttpRequest& req, CryptoNot
         return;
       }
 
-      processJsonRpcRequest(jsonRpcRequest, jsonRpcResponse);
+      std::string result;
+      processJsonRpcRequest(jsonRpcRequest, jsonRpcResponse, result);
 
-      std::ostringstream jsonOutputStream;
-      jsonOutputStream << jsonRpcResponse;
+      std::string body = jsonRpcResponse.toString();
+      if (!result.empty()) {
+        // "result" sorts after the other members, so it goes last as JsonValue would print it
+        body.pop_back();
+        if (body.size() > 1) {
+          body += ',';
+        }
+
+        body += "\"result\":";
+        body += result;
+        body += '}';
+      }
 
       resp.setStatus(CryptoNote::HttpResponse::STATUS_200);
-      resp.setBody(jsonOutputStream.str());
+      resp.setBody(body);
 
     } else {
       logger(Logging::WARNING) << "Requested url \"" << req.getUrl() << "\" is not found";
@@ -166,10 +175,6 @@ void JsonRpcServer::makeMethodNotFoundResponse(Common::JsonValue& resp) {
   resp.insert("error", error);
 }
 
-void JsonRpcServer::fillJsonResponse(const Common::JsonValue& v, Common::JsonValue& resp) {
-  resp.insert("result", v);
-}
-
 void JsonRpcServer::makeJsonParsingErrorResponse(Common::JsonValue& resp) {
   using Common::JsonValue;
 
@@ -0,0 +1,241 @@
+// Copyright (c) 2017-2018 Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "AsyncLogger.h"
+#include <algorithm>
+#include <chrono>
+
+namespace Logging {
+
+namespace {
+
+// Messages wait at most this long for the writer when their ring is not filling up.
+const std::chrono::milliseconds WRITER_PERIOD(10);
+
+std::atomic<uint64_t> nextLoggerId(0);
+
+}
+
+const size_t AsyncLogger::DEFAULT_QUEUE_SIZE;
+
+AsyncLogger::Ring::Ring(size_t capacity) : entries(capacity), head(0), tail(0), abandoned(false) {
+}
+
+AsyncLogger::AsyncLogger(ILogger& sink, size_t queueSize, OverflowPolicy overflowPolicy) :
+  sink(sink),
+  queueSize(std::max<size_t>(queueSize, 1)),
+  overflowPolicy(overflowPolicy),
+  id(nextLoggerId++),
+  droppedCount(0),
+  reportedDroppedCount(0),
+  passCount(0),
+  flushWaiters(0),
+  blockedProducers(0),
+  stopped(false) {
+  writer = std::thread(&AsyncLogger::writerLoop, this);
+}
+
+AsyncLogger::~AsyncLogger() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopped = true;
+  }
+
+  writerEvent.notify_one();
+  writer.join();
+}
+
+void AsyncLogger::operator()(const std::string& category, Level level, boost::posix_time::ptime time, const std::string& body) {
+  if (level > sink.getMaxLevel()) {
+    return;
+  }
+
+  Ring& ring = threadRing();
+  size_t capacity = ring.entries.size();
+  size_t head = ring.head.load(std::memory_order_relaxed);
+  size_t tail = ring.tail.load(std::memory_order_acquire);
+  if (head - tail == capacity) {
+    if (overflowPolicy.load(std::memory_order_relaxed) == DROP) {
+      droppedCount.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    waitForRoom(ring, head);
+    tail = ring.tail.load(std::memory_order_acquire);
+    if (head - tail == capacity) {
+      // the writer has stopped
+      droppedCount.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+
+  // the slots keep their strings, so their capacity is reused once the ring has gone round
+  Entry& entry = ring.entries[head % capacity];
+  entry.category.assign(category);
+  entry.level = level;
+  entry.time = time;
+  entry.body.assign(body);
+  ring.head.store(head + 1, std::memory_order_release);
+
+  // a ring filling up is written without waiting for the period to pass
+  if (head + 1 - tail == capacity / 2 + 1) {
+    wakeWriter();
+  }
+}
+
+Level AsyncLogger::getMaxLevel() const {
+  return sink.getMaxLevel();
+}
+
+void AsyncLogger::flush() {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (stopped) {
+    return;
+  }
+
+  // the pass running now may have missed messages logged before the call, the one after it cannot
+  uint64_t lastPass = passCount + 2;
+  ++flushWaiters;
+  writerEvent.notify_one();
+  passCompleted.wait(lock, [&] { return passCount >= lastPass; });
+  --flushWaiters;
+}
+
+uint64_t AsyncLogger::getDroppedCount() const {
+  return droppedCount.load(std::memory_order_relaxed);
+}
+
+void AsyncLogger::setQueueSize(size_t size) {
+  queueSize.store(std::max<size_t>(size, 1), std::memory_order_relaxed);
+}
+
+void AsyncLogger::setOverflowPolicy(OverflowPolicy policy) {
+  overflowPolicy.store(policy, std::memory_order_relaxed);
+}
+
+AsyncLogger::Ring& AsyncLogger::threadRing() {
+  struct ThreadRings {
+    ~ThreadRings() {
+      for (auto& ring : rings) {
+        ring.second->abandoned.store(true, std::memory_order_release);
+      }
+    }
+
+    std::vector<std::pair<uint64_t, std::shared_ptr<Ring>>> rings;
+  };
+
+  thread_local ThreadRings threadRings;
+
+  size_t capacity = queueSize.load(std::memory_order_relaxed);
+  auto current = std::find_if(threadRings.rings.begin(), threadRings.rings.end(),
+    [this](const std::pair<uint64_t, std::shared_ptr<Ring>>& ring) { return ring.first == id; });
+  if (current != threadRings.rings.end()) {
+    if (current->second->entries.size() == capacity) {
+      return *current->second;
+    }
+
+    // the writer drains rings in the order they were added, so the old ring is written out before the new one
+    current->second->abandoned.store(true, std::memory_order_release);
+    threadRings.rings.erase(current);
+  }
+
+  // rings only this thread still holds belong to loggers that are gone
+  threadRings.rings.erase(std::remove_if(threadRings.rings.begin(), threadRings.rings.end(),
+    [](const std::pair<uint64_t, std::shared_ptr<Ring>>& ring) { return ring.second.use_count() == 1; }), threadRings.rings.end());
+
+  std::shared_ptr<Ring> ring = std::make_shared<Ring>(capacity);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    rings.push_back(ring);
+  }
+
+  threadRings.rings.emplace_back(id, ring);
+  return *ring;
+}
+
+size_t AsyncLogger::drain(Ring& ring) {
+  size_t capacity = ring.entries.size();
+  size_t tail = ring.tail.load(std::memory_order_relaxed);
+  size_t head = ring.head.load(std::memory_order_acquire);
+  for (size_t i = tail; i != head; ++i) {
+    const Entry& entry = ring.entries[i % capacity];
+    sink(entry.category, entry.level, entry.time, entry.body);
+    ring.tail.store(i + 1, std::memory_order_release);
+  }
+
+  return head - tail;
+}
+
+void AsyncLogger::writerLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    bool stopping = stopped;
+    drainedRings.assign(rings.begin(), rings.end());
+    lock.unlock();
+
+    size_t written = 0;
+    for (auto& ring : drainedRings) {
+      written += drain(*ring);
+    }
+
+    uint64_t dropped = droppedCount.load(std::memory_order_relaxed);
+    if (dropped != reportedDroppedCount) {
+      sink("logging", WARNING, boost::posix_time::microsec_clock::local_time(),
+        std::to_string(dropped - reportedDroppedCount) + " log messages dropped, the queue was full\n");
+      reportedDroppedCount = dropped;
+      ++written;
+    }
+
+    if (written != 0) {
+      sink.flush();
+    }
+
+    lock.lock();
+    // a thread marks its ring abandoned after its last message, so an abandoned empty ring stays empty
+    rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<Ring>& ring) {
+      return ring->abandoned.load(std::memory_order_acquire) &&
+        ring->head.load(std::memory_order_acquire) == ring->tail.load(std::memory_order_relaxed);
+    }), rings.end());
+
+    drainedRings.clear();
+    ++passCount;
+    passCompleted.notify_all();
+    if (stopping) {
+      break;
+    }
+
+    if (written == 0 && flushWaiters == 0 && blockedProducers == 0 && !stopped) {
+      writerEvent.wait_for(lock, WRITER_PERIOD);
+    }
+  }
+}
+
+void AsyncLogger::wakeWriter() {
+  writerEvent.notify_one();
+}
+
+void AsyncLogger::waitForRoom(Ring& ring, size_t head) {
+  size_t capacity = ring.entries.size();
+  std::unique_lock<std::mutex> lock(mutex);
+  ++blockedProducers;
+  writerEvent.notify_one();
+  // the writer moves the tail before it completes a pass, and it completes passes while a producer is blocked
+  passCompleted.wait(lock, [&] { return stopped || head - ring.tail.load(std::memory_order_acquire) != capacity; });
+  --blockedProducers;
+}
+
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2017-2018 Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ILogger.h"
+
+namespace Logging {
+
+// Hands messages to a background thread that passes them on to the sink and flushes it once per batch. Every
+// producing thread gets its own bounded single producer ring, so logging takes no lock unless the ring is full.
+// A new queue size applies to the ring a thread uses after its next message, the old ring is written out first.
+class AsyncLogger : public ILogger {
+public:
+  enum OverflowPolicy {
+    DROP, // messages that find the ring full are counted and discarded
+    BLOCK // the producer waits for the writer to make room
+  };
+
+  static const size_t DEFAULT_QUEUE_SIZE = 4096;
+
+  AsyncLogger(ILogger& sink, size_t queueSize = DEFAULT_QUEUE_SIZE, OverflowPolicy overflowPolicy = DROP);
+  AsyncLogger(const AsyncLogger&) = delete;
+  ~AsyncLogger();
+  AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+  virtual void operator()(const std::string& category, Level level, boost::posix_time::ptime time, const std::string& body) override;
+  virtual Level getMaxLevel() const override;
+  // Returns once every message logged before the call has been written and the sink flushed.
+  virtual void flush() override;
+
+  uint64_t getDroppedCount() const;
+  void setQueueSize(size_t queueSize);
+  void setOverflowPolicy(OverflowPolicy overflowPolicy);
+
+private:
+  struct Entry {
+    std::string category;
+    Level level;
+    boost::posix_time::ptime time;
+    std::string body;
+  };
+
+  struct Ring {
+    explicit Ring(size_t capacity);
+
+    std::vector<Entry> entries;
+    std::atomic<size_t> head; // next entry the producer writes
+    std::atomic<size_t> tail; // next entry the writer reads
+    std::atomic<bool> abandoned; // the producing thread has exited
+  };
+
+  Ring& threadRing();
+  size_t drain(Ring& ring);
+  void writerLoop();
+  void wakeWriter();
+  void waitForRoom(Ring& ring, size_t head);
+
+  ILogger& sink;
+  std::atomic<size_t> queueSize;
+  std::atomic<OverflowPolicy> overflowPolicy;
+  const uint64_t id;
+  std::atomic<uint64_t> droppedCount;
+  uint64_t reportedDroppedCount;
+
+  std::mutex mutex;
+  std::condition_variable writerEvent;
+  std::condition_variable passCompleted;
+  std::vector<std::shared_ptr<Ring>> rings;
+  std::vector<std::shared_ptr<Ring>> drainedRings;
+  uint64_t passCount;
+  size_t flushWaiters;
+  size_t blockedProducers;
+  bool stopped;
+  std::thread writer;
+};
+
+}
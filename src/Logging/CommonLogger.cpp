@@ -21,56 +21,116 @@ namespace Logging {
 
 namespace {
 
-std::string formatPattern(const std::string& pattern, const std::string& category, Level level, boost::posix_time::ptime time) {
-  std::stringstream s;
+// The date only changes once a day and the seconds once a second, both are formatted again only when they do.
+struct TimeCache {
+  boost::gregorian::date date;
+  std::string dateString;
+  long seconds = -1;
+  std::string secondsString;
+};
+
+thread_local TimeCache timeCache;
+thread_local std::string messageBuffer;
+
+void appendTwoDigits(std::string& s, long value) {
+  s += static_cast<char>('0' + value / 10 % 10);
+  s += static_cast<char>('0' + value % 10);
+}
+
+void appendTime(std::string& s, const boost::posix_time::time_duration& timeOfDay) {
+  long seconds = timeOfDay.total_seconds();
+  if (seconds != timeCache.seconds) {
+    timeCache.seconds = seconds;
+    timeCache.secondsString.clear();
+    appendTwoDigits(timeCache.secondsString, timeOfDay.hours());
+    timeCache.secondsString += ':';
+    appendTwoDigits(timeCache.secondsString, timeOfDay.minutes());
+    timeCache.secondsString += ':';
+    appendTwoDigits(timeCache.secondsString, timeOfDay.seconds());
+  }
 
+  s += timeCache.secondsString;
+
+  // same output as streaming the time_duration, which omits a zero fraction
+  long fraction = static_cast<long>(timeOfDay.fractional_seconds());
+  if (fraction != 0) {
+    // num_fractional_digits is not constexpr, the buffer fits any resolution up to nanoseconds
+    const int fractionalDigits = boost::posix_time::time_duration::num_fractional_digits();
+    char digits[16];
+    for (int i = fractionalDigits; i > 0; --i) {
+      digits[i] = static_cast<char>('0' + fraction % 10);
+      fraction /= 10;
+    }
+
+    digits[0] = '.';
+    s.append(digits, fractionalDigits + 1);
+  }
+}
+
+void formatPattern(std::string& s, const std::string& pattern, const std::string& category, Level level, boost::posix_time::ptime time) {
   for (const char* p = pattern.c_str(); p && *p != 0; ++p) {
     if (*p == '%') {
       ++p;
       switch (*p) {
       case 0:
+        // a trailing '%' is dropped, step back so the loop sees the terminator
+        --p;
         break;
       case 'C':
-        s << category;
+        s += category;
         break;
       case 'D':
-        s << time.date();
+        if (time.date() != timeCache.date || timeCache.dateString.empty()) {
+          timeCache.date = time.date();
+          timeCache.dateString = boost::gregorian::to_simple_string(time.date());
+        }
+
+        s += timeCache.dateString;
         break;
       case 'T':
-        s << time.time_of_day();
+        appendTime(s, time.time_of_day());
         break;
-      case 'L':
-        s << std::setw(7) << std::left << ILogger::LEVEL_NAMES[level];
+      case 'L': {
+        const std::string& name = ILogger::LEVEL_NAMES[level];
+        s += name;
+        if (name.size() < 7) {
+          s.append(7 - name.size(), ' ');
+        }
+
         break;
+      }
       default:
-        s << *p;
+        s += *p;
       }
     } else {
-      s << *p;
+      s += *p;
     }
   }
-
-  return s.str();
 }
 
 }
 
 void CommonLogger::operator()(const std::string& category, Level level, boost::posix_time::ptime time, const std::string& body) {
   if (level <= logLevel && disabledCategories.count(category) == 0) {
-    std::string body2 = body;
-    if (!pattern.empty()) {
-      size_t insertPos = 0;
-      if (!body2.empty() && body2[0] == ILogger::COLOR_DELIMETER) {
-        size_t delimPos = body2.find(ILogger::COLOR_DELIMETER, 1);
-        if (delimPos != std::string::npos) {
-          insertPos = delimPos + 1;
-        }
-      }
+    if (pattern.empty()) {
+      doLogString(body);
+      return;
+    }
 
-      body2.insert(insertPos, formatPattern(pattern, category, level, time));
+    size_t insertPos = 0;
+    if (!body.empty() && body[0] == ILogger::COLOR_DELIMETER) {
+      size_t delimPos = body.find(ILogger::COLOR_DELIMETER, 1);
+      if (delimPos != std::string::npos) {
+        insertPos = delimPos + 1;
+      }
     }
 
-    doLogString(body2);
+    // one buffer per thread, its capacity is reused by every message
+    std::string& message = messageBuffer;
+    message.assign(body, 0, insertPos);
+    formatPattern(message, pattern, category, level, time);
+    message.append(body, insertPos, std::string::npos);
+    doLogString(message);
   }
 }
 
@@ -90,7 +150,15 @@ void CommonLogger::setMaxLevel(Level level) {
   logLevel = level;
 }
 
-CommonLogger::CommonLogger(Level level) : logLevel(level), pattern("%D %T %L [%C] ") {
+Level CommonLogger::getMaxLevel() const {
+  return logLevel;
+}
+
+void CommonLogger::setFlushEachMessage(bool flushEachMessage) {
+  this->flushEachMessage = flushEachMessage;
+}
+
+CommonLogger::CommonLogger(Level level) : logLevel(level), pattern("%D %T %L [%C] "), flushEachMessage(true) {
 }
 
 void CommonLogger::doLogString(const std::string& message) {
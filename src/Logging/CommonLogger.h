@@ -29,13 +29,17 @@ public:
   virtual void enableCategory(const std::string& category);
   virtual void disableCategory(const std::string& category);
   virtual void setMaxLevel(Level level);
+  virtual Level getMaxLevel() const override;
 
   void setPattern(const std::string& pattern);
+  // Loggers fed by a background writer are flushed after each batch and need not flush every message.
+  void setFlushEachMessage(bool flushEachMessage);
 
 protected:
   std::set<std::string> disabledCategories;
   Level logLevel;
   std::string pattern;
+  bool flushEachMessage;
 
   CommonLogger(Level level);
   virtual void doLogString(const std::string& message);
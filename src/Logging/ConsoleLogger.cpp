@@ -54,8 +54,13 @@ void ConsoleLogger::doLogString(const std::string& message) {
     { DEFAULT, Color::Default }
   };
 
+  size_t textBegin = 0;
   for (size_t charPos = 0; charPos < message.size(); ++charPos) {
     if (message[charPos] == ILogger::COLOR_DELIMETER) {
+      if (readingText) {
+        std::cout.write(message.data() + textBegin, charPos - textBegin);
+      }
+
       readingText = !readingText;
       color += message[charPos];
       if (readingText) {
@@ -63,17 +68,25 @@ void ConsoleLogger::doLogString(const std::string& message) {
         Common::Console::setTextColor(it == colorMapping.end() ? Color::Default : it->second);
         changedColor = true;
         color.clear();
+        textBegin = charPos + 1;
       }
-    } else if (readingText) {
-      std::cout << message[charPos];
-    } else {
+    } else if (!readingText) {
       color += message[charPos];
     }
   }
 
+  if (readingText) {
+    std::cout.write(message.data() + textBegin, message.size() - textBegin);
+  }
+
   if (changedColor) {
     Common::Console::setTextColor(Color::Default);
   }
 }
 
+void ConsoleLogger::flush() {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::cout.flush();
+}
+
 }
@@ -57,6 +57,11 @@ public:
   const static std::array<std::string, 6> LEVEL_NAMES;
 
   virtual void operator()(const std::string& category, Level level, boost::posix_time::ptime time, const std::string& body) = 0;
+
+  // Messages above this level are dropped, LoggerRef checks it before building them.
+  virtual Level getMaxLevel() const { return TRACE; }
+  // Writes out whatever the logger buffers.
+  virtual void flush() {}
 };
 
 #ifndef ENDL
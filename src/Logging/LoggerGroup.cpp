@@ -39,4 +39,10 @@ void LoggerGroup::operator()(const std::string& category, Level level, boost::po
   }
 }
 
+void LoggerGroup::flush() {
+  for (auto& logger : loggers) {
+    logger->flush();
+  }
+}
+
 }
@@ -24,15 +24,49 @@ namespace Logging {
 
 using Common::JsonValue;
 
-LoggerManager::LoggerManager() {
+LoggerManager::LoggerManager() : maxLevel(logLevel), groupSink(*this), asyncTarget(nullptr) {
 }
 
 void LoggerManager::operator()(const std::string& category, Level level, boost::posix_time::ptime time, const std::string& body) {
+  AsyncLogger* async = asyncTarget.load(std::memory_order_acquire);
+  if (async != nullptr) {
+    (*async)(category, level, time, body);
+    return;
+  }
+
   std::unique_lock<std::mutex> lock(reconfigureLock);
   LoggerGroup::operator()(category, level, time, body);
 }
 
+void LoggerManager::setMaxLevel(Level level) {
+  LoggerGroup::setMaxLevel(level);
+  maxLevel.store(level, std::memory_order_relaxed);
+}
+
+Level LoggerManager::getMaxLevel() const {
+  return maxLevel.load(std::memory_order_relaxed);
+}
+
+void LoggerManager::flush() {
+  AsyncLogger* async = asyncTarget.load(std::memory_order_acquire);
+  if (async != nullptr) {
+    async->flush();
+  } else {
+    groupSink.flush();
+  }
+}
+
+uint64_t LoggerManager::getDroppedMessageCount() const {
+  return asyncLogger ? asyncLogger->getDroppedCount() : 0;
+}
+
 void LoggerManager::configure(const JsonValue& val) {
+  // queued messages go to the loggers they were logged for, the writer needs reconfigureLock to write them
+  AsyncLogger* async = asyncTarget.load(std::memory_order_acquire);
+  if (async != nullptr) {
+    async->flush();
+  }
+
   std::unique_lock<std::mutex> lock(reconfigureLock);
   loggers.clear();
   LoggerGroup::loggers.clear();
@@ -49,6 +83,30 @@ void LoggerManager::configure(const JsonValue& val) {
   }
   std::vector<std::string> globalDisabledCategories;
 
+  bool asyncEnabled = false;
+  size_t asyncQueueSize = AsyncLogger::DEFAULT_QUEUE_SIZE;
+  AsyncLogger::OverflowPolicy asyncOverflowPolicy = AsyncLogger::DROP;
+  if (val.contains("async")) {
+    auto asyncVal = val("async");
+    if (!asyncVal.isObject()) {
+      throw std::runtime_error("parameter async has wrong type");
+    }
+
+    asyncEnabled = true;
+    if (asyncVal.contains("queueSize")) {
+      int64_t queueSize = asyncVal("queueSize").getInteger();
+      if (queueSize < 1) {
+        throw std::runtime_error("parameter queueSize must be positive");
+      }
+
+      asyncQueueSize = static_cast<size_t>(queueSize);
+    }
+
+    if (asyncVal.contains("blockWhenFull") && asyncVal("blockWhenFull").getBool()) {
+      asyncOverflowPolicy = AsyncLogger::BLOCK;
+    }
+  }
+
   if (val.contains("globalDisabledCategories")) {
     auto globalDisabledCategoriesList = val("globalDisabledCategories");
     if (globalDisabledCategoriesList.isArray()) {
@@ -97,6 +155,9 @@ void LoggerManager::configure(const JsonValue& val) {
           logger->setPattern(loggerConfiguration("pattern").getString());
         }
 
+        // the background writer flushes once per batch
+        logger->setFlushEachMessage(!asyncEnabled);
+
         std::vector<std::string> disabledCategories;
         if (loggerConfiguration.contains("disabledCategories")) {
           auto disabledCategoriesVal = loggerConfiguration("disabledCategories");
@@ -122,6 +183,35 @@ void LoggerManager::configure(const JsonValue& val) {
   for (const auto& category : globalDisabledCategories) {
     disableCategory(category);
   }
+
+  if (asyncEnabled) {
+    if (!asyncLogger) {
+      asyncLogger.reset(new AsyncLogger(groupSink, asyncQueueSize, asyncOverflowPolicy));
+    } else {
+      // the logger is kept because threads may still be inside it, it takes the new settings instead
+      asyncLogger->setQueueSize(asyncQueueSize);
+      asyncLogger->setOverflowPolicy(asyncOverflowPolicy);
+    }
+  }
+
+  asyncTarget.store(asyncEnabled ? asyncLogger.get() : nullptr, std::memory_order_release);
+}
+
+LoggerManager::GroupSink::GroupSink(LoggerManager& manager) : manager(manager) {
+}
+
+void LoggerManager::GroupSink::operator()(const std::string& category, Level level, boost::posix_time::ptime time, const std::string& body) {
+  std::unique_lock<std::mutex> lock(manager.reconfigureLock);
+  manager.LoggerGroup::operator()(category, level, time, body);
+}
+
+Level LoggerManager::GroupSink::getMaxLevel() const {
+  return manager.getMaxLevel();
+}
+
+void LoggerManager::GroupSink::flush() {
+  std::unique_lock<std::mutex> lock(manager.reconfigureLock);
+  manager.LoggerGroup::flush();
 }
 
 }
@@ -17,10 +17,12 @@
 
 #pragma once
 
+#include <atomic>
 #include <list>
 #include <memory>
 #include <mutex>
 #include "../Common/JsonValue.h"
+#include "AsyncLogger.h"
 #include "LoggerGroup.h"
 
 namespace Logging {
@@ -30,10 +32,33 @@ public:
   LoggerManager();
   void configure(const Common::JsonValue& val);
   virtual void operator()(const std::string& category, Level level, boost::posix_time::ptime time, const std::string& body) override;
+  virtual void setMaxLevel(Level level) override;
+  virtual Level getMaxLevel() const override;
+  virtual void flush() override;
+
+  // Messages dropped because the asynchronous queue was full.
+  uint64_t getDroppedMessageCount() const;
 
 private:
+  // What the background writer feeds when logging is asynchronous, the configured loggers under reconfigureLock.
+  class GroupSink : public ILogger {
+  public:
+    explicit GroupSink(LoggerManager& manager);
+    virtual void operator()(const std::string& category, Level level, boost::posix_time::ptime time, const std::string& body) override;
+    virtual Level getMaxLevel() const override;
+    virtual void flush() override;
+
+  private:
+    LoggerManager& manager;
+  };
+
   std::vector<std::unique_ptr<CommonLogger>> loggers;
   std::mutex reconfigureLock;
+  std::atomic<Level> maxLevel;
+  GroupSink groupSink;
+  // created by the first configuration that asks for it and kept, asyncTarget is null while it is not used
+  std::unique_ptr<AsyncLogger> asyncLogger;
+  std::atomic<AsyncLogger*> asyncTarget;
 };
 
 }
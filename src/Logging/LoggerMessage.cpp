@@ -29,19 +29,47 @@
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "LoggerMessage.h"
+#include <boost/date_time/c_local_time_adjustor.hpp>
 
 namespace Logging {
 
-LoggerMessage::LoggerMessage(ILogger& logger, const std::string& category, Level level, const std::string& color)
+namespace {
+
+// microsec_clock::local_time() goes through localtime_r for every message, the UTC offset is only looked up again
+// once a minute.
+boost::posix_time::ptime currentLocalTime() {
+	thread_local boost::posix_time::ptime nextUpdate;
+	thread_local boost::posix_time::time_duration utcOffset;
+
+	boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+	if (nextUpdate.is_not_a_date_time() || now >= nextUpdate) {
+		boost::posix_time::time_duration timeOfDay = now.time_of_day();
+		boost::posix_time::ptime minute(now.date(), boost::posix_time::time_duration(timeOfDay.hours(), timeOfDay.minutes(), 0));
+		utcOffset = boost::date_time::c_local_adjustor<boost::posix_time::ptime>::utc_to_local(minute) - minute;
+		nextUpdate = minute + boost::posix_time::minutes(1);
+	}
+
+	return now + utcOffset;
+}
+
+}
+
+LoggerMessage::LoggerMessage(ILogger& logger, const std::string& category, Level level, const std::string& color, bool enabled)
 	: std::ostream(this)
 	, std::streambuf()
 	, m_logger(logger)
-	, m_sCategory(category)
+	, m_sCategory(enabled ? category : std::string())
 	, m_nLogLevel(level)
-	, m_sMessage(color)
-	, m_tmTimeStamp(boost::posix_time::microsec_clock::local_time())
+	, m_sMessage(enabled ? color : std::string())
+	, m_tmTimeStamp(enabled ? currentLocalTime() : boost::posix_time::ptime())
 	, m_bGotText(false)
-{}
+	, m_bEnabled(enabled)
+{
+	if (!m_bEnabled) {
+		// formatted insertions check the stream state first and skip their conversions
+		setstate(std::ios_base::badbit);
+	}
+}
 
 #if defined __linux__ && !defined __ANDROID__
 LoggerMessage::LoggerMessage(LoggerMessage&& other)
@@ -51,8 +79,9 @@ LoggerMessage::LoggerMessage(LoggerMessage&& other)
   , m_nLogLevel(other.m_nLogLevel)
   , m_logger(other.m_logger)
   , m_sMessage(other.m_sMessage)
-  , m_tmTimeStamp(boost::posix_time::microsec_clock::local_time())
-  , m_bGotText(false) {
+  , m_tmTimeStamp(other.m_tmTimeStamp)
+  , m_bGotText(false)
+  , m_bEnabled(other.m_bEnabled) {
   if (this != &other) {
     _M_tie = nullptr;
     _M_streambuf = nullptr;
@@ -98,8 +127,9 @@ LoggerMessage::LoggerMessage(LoggerMessage&& other)
 	, m_sCategory(other.m_sCategory)
 	, m_nLogLevel(other.m_nLogLevel)
 	, m_sMessage(other.m_sMessage)
-	, m_tmTimeStamp(boost::posix_time::microsec_clock::local_time())
+	, m_tmTimeStamp(other.m_tmTimeStamp)
 	, m_bGotText(false)
+	, m_bEnabled(other.m_bEnabled)
 {
 	std::ostream::rdbuf(this);
 }
@@ -113,6 +143,10 @@ LoggerMessage::~LoggerMessage()
 
 int LoggerMessage::sync()
 {
+	if (!m_bEnabled) {
+		return 0;
+	}
+
 	m_logger(m_sCategory, m_nLogLevel, m_tmTimeStamp, m_sMessage);
 	m_bGotText = false;
 	m_sMessage = Logging::DEFAULT;
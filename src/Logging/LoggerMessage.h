@@ -38,7 +38,8 @@ namespace Logging {
 class LoggerMessage : public std::ostream, std::streambuf
 {
 public:
-	LoggerMessage(ILogger& logger, const std::string& category, Level level, const std::string& color);
+	// A disabled message formats nothing and is never passed to the logger.
+	LoggerMessage(ILogger& logger, const std::string& category, Level level, const std::string& color, bool enabled = true);
 	LoggerMessage(LoggerMessage&& other);
 	~LoggerMessage();
 	LoggerMessage(const LoggerMessage&) = delete;
@@ -56,6 +57,7 @@ private:
 	std::string m_sMessage;
 	boost::posix_time::ptime m_tmTimeStamp;
 	bool m_bGotText;
+	bool m_bEnabled;
 };
 
 } //Logging
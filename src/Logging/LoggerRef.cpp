@@ -39,7 +39,7 @@ LoggerRef::LoggerRef(ILogger& logger, const std::string& category)
 
 LoggerMessage LoggerRef::operator()(Level level, const std::string& color) const
 {
-	return LoggerMessage(*m_logger, m_sCategory, level, color);
+	return LoggerMessage(*m_logger, m_sCategory, level, color, level <= m_logger->getMaxLevel());
 }
 
 ILogger& LoggerRef::getLogger() const
@@ -35,15 +35,32 @@ void StreamLogger::doLogString(const std::string& message) {
   if (stream != nullptr && stream->good()) {
     std::lock_guard<std::mutex> lock(mutex);
     bool readingText = true;
+    size_t textBegin = 0;
     for (size_t charPos = 0; charPos < message.size(); ++charPos) {
       if (message[charPos] == ILogger::COLOR_DELIMETER) {
+        if (readingText) {
+          stream->write(message.data() + textBegin, charPos - textBegin);
+        }
+
         readingText = !readingText;
-      } else if (readingText) {
-        *stream << message[charPos];
+        textBegin = charPos + 1;
       }
     }
 
-    *stream << std::flush;
+    if (readingText) {
+      stream->write(message.data() + textBegin, message.size() - textBegin);
+    }
+
+    if (flushEachMessage) {
+      *stream << std::flush;
+    }
+  }
+}
+
+void StreamLogger::flush() {
+  if (stream != nullptr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stream->flush();
   }
 }
 
@@ -16,6 +16,9 @@
 // along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "LevinProtocol.h"
+
+#include <algorithm>
+
 #include <System/TcpConnection.h>
 
 using namespace CryptoNote;
@@ -27,6 +30,7 @@ const uint32_t LEVIN_PACKET_REQUEST = 0x00000001;
 const uint32_t LEVIN_PACKET_RESPONSE = 0x00000002;
 const uint32_t LEVIN_DEFAULT_MAX_PACKET_SIZE = 100000000;      //100MB by default
 const uint32_t LEVIN_PROTOCOL_VER_1 = 1;
+const size_t LEVIN_READ_AHEAD_SIZE = 64 * 1024;
 
 #pragma pack(push)
 #pragma pack(1)
@@ -48,27 +52,65 @@ bool LevinProtocol::Command::needReply() const {
   return !(isNotify || isResponse);
 }
 
-LevinProtocol::LevinProtocol(System::TcpConnection& connection) 
-  : m_conn(connection) {}
+LevinProtocol::LevinProtocol(System::TcpConnection& connection, ReadBuffer* readBuffer)
+  : m_conn(connection), m_readBuffer(readBuffer) {}
 
 void LevinProtocol::sendMessage(uint32_t command, const BinaryArray& out, bool needResponse) {
+  queueMessage(command, out, needResponse);
+  flush();
+}
+
+void LevinProtocol::queueMessage(uint32_t command, const BinaryArray& out, bool needResponse) {
+  queueFrame(command, out, needResponse, LEVIN_PACKET_REQUEST, 0);
+}
+
+void LevinProtocol::queueReply(uint32_t command, const BinaryArray& out, int32_t returnCode) {
+  queueFrame(command, out, false, LEVIN_PACKET_RESPONSE, returnCode);
+}
+
+void LevinProtocol::queueFrame(uint32_t command, const BinaryArray& out, bool needResponse, uint32_t flags, int32_t returnCode) {
   bucket_head2 head = { 0 };
   head.m_signature = LEVIN_SIGNATURE;
   head.m_cb = out.size();
   head.m_have_to_return_data = needResponse;
   head.m_command = command;
   head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
-  head.m_flags = LEVIN_PACKET_REQUEST;
+  head.m_flags = flags;
+  head.m_return_code = returnCode;
 
-  // write header and body in one operation
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
+  const uint8_t* headBytes = reinterpret_cast<const uint8_t*>(&head);
+  m_pendingHeads.insert(m_pendingHeads.end(), headBytes, headBytes + sizeof(head));
+  m_pendingBodies.push_back(&out);
+}
 
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
+void LevinProtocol::flush() {
+  // heads are collected first, their buffer does not move while the frames are written
+  std::vector<System::TcpConnection::Buffer> buffers;
+  buffers.reserve(m_pendingBodies.size() * 2);
+  for (size_t i = 0; i < m_pendingBodies.size(); ++i) {
+    buffers.push_back({m_pendingHeads.data() + i * sizeof(bucket_head2), sizeof(bucket_head2)});
+    if (!m_pendingBodies[i]->empty()) {
+      buffers.push_back({m_pendingBodies[i]->data(), m_pendingBodies[i]->size()});
+    }
+  }
 
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  m_pendingHeads.clear();
+  m_pendingBodies.clear();
+
+  size_t index = 0;
+  while (index < buffers.size()) {
+    size_t transferred = m_conn.writeBuffers(buffers.data() + index, buffers.size() - index);
+    while (transferred != 0) {
+      if (transferred >= buffers[index].size) {
+        transferred -= buffers[index].size;
+        ++index;
+      } else {
+        buffers[index].data += transferred;
+        buffers[index].size -= transferred;
+        transferred = 0;
+      }
+    }
+  }
 }
 
 bool LevinProtocol::readCommand(Command& cmd) {
@@ -104,33 +146,15 @@ bool LevinProtocol::readCommand(Command& cmd) {
 }
 
 void LevinProtocol::sendReply(uint32_t command, const BinaryArray& out, int32_t returnCode) {
-  bucket_head2 head = { 0 };
-  head.m_signature = LEVIN_SIGNATURE;
-  head.m_cb = out.size();
-  head.m_have_to_return_data = false;
-  head.m_command = command;
-  head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
-  head.m_flags = LEVIN_PACKET_RESPONSE;
-  head.m_return_code = returnCode;
-
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  queueReply(command, out, returnCode);
+  flush();
 }
 
-void LevinProtocol::writeStrict(const uint8_t* ptr, size_t size) {
-  size_t offset = 0;
-  while (offset < size) {
-    offset += m_conn.write(ptr + offset, size - offset);
+bool LevinProtocol::readStrict(uint8_t* ptr, size_t size) {
+  if (m_readBuffer != nullptr) {
+    return readBuffered(ptr, size);
   }
-}
 
-bool LevinProtocol::readStrict(uint8_t* ptr, size_t size) {
   size_t offset = 0;
   while (offset < size) {
     size_t read = m_conn.read(ptr + offset, size - offset);
@@ -143,3 +167,45 @@ bool LevinProtocol::readStrict(uint8_t* ptr, size_t size) {
 
   return true;
 }
+
+bool LevinProtocol::readBuffered(uint8_t* ptr, size_t size) {
+  ReadBuffer& buffer = *m_readBuffer;
+  size_t offset = std::min(size, buffer.end - buffer.begin);
+  std::copy(buffer.data.begin() + buffer.begin, buffer.data.begin() + buffer.begin + offset, ptr);
+  buffer.begin += offset;
+  if (offset == size) {
+    return true;
+  }
+
+  buffer.begin = 0;
+  buffer.end = 0;
+  if (size - offset >= LEVIN_READ_AHEAD_SIZE) {
+    // large bodies go straight to their destination, there is little to gain from reading ahead of them
+    while (offset < size) {
+      size_t read = m_conn.read(ptr + offset, size - offset);
+      if (read == 0) {
+        return false;
+      }
+
+      offset += read;
+    }
+
+    return true;
+  }
+
+  buffer.data.resize(LEVIN_READ_AHEAD_SIZE);
+  while (offset < size) {
+    size_t read = m_conn.read(buffer.data.data(), buffer.data.size());
+    if (read == 0) {
+      return false;
+    }
+
+    size_t used = std::min(read, size - offset);
+    std::copy(buffer.data.begin(), buffer.data.begin() + used, ptr + offset);
+    offset += used;
+    buffer.begin = used;
+    buffer.end = read;
+  }
+
+  return true;
+}
@@ -45,7 +45,16 @@ const int32_t LEVIN_PROTOCOL_RETCODE_SUCCESS = 1;
 class LevinProtocol {
 public:
 
-  LevinProtocol(System::TcpConnection& connection);
+  // Bytes read from a connection ahead of the frame being parsed, so that one read can bring in several frames.
+  // It belongs to the connection: every protocol reading from that connection has to be given the same buffer.
+  struct ReadBuffer {
+    BinaryArray data;
+    size_t begin = 0;
+    size_t end = 0;
+  };
+
+  // Without a read buffer nothing past the current frame is read, which suits connections used for a single invoke.
+  LevinProtocol(System::TcpConnection& connection, ReadBuffer* readBuffer = nullptr);
 
   template <typename Request, typename Response>
   bool invoke(uint32_t command, const Request& request, Response& response) {
@@ -80,6 +89,12 @@ public:
   void sendMessage(uint32_t command, const BinaryArray& out, bool needResponse);
   void sendReply(uint32_t command, const BinaryArray& out, int32_t returnCode);
 
+  // Frames queued here are sent by flush with as few writes as the connection allows. Bodies are not copied, they
+  // have to stay alive until flush returns.
+  void queueMessage(uint32_t command, const BinaryArray& out, bool needResponse);
+  void queueReply(uint32_t command, const BinaryArray& out, int32_t returnCode);
+  void flush();
+
   template <typename T>
   static bool decode(const BinaryArray& buf, T& value) {
     try {
@@ -106,8 +121,12 @@ public:
 private:
 
   bool readStrict(uint8_t* ptr, size_t size);
-  void writeStrict(const uint8_t* ptr, size_t size);
+  bool readBuffered(uint8_t* ptr, size_t size);
+  void queueFrame(uint32_t command, const BinaryArray& out, bool needResponse, uint32_t flags, int32_t returnCode);
   System::TcpConnection& m_conn;
+  ReadBuffer* m_readBuffer;
+  BinaryArray m_pendingHeads;
+  std::vector<const BinaryArray*> m_pendingBodies;
 };
 
 }
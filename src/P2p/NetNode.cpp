@@ -830,7 +830,7 @@ namespace CryptoNote
 
       try {
         System::Context<bool> handshakeContext(m_dispatcher, [&] {
-          CryptoNote::LevinProtocol proto(ctx.connection);
+          CryptoNote::LevinProtocol proto(ctx.connection, &ctx.readBuffer);
           return handshake(proto, ctx, just_take_peerlist);
         });
 
@@ -1156,12 +1156,17 @@ namespace CryptoNote
 
   void NodeServer::relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) {
     net_connection_id excludeId = excludeConnection ? *excludeConnection : boost::value_initialized<net_connection_id>();
+    std::shared_ptr<const BinaryArray> payload;
 
     forEachConnection([&](P2pConnectionContext& conn) {
       if (conn.peerId && conn.m_connection_id != excludeId &&
           (conn.m_state == CryptoNoteConnectionContext::state_normal ||
            conn.m_state == CryptoNoteConnectionContext::state_synchronizing)) {
-        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, data_buff));
+        if (!payload) {
+          payload = std::make_shared<const BinaryArray>(data_buff);
+        }
+
+        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, payload));
       }
     });
   }
@@ -1491,7 +1496,7 @@ namespace CryptoNote
       try {
         on_connection_new(ctx);
 
-        LevinProtocol proto(ctx.connection);
+        LevinProtocol proto(ctx.connection, &ctx.readBuffer);
         LevinProtocol::Command cmd;
 
         for (;;) {
@@ -1560,22 +1565,25 @@ namespace CryptoNote
           break;
         }
 
+        // everything queued goes out together, msgs keeps the payloads alive until flush returns
         for (const auto& msg : msgs) {
           logger(DEBUGGING) << ctx << "msg " << msg.type << ':' << msg.command;
           switch (msg.type) {
           case P2pMessage::COMMAND:
-            proto.sendMessage(msg.command, msg.buffer, true);
+            proto.queueMessage(msg.command, *msg.buffer, true);
             break;
           case P2pMessage::NOTIFY:
-            proto.sendMessage(msg.command, msg.buffer, false);
+            proto.queueMessage(msg.command, *msg.buffer, false);
             break;
           case P2pMessage::REPLY:
-            proto.sendReply(msg.command, msg.buffer, msg.returnCode);
+            proto.queueReply(msg.command, *msg.buffer, msg.returnCode);
             break;
           default:
             assert(false);
           }
         }
+
+        proto.flush();
       }
     } catch (System::InterruptedException&) {
       // connection stopped
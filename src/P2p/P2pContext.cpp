@@ -103,7 +103,7 @@ bool P2pContext::readCommand(LevinProtocol::Command& cmd) {
   }
 
   EventLock lk(readEvent);
-  bool result = LevinProtocol(connection).readCommand(cmd);
+  bool result = LevinProtocol(connection, &readBuffer).readCommand(cmd);
   lastReadTime = Clock::now();
   return result;
 }
@@ -90,6 +90,7 @@ private:
   System::Event timedSyncFinished;
 
   System::TcpConnection connection;
+  LevinProtocol::ReadBuffer readBuffer;
   System::Event writeEvent;
   System::Event readEvent;
 
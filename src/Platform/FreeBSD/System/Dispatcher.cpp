@@ -95,6 +95,7 @@ Dispatcher::Dispatcher() : lastCreatedTimer(0) {
           firstResumingContext = nullptr;
           firstReusableContext = nullptr;
           runningContextCount = 0;
+          peakContextCount = 0;
           return;
         }
       }
@@ -342,7 +343,7 @@ int Dispatcher::getKqueue() const {
   return kqueue;
 }
 
-NativeContext& Dispatcher::getReusableContext() {
+NativeContext& Dispatcher::getReusableContext(size_t) {
   if(firstReusableContext == nullptr) {
    uctx* newlyCreatedContext = new uctx;
    uint8_t* stackPointer = new uint8_t[STACK_SIZE];
@@ -373,6 +374,14 @@ void Dispatcher::pushReusableContext(NativeContext& context) {
   --runningContextCount;
 }
 
+size_t Dispatcher::getLiveContextCount() const {
+  return runningContextCount;
+}
+
+size_t Dispatcher::getPeakContextCount() const {
+  return peakContextCount;
+}
+
 int Dispatcher::getTimer() {
   int timer;
   if (timers.empty()) {
@@ -403,7 +412,10 @@ void Dispatcher::contextProcedure(void* ucontext) {
   }
 
   for (;;) {
-    ++runningContextCount;
+    if (++runningContextCount > peakContextCount) {
+      peakContextCount = runningContextCount;
+    }
+
     try {
       context.procedure();
     } catch(std::exception&) {
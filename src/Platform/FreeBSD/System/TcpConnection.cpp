@@ -24,6 +24,7 @@
 #include <sys/event.h>
 #include <sys/errno.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "Dispatcher.h"
@@ -33,6 +34,13 @@
 
 namespace System {
 
+namespace {
+
+// sendmsg is limited to IOV_MAX buffers, callers loop over partial writes anyway
+const int MAX_GATHER_BUFFERS = 64;
+
+}
+
 TcpConnection::TcpConnection() : dispatcher(nullptr) {
 }
 
@@ -220,6 +228,43 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
   return transferred;
 }
 
+std::size_t TcpConnection::writeBuffers(const Buffer* buffers, std::size_t count) {
+  assert(dispatcher != nullptr);
+  assert(writeContext == nullptr);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  iovec vectors[MAX_GATHER_BUFFERS];
+  int vectorCount = 0;
+  for (std::size_t i = 0; i < count && vectorCount < MAX_GATHER_BUFFERS; ++i) {
+    if (buffers[i].size != 0) {
+      vectors[vectorCount].iov_base = const_cast<uint8_t*>(buffers[i].data);
+      vectors[vectorCount].iov_len = buffers[i].size;
+      ++vectorCount;
+    }
+  }
+
+  if (vectorCount == 0) {
+    return 0;
+  }
+
+  msghdr message = {};
+  message.msg_iov = vectors;
+  message.msg_iovlen = vectorCount;
+  ssize_t transferred = ::sendmsg(connection, &message, 0);
+  if (transferred == -1) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      throw std::runtime_error("TcpConnection::write, sendmsg failed, " + lastErrorMessage());
+    }
+
+    // the socket buffer is full, the single buffer write waits until it drains
+    return write(static_cast<const uint8_t*>(vectors[0].iov_base), vectors[0].iov_len);
+  }
+
+  return transferred;
+}
+
 std::pair<Ipv4Address, uint16_t> TcpConnection::getPeerAddressAndPort() const {
   sockaddr_in addr;
   socklen_t size = sizeof(addr);
@@ -20,6 +20,7 @@
 
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <sys/timerfd.h>
 #include <fcntl.h>
 #include <string.h>
@@ -36,27 +37,66 @@ struct ContextMakingData {
   void* ucontext;
 };
 
-class MutextGuard {
-public:
-  MutextGuard(pthread_mutex_t& _mutex) : mutex(_mutex) {
-    auto ret = pthread_mutex_lock(&mutex);
-    if (ret != 0) {
-      throw std::runtime_error("pthread_mutex_lock failed, " + errorMessage(ret));
-    }
+//const size_t STACK_SIZE = 64 * 1024;
+const size_t STACK_SIZE = 512 * 1024;
+
+// idle contexts whose stacks keep their pages, stacks returned beyond this are given back to the system
+const size_t MAX_WARM_CONTEXTS = 16;
+// idle contexts kept for reuse, older ones are unmapped
+const size_t MAX_REUSABLE_CONTEXTS = 256;
+
+size_t pageSize() {
+  static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+// Maps stackSize bytes with a PROT_NONE guard page below them, pages are committed on first touch.
+// Returns the start of the mapping, the stack itself begins one page above it.
+uint8_t* mapStack(size_t stackSize) {
+  void* mapping = mmap(nullptr, stackSize + pageSize(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("Dispatcher::getReusableContext, mmap failed, " + lastErrorMessage());
   }
 
-  ~MutextGuard() {
-    pthread_mutex_unlock(&mutex);
+  if (mprotect(mapping, pageSize(), PROT_NONE) == -1) {
+    std::string message = "Dispatcher::getReusableContext, mprotect failed, " + lastErrorMessage();
+    munmap(mapping, stackSize + pageSize());
+    throw std::runtime_error(message);
   }
 
-private:
-  pthread_mutex_t& mutex;
-};
+  return static_cast<uint8_t*>(mapping);
+}
 
-static_assert(Dispatcher::SIZEOF_PTHREAD_MUTEX_T == sizeof(pthread_mutex_t), "invalid pthread mutex size");
+// The context lives on its own stack, so nothing may touch it afterwards.
+void destroyContext(NativeContext* context) {
+  auto ucontext = static_cast<ucontext_t*>(context->ucontext);
+  void* mapping = context->stackPtr;
+  size_t mappingSize = context->stackSize + pageSize();
+  context->~NativeContext();
+  delete ucontext;
+  if (munmap(mapping, mappingSize) == -1) {
+    throw std::runtime_error("Dispatcher::destroyContext, munmap failed, " + lastErrorMessage());
+  }
+}
 
-//const size_t STACK_SIZE = 64 * 1024;
-const size_t STACK_SIZE = 512 * 1024;
+// Drops the pages of an idle stack. pushReusableContext may run on the stack being returned, the frames above
+// the caller are kept in that case.
+void releaseStackPages(const NativeContext& context) {
+  uint8_t marker;
+  uintptr_t low = reinterpret_cast<uintptr_t>(context.stackPtr) + pageSize();
+  uintptr_t high = low + context.stackSize;
+  uintptr_t current = reinterpret_cast<uintptr_t>(&marker);
+  if (current >= low && current < high) {
+    high = (current & ~(pageSize() - 1)) - pageSize();
+  } else {
+    // the top page holds the suspended frames of contextProcedure
+    high -= pageSize();
+  }
+
+  if (high > low) {
+    madvise(reinterpret_cast<void*>(low), high - low, MADV_DONTNEED);
+  }
+}
 
 };
 
@@ -84,7 +124,7 @@ Dispatcher::Dispatcher() {
         if (epoll_ctl(epoll, EPOLL_CTL_ADD, remoteSpawnEvent, &remoteSpawnEventEpollEvent) == -1) {
           message = "epoll_ctl failed, " + lastErrorMessage();
         } else {
-          *reinterpret_cast<pthread_mutex_t*>(this->mutex) = pthread_mutex_t(PTHREAD_MUTEX_INITIALIZER);
+          remoteSpawnPending = false;
 
           mainContext.interrupted = false;
           mainContext.group = &contextGroup;
@@ -98,7 +138,9 @@ Dispatcher::Dispatcher() {
           currentContext = &mainContext;
           firstResumingContext = nullptr;
           firstReusableContext = nullptr;
+          reusableContextCount = 0;
           runningContextCount = 0;
+          peakContextCount = 0;
           return;
         }
 
@@ -124,13 +166,7 @@ Dispatcher::~Dispatcher() {
   assert(contextGroup.firstWaiter == nullptr);
   assert(firstResumingContext == nullptr);
   assert(runningContextCount == 0);
-  while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
-    firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
-  }
+  releaseReusableContexts();
 
   while (!timers.empty()) {
     int result = ::close(timers.top());
@@ -142,18 +178,10 @@ Dispatcher::~Dispatcher() {
   assert(result == 0);
   result = close(remoteSpawnEvent);
   assert(result == 0);
-  result = pthread_mutex_destroy(reinterpret_cast<pthread_mutex_t*>(this->mutex));
-  assert(result == 0);
 }
 
 void Dispatcher::clear() {
-  while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
-    firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
-  }
+  releaseReusableContexts();
 
   while (!timers.empty()) {
     int result = ::close(timers.top());
@@ -181,18 +209,7 @@ void Dispatcher::dispatch() {
     if (count == 1) {
       ContextPair *contextPair = static_cast<ContextPair*>(event.data.ptr);
       if(((event.events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-        uint64_t buf;
-        auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-        if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-        }
-
-        MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-        while (!remoteSpawningProcedures.empty()) {
-          spawn(std::move(remoteSpawningProcedures.front()));
-          remoteSpawningProcedures.pop();
-        }
-
+        spawnRemoteProcedures();
         continue;
       }
 
@@ -270,10 +287,11 @@ void Dispatcher::pushContext(NativeContext* context) {
 }
 
 void Dispatcher::remoteSpawn(std::function<void()>&& procedure) {
-  {
-    MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-    remoteSpawningProcedures.push(std::move(procedure));
+  remoteSpawningProcedures.push(std::move(procedure));
+  if (remoteSpawnPending.exchange(true)) {
+    return;
   }
+
   uint64_t one = 1;
   auto transferred = write(remoteSpawnEvent, &one, sizeof one);
   if(transferred == - 1) {
@@ -301,6 +319,21 @@ void Dispatcher::spawn(std::function<void()>&& procedure) {
   pushContext(context);
 }
 
+void Dispatcher::spawnRemoteProcedures() {
+  uint64_t buf;
+  auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
+  if(transferred == -1) {
+    throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
+  }
+
+  // procedures pushed after this are either taken below or signal the event again
+  remoteSpawnPending = false;
+  std::function<void()> procedure;
+  while (remoteSpawningProcedures.pop(procedure)) {
+    spawn(std::move(procedure));
+  }
+}
+
 void Dispatcher::yield() {
   for(;;){
     epoll_event events[16];
@@ -313,18 +346,7 @@ void Dispatcher::yield() {
       for(int i = 0; i < count; ++i) {
         ContextPair *contextPair = static_cast<ContextPair*>(events[i].data.ptr);
         if(((events[i].events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-          uint64_t buf;
-          auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-          if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-          }
-
-          MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-          while (!remoteSpawningProcedures.empty()) {
-            spawn(std::move(remoteSpawningProcedures.front()));
-            remoteSpawningProcedures.pop();
-          }
-
+          spawnRemoteProcedures();
           continue;
         }
 
@@ -367,16 +389,22 @@ int Dispatcher::getEpoll() const {
   return epoll;
 }
 
-NativeContext& Dispatcher::getReusableContext() {
-  if(firstReusableContext == nullptr) {
+NativeContext& Dispatcher::getReusableContext(size_t requestedStackSize) {
+  const size_t stackSize = requestedStackSize == 0 ? STACK_SIZE : (requestedStackSize + pageSize() - 1) & ~(pageSize() - 1);
+  NativeContext** link = &firstReusableContext;
+  while (*link != nullptr && (*link)->stackSize != stackSize) {
+    link = &(*link)->next;
+  }
+
+  if (*link == nullptr) {
     ucontext_t* newlyCreatedContext = new ucontext_t;
     if (getcontext(newlyCreatedContext) == -1) { //makecontext precondition
       throw std::runtime_error("Dispatcher::getReusableContext, getcontext failed, " + lastErrorMessage());
     }
 
-    auto stackPointer = new uint8_t[STACK_SIZE];
-    newlyCreatedContext->uc_stack.ss_sp = stackPointer;
-    newlyCreatedContext->uc_stack.ss_size = STACK_SIZE;
+    auto stackPointer = mapStack(stackSize);
+    newlyCreatedContext->uc_stack.ss_sp = stackPointer + pageSize();
+    newlyCreatedContext->uc_stack.ss_size = stackSize;
 
     ContextMakingData makingContextData {this, newlyCreatedContext};
     makecontext(newlyCreatedContext, (void(*)())contextProcedureStatic, 1, reinterpret_cast<int*>(&makingContextData));
@@ -389,19 +417,58 @@ NativeContext& Dispatcher::getReusableContext() {
     assert(firstReusableContext != nullptr);
     assert(firstReusableContext->ucontext == newlyCreatedContext);
     firstReusableContext->stackPtr = stackPointer;
-  };
+    firstReusableContext->stackSize = stackSize;
+    link = &firstReusableContext;
+  }
 
-  NativeContext* context = firstReusableContext;
-  firstReusableContext = firstReusableContext-> next;
+  NativeContext* context = *link;
+  *link = context->next;
+  --reusableContextCount;
   return *context;
 }
 
 void Dispatcher::pushReusableContext(NativeContext& context) {
+  if (reusableContextCount >= MAX_REUSABLE_CONTEXTS) {
+    // contexts are pushed at the head, the oldest one is at the end of the list
+    NativeContext** link = &firstReusableContext;
+    while ((*link)->next != nullptr) {
+      link = &(*link)->next;
+    }
+
+    NativeContext* retired = *link;
+    *link = nullptr;
+    --reusableContextCount;
+    destroyContext(retired);
+  }
+
+  if (reusableContextCount >= MAX_WARM_CONTEXTS) {
+    releaseStackPages(context);
+  }
+
   context.next = firstReusableContext;
   firstReusableContext = &context;
+  ++reusableContextCount;
   --runningContextCount;
 }
 
+size_t Dispatcher::getLiveContextCount() const {
+  return runningContextCount;
+}
+
+size_t Dispatcher::getPeakContextCount() const {
+  return peakContextCount;
+}
+
+void Dispatcher::releaseReusableContexts() {
+  while (firstReusableContext != nullptr) {
+    NativeContext* context = firstReusableContext;
+    firstReusableContext = context->next;
+    destroyContext(context);
+  }
+
+  reusableContextCount = 0;
+}
+
 int Dispatcher::getTimer() {
   int timer;
   if (timers.empty()) {
@@ -426,20 +493,23 @@ void Dispatcher::pushTimer(int timer) {
 }
 
 void Dispatcher::contextProcedure(void* ucontext) {
-  assert(firstReusableContext == nullptr);
   NativeContext context;
   context.ucontext = ucontext;
   context.interrupted = false;
-  context.next = nullptr;
+  context.next = firstReusableContext;
   context.inExecutionQueue = false;
   firstReusableContext = &context;
+  ++reusableContextCount;
   ucontext_t* oldContext = static_cast<ucontext_t*>(context.ucontext);
   if (swapcontext(oldContext, static_cast<ucontext_t*>(currentContext->ucontext)) == -1) {
     throw std::runtime_error("Dispatcher::contextProcedure, swapcontext failed, " + lastErrorMessage());
   }
 
   for (;;) {
-    ++runningContextCount;
+    if (++runningContextCount > peakContextCount) {
+      peakContextCount = runningContextCount;
+    }
+
     try {
       context.procedure();
     } catch(std::exception&) {
@@ -17,13 +17,12 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <functional>
-#include <queue>
 #include <stack>
-#ifndef __GLIBC__
-#include <bits/reg.h>
-#endif
+
+#include <System/MpscQueue.h>
 
 namespace System {
 
@@ -32,6 +31,7 @@ struct NativeContextGroup;
 struct NativeContext {
   void* ucontext;
   void* stackPtr;
+  size_t stackSize;
   bool interrupted;
   bool inExecutionQueue;
   NativeContext* next;
@@ -76,30 +76,27 @@ public:
   void remoteSpawn(std::function<void()>&& procedure);
   void yield();
 
+  // Contexts currently running a procedure and the highest number seen since construction.
+  size_t getLiveContextCount() const;
+  size_t getPeakContextCount() const;
+
   // system-dependent
   int getEpoll() const;
-  NativeContext& getReusableContext();
+  // stackSize 0 takes the default size. Stacks are mapped with a guard page below them and committed on first touch.
+  NativeContext& getReusableContext(size_t stackSize = 0);
   void pushReusableContext(NativeContext&);
   int getTimer();
   void pushTimer(int timer);
 
-#ifdef __x86_64__
-# if __WORDSIZE == 64
-  static const int SIZEOF_PTHREAD_MUTEX_T = 40;
-# else
-  static const int SIZEOF_PTHREAD_MUTEX_T = 32;
-# endif
-#else
-  static const int SIZEOF_PTHREAD_MUTEX_T = 24;
-#endif
-
 private:
   void spawn(std::function<void()>&& procedure);
+  void spawnRemoteProcedures();
   int epoll;
-  alignas(void*) uint8_t mutex[SIZEOF_PTHREAD_MUTEX_T];
   int remoteSpawnEvent;
   ContextPair remoteSpawnEventContext;
-  std::queue<std::function<void()>> remoteSpawningProcedures;
+  MpscQueue<std::function<void()>> remoteSpawningProcedures;
+  // set while remoteSpawnEvent is signalled and not yet consumed, so producers write it once per wakeup
+  std::atomic<bool> remoteSpawnPending;
   std::stack<int> timers;
 
   NativeContext mainContext;
@@ -108,8 +105,11 @@ private:
   NativeContext* firstResumingContext;
   NativeContext* lastResumingContext;
   NativeContext* firstReusableContext;
+  size_t reusableContextCount;
   size_t runningContextCount;
+  size_t peakContextCount;
 
+  void releaseReusableContexts();
   void contextProcedure(void* ucontext);
   static void contextProcedureStatic(void* context);
 };
@@ -94,6 +94,7 @@ Dispatcher::Dispatcher() : lastCreatedTimer(0) {
           firstResumingContext = nullptr;
           firstReusableContext = nullptr;
           runningContextCount = 0;
+          peakContextCount = 0;
           return;
         }
       }
@@ -341,7 +342,7 @@ int Dispatcher::getKqueue() const {
   return kqueue;
 }
 
-NativeContext& Dispatcher::getReusableContext() {
+NativeContext& Dispatcher::getReusableContext(size_t) {
   if(firstReusableContext == nullptr) {
    uctx* newlyCreatedContext = new uctx;
    uint8_t* stackPointer = new uint8_t[STACK_SIZE];
@@ -372,6 +373,14 @@ void Dispatcher::pushReusableContext(NativeContext& context) {
   --runningContextCount;
 }
 
+size_t Dispatcher::getLiveContextCount() const {
+  return runningContextCount;
+}
+
+size_t Dispatcher::getPeakContextCount() const {
+  return peakContextCount;
+}
+
 int Dispatcher::getTimer() {
   int timer;
   if (timers.empty()) {
@@ -402,7 +411,10 @@ void Dispatcher::contextProcedure(void* ucontext) {
   }
 
   for (;;) {
-    ++runningContextCount;
+    if (++runningContextCount > peakContextCount) {
+      peakContextCount = runningContextCount;
+    }
+
     try {
       context.procedure();
     } catch(std::exception&) {
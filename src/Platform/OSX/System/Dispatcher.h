@@ -68,8 +68,13 @@ public:
   void remoteSpawn(std::function<void()>&& procedure);
   void yield();
 
+  // Contexts currently running a procedure and the highest number seen since construction.
+  size_t getLiveContextCount() const;
+  size_t getPeakContextCount() const;
+
   int getKqueue() const;
-  NativeContext& getReusableContext();
+  // stackSize is not used on this platform, every context gets the default stack.
+  NativeContext& getReusableContext(size_t stackSize = 0);
   void pushReusableContext(NativeContext&);
   int getTimer();
   void pushTimer(int timer);
@@ -97,6 +102,7 @@ private:
   NativeContext* lastResumingContext;
   NativeContext* firstReusableContext;
   size_t runningContextCount;
+  size_t peakContextCount;
 
   void contextProcedure(void* uctx);
   static void contextProcedureStatic(intptr_t context);
@@ -220,6 +220,46 @@ void MemoryMappedFile::close() {
   }
 }
 
+void MemoryMappedFile::resize(uint64_t size, std::error_code& ec) {
+  assert(isOpened());
+
+  Tools::ScopeExit failExitHandler([this, &ec] {
+    ec = std::error_code(errno, std::system_category());
+    std::error_code ignore;
+    close(ignore);
+  });
+
+  int result = ::munmap(m_data, static_cast<size_t>(m_size));
+  if (result == -1) {
+    return;
+  }
+
+  m_data = nullptr;
+  result = ::ftruncate(m_file, static_cast<off_t>(size));
+  if (result == -1) {
+    return;
+  }
+
+  void* data = ::mmap(nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+  if (data == MAP_FAILED) {
+    return;
+  }
+
+  m_data = reinterpret_cast<uint8_t*>(data);
+  m_size = size;
+  ec = std::error_code();
+
+  failExitHandler.cancel();
+}
+
+void MemoryMappedFile::resize(uint64_t size) {
+  std::error_code ec;
+  resize(size, ec);
+  if (ec) {
+    throw std::system_error(ec, "MemoryMappedFile::resize");
+  }
+}
+
 void MemoryMappedFile::flush(uint8_t* data, uint64_t size, std::error_code& ec) {
   assert(isOpened());
 
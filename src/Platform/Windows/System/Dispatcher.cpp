@@ -74,6 +74,7 @@ Dispatcher::Dispatcher() {
         firstResumingContext = nullptr;
         firstReusableContext = nullptr;
         runningContextCount = 0;
+        peakContextCount = 0;
         return;
       }
 
@@ -336,7 +337,7 @@ void* Dispatcher::getCompletionPort() const {
   return completionPort;
 }
 
-NativeContext& Dispatcher::getReusableContext() {
+NativeContext& Dispatcher::getReusableContext(size_t) {
   if (firstReusableContext == nullptr) {
     void* fiber = CreateFiberEx(STACK_SIZE, RESERVE_STACK_SIZE, 0, contextProcedureStatic, this);
     if (fiber == NULL) {
@@ -359,6 +360,14 @@ void Dispatcher::pushReusableContext(NativeContext& context) {
   --runningContextCount;
 }
 
+size_t Dispatcher::getLiveContextCount() const {
+  return runningContextCount;
+}
+
+size_t Dispatcher::getPeakContextCount() const {
+  return peakContextCount;
+}
+
 void Dispatcher::interruptTimer(uint64_t time, NativeContext* context) {
   assert(GetCurrentThreadId() == threadId);
   if (context->inExecutionQueue) {
@@ -385,7 +394,10 @@ void Dispatcher::contextProcedure() {
   firstReusableContext = &context;
   SwitchToFiber(currentContext->fiber);
   for (;;) {
-    ++runningContextCount;
+    if (++runningContextCount > peakContextCount) {
+      peakContextCount = runningContextCount;
+    }
+
     try {
       context.procedure();
     } catch (std::exception&) {
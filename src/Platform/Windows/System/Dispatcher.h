@@ -61,10 +61,15 @@ public:
   void remoteSpawn(std::function<void()>&& procedure);
   void yield();
 
+  // Contexts currently running a procedure and the highest number seen since construction.
+  size_t getLiveContextCount() const;
+  size_t getPeakContextCount() const;
+
   // Platform-specific
   void addTimer(uint64_t time, NativeContext* context);
   void* getCompletionPort() const;
-  NativeContext& getReusableContext();
+  // stackSize is not used on this platform, every context gets the default stack.
+  NativeContext& getReusableContext(size_t stackSize = 0);
   void pushReusableContext(NativeContext&);
   void interruptTimer(uint64_t time, NativeContext* context);
 
@@ -85,6 +90,7 @@ private:
   NativeContext* lastResumingContext;
   NativeContext* firstReusableContext;
   size_t runningContextCount;
+  size_t peakContextCount;
 
   void contextProcedure();
   static void __stdcall contextProcedureStatic(void* context);
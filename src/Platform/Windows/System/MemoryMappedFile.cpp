@@ -257,6 +257,65 @@ void MemoryMappedFile::close() {
   }
 }
 
+void MemoryMappedFile::resize(uint64_t size, std::error_code& ec) {
+  assert(isOpened());
+
+  Tools::ScopeExit failExitHandler([this, &ec] {
+    ec = std::error_code(::GetLastError(), std::system_category());
+    std::error_code ignore;
+    close(ignore);
+  });
+
+  // the size of a file can't be changed while it is mapped
+  BOOL result = ::UnmapViewOfFile(m_data);
+  if (!result) {
+    return;
+  }
+
+  m_data = nullptr;
+  result = ::CloseHandle(m_mappingHandle);
+  if (!result) {
+    return;
+  }
+
+  m_mappingHandle = INVALID_HANDLE_VALUE;
+  LARGE_INTEGER distanceToMove;
+  distanceToMove.QuadPart = static_cast<LONGLONG>(size);
+  result = ::SetFilePointerEx(m_fileHandle, distanceToMove, NULL, FILE_BEGIN);
+  if (!result) {
+    return;
+  }
+
+  result = ::SetEndOfFile(m_fileHandle);
+  if (!result) {
+    return;
+  }
+
+  m_mappingHandle = ::CreateFileMapping(m_fileHandle, NULL, PAGE_READWRITE, 0, 0, NULL);
+  if (m_mappingHandle == NULL) {
+    m_mappingHandle = INVALID_HANDLE_VALUE;
+    return;
+  }
+
+  m_data = reinterpret_cast<uint8_t*>(::MapViewOfFile(m_mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+  if (m_data == NULL) {
+    return;
+  }
+
+  m_size = size;
+  ec = std::error_code();
+
+  failExitHandler.cancel();
+}
+
+void MemoryMappedFile::resize(uint64_t size) {
+  std::error_code ec;
+  resize(size, ec);
+  if (ec) {
+    throw std::system_error(ec, "MemoryMappedFile::resize");
+  }
+}
+
 void MemoryMappedFile::flush(uint8_t* data, uint64_t size, std::error_code& ec) {
   assert(isOpened());
 
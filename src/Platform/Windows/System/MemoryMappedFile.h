@@ -44,6 +44,10 @@ public:
   void rename(const std::string& newPath, std::error_code& ec);
   void rename(const std::string& newPath);
 
+  // Changes the size of the file in place, the data may be mapped to another address afterwards.
+  void resize(uint64_t size, std::error_code& ec);
+  void resize(uint64_t size);
+
   void flush(uint8_t* data, uint64_t size, std::error_code& ec);
   void flush(uint8_t* data, uint64_t size);
 
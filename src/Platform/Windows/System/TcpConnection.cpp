@@ -31,6 +31,9 @@ namespace System {
 
 namespace {
 
+// limits the WSABUF array kept on the stack, callers loop over partial writes anyway
+const DWORD MAX_GATHER_BUFFERS = 64;
+
 struct TcpConnectionContext : public OVERLAPPED {
   NativeContext* context;
   bool interrupted;
@@ -160,10 +163,42 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  WSABUF buf{static_cast<ULONG>(size), reinterpret_cast<char*>(const_cast<uint8_t*>(data))};
+  Buffer buffer = {data, size};
+  return send(&buffer, 1);
+}
+
+size_t TcpConnection::writeBuffers(const Buffer* buffers, size_t count) {
+  assert(dispatcher != nullptr);
+  assert(writeContext == nullptr);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    if (buffers[i].size != 0) {
+      return send(buffers, count);
+    }
+  }
+
+  return 0;
+}
+
+size_t TcpConnection::send(const Buffer* buffers, size_t count) {
+  WSABUF bufs[MAX_GATHER_BUFFERS];
+  DWORD bufCount = 0;
+  size_t size = 0;
+  for (size_t i = 0; i < count && bufCount < MAX_GATHER_BUFFERS; ++i) {
+    if (buffers[i].size != 0) {
+      bufs[bufCount].len = static_cast<ULONG>(buffers[i].size);
+      bufs[bufCount].buf = reinterpret_cast<char*>(const_cast<uint8_t*>(buffers[i].data));
+      size += buffers[i].size;
+      ++bufCount;
+    }
+  }
+
   TcpConnectionContext context;
   context.hEvent = NULL;
-  if (WSASend(connection, &buf, 1, NULL, 0, &context, NULL) != 0) {
+  if (WSASend(connection, bufs, bufCount, NULL, 0, &context, NULL) != 0) {
     int lastError = WSAGetLastError();
     if (lastError != WSA_IO_PENDING) {
       throw std::runtime_error("TcpConnection::write, WSASend failed, " + errorMessage(lastError));
@@ -27,6 +27,11 @@ class Ipv4Address;
 
 class TcpConnection {
 public:
+  struct Buffer {
+    const uint8_t* data;
+    size_t size;
+  };
+
   TcpConnection();
   TcpConnection(const TcpConnection&) = delete;
   TcpConnection(TcpConnection&& other);
@@ -35,6 +40,9 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   size_t read(uint8_t* data, size_t size);
   size_t write(const uint8_t* data, size_t size);
+  // Gathers the buffers into as few sends as the platform allows, returns the number of bytes written which may be
+  // less than their total. Buffers of total size 0 write nothing and return 0.
+  size_t writeBuffers(const Buffer* buffers, size_t count);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
@@ -47,6 +55,7 @@ private:
   void* writeContext;
 
   TcpConnection(Dispatcher& dispatcher, size_t connection);
+  size_t send(const Buffer* buffers, size_t count);
 };
 
 }
@@ -21,14 +21,19 @@
 #include "HttpServer.h"
 #include <boost/scope_exit.hpp>
 
-#include <HTTP/HttpParser.h>
+#include <cstring>
+
+#include <HTTP/HttpRequestParser.h>
 #include <System/InterruptedException.h>
-#include <System/TcpStream.h>
 #include <System/Ipv4Address.h>
 
 using namespace Logging;
 
 namespace {
+	const size_t READ_BUFFER_SIZE = 16 * 1024;
+	// pipelined requests answered by one gathered write at most
+	const size_t MAX_PIPELINED_RESPONSES = 32;
+
 	std::string base64Encode(const std::string& data) {
 		static const char* encodingTable = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 		const size_t resultSize = 4 * ((data.size() + 2) / 3);
@@ -69,32 +74,77 @@ namespace {
 namespace CryptoNote {
 
 HttpServer::HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log)
-  : m_dispatcher(dispatcher), workingContextGroup(dispatcher), logger(log, "HttpServer") {
+  : m_dispatcher(dispatcher), workingContextGroup(dispatcher), logger(log, "HttpServer"), m_workerLoops(nullptr) {
 
 }
 
-void HttpServer::start(const std::string& address, uint16_t port, const std::string& user, const std::string& password) {
-  m_listener = System::TcpListener(m_dispatcher, System::Ipv4Address(address), port);
-  workingContextGroup.spawn(std::bind(&HttpServer::acceptLoop, this));
+HttpServer::~HttpServer() {
+  stopWorkerLoops();
+}
 
-  		if (!user.empty() || !password.empty()) {
-			m_credentials = base64Encode(user + ":" + password);
-		}
+void HttpServer::start(const std::string& address, uint16_t port, const std::string& user, const std::string& password,
+  System::DispatcherGroup* workerLoops) {
+  // accept loops read the credentials from their own threads, they are set before the first one starts
+  if (!user.empty() || !password.empty()) {
+    m_credentials = base64Encode(user + ":" + password);
+  }
+
+  if (workerLoops == nullptr) {
+    m_listener = System::TcpListener(m_dispatcher, System::Ipv4Address(address), port);
+    workingContextGroup.spawn(std::bind(&HttpServer::acceptLoop, this, std::ref(workingContextGroup), std::ref(m_listener)));
+  } else {
+    // all listeners are bound before any accept loop starts, the vectors are not resized afterwards
+    m_workerLoops = workerLoops;
+    for (size_t i = 0; i < workerLoops->size(); ++i) {
+      System::Dispatcher& loopDispatcher = workerLoops->getDispatcher(i);
+      m_workerListeners.emplace_back(loopDispatcher, System::Ipv4Address(address), port, true);
+      m_workerContextGroups.emplace_back(new System::ContextGroup(loopDispatcher));
+    }
+
+    for (size_t i = 0; i < workerLoops->size(); ++i) {
+      workerLoops->spawn(i, *m_workerContextGroups[i],
+        std::bind(&HttpServer::acceptLoop, this, std::ref(*m_workerContextGroups[i]), std::ref(m_workerListeners[i])));
+    }
+  }
 }
 
 void HttpServer::stop() {
   workingContextGroup.interrupt();
   workingContextGroup.wait();
+  stopWorkerLoops();
+}
+
+void HttpServer::stopWorkerLoops() {
+  for (size_t i = 0; i < m_workerContextGroups.size(); ++i) {
+    System::ContextGroup& contextGroup = *m_workerContextGroups[i];
+    System::remoteCall(m_dispatcher, m_workerLoops->getDispatcher(i), [&contextGroup] {
+      contextGroup.interrupt();
+      contextGroup.wait();
+    });
+  }
+
+  m_workerContextGroups.clear();
+  m_workerListeners.clear();
+  m_workerLoops = nullptr;
 }
 
-void HttpServer::acceptLoop() {
+void HttpServer::runOnOwnerLoop(std::function<void()>&& procedure) {
+  System::Dispatcher* current = m_workerLoops != nullptr ? m_workerLoops->getCurrentDispatcher() : nullptr;
+  if (current == nullptr) {
+    procedure();
+  } else {
+    System::remoteCall(*current, m_dispatcher, std::move(procedure));
+  }
+}
+
+void HttpServer::acceptLoop(System::ContextGroup& contextGroup, System::TcpListener& listener) {
   try {
     System::TcpConnection connection;
     bool accepted = false;
 
     while (!accepted) {
       try {
-        connection = m_listener.accept();
+        connection = listener.accept();
         accepted = true;
       } catch (System::InterruptedException&) {
         throw;
@@ -103,11 +153,16 @@ void HttpServer::acceptLoop() {
       }
     }
 
-    m_connections.insert(&connection);
+    {
+      std::lock_guard<std::mutex> lock(m_connectionsMutex);
+      m_connections.insert(&connection);
+    }
+
     BOOST_SCOPE_EXIT_ALL(this, &connection) {
+      std::lock_guard<std::mutex> lock(m_connectionsMutex);
       m_connections.erase(&connection); };
 
-	workingContextGroup.spawn(std::bind(&HttpServer::acceptLoop, this));
+	contextGroup.spawn(std::bind(&HttpServer::acceptLoop, this, std::ref(contextGroup), std::ref(listener)));
 
 	//auto addr = connection.getPeerAddressAndPort();
 	auto addr = std::pair<System::Ipv4Address, uint16_t>(static_cast<System::Ipv4Address>(0), 0);
@@ -119,53 +174,135 @@ void HttpServer::acceptLoop() {
 
     logger(DEBUGGING) << "Incoming connection from " << addr.first.toDottedDecimal() << ":" << addr.second;
 
-    System::TcpStreambuf streambuf(connection);
-    std::iostream stream(&streambuf);
-    HttpParser parser;
-
-    for (;;) {
-      HttpRequest req;
-      HttpResponse resp;
-	  resp.addHeader("Access-Control-Allow-Origin", "*");
-	  resp.addHeader("content-type", "application/json");
-	
-      parser.receiveRequest(stream, req);
-				if (authenticate(req)) {
-					processRequest(req, resp);
-				}
-				else {
-					logger(WARNING) << "Authorization required " << addr.first.toDottedDecimal() << ":" << addr.second;
-					fillUnauthorizedResponse(resp);
-				}
+    serveConnection(connection, addr);
+
+    logger(DEBUGGING) << "Closing connection from " << addr.first.toDottedDecimal() << ":" << addr.second << " total=" << get_connections_count();
+
+  } catch (System::InterruptedException&) {
+  } catch (std::exception& e) {
+    logger(DEBUGGING) << "Connection error: " << e.what();
+  }
+}
 
-      stream << resp;
-      stream.flush();
+void HttpServer::serveConnection(System::TcpConnection& connection, const std::pair<System::Ipv4Address, uint16_t>& addr) {
+  std::vector<uint8_t> buffer(READ_BUFFER_SIZE);
+  size_t begin = 0;
+  size_t end = 0;
+  HttpRequestParser parser;
+  HttpRequest request;
+  std::vector<HttpResponse> responses;
+  std::vector<std::string> heads;
+  bool keepAlive = true;
+
+  while (keepAlive) {
+    // everything pipelined behind the first request is answered before writing, all responses go out in one write
+    while (keepAlive && responses.size() < MAX_PIPELINED_RESPONSES && parser.parse(buffer.data() + begin, end - begin)) {
+      parser.fillRequest(request);
+      responses.emplace_back();
+      HttpResponse& response = responses.back();
+      response.addHeader("Access-Control-Allow-Origin", "*");
+      response.addHeader("content-type", "application/json");
+      if (authenticate(parser)) {
+        processRequest(request, response);
+      } else {
+        logger(WARNING) << "Authorization required " << addr.first.toDottedDecimal() << ":" << addr.second;
+        fillUnauthorizedResponse(response);
+      }
 
-      if (stream.peek() == std::iostream::traits_type::eof()) {
-        break;
+      keepAlive = parser.isKeepAlive();
+      if (!keepAlive) {
+        response.addHeader("Connection", "close");
+      } else if (parser.getMinorVersion() == 0) {
+        response.addHeader("Connection", "keep-alive");
       }
+
+      begin += parser.getRequestSize();
+      parser.reset();
     }
 
-    logger(DEBUGGING) << "Closing connection from " << addr.first.toDottedDecimal() << ":" << addr.second << " total=" << m_connections.size();
+    if (!responses.empty()) {
+      writeResponses(connection, responses, heads);
+      responses.clear();
+      continue;
+    }
 
-  } catch (System::InterruptedException&) {
-  } catch (std::exception& e) {
-    logger(DEBUGGING) << "Connection error: " << e.what();
+    if (begin == end) {
+      begin = 0;
+      end = 0;
+      if (buffer.size() > READ_BUFFER_SIZE) {
+        std::vector<uint8_t>(READ_BUFFER_SIZE).swap(buffer);
+      }
+    } else if (begin != 0) {
+      std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+      end -= begin;
+      begin = 0;
+    }
+
+    // the parser bounds the request size, so does this
+    if (end == buffer.size()) {
+      buffer.resize(buffer.size() * 2);
+    }
+
+    size_t transferred = connection.read(buffer.data() + end, buffer.size() - end);
+    if (transferred == 0) {
+      if (end != 0) {
+        logger(DEBUGGING) << "Connection closed in the middle of a request from " << addr.first.toDottedDecimal() << ":" << addr.second;
+      }
+
+      return;
+    }
+
+    end += transferred;
+  }
+
+  connection.write(nullptr, 0);
+}
+
+void HttpServer::writeResponses(System::TcpConnection& connection, const std::vector<HttpResponse>& responses, std::vector<std::string>& heads) {
+  if (heads.size() < responses.size()) {
+    heads.resize(responses.size());
+  }
+
+  std::vector<System::TcpConnection::Buffer> buffers;
+  buffers.reserve(responses.size() * 2);
+  for (size_t i = 0; i < responses.size(); ++i) {
+    heads[i].clear();
+    responses[i].writeHead(heads[i]);
+    buffers.push_back({reinterpret_cast<const uint8_t*>(heads[i].data()), heads[i].size()});
+    const std::string& body = responses[i].getBody();
+    if (!body.empty()) {
+      buffers.push_back({reinterpret_cast<const uint8_t*>(body.data()), body.size()});
+    }
+  }
+
+  size_t index = 0;
+  while (index < buffers.size()) {
+    size_t transferred = connection.writeBuffers(buffers.data() + index, buffers.size() - index);
+    while (transferred != 0) {
+      if (transferred >= buffers[index].size) {
+        transferred -= buffers[index].size;
+        ++index;
+      } else {
+        buffers[index].data += transferred;
+        buffers[index].size -= transferred;
+        transferred = 0;
+      }
+    }
   }
 }
 
-bool HttpServer::authenticate(const HttpRequest& request) const {
+bool HttpServer::authenticate(const HttpRequestParser& parser) const {
 	if (!m_credentials.empty()) {
-		auto headerIt = request.getHeaders().find("authorization");
-		if (headerIt == request.getHeaders().end()) {
+		Common::StringView header = parser.getHeader("authorization");
+		if (header.isNil()) {
 			return false;
 		}
 
-		if (headerIt->second.substr(0, 6) != "Basic ") {
+		if (!header.beginsWith("Basic ")) {
 			return false;
 		}
 
-		if (headerIt->second.substr(6) != m_credentials) {
+		if (header.unhead(6) != m_credentials) {
 			return false;
 		}
 	}
@@ -174,6 +311,7 @@ bool HttpServer::authenticate(const HttpRequest& request) const {
 }
 
 size_t HttpServer::get_connections_count() const {
+	std::lock_guard<std::mutex> lock(m_connectionsMutex);
 	return m_connections.size();
 }
 
@@ -18,16 +18,22 @@
 
 #pragma once 
 
+#include <memory>
+#include <mutex>
 #include <unordered_set>
+#include <vector>
 
 #include <HTTP/HttpRequest.h>
+#include <HTTP/HttpRequestParser.h>
 #include <HTTP/HttpResponse.h>
 
 #include <System/ContextGroup.h>
 #include <System/Dispatcher.h>
+#include <System/DispatcherGroup.h>
 #include <System/TcpListener.h>
 #include <System/TcpConnection.h>
 #include <System/Event.h>
+#include <System/Ipv4Address.h>
 
 #include <Logging/LoggerRef.h>
 
@@ -38,10 +44,18 @@ class HttpServer {
 public:
 
   HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log);
+  ~HttpServer();
 
-  void start(const std::string& address, uint16_t port, const std::string& user = "", const std::string& password = "");
+  // With workerLoops, every loop accepts on its own SO_REUSEPORT listener and serves the connections it accepted,
+  // processRequest then runs on the loop threads. The group has to outlive stop().
+  void start(const std::string& address, uint16_t port, const std::string& user = "", const std::string& password = "",
+    System::DispatcherGroup* workerLoops = nullptr);
   void stop();
 
+  // Runs procedure on the dispatcher the server was created with, for request handlers touching state owned by it.
+  void runOnOwnerLoop(std::function<void()>&& procedure);
+
+  // request carries the method, url and body, its header map is left empty
   virtual void processRequest(const HttpRequest& request, HttpResponse& response) = 0;
   virtual size_t get_connections_count() const;
 
@@ -51,14 +65,22 @@ protected:
 
 private:
 
-  void acceptLoop();
+  void acceptLoop(System::ContextGroup& contextGroup, System::TcpListener& listener);
   void connectionHandler(System::TcpConnection&& conn);
-  bool authenticate(const HttpRequest& request) const;
+  void serveConnection(System::TcpConnection& connection, const std::pair<System::Ipv4Address, uint16_t>& addr);
+  void writeResponses(System::TcpConnection& connection, const std::vector<HttpResponse>& responses, std::vector<std::string>& heads);
+  bool authenticate(const HttpRequestParser& parser) const;
+  void stopWorkerLoops();
 
   System::ContextGroup workingContextGroup;
   Logging::LoggerRef logger;
   System::TcpListener m_listener;
+  System::DispatcherGroup* m_workerLoops;
+  // one group and listener per worker loop, each used only on its loop
+  std::vector<std::unique_ptr<System::ContextGroup>> m_workerContextGroups;
+  std::vector<System::TcpListener> m_workerListeners;
   std::unordered_set<System::TcpConnection*> m_connections;
+  mutable std::mutex m_connectionsMutex;
   std::string m_credentials;
 };
 
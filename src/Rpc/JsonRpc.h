@@ -20,6 +20,7 @@
 #include <boost/optional.hpp>
 #include <boost/foreach.hpp>
 #include <functional>
+#include <memory>
 
 #include "CoreRpcServerCommandsDefinitions.h"
 #include <Common/JsonValue.h>
@@ -68,21 +69,21 @@ public:
   
   JsonRpcRequest() : psReq(Common::JsonValue::OBJECT) {}
 
+  // The body is read in place, params are only converted when they are loaded.
   bool parseRequest(const std::string& requestBody) {
     try {
-      psReq = Common::JsonValue::fromString(requestBody);
+      input.reset(new JsonInputBufferSerializer(requestBody));
     } catch (std::exception&) {
       throw JsonRpcError(errParseError);
     }
 
-    if (!psReq.contains("method")) {
+    if (!(*input)(method, "method")) {
       throw JsonRpcError(errInvalidRequest);
     }
 
-    method = psReq("method").getString();
-
-    if (psReq.contains("id")) {
-      id = psReq("id");
+    std::string idJson;
+    if (input->getRawValue("id", idJson)) {
+      id = Common::JsonValue::fromString(idJson);
     }
 
     return true;
@@ -90,9 +91,7 @@ public:
 
   template <typename T>
   bool loadParams(T& v) const {
-    loadFromJsonValue(v, psReq.contains("params") ? 
-      psReq("params") : Common::JsonValue(Common::JsonValue::NIL));
-    return true;
+    return input && (*input)(v, "params");
   }
 
   template <typename T>
@@ -122,66 +121,83 @@ public:
 private:
 
   Common::JsonValue psReq;
+  std::unique_ptr<JsonInputBufferSerializer> input;
   OptionalId id;
   std::string method;
 };
 
 
+// The result and the error are kept as JSON text and the body is put together from them, a received body is
+// read in place.
 class JsonRpcResponse {
 public:
 
-  JsonRpcResponse() : psResp(Common::JsonValue::OBJECT) {}
-
   void parse(const std::string& responseBody) {
     try {
-      psResp = Common::JsonValue::fromString(responseBody);
+      input.reset(new JsonInputBufferSerializer(responseBody));
     } catch (std::exception&) {
       throw JsonRpcError(errParseError);
     }
   }
 
   void setId(const OptionalId& id) {
-    if (id.is_initialized()) {
-      psResp.insert("id", id.get());
-    }
+    this->id = id;
   }
 
   void setError(const JsonRpcError& err) {
-    psResp.set("error", storeToJsonValue(err));
+    error = storeToJson(err);
   }
 
   bool getError(JsonRpcError& err) const {
-    if (!psResp.contains("error")) {
-      return false;
-    }
-
-    loadFromJsonValue(err, psResp("error"));
-    return true;
+    return input && (*input)(err, "error");
   }
 
   std::string getBody() {
-    psResp.set("jsonrpc", std::string("2.0"));
-    return psResp.toString();
+    // members go in the order JsonValue prints them
+    std::string body = "{";
+    if (id.is_initialized()) {
+      body += "\"id\":";
+      body += id->toString();
+      body += ',';
+    }
+
+    if (!error.empty()) {
+      body += "\"error\":";
+      body += error;
+      body += ',';
+    }
+
+    body += "\"jsonrpc\":\"2.0\"";
+    if (!result.empty()) {
+      body += ",\"result\":";
+      body += result;
+    }
+
+    body += '}';
+    return body;
   }
 
   template <typename T>
   bool setResult(const T& v) {
-    psResp.set("result", storeToJsonValue(v));
+    result = storeToJson(v);
+    return true;
+  }
+
+  bool setResult(const std::string& v) {
+    result = storeToJsonValue(v).toString();
     return true;
   }
 
   template <typename T>
   bool getResult(T& v) const {
-    if (!psResp.contains("result")) {
-      return false;
-    }
-
-    loadFromJsonValue(v, psResp("result"));
-    return true;
+    return input && (*input)(v, "result");
   }
 
 private:
-  Common::JsonValue psResp;
+  std::unique_ptr<JsonInputBufferSerializer> input;
+  OptionalId id;
+  std::string error;
+  std::string result;
 };
 
 
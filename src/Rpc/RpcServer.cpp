@@ -67,7 +67,9 @@ RpcServer::HandlerFunction binMethod(bool (RpcServer::*handler)(typename Command
       return false;
     }
 
-    bool result = (obj->*handler)(req, res);
+    // request and response are (de)serialized on the calling loop, only the handler needs the core's loop
+    bool result = false;
+    obj->runOnOwnerLoop([&] { result = (obj->*handler)(req, res); });
     response.setBody(storeToBinaryKeyValue(res.data()));
     return result;
   };
@@ -84,7 +86,9 @@ RpcServer::HandlerFunction jsonMethod(bool (RpcServer::*handler)(typename Comman
       return false;
     }
 
-    bool result = (obj->*handler)(req, res);
+    // request and response are (de)serialized on the calling loop, only the handler needs the core's loop
+    bool result = false;
+    obj->runOnOwnerLoop([&] { result = (obj->*handler)(req, res); });
     response.setBody(storeToJson(res.data()));
     return result;
   };
@@ -219,7 +223,7 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
       throw JsonRpcError(CORE_RPC_ERROR_CODE_CORE_BUSY, "Core is busy");
     }
 
-    it->second.handler(this, jsonRequest, jsonResponse);
+    runOnOwnerLoop([&] { it->second.handler(this, jsonRequest, jsonResponse); });
 
   } catch (const JsonRpcError& err) {
     jsonResponse.setError(err);
@@ -227,8 +231,9 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
     jsonResponse.setError(JsonRpcError(JsonRpc::errInternalError, e.what()));
   }
 
-  response.setBody(jsonResponse.getBody());
-  logger(TRACE) << "JSON-RPC response: " << jsonResponse.getBody();
+  std::string body = jsonResponse.getBody();
+  logger(TRACE) << "JSON-RPC response: " << body;
+  response.setBody(body);
   return true;
 }
 
@@ -642,9 +647,11 @@ bool RpcServer::onGetTransactionHashesByPaymentId(const COMMAND_RPC_GET_TRANSACT
 //
 
 bool RpcServer::on_get_info(const COMMAND_RPC_GET_INFO::request& req, COMMAND_RPC_GET_INFO::response& res) {
-  res.height = m_core.get_current_blockchain_height();
-  res.difficulty = m_core.getNextBlockDifficulty();
-  res.tx_count = m_core.get_blockchain_total_transactions() - res.height; //without coinbase
+  // every chain value comes from one tip snapshot, so they always describe the same block
+  std::shared_ptr<const BlockchainTipSnapshot> tip = m_core.getTipSnapshot();
+  res.height = tip->height;
+  res.difficulty = tip->nextDifficulty;
+  res.tx_count = tip->transactionsCount - res.height; //without coinbase
   res.tx_pool_size = m_core.get_pool_transactions_count();
   res.alt_blocks_count = m_core.get_alternative_blocks_count();
   uint64_t total_conn = m_p2p.get_connections_count();
@@ -654,42 +661,21 @@ bool RpcServer::on_get_info(const COMMAND_RPC_GET_INFO::request& req, COMMAND_RP
   res.white_peerlist_size = m_p2p.getPeerlistManager().get_white_peers_count();
   res.grey_peerlist_size = m_p2p.getPeerlistManager().get_gray_peers_count();
   res.last_known_block_index = std::max(static_cast<uint32_t>(1), m_protocolQuery.getObservedHeight()) - 1;
-  Crypto::Hash last_block_hash = m_core.getBlockIdByHeight(m_core.get_current_blockchain_height() - 1);
-  res.top_block_hash = Common::podToHex(last_block_hash);
+  res.top_block_hash = Common::podToHex(tip->tailId);
   res.version = PROJECT_VERSION_LONG;
   res.fee_address = m_fee_address.empty() ? std::string() : m_fee_address;
   res.contact = m_contact_info.empty() ? std::string() : m_contact_info;
-  res.min_tx_fee = m_core.getMinimalFee();
-  res.readable_tx_fee = m_core.currency().formatAmount(m_core.getMinimalFee());
+  res.min_tx_fee = tip->minimalFee;
+  res.readable_tx_fee = m_core.currency().formatAmount(tip->minimalFee);
   res.start_time = (uint64_t)m_core.getStartTime();
   // that large uint64_t number is unsafe in JavaScript environment and therefore as a JSON value so we display it as a formatted string
-  res.already_generated_coins = m_core.currency().formatAmount(m_core.getTotalGeneratedAmount());
-
-  Block blk;
-  if (!m_core.getBlockByHash(last_block_hash, blk)) {
-	  throw JsonRpc::JsonRpcError{
-		CORE_RPC_ERROR_CODE_INTERNAL_ERROR,
-		"Internal error: can't get last block by hash." };
-  }
-
-  if (blk.baseTransaction.inputs.front().type() != typeid(BaseInput)) {
-	  throw JsonRpc::JsonRpcError{
-		CORE_RPC_ERROR_CODE_INTERNAL_ERROR,
-		"Internal error: coinbase transaction in the block has the wrong type" };
-  }
-
-  block_header_response block_header;
-  uint32_t last_block_height = boost::get<BaseInput>(blk.baseTransaction.inputs.front()).blockIndex;
-
-  Crypto::Hash tmp_hash = m_core.getBlockIdByHeight(last_block_height);
-  bool is_orphaned = last_block_hash != tmp_hash;
-  fill_block_header_response(blk, is_orphaned, last_block_height, last_block_hash, block_header);
+  res.already_generated_coins = m_core.currency().formatAmount(tip->alreadyGeneratedCoins);
 
-  res.block_major_version = block_header.major_version;
-  res.block_minor_version = block_header.minor_version;
-  res.last_block_timestamp = block_header.timestamp;
-  res.last_block_reward = block_header.reward;
-  m_core.getBlockDifficulty(static_cast<uint32_t>(last_block_height), res.last_block_difficulty);
+  res.block_major_version = tip->tailMajorVersion;
+  res.block_minor_version = tip->tailMinorVersion;
+  res.last_block_timestamp = tip->tailTimestamp;
+  res.last_block_reward = tip->tailReward;
+  res.last_block_difficulty = tip->tailDifficulty;
 
   res.status = CORE_RPC_STATUS_OK;
   return true;
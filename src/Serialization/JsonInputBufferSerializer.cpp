@@ -0,0 +1,423 @@
+// Copyright (c) 2017-2018 Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "JsonInputBufferSerializer.h"
+
+#include <cassert>
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+
+#include "Common/StringTools.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+// values nest no deeper than this, parsing is recursive and the text may come from anyone
+const size_t MAX_DEPTH = 512;
+
+bool isDigit(char character) {
+  return character >= '0' && character <= '9';
+}
+
+}
+
+JsonInputBufferSerializer::JsonInputBufferSerializer(std::string text) : json(std::move(text)) {
+  size_t position = 0;
+  parseValue(position, 0);
+  if (tokens[0].type != OBJECT_TOKEN) {
+    throw std::runtime_error("Serializer doesn't support this type of serialization: Object expected.");
+  }
+
+  chain.push_back(Frame{0, 1});
+}
+
+JsonInputBufferSerializer::~JsonInputBufferSerializer() {
+}
+
+ISerializer::SerializerType JsonInputBufferSerializer::type() const {
+  return ISerializer::INPUT;
+}
+
+bool JsonInputBufferSerializer::beginObject(Common::StringView name) {
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    return false;
+  }
+
+  size_t index = token - tokens.data();
+  chain.push_back(Frame{index, index + 1});
+  return true;
+}
+
+void JsonInputBufferSerializer::endObject() {
+  assert(chain.size() > 1);
+  chain.pop_back();
+}
+
+bool JsonInputBufferSerializer::beginArray(size_t& size, Common::StringView name) {
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    size = 0;
+    return false;
+  }
+
+  if (token->type != ARRAY_TOKEN) {
+    throw std::runtime_error("JsonValue type is not ARRAY");
+  }
+
+  size_t index = token - tokens.data();
+  size = 0;
+  for (size_t i = index + 1; i < token->next; i = tokens[i].next) {
+    ++size;
+  }
+
+  chain.push_back(Frame{index, index + 1});
+  return true;
+}
+
+void JsonInputBufferSerializer::endArray() {
+  assert(chain.size() > 1);
+  chain.pop_back();
+}
+
+bool JsonInputBufferSerializer::operator()(uint16_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(int16_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(uint32_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(int32_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(int64_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(uint64_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(double& value, Common::StringView name) {
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    return false;
+  }
+
+  if (token->type != NUMBER_TOKEN) {
+    throw std::runtime_error("JsonValue type is not REAL");
+  }
+
+  // the number is followed by a delimiter or the end of the text, either stops the conversion
+  value = std::strtod(json.c_str() + token->offset, nullptr);
+  return true;
+}
+
+bool JsonInputBufferSerializer::operator()(uint8_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(std::string& value, Common::StringView name) {
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    return false;
+  }
+
+  if (token->type != STRING_TOKEN) {
+    throw std::runtime_error("JsonValue type is not STRING");
+  }
+
+  value.assign(json, token->offset + 1, token->size - 2);
+  return true;
+}
+
+bool JsonInputBufferSerializer::operator()(bool& value, Common::StringView name) {
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    return false;
+  }
+
+  if (token->type != TRUE_TOKEN && token->type != FALSE_TOKEN) {
+    throw std::runtime_error("JsonValue type is not BOOL");
+  }
+
+  value = token->type == TRUE_TOKEN;
+  return true;
+}
+
+bool JsonInputBufferSerializer::binary(void* value, size_t size, Common::StringView name) {
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    return false;
+  }
+
+  if (token->type != STRING_TOKEN) {
+    throw std::runtime_error("JsonValue type is not STRING");
+  }
+
+  size_t textSize = token->size - 2;
+  if ((textSize & 1) != 0) {
+    throw std::runtime_error("fromHex: invalid string size");
+  }
+
+  if (textSize >> 1 > size) {
+    throw std::runtime_error("fromHex: invalid buffer size");
+  }
+
+  const char* text = json.data() + token->offset + 1;
+  for (size_t i = 0; i < textSize >> 1; ++i) {
+    static_cast<uint8_t*>(value)[i] = Common::fromHex(text[i << 1]) << 4 | Common::fromHex(text[(i << 1) + 1]);
+  }
+
+  return true;
+}
+
+bool JsonInputBufferSerializer::binary(std::string& value, Common::StringView name) {
+  const Token* token = getValue(name);
+  if (token == nullptr) {
+    return false;
+  }
+
+  if (token->type != STRING_TOKEN) {
+    throw std::runtime_error("JsonValue type is not STRING");
+  }
+
+  size_t textSize = token->size - 2;
+  if ((textSize & 1) != 0) {
+    throw std::runtime_error("fromHex: invalid string size");
+  }
+
+  const char* text = json.data() + token->offset + 1;
+  value.resize(textSize >> 1);
+  for (size_t i = 0; i < textSize >> 1; ++i) {
+    value[i] = static_cast<char>(Common::fromHex(text[i << 1]) << 4 | Common::fromHex(text[(i << 1) + 1]));
+  }
+
+  return true;
+}
+
+bool JsonInputBufferSerializer::getRawValue(Common::StringView name, std::string& text) {
+  const Token* token = findMember(chain.back(), name);
+  if (token == nullptr) {
+    return false;
+  }
+
+  text.assign(json, token->offset, token->size);
+  return true;
+}
+
+void JsonInputBufferSerializer::parseValue(size_t& position, size_t depth) {
+  if (depth > MAX_DEPTH) {
+    throw std::runtime_error("Unable to parse: values nest too deep");
+  }
+
+  skipSpaces(position);
+  if (position == json.size()) {
+    throw std::runtime_error("Unable to parse: unexpected end of stream");
+  }
+
+  size_t index = tokens.size();
+  size_t offset = position;
+  TokenType type;
+  tokens.push_back(Token{NULL_TOKEN, offset, 0, 0});
+
+  char c = json[position];
+  if (c == '{' || c == '[') {
+    char close = c == '{' ? '}' : ']';
+    type = c == '{' ? OBJECT_TOKEN : ARRAY_TOKEN;
+    ++position;
+    skipSpaces(position);
+    if (position < json.size() && json[position] == close) {
+      ++position;
+    } else {
+      for (;;) {
+        if (type == OBJECT_TOKEN) {
+          skipSpaces(position);
+          if (position == json.size() || json[position] != '"') {
+            throw std::runtime_error("Unable to parse");
+          }
+
+          parseValue(position, depth + 1);
+          skipSpaces(position);
+          if (position == json.size() || json[position] != ':') {
+            throw std::runtime_error("Unable to parse");
+          }
+
+          ++position;
+        }
+
+        parseValue(position, depth + 1);
+        skipSpaces(position);
+        if (position == json.size()) {
+          throw std::runtime_error("Unable to parse: unexpected end of stream");
+        }
+
+        c = json[position++];
+        if (c == close) {
+          break;
+        }
+
+        if (c != ',') {
+          throw std::runtime_error("Unable to parse");
+        }
+      }
+    }
+  } else if (c == '"') {
+    // escapes are kept as they are, as JsonValue keeps them
+    type = STRING_TOKEN;
+    for (++position;;) {
+      if (position >= json.size()) {
+        throw std::runtime_error("Unable to parse: unexpected end of stream");
+      }
+
+      c = json[position++];
+      if (c == '"') {
+        break;
+      }
+
+      if (c == '\\') {
+        ++position;
+      }
+    }
+  } else if (c == '-' || isDigit(c)) {
+    type = NUMBER_TOKEN;
+    if (c == '-') {
+      ++position;
+    }
+
+    size_t digits = position;
+    while (position < json.size() && isDigit(json[position])) {
+      ++position;
+    }
+
+    if (position == digits || (json[digits] == '0' && position - digits > 1)) {
+      throw std::runtime_error("Unable to parse");
+    }
+
+    if (position < json.size() && json[position] == '.') {
+      ++position;
+      while (position < json.size() && isDigit(json[position])) {
+        ++position;
+      }
+    }
+
+    if (position < json.size() && (json[position] == 'e' || json[position] == 'E')) {
+      ++position;
+      if (position < json.size() && (json[position] == '+' || json[position] == '-')) {
+        ++position;
+      }
+
+      digits = position;
+      while (position < json.size() && isDigit(json[position])) {
+        ++position;
+      }
+
+      if (position == digits) {
+        throw std::runtime_error("Unable to parse");
+      }
+    }
+  } else if (json.compare(position, 4, "true") == 0) {
+    type = TRUE_TOKEN;
+    position += 4;
+  } else if (json.compare(position, 5, "false") == 0) {
+    type = FALSE_TOKEN;
+    position += 5;
+  } else if (json.compare(position, 4, "null") == 0) {
+    type = NULL_TOKEN;
+    position += 4;
+  } else {
+    throw std::runtime_error("Unable to parse");
+  }
+
+  Token& token = tokens[index];
+  token.type = type;
+  token.size = position - offset;
+  token.next = tokens.size();
+}
+
+void JsonInputBufferSerializer::skipSpaces(size_t& position) const {
+  while (position < json.size() && std::isspace(static_cast<unsigned char>(json[position]))) {
+    ++position;
+  }
+}
+
+const JsonInputBufferSerializer::Token* JsonInputBufferSerializer::findMember(const Frame& frame, Common::StringView name) const {
+  const Token& object = tokens[frame.token];
+  if (object.type != OBJECT_TOKEN) {
+    throw std::runtime_error("JsonValue type is not OBJECT");
+  }
+
+  // a name given twice takes the last value, as in JsonValue
+  const Token* member = nullptr;
+  for (size_t i = frame.token + 1; i < object.next; i = tokens[i + 1].next) {
+    const Token& memberName = tokens[i];
+    if (memberName.size - 2 == name.getSize() && json.compare(memberName.offset + 1, memberName.size - 2, name.getData(), name.getSize()) == 0) {
+      member = &tokens[i + 1];
+    }
+  }
+
+  return member;
+}
+
+const JsonInputBufferSerializer::Token* JsonInputBufferSerializer::getValue(Common::StringView name) {
+  Frame& frame = chain.back();
+  const Token& parent = tokens[frame.token];
+  if (parent.type == ARRAY_TOKEN) {
+    if (frame.element >= parent.next) {
+      throw std::out_of_range("JsonValue array index out of range");
+    }
+
+    const Token* element = &tokens[frame.element];
+    frame.element = element->next;
+    return element;
+  }
+
+  return findMember(frame, name);
+}
+
+uint64_t JsonInputBufferSerializer::getInteger(const Token& token) const {
+  if (token.type != NUMBER_TOKEN) {
+    throw std::runtime_error("JsonValue type is not INTEGER");
+  }
+
+  const char* text = json.data() + token.offset;
+  const char* end = text + token.size;
+  bool negative = *text == '-';
+  if (negative) {
+    ++text;
+  }
+
+  uint64_t value = 0;
+  for (; text != end; ++text) {
+    if (!isDigit(*text)) {
+      throw std::runtime_error("JsonValue type is not INTEGER");
+    }
+
+    value = value * 10 + static_cast<uint64_t>(*text - '0');
+  }
+
+  return negative ? 0 - value : value;
+}
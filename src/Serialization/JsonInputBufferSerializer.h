@@ -0,0 +1,110 @@
+// Copyright (c) 2017-2018 Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ISerializer.h"
+
+namespace CryptoNote {
+
+// Reads values straight from JSON text. Parsing only records where every value starts and ends, the values
+// themselves are converted when they are serialized. Takes the input JsonInputValueSerializer takes over a
+// parsed JsonValue, and real numbers for double values besides.
+class JsonInputBufferSerializer : public ISerializer {
+public:
+  // Throws if the text is not JSON or its root is not an object.
+  explicit JsonInputBufferSerializer(std::string text);
+  virtual ~JsonInputBufferSerializer();
+
+  SerializerType type() const override;
+
+  virtual bool beginObject(Common::StringView name) override;
+  virtual void endObject() override;
+
+  virtual bool beginArray(size_t& size, Common::StringView name) override;
+  virtual void endArray() override;
+
+  virtual bool operator()(uint8_t& value, Common::StringView name) override;
+  virtual bool operator()(int16_t& value, Common::StringView name) override;
+  virtual bool operator()(uint16_t& value, Common::StringView name) override;
+  virtual bool operator()(int32_t& value, Common::StringView name) override;
+  virtual bool operator()(uint32_t& value, Common::StringView name) override;
+  virtual bool operator()(int64_t& value, Common::StringView name) override;
+  virtual bool operator()(uint64_t& value, Common::StringView name) override;
+  virtual bool operator()(double& value, Common::StringView name) override;
+  virtual bool operator()(bool& value, Common::StringView name) override;
+  virtual bool operator()(std::string& value, Common::StringView name) override;
+  virtual bool binary(void* value, size_t size, Common::StringView name) override;
+  virtual bool binary(std::string& value, Common::StringView name) override;
+
+  template<typename T>
+  bool operator()(T& value, Common::StringView name) {
+    return ISerializer::operator()(value, name);
+  }
+
+  // Copies the text of a member of the current object as it is in the source, returns false if there is none.
+  bool getRawValue(Common::StringView name, std::string& text);
+
+private:
+  enum TokenType : uint8_t {
+    ARRAY_TOKEN,
+    OBJECT_TOKEN,
+    STRING_TOKEN,
+    NUMBER_TOKEN,
+    TRUE_TOKEN,
+    FALSE_TOKEN,
+    NULL_TOKEN
+  };
+
+  // Members of an object follow it as pairs of a name and a value, elements of an array follow it in order.
+  struct Token {
+    TokenType type;
+    size_t offset; // of the text, strings include their quotes
+    size_t size;
+    size_t next; // index of the first token after the value and everything it contains
+  };
+
+  struct Frame {
+    size_t token;
+    size_t element; // next element of an array
+  };
+
+  void parseValue(size_t& position, size_t depth);
+  void skipSpaces(size_t& position) const;
+  const Token* findMember(const Frame& frame, Common::StringView name) const;
+  const Token* getValue(Common::StringView name);
+  uint64_t getInteger(const Token& token) const;
+
+  template <typename T>
+  bool getNumber(Common::StringView name, T& v) {
+    const Token* token = getValue(name);
+    if (token == nullptr) {
+      return false;
+    }
+
+    v = static_cast<T>(getInteger(*token));
+    return true;
+  }
+
+  std::string json;
+  std::vector<Token> tokens;
+  std::vector<Frame> chain;
+};
+
+}
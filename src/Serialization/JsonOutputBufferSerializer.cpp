@@ -0,0 +1,206 @@
+// Copyright (c) 2017-2018 Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "JsonOutputBufferSerializer.h"
+#include <cassert>
+#include <cstdio>
+
+using namespace CryptoNote;
+
+namespace {
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+}
+
+JsonOutputBufferSerializer::JsonOutputBufferSerializer() : buffer(1, '{') {
+  arrays.push_back(false);
+}
+
+JsonOutputBufferSerializer::~JsonOutputBufferSerializer() {
+}
+
+ISerializer::SerializerType JsonOutputBufferSerializer::type() const {
+  return ISerializer::OUTPUT;
+}
+
+bool JsonOutputBufferSerializer::beginObject(Common::StringView name) {
+  beginValue(name);
+  buffer += '{';
+  arrays.push_back(false);
+  return true;
+}
+
+void JsonOutputBufferSerializer::endObject() {
+  assert(arrays.size() > 1 && !arrays.back());
+  buffer += '}';
+  arrays.pop_back();
+}
+
+bool JsonOutputBufferSerializer::beginArray(size_t& size, Common::StringView name) {
+  beginValue(name);
+  buffer += '[';
+  arrays.push_back(true);
+  return true;
+}
+
+void JsonOutputBufferSerializer::endArray() {
+  assert(arrays.size() > 1 && arrays.back());
+  buffer += ']';
+  arrays.pop_back();
+}
+
+// unsigned values are printed as JsonValue holds them, as signed 64 bit integers
+bool JsonOutputBufferSerializer::operator()(uint64_t& value, Common::StringView name) {
+  beginValue(name);
+  writeInteger(static_cast<int64_t>(value));
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(uint16_t& value, Common::StringView name) {
+  beginValue(name);
+  writeInteger(value);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(int16_t& value, Common::StringView name) {
+  beginValue(name);
+  writeInteger(value);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(uint32_t& value, Common::StringView name) {
+  beginValue(name);
+  writeInteger(value);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(int32_t& value, Common::StringView name) {
+  beginValue(name);
+  writeInteger(value);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(int64_t& value, Common::StringView name) {
+  beginValue(name);
+  writeInteger(value);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(double& value, Common::StringView name) {
+  beginValue(name);
+
+  // the same text JsonValue prints: fixed with 11 decimals, trailing zeros dropped down to one decimal
+  char text[64];
+  int size = snprintf(text, sizeof(text), "%.11f", value);
+  std::string longText;
+  const char* begin = text;
+  if (size >= static_cast<int>(sizeof(text))) {
+    longText.resize(size + 1);
+    snprintf(&longText[0], longText.size(), "%.11f", value);
+    begin = longText.data();
+  }
+
+  while (size > 1 && begin[size - 2] != '.' && begin[size - 1] == '0') {
+    --size;
+  }
+
+  buffer.append(begin, size);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(std::string& value, Common::StringView name) {
+  beginValue(name);
+  buffer += '"';
+  buffer += value;
+  buffer += '"';
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(uint8_t& value, Common::StringView name) {
+  beginValue(name);
+  writeInteger(value);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(bool& value, Common::StringView name) {
+  beginValue(name);
+  buffer += value ? "true" : "false";
+  return true;
+}
+
+bool JsonOutputBufferSerializer::binary(void* value, size_t size, Common::StringView name) {
+  beginValue(name);
+
+  size_t offset = buffer.size();
+  buffer.resize(offset + size * 2 + 2);
+  char* output = &buffer[offset];
+  *output++ = '"';
+  for (size_t i = 0; i < size; ++i) {
+    uint8_t byte = static_cast<const uint8_t*>(value)[i];
+    *output++ = HEX_DIGITS[byte >> 4];
+    *output++ = HEX_DIGITS[byte & 15];
+  }
+
+  *output = '"';
+  return true;
+}
+
+bool JsonOutputBufferSerializer::binary(std::string& value, Common::StringView name) {
+  return binary(const_cast<char*>(value.data()), value.size(), name);
+}
+
+std::string& JsonOutputBufferSerializer::getJson() {
+  if (!arrays.empty()) {
+    assert(arrays.size() == 1);
+    buffer += '}';
+    arrays.pop_back();
+  }
+
+  return buffer;
+}
+
+void JsonOutputBufferSerializer::beginValue(Common::StringView name) {
+  assert(!arrays.empty());
+  char last = buffer.back();
+  if (last != '{' && last != '[') {
+    buffer += ',';
+  }
+
+  if (!arrays.back()) {
+    buffer += '"';
+    buffer.append(name.getData(), name.getSize());
+    buffer += "\":";
+  }
+}
+
+void JsonOutputBufferSerializer::writeInteger(int64_t value) {
+  char digits[20];
+  char* end = digits + sizeof(digits);
+  char* begin = end;
+  uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+  do {
+    *--begin = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+
+  if (value < 0) {
+    buffer += '-';
+  }
+
+  buffer.append(begin, end);
+}
@@ -30,7 +30,8 @@ public:
   ContextGroup& operator=(const ContextGroup&) = delete;
   ContextGroup& operator=(ContextGroup&& other);
   void interrupt();
-  void spawn(std::function<void()>&& procedure);
+  // stackSize 0 takes the dispatcher default.
+  void spawn(std::function<void()>&& procedure, size_t stackSize = 0);
   void wait();
 
 private:
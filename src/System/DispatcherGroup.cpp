@@ -0,0 +1,178 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "DispatcherGroup.h"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <future>
+#include <thread>
+
+#include <System/ContextGroup.h>
+#include <System/Dispatcher.h>
+#include <System/Event.h>
+#include <System/InterruptedException.h>
+
+namespace System {
+
+struct DispatcherGroup::Loop {
+  std::thread thread;
+  std::thread::id threadId;
+  Dispatcher* dispatcher;
+  Event* stopEvent;
+};
+
+void remoteCall(Dispatcher& current, Dispatcher& target, std::function<void()>&& procedure) {
+  if (&current == &target) {
+    procedure();
+    return;
+  }
+
+  Event done(current);
+  std::exception_ptr exception;
+  target.remoteSpawn([&] {
+    try {
+      procedure();
+    } catch (...) {
+      exception = std::current_exception();
+    }
+
+    // done lives on the caller's stack, the caller keeps waiting until current runs this
+    current.remoteSpawn([&done] {
+      done.set();
+    });
+  });
+
+  bool interrupted = false;
+  while (!done.get()) {
+    try {
+      done.wait();
+    } catch (InterruptedException&) {
+      interrupted = true;
+    }
+  }
+
+  if (interrupted) {
+    current.interrupt();
+  }
+
+  if (exception != nullptr) {
+    std::rethrow_exception(exception);
+  }
+}
+
+DispatcherGroup::DispatcherGroup(size_t loopCount) {
+  if (loopCount == 0) {
+    loopCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  for (size_t i = 0; i < loopCount; ++i) {
+    std::unique_ptr<Loop> loop(new Loop());
+    std::promise<void> started;
+    std::future<void> startedFuture = started.get_future();
+    Loop* loopPtr = loop.get();
+    loop->thread = std::thread([loopPtr, &started] {
+      try {
+        Dispatcher dispatcher;
+        Event stopEvent(dispatcher);
+        loopPtr->dispatcher = &dispatcher;
+        loopPtr->stopEvent = &stopEvent;
+        loopPtr->threadId = std::this_thread::get_id();
+        started.set_value();
+
+        while (!stopEvent.get()) {
+          try {
+            stopEvent.wait();
+          } catch (InterruptedException&) {
+          }
+        }
+
+        loopPtr->dispatcher = nullptr;
+        loopPtr->stopEvent = nullptr;
+      } catch (...) {
+        started.set_exception(std::current_exception());
+      }
+    });
+
+    try {
+      startedFuture.get();
+    } catch (...) {
+      loop->thread.join();
+      stop();
+      throw;
+    }
+
+    loops.push_back(std::move(loop));
+  }
+}
+
+DispatcherGroup::~DispatcherGroup() {
+  stop();
+}
+
+size_t DispatcherGroup::size() const {
+  return loops.size();
+}
+
+Dispatcher& DispatcherGroup::getDispatcher(size_t index) {
+  assert(index < loops.size());
+  assert(loops[index]->dispatcher != nullptr);
+  return *loops[index]->dispatcher;
+}
+
+Dispatcher* DispatcherGroup::getCurrentDispatcher() const {
+  std::thread::id current = std::this_thread::get_id();
+  for (auto& loop : loops) {
+    if (loop->threadId == current) {
+      return loop->dispatcher;
+    }
+  }
+
+  return nullptr;
+}
+
+void DispatcherGroup::spawn(size_t index, ContextGroup& group, std::function<void()>&& procedure) {
+  assert(index < loops.size());
+  Loop& loop = *loops[index];
+  if (loop.threadId == std::this_thread::get_id()) {
+    group.spawn(std::move(procedure));
+    return;
+  }
+
+  ContextGroup* target = &group;
+  loop.dispatcher->remoteSpawn([target, procedure]() mutable {
+    target->spawn(std::move(procedure));
+  });
+}
+
+void DispatcherGroup::stop() {
+  for (auto& loop : loops) {
+    if (loop->thread.joinable()) {
+      Event* stopEvent = loop->stopEvent;
+      loop->dispatcher->remoteSpawn([stopEvent] {
+        stopEvent->set();
+      });
+
+      loop->thread.join();
+    }
+  }
+
+  loops.clear();
+}
+
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace System {
+
+class ContextGroup;
+class Dispatcher;
+
+// Runs procedure on target and suspends the current context of current until it has finished, other contexts of
+// current keep running meanwhile. Exceptions thrown by procedure are rethrown here. An interruption of the caller
+// does not cut the call short, it is delivered once the call returns.
+void remoteCall(Dispatcher& current, Dispatcher& target, std::function<void()>&& procedure);
+
+// Event loops running on threads of their own, each with its own Dispatcher. Work is placed on a loop by spawning
+// it in a ContextGroup created for that loop's dispatcher, the group and its contexts then stay on the loop.
+class DispatcherGroup {
+public:
+  // loopCount 0 starts one loop per hardware thread.
+  explicit DispatcherGroup(size_t loopCount = 0);
+  DispatcherGroup(const DispatcherGroup&) = delete;
+  ~DispatcherGroup();
+  DispatcherGroup& operator=(const DispatcherGroup&) = delete;
+
+  size_t size() const;
+  Dispatcher& getDispatcher(size_t index);
+  // Dispatcher of the loop running on the calling thread, nullptr outside the group.
+  Dispatcher* getCurrentDispatcher() const;
+
+  // Spawns procedure in group, which must belong to the dispatcher of loop index. Can be called from any thread.
+  void spawn(size_t index, ContextGroup& group, std::function<void()>&& procedure);
+
+  // Ends the loops and joins their threads. Groups pinned to the loops should be stopped before.
+  void stop();
+
+private:
+  struct Loop;
+
+  std::vector<std::unique_ptr<Loop>> loops;
+};
+
+}
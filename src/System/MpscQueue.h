@@ -0,0 +1,102 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace System {
+
+// Unbounded queue which any number of threads push to and a single thread pops from, neither side takes a lock.
+// pop returns false while the queue is empty and also while the only pushed item is still being linked in, so the
+// consumer must be woken again by the producer after push returns.
+template<class T> class MpscQueue {
+public:
+  MpscQueue() : head(&stub), tail(&stub) {
+    stub.next.store(nullptr, std::memory_order_relaxed);
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  ~MpscQueue() {
+    T value;
+    while (pop(value)) {
+    }
+  }
+
+  void push(T&& value) {
+    pushNode(new Node(std::move(value)));
+  }
+
+  bool pop(T& value) {
+    Node* last = tail;
+    Node* next = last->next.load(std::memory_order_acquire);
+    if (last == &stub) {
+      if (next == nullptr) {
+        return false;
+      }
+
+      tail = next;
+      last = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next == nullptr) {
+      if (last != head.load(std::memory_order_acquire)) {
+        return false;
+      }
+
+      // the stub keeps the list non-empty once the last node is taken
+      pushNode(&stub);
+      next = last->next.load(std::memory_order_acquire);
+      if (next == nullptr) {
+        return false;
+      }
+    }
+
+    tail = next;
+    value = std::move(last->value);
+    delete last;
+    return true;
+  }
+
+private:
+  struct Node {
+    Node() {
+    }
+
+    explicit Node(T&& value) : next(nullptr), value(std::move(value)) {
+    }
+
+    std::atomic<Node*> next;
+    T value;
+  };
+
+  void pushNode(Node* node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node* previous = head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+  }
+
+  Node stub;
+  std::atomic<Node*> head;
+  Node* tail;
+};
+
+}
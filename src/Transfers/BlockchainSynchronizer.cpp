@@ -22,6 +22,7 @@
 #include <sstream>
 #include <unordered_set>
 
+#include "Common/ScopeExit.h"
 #include "Common/StreamTools.h"
 #include "Common/StringTools.h"
 #include "CryptoNoteCore/CryptoNoteBasicImpl.h"
@@ -77,7 +78,8 @@ BlockchainSynchronizer::BlockchainSynchronizer(INode& node, Logging::ILogger& lo
   m_node(node),
   m_genesisBlockHash(genesisBlockHash),
   m_currentState(State::stopped),
-  m_futureState(State::stopped) {
+  m_futureState(State::stopped),
+  m_consumersLockedCallCount(0) {
 }
 
 BlockchainSynchronizer::~BlockchainSynchronizer() {
@@ -118,12 +120,12 @@ bool BlockchainSynchronizer::removeConsumer(IBlockchainConsumer* consumer) {
 }
 
 IStreamSerializable* BlockchainSynchronizer::getConsumerState(IBlockchainConsumer* consumer) const {
-  std::unique_lock<std::mutex> lk(m_consumersMutex);
+  std::unique_lock<std::recursive_mutex> lk(m_consumersMutex);
   return getConsumerSynchronizationState(consumer);
 }
 
 std::vector<Crypto::Hash> BlockchainSynchronizer::getConsumerKnownBlocks(IBlockchainConsumer& consumer) const {
-  std::unique_lock<std::mutex> lk(m_consumersMutex);
+  std::unique_lock<std::recursive_mutex> lk(m_consumersMutex);
 
   auto state = getConsumerSynchronizationState(&consumer);
   if (state == nullptr) {
@@ -135,6 +137,31 @@ std::vector<Crypto::Hash> BlockchainSynchronizer::getConsumerKnownBlocks(IBlockc
   return state->getKnownBlockHashes();
 }
 
+std::vector<Crypto::Hash> BlockchainSynchronizer::getConsumerKnownBlocks(IBlockchainConsumer& consumer, uint32_t startIndex, uint32_t& knownBlockCount) const {
+  std::unique_lock<std::recursive_mutex> lk(m_consumersMutex);
+
+  auto state = getConsumerSynchronizationState(&consumer);
+  if (state == nullptr) {
+    auto message = "Failed to get consumer known blocks: not found";
+    m_logger(ERROR, BRIGHT_RED) << message << ", consumer " << &consumer;
+    throw std::invalid_argument(message);
+  }
+
+  const std::vector<Crypto::Hash>& blocks = state->getKnownBlockHashes();
+  knownBlockCount = static_cast<uint32_t>(blocks.size());
+  return std::vector<Crypto::Hash>(blocks.begin() + std::min(static_cast<size_t>(startIndex), blocks.size()), blocks.end());
+}
+
+void BlockchainSynchronizer::runWithConsumersLocked(const std::function<void()>& func) {
+  std::unique_lock<std::recursive_mutex> lk(m_consumersMutex);
+  ++m_consumersLockedCallCount;
+  Tools::ScopeExit decrementCount([this] {
+    --m_consumersLockedCallCount;
+  });
+
+  func();
+}
+
 std::future<std::error_code> BlockchainSynchronizer::addUnconfirmedTransaction(const ITransactionReader& transaction) {
   m_logger(INFO, BRIGHT_WHITE) << "Adding unconfirmed transaction, hash " << transaction.getTransactionHash();
 
@@ -174,7 +201,7 @@ std::future<void> BlockchainSynchronizer::removeUnconfirmedTransaction(const Cry
 }
 
 std::error_code BlockchainSynchronizer::doAddUnconfirmedTransaction(const ITransactionReader& transaction) {
-  std::unique_lock<std::mutex> lk(m_consumersMutex);
+  std::unique_lock<std::recursive_mutex> lk(m_consumersMutex);
 
   std::error_code ec;
   auto addIt = m_consumers.begin();
@@ -200,7 +227,7 @@ std::error_code BlockchainSynchronizer::doAddUnconfirmedTransaction(const ITrans
 }
 
 void BlockchainSynchronizer::doRemoveUnconfirmedTransaction(const Crypto::Hash& transactionHash) {
-  std::unique_lock<std::mutex> lk(m_consumersMutex);
+  std::unique_lock<std::recursive_mutex> lk(m_consumersMutex);
 
   for (auto& consumer : m_consumers) {
     consumer.first->removeUnconfirmedTransaction(transactionHash);
@@ -388,7 +415,7 @@ void BlockchainSynchronizer::poolChanged() {
 //--------------------------- FSM END ------------------------------------
 
 void BlockchainSynchronizer::getPoolUnionAndIntersection(std::unordered_set<Crypto::Hash>& poolUnion, std::unordered_set<Crypto::Hash>& poolIntersection) const {
-  std::unique_lock<std::mutex> lk(m_consumersMutex);
+  std::unique_lock<std::recursive_mutex> lk(m_consumersMutex);
 
   auto itConsumers = m_consumers.begin();
   poolUnion = itConsumers->first->getKnownPoolTxIds();
@@ -414,7 +441,7 @@ void BlockchainSynchronizer::getPoolUnionAndIntersection(std::unordered_set<Cryp
 
 BlockchainSynchronizer::GetBlocksRequest BlockchainSynchronizer::getCommonHistory() {
   GetBlocksRequest request;
-  std::unique_lock<std::mutex> lk(m_consumersMutex);
+  std::unique_lock<std::recursive_mutex> lk(m_consumersMutex);
   if (m_consumers.empty()) {
     return request;
   }
@@ -519,7 +546,7 @@ void BlockchainSynchronizer::processBlocks(GetBlocksResponse& response) {
   uint32_t processedBlockCount = response.startHeight + static_cast<uint32_t>(response.newBlocks.size());
   if (!checkIfShouldStop()) {
     response.newBlocks.clear();
-    std::unique_lock<std::mutex> lk(m_consumersMutex);
+    std::unique_lock<std::recursive_mutex> lk(m_consumersMutex);
     auto result = updateConsumers(interval, blocks);
     lk.unlock();
 
@@ -616,7 +643,7 @@ void BlockchainSynchronizer::removeOutdatedTransactions() {
   if (!ec) {
     m_logger(DEBUGGING) << "Outdated pool transactions received, " << response.deletedTxIds.size() << ':' << makeContainerFormatter(response.deletedTxIds);
 
-    std::unique_lock<std::mutex> lock(m_consumersMutex);
+    std::unique_lock<std::recursive_mutex> lock(m_consumersMutex);
     for (auto& consumer : m_consumers) {
       ec = consumer.first->onPoolUpdated({}, response.deletedTxIds);
       if (ec) {
@@ -732,7 +759,7 @@ std::error_code BlockchainSynchronizer::processPoolTxs(GetPoolResponse& response
 
   std::error_code error;
   {
-    std::unique_lock<std::mutex> lk(m_consumersMutex);
+    std::unique_lock<std::recursive_mutex> lk(m_consumersMutex);
     for (auto& consumer : m_consumers) {
       if (checkIfShouldStop()) { //if stop, return immediately, without notification
         m_logger(WARNING, BRIGHT_YELLOW) << "Pool transactions processing is interrupted";
@@ -758,8 +785,8 @@ std::error_code BlockchainSynchronizer::processPoolTxs(GetPoolResponse& response
 SynchronizationState* BlockchainSynchronizer::getConsumerSynchronizationState(IBlockchainConsumer* consumer) const {
   assert(consumer != nullptr);
 
-  if (!(checkIfStopped() && checkIfShouldStop())) {
-    auto message = "Failed to get consumer state: not stopped";
+  if (m_consumersLockedCallCount == 0 && !(checkIfStopped() && checkIfShouldStop())) {
+    auto message = "Failed to get consumer state: neither stopped nor locked";
     m_logger(ERROR, BRIGHT_RED) << message << ", consumer " << consumer;
     throw std::runtime_error(message);
   }
@@ -45,6 +45,8 @@ public:
   virtual bool removeConsumer(IBlockchainConsumer* consumer) override;
   virtual IStreamSerializable* getConsumerState(IBlockchainConsumer* consumer) const override;
   virtual std::vector<Crypto::Hash> getConsumerKnownBlocks(IBlockchainConsumer& consumer) const override;
+  virtual std::vector<Crypto::Hash> getConsumerKnownBlocks(IBlockchainConsumer& consumer, uint32_t startIndex, uint32_t& knownBlockCount) const override;
+  virtual void runWithConsumersLocked(const std::function<void()>& func) override;
 
   virtual std::future<std::error_code> addUnconfirmedTransaction(const ITransactionReader& transaction) override;
   virtual std::future<void> removeUnconfirmedTransaction(const Crypto::Hash& transactionHash) override;
@@ -143,7 +145,8 @@ private:
   std::list<std::pair<const ITransactionReader*, std::promise<std::error_code>>> m_addTransactionTasks;
   std::list<std::pair<const Crypto::Hash*, std::promise<void>>> m_removeTransactionTasks;
 
-  mutable std::mutex m_consumersMutex;
+  mutable std::recursive_mutex m_consumersMutex;
+  size_t m_consumersLockedCallCount; // guarded by m_consumersMutex
   mutable std::mutex m_stateMutex;
   std::condition_variable m_hasWork;
 };
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <future>
 #include <system_error>
 #include <unordered_set>
@@ -71,6 +72,10 @@ public:
   virtual bool removeConsumer(IBlockchainConsumer* consumer) = 0;
   virtual IStreamSerializable* getConsumerState(IBlockchainConsumer* consumer) const = 0;
   virtual std::vector<Crypto::Hash> getConsumerKnownBlocks(IBlockchainConsumer& consumer) const = 0;
+  // Returns the known blocks starting at startIndex, knownBlockCount is set to the count of all of them
+  virtual std::vector<Crypto::Hash> getConsumerKnownBlocks(IBlockchainConsumer& consumer, uint32_t startIndex, uint32_t& knownBlockCount) const = 0;
+  // Runs func while the consumers are not updated, it can read the consumer states without stopping the synchronizer
+  virtual void runWithConsumersLocked(const std::function<void()>& func) = 0;
 
   virtual std::future<std::error_code> addUnconfirmedTransaction(const ITransactionReader& transaction) = 0;
   virtual std::future<void> removeUnconfirmedTransaction(const Crypto::Hash& transactionHash) = 0;
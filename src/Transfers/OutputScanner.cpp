@@ -0,0 +1,204 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "OutputScanner.h"
+
+#include <cassert>
+#include <cstring>
+#include <memory>
+
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+
+using namespace Crypto;
+
+namespace CryptoNote {
+
+namespace {
+
+const size_t MIN_SLOT_COUNT = 16;
+
+size_t slotIndex(const PublicKey& key) {
+  // keys are point encodings, so their first bytes are already uniformly distributed
+  uint64_t word;
+  std::memcpy(&word, &key, sizeof(word));
+  return static_cast<size_t>(word);
+}
+
+}
+
+OutputScanner::OutputScanner(const SecretKey& viewSecretKey) : m_viewSecretKey(viewSecretKey), m_slotMask(0), m_keyCount(0) {
+  rebuild(MIN_SLOT_COUNT);
+}
+
+void OutputScanner::addSpendKey(const PublicKey& spendKey) {
+  assert(spendKey != NULL_PUBLIC_KEY);
+  if (hasSpendKey(spendKey)) {
+    return;
+  }
+
+  // keep the table at most half full
+  if ((m_keyCount + 1) * 2 > m_slots.size()) {
+    rebuild(m_slots.size() * 2);
+  }
+
+  size_t index = slotIndex(spendKey) & m_slotMask;
+  while (m_slots[index] != NULL_PUBLIC_KEY) {
+    index = (index + 1) & m_slotMask;
+  }
+
+  m_slots[index] = spendKey;
+  ++m_keyCount;
+}
+
+void OutputScanner::removeSpendKey(const PublicKey& spendKey) {
+  if (!hasSpendKey(spendKey)) {
+    return;
+  }
+
+  // linear probing cannot just clear a slot, the table is rebuilt without the key instead
+  std::vector<PublicKey> keys;
+  keys.reserve(m_keyCount - 1);
+  for (const PublicKey& key : m_slots) {
+    if (key != NULL_PUBLIC_KEY && key != spendKey) {
+      keys.push_back(key);
+    }
+  }
+
+  m_slots.assign(m_slots.size(), NULL_PUBLIC_KEY);
+  m_keyCount = 0;
+  for (const PublicKey& key : keys) {
+    addSpendKey(key);
+  }
+}
+
+bool OutputScanner::hasSpendKey(const PublicKey& spendKey) const {
+  for (size_t index = slotIndex(spendKey) & m_slotMask;; index = (index + 1) & m_slotMask) {
+    const PublicKey& slot = m_slots[index];
+    if (slot == NULL_PUBLIC_KEY) {
+      return false;
+    }
+
+    if (slot == spendKey) {
+      return true;
+    }
+  }
+}
+
+size_t OutputScanner::spendKeyCount() const {
+  return m_keyCount;
+}
+
+void OutputScanner::scan(const ITransactionReader* const* transactions, size_t count, std::vector<Outputs>& outputs) const {
+  outputs.clear();
+  outputs.resize(count);
+  if (m_keyCount == 0 || count == 0) {
+    return;
+  }
+
+  std::vector<PublicKey> transactionKeys;
+  transactionKeys.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    transactionKeys.push_back(transactions[i]->getTransactionPublicKey());
+  }
+
+  std::vector<KeyDerivation> derivations(count);
+  std::unique_ptr<bool[]> derived(new bool[count]);
+  generate_key_derivations(transactionKeys.data(), count, m_viewSecretKey, derivations.data(), derived.get());
+
+  // every output key of the batch with the derivation and index it was created with
+  std::vector<const KeyDerivation*> keyDerivations;
+  std::vector<size_t> keyIndexes;
+  std::vector<PublicKey> keys;
+  std::vector<std::pair<size_t, uint32_t>> keyOutputs;
+  for (size_t i = 0; i < count; ++i) {
+    if (!derived[i]) {
+      continue;
+    }
+
+    const ITransactionReader& tx = *transactions[i];
+    size_t keyIndex = 0;
+    size_t outputCount = tx.getOutputCount();
+    for (size_t idx = 0; idx < outputCount; ++idx) {
+      auto outType = tx.getOutputType(idx);
+      uint64_t amount;
+
+      if (outType == TransactionTypes::OutputType::Key) {
+        KeyOutput out;
+        tx.getOutput(idx, out, amount);
+
+        keyDerivations.push_back(&derivations[i]);
+        keyIndexes.push_back(keyIndex);
+        keys.push_back(out.key);
+        keyOutputs.emplace_back(i, static_cast<uint32_t>(idx));
+        ++keyIndex;
+      } else if (outType == TransactionTypes::OutputType::Multisignature) {
+        MultisignatureOutput out;
+        tx.getOutput(idx, out, amount);
+
+        // keys of a multisignature output are all derived with the index of the output
+        for (const auto& key : out.keys) {
+          keyDerivations.push_back(&derivations[i]);
+          keyIndexes.push_back(idx);
+          keys.push_back(key);
+          keyOutputs.emplace_back(i, static_cast<uint32_t>(idx));
+          ++keyIndex;
+        }
+      }
+    }
+  }
+
+  std::vector<PublicKey> spendKeys(keys.size());
+  std::unique_ptr<bool[]> underived(new bool[keys.size()]);
+  underive_public_keys(keyDerivations.data(), keyIndexes.data(), keys.data(), keys.size(), spendKeys.data(), underived.get());
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (underived[i] && hasSpendKey(spendKeys[i])) {
+      outputs[keyOutputs[i].first][spendKeys[i]].push_back(keyOutputs[i].second);
+    }
+  }
+}
+
+void OutputScanner::scan(const ITransactionReader& transaction, Outputs& outputs) const {
+  const ITransactionReader* transactions[] = { &transaction };
+  std::vector<Outputs> transactionOutputs;
+  scan(transactions, 1, transactionOutputs);
+  outputs = std::move(transactionOutputs[0]);
+}
+
+void OutputScanner::rebuild(size_t slotCount) {
+  assert((slotCount & (slotCount - 1)) == 0);
+
+  std::vector<PublicKey> slots(slotCount, NULL_PUBLIC_KEY);
+  size_t mask = slotCount - 1;
+  for (const PublicKey& key : m_slots) {
+    if (key == NULL_PUBLIC_KEY) {
+      continue;
+    }
+
+    size_t index = slotIndex(key) & mask;
+    while (slots[index] != NULL_PUBLIC_KEY) {
+      index = (index + 1) & mask;
+    }
+
+    slots[index] = key;
+  }
+
+  m_slots.swap(slots);
+  m_slotMask = mask;
+}
+
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "ITransaction.h"
+#include "crypto/crypto.h"
+
+namespace CryptoNote {
+
+// Finds transaction outputs sent to any of a set of spend public keys which share one view secret key.
+// Transactions are scanned in batches: key derivations of all transactions of a batch, and then the spend keys
+// of all their outputs, are encoded with a single field inversion each. Almost every output belongs to somebody
+// else, so spend keys are kept in a flat open addressing table where most misses take a single probe.
+class OutputScanner {
+public:
+  // spend public key -> indexes of outputs in the transaction
+  typedef std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>> Outputs;
+
+  explicit OutputScanner(const Crypto::SecretKey& viewSecretKey);
+
+  void addSpendKey(const Crypto::PublicKey& spendKey);
+  void removeSpendKey(const Crypto::PublicKey& spendKey);
+  bool hasSpendKey(const Crypto::PublicKey& spendKey) const;
+  size_t spendKeyCount() const;
+
+  // outputs[i] receives the outputs of transactions[i]
+  void scan(const ITransactionReader* const* transactions, size_t count, std::vector<Outputs>& outputs) const;
+  void scan(const ITransactionReader& transaction, Outputs& outputs) const;
+
+private:
+  void rebuild(size_t slotCount);
+
+  const Crypto::SecretKey m_viewSecretKey;
+  // NULL_PUBLIC_KEY marks a free slot, it is never a spend key
+  std::vector<Crypto::PublicKey> m_slots;
+  size_t m_slotMask;
+  size_t m_keyCount;
+};
+
+}
@@ -19,12 +19,14 @@
 
 #include "TransfersConsumer.h"
 
+#include <condition_variable>
 #include <numeric>
 #include <future>
 
 #include "CommonTypes.h"
 #include "Common/StringTools.h"
 #include "Common/BlockingQueue.h"
+#include "Common/ScopeExit.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 #include "CryptoNoteCore/TransactionApi.h"
 
@@ -35,73 +37,19 @@ using namespace Crypto;
 using namespace Logging;
 using namespace Common;
 
-std::unordered_set<Crypto::Hash> transactions_hash_seen;
-std::unordered_set<Crypto::PublicKey> public_keys_seen;
-std::mutex seen_mutex;
-
 namespace {
 
 using namespace CryptoNote;
 
-void checkOutputKey(
-  const KeyDerivation& derivation,
-  const PublicKey& key,
-  size_t keyIndex,
-  size_t outputIndex,
-  const std::unordered_set<PublicKey>& spendKeys,
-  std::unordered_map<PublicKey, std::vector<uint32_t>>& outputs) {
-
-  PublicKey spendKey;
-  underive_public_key(derivation, keyIndex, key, spendKey);
-
-  if (spendKeys.find(spendKey) != spendKeys.end()) {
-    outputs[spendKey].push_back(static_cast<uint32_t>(outputIndex));
-  }
-
-}
-
-void findMyOutputs(
-  const ITransactionReader& tx,
-  const SecretKey& viewSecretKey,
-  const std::unordered_set<PublicKey>& spendKeys,
-  std::unordered_map<PublicKey, std::vector<uint32_t>>& outputs) {
-
-  auto txPublicKey = tx.getTransactionPublicKey();
-  KeyDerivation derivation;
-
-  if (!generate_key_derivation( txPublicKey, viewSecretKey, derivation)) {
-    return;
-  }
-
-  size_t keyIndex = 0;
-  size_t outputCount = tx.getOutputCount();
-
-  for (size_t idx = 0; idx < outputCount; ++idx) {
-
-    auto outType = tx.getOutputType(size_t(idx));
-
-    if (outType == TransactionTypes::OutputType::Key) {
-
-      uint64_t amount;
-      KeyOutput out;
-      tx.getOutput(idx, out, amount);
-
-      checkOutputKey(derivation, out.key, keyIndex, idx, spendKeys, outputs);
-      ++keyIndex;
-
-    } else if (outType == TransactionTypes::OutputType::Multisignature) {
-
-      uint64_t amount;
-      MultisignatureOutput out;
-      tx.getOutput(idx, out, amount);
+// transactions scanned for own outputs at once, derivations and spend keys of a batch share a field inversion
+const size_t SCAN_BATCH_SIZE = 64;
 
-      for (const auto& key : out.keys) {
-        checkOutputKey(derivation, key, idx, idx, spendKeys, outputs);
+// batches in flight per worker, a scanned batch waits for its predecessors at most this long
+const size_t SCAN_BATCHES_PER_WORKER = 4;
 
-        ++keyIndex;
-      }
-    }
-  }
+size_t scanWorkerCount() {
+  size_t workers = std::thread::hardware_concurrency();
+  return workers == 0 ? 2 : workers;
 }
 
 std::vector<Crypto::Hash> getBlockHashes(const CryptoNote::CompleteBlock* blocks, size_t count) {
@@ -120,10 +68,18 @@ std::vector<Crypto::Hash> getBlockHashes(const CryptoNote::CompleteBlock* blocks
 namespace CryptoNote {
 
 TransfersConsumer::TransfersConsumer(const CryptoNote::Currency& currency, INode& node, Logging::ILogger& logger, const SecretKey& viewSecret) :
-  m_node(node), m_viewSecret(viewSecret), m_currency(currency), m_logger(logger, "TransfersConsumer") {
+  m_node(node), m_viewSecret(viewSecret), m_outputScanner(viewSecret), m_currency(currency), m_logger(logger, "TransfersConsumer"),
+  m_scanTasks(scanWorkerCount() * SCAN_BATCHES_PER_WORKER) {
   updateSyncStart();
 }
 
+TransfersConsumer::~TransfersConsumer() {
+  m_scanTasks.close();
+  for (auto& worker : m_scanWorkers) {
+    worker.join();
+  }
+}
+
 ITransfersSubscription& TransfersConsumer::addSubscription(const AccountSubscription& subscription) {
   if (subscription.keys.viewSecretKey != m_viewSecret) {
     throw std::runtime_error("TransfersConsumer: view secret key mismatch");
@@ -133,7 +89,7 @@ ITransfersSubscription& TransfersConsumer::addSubscription(const AccountSubscrip
 
   if (res.get() == nullptr) {
     res.reset(new TransfersSubscription(m_currency, m_logger.getLogger(), subscription));
-    m_spendKeys.insert(subscription.keys.address.spendPublicKey);
+    m_outputScanner.addSpendKey(subscription.keys.address.spendPublicKey);
     if (m_subscriptions.size() == 1) {
       m_syncStart = res->getSyncStart();
     } else {
@@ -148,7 +104,7 @@ ITransfersSubscription& TransfersConsumer::addSubscription(const AccountSubscrip
 
 bool TransfersConsumer::removeSubscription(const AccountPublicAddress& address) {
   m_subscriptions.erase(address.spendPublicKey);
-  m_spendKeys.erase(address.spendPublicKey);
+  m_outputScanner.removeSpendKey(address.spendPublicKey);
   updateSyncStart();
   return m_subscriptions.empty();
 }
@@ -204,32 +160,29 @@ void TransfersConsumer::onBlockchainDetach(uint32_t height) {
   }
 }
 
+// Transactions are scanned in batches by the worker pool while this thread applies the scanned batches in chain order.
+// At most m_scanTasks.capacity() batches are in flight, so memory does not depend on the number of blocks.
 bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startHeight, uint32_t count) {
   assert(blocks);
   assert(count > 0);
 
-  struct Tx {
-    TransactionBlockInfo blockInfo;
-    const ITransactionReader* tx;
-  };
-
-  struct PreprocessedTx : Tx, PreprocessInfo {};
+  startScanWorkers();
 
-  std::vector<PreprocessedTx> preprocessedTransactions;
-  std::mutex preprocessedTransactionsMutex;
+  size_t window = m_scanTasks.capacity();
+  std::vector<ScanBatch> batches(window);
+  std::mutex readyMutex;
+  std::condition_variable readyChanged;
 
-  size_t workers = std::thread::hardware_concurrency();
-  if (workers == 0) {
-    workers = 2;
-  }
-
-  BlockingQueue<Tx> inputQueue(workers * 2);
-
-  std::atomic<bool> stopProcessing(false);
+  uint32_t blockIndex = 0;
+  size_t transactionIndex = 0;
+  auto fillBatch = [&](ScanBatch& batch) {
+    batch.blockInfos.clear();
+    batch.transactions.clear();
+    batch.error = std::error_code();
+    batch.ready = false;
 
-  auto pushingThread = std::async(std::launch::async, [&] {
-    for( uint32_t i = 0; i < count && !stopProcessing; ++i) {
-      const auto& block = blocks[i].block;
+    for (; blockIndex < count && batch.transactions.size() < SCAN_BATCH_SIZE; ++blockIndex, transactionIndex = 0) {
+      const auto& block = blocks[blockIndex].block;
 
       if (!block.is_initialized()) {
         continue;
@@ -241,77 +194,94 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
       }
 
       TransactionBlockInfo blockInfo;
-      blockInfo.height = startHeight + i;
+      blockInfo.height = startHeight + blockIndex;
       blockInfo.timestamp = block->timestamp;
-      blockInfo.transactionIndex = 0; // position in block
 
-      for (const auto& tx : blocks[i].transactions) {
-        auto pubKey = tx->getTransactionPublicKey();
-        if (pubKey == NULL_PUBLIC_KEY) {
-          ++blockInfo.transactionIndex;
+      const auto& transactions = blocks[blockIndex].transactions;
+      auto it = std::next(transactions.begin(), transactionIndex);
+      for (; it != transactions.end() && batch.transactions.size() < SCAN_BATCH_SIZE; ++it, ++transactionIndex) {
+        if ((*it)->getTransactionPublicKey() == NULL_PUBLIC_KEY) {
           continue;
         }
 
-        Tx item = { blockInfo, tx.get() };
-        inputQueue.push(item);
-        ++blockInfo.transactionIndex;
+        blockInfo.transactionIndex = static_cast<uint32_t>(transactionIndex); // position in block
+        batch.blockInfos.push_back(blockInfo);
+        batch.transactions.push_back(it->get());
+      }
+
+      if (transactionIndex < transactions.size()) {
+        break;
       }
     }
 
-    inputQueue.close();
-  });
+    return !batch.transactions.empty();
+  };
+
+  auto waitReady = [&](const ScanBatch& batch) {
+    std::unique_lock<std::mutex> lk(readyMutex);
+    readyChanged.wait(lk, [&] { return batch.ready; });
+  };
 
-  auto processingFunction = [&] {
-    Tx item;
-    std::error_code ec;
-    while (!stopProcessing && inputQueue.pop(item)) {
-      PreprocessedTx output;
-      static_cast<Tx&>(output) = item;
+  std::vector<Crypto::Hash> blockHashes = getBlockHashes(blocks, count);
+  bool blocksAdded = false;
+  bool filling = true;
+  size_t submitted = 0;
+  size_t applied = 0;
+  std::error_code processingError;
 
-      ec = preprocessOutputs(item.blockInfo, *item.tx, output);
-      if (ec) {
-        stopProcessing = true;
+  // queued tasks refer to the batches on this frame, they all have to finish before it is left, also by an exception
+  Tools::ScopeExit waitSubmitted([&] {
+    for (; applied < submitted; ++applied) {
+      waitReady(batches[applied % window]);
+    }
+  });
+
+  while (!processingError) {
+    while (filling && submitted - applied < window) {
+      ScanBatch& batch = batches[submitted % window];
+      if (!fillBatch(batch)) {
+        filling = false;
         break;
       }
 
-      std::lock_guard<std::mutex> lk(preprocessedTransactionsMutex);
-      preprocessedTransactions.push_back(std::move(output));
+      ++submitted;
+      m_scanTasks.push([this, &batch, &readyMutex, &readyChanged] {
+        scanBatch(batch);
+        std::lock_guard<std::mutex> lk(readyMutex);
+        batch.ready = true;
+        readyChanged.notify_all();
+      });
     }
-    return ec;
-  };
 
-  std::vector<std::future<std::error_code>> processingThreads;
-  for (size_t i = 0; i < workers; ++i) {
-    processingThreads.push_back(std::async(std::launch::async, processingFunction));
-  }
+    if (applied == submitted) {
+      break;
+    }
 
-  std::error_code processingError;
-  for (auto& f : processingThreads) {
-    try {
-      std::error_code ec = f.get();
-      if (!processingError && ec) {
-        processingError = ec;
-      }
-    } catch (const std::system_error& e) {
-      processingError = e.code();
-    } catch (const std::exception&) {
-      processingError = std::make_error_code(std::errc::operation_canceled);
+    ScanBatch& batch = batches[applied % window];
+    waitReady(batch);
+    ++applied;
+    if (batch.error) {
+      processingError = batch.error;
+      break;
     }
-  }
 
-  std::vector<Crypto::Hash> blockHashes = getBlockHashes(blocks, count);
-  if (!processingError) {
-    m_observerManager.notify(&IBlockchainConsumerObserver::onBlocksAdded, this, blockHashes);
+    if (!blocksAdded) {
+      m_observerManager.notify(&IBlockchainConsumerObserver::onBlocksAdded, this, blockHashes);
+      blocksAdded = true;
+    }
 
-    // sort by block height and transaction index in block
-    std::sort(preprocessedTransactions.begin(), preprocessedTransactions.end(), [](const PreprocessedTx& a, const PreprocessedTx& b) {
-      return std::tie(a.blockInfo.height, a.blockInfo.transactionIndex) < std::tie(b.blockInfo.height, b.blockInfo.transactionIndex);
-    });
+    for (size_t i = 0; i < batch.transactions.size(); ++i) {
+      processTransaction(batch.blockInfos[i], *batch.transactions[i], batch.infos[i]);
+    }
+  }
 
-    for (const auto& tx : preprocessedTransactions) {
-      processTransaction(tx.blockInfo, *tx.tx, tx);
+  if (processingError) {
+    if (blocksAdded) {
+      // transactions of the batches applied so far are rolled back with onTransactionDeleted notifications,
+      // so observers drop them before they get the error
+      onBlockchainDetach(startHeight);
     }
-  } else {
+
     forEachSubscription([&](TransfersSubscription& sub) {
       sub.onError(processingError, startHeight);
     });
@@ -319,6 +289,10 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
     return false;
   }
 
+  if (!blocksAdded) {
+    m_observerManager.notify(&IBlockchainConsumerObserver::onBlocksAdded, this, blockHashes);
+  }
+
   auto newHeight = startHeight + count - 1;
   forEachSubscription([newHeight](TransfersSubscription& sub) {
     sub.advanceHeight(newHeight);
@@ -327,6 +301,42 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
   return true;
 }
 
+void TransfersConsumer::startScanWorkers() {
+  if (!m_scanWorkers.empty()) {
+    return;
+  }
+
+  size_t workers = scanWorkerCount();
+  for (size_t i = 0; i < workers; ++i) {
+    m_scanWorkers.emplace_back([this] {
+      std::function<void()> task;
+      while (m_scanTasks.pop(task)) {
+        task();
+      }
+    });
+  }
+}
+
+void TransfersConsumer::scanBatch(ScanBatch& batch) {
+  try {
+    std::vector<OutputScanner::Outputs> outputs;
+    m_outputScanner.scan(batch.transactions.data(), batch.transactions.size(), outputs);
+
+    batch.infos.clear();
+    batch.infos.resize(batch.transactions.size());
+    for (size_t i = 0; i < batch.transactions.size(); ++i) {
+      batch.error = preprocessOutputs(batch.blockInfos[i], *batch.transactions[i], outputs[i], batch.infos[i]);
+      if (batch.error) {
+        break;
+      }
+    }
+  } catch (const std::system_error& e) {
+    batch.error = e.code();
+  } catch (const std::exception&) {
+    batch.error = std::make_error_code(std::errc::operation_canceled);
+  }
+}
+
 std::error_code TransfersConsumer::onPoolUpdated(const std::vector<std::unique_ptr<ITransactionReader>>& addedTransactions, const std::vector<Hash>& deletedTransactions) {
   TransactionBlockInfo unconfirmedBlockInfo;
   unconfirmedBlockInfo.timestamp = 0; 
@@ -381,9 +391,8 @@ void TransfersConsumer::removeUnconfirmedTransaction(const Crypto::Hash& transac
 }
 
 void TransfersConsumer::addPublicKeysSeen(const Crypto::Hash& transactionHash, const Crypto::PublicKey& outputKey) {
-	std::lock_guard<std::mutex> lk(seen_mutex);
-    transactions_hash_seen.insert(transactionHash);
-    public_keys_seen.insert(outputKey);
+  std::lock_guard<std::mutex> lk(m_seenOutputKeysMutex);
+  m_seenOutputKeys.emplace(outputKey, transactionHash);
 }
 
 std::error_code TransfersConsumer::createTransfers(
@@ -397,7 +406,7 @@ std::error_code TransfersConsumer::createTransfers(
   auto txPubKey = tx.getTransactionPublicKey();
   auto txHash = tx.getTransactionHash();
   std::vector<PublicKey> temp_keys;
-  std::lock_guard<std::mutex> lk(seen_mutex);
+  std::lock_guard<std::mutex> lk(m_seenOutputKeysMutex);
 
   for (auto idx : outputs) {
 
@@ -436,19 +445,16 @@ std::error_code TransfersConsumer::createTransfers(
 
       assert(out.key == reinterpret_cast<const PublicKey&>(in_ephemeral.publicKey));
 
-      std::unordered_set<Crypto::Hash>::iterator it = transactions_hash_seen.find(txHash);
-	  if (it == transactions_hash_seen.end()) {
-        std::unordered_set<Crypto::PublicKey>::iterator key_it = public_keys_seen.find(out.key);
-        if (key_it != public_keys_seen.end()) {
-          m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": duplicate output key is found!";
-          return std::error_code();
-        }
-        if (std::find(temp_keys.begin(), temp_keys.end(), out.key) != temp_keys.end()) {
-          m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": the same output key is present more than once";
-          return std::error_code();
-        }
-        temp_keys.push_back(out.key);
-	  }
+      auto key_it = m_seenOutputKeys.find(out.key);
+      if (key_it != m_seenOutputKeys.end() && key_it->second != txHash) {
+        m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": duplicate output key is found!";
+        return std::error_code();
+      }
+      if (std::find(temp_keys.begin(), temp_keys.end(), out.key) != temp_keys.end()) {
+        m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": the same output key is present more than once";
+        return std::error_code();
+      }
+      temp_keys.push_back(out.key);
       info.amount = amount;
       info.outputKey = out.key;
 
@@ -457,20 +463,17 @@ std::error_code TransfersConsumer::createTransfers(
       MultisignatureOutput out;
       tx.getOutput(idx, out, amount);
 
-	  for (const auto& key : out.keys) {
-        std::unordered_set<Crypto::Hash>::iterator it = transactions_hash_seen.find(txHash);
-        if (it == transactions_hash_seen.end()) {
-          std::unordered_set<Crypto::PublicKey>::iterator key_it = public_keys_seen.find(key);
-          if (key_it != public_keys_seen.end()) {
-			  m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": duplicate multisignature output key is found";
-            return std::error_code();
-          }
-          if (std::find(temp_keys.begin(), temp_keys.end(), key) != temp_keys.end()) {
-            m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": the same multisignature output key is present more than once";
-            return std::error_code();
-          }
-          temp_keys.push_back(key);
+      for (const auto& key : out.keys) {
+        auto key_it = m_seenOutputKeys.find(key);
+        if (key_it != m_seenOutputKeys.end() && key_it->second != txHash) {
+          m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": duplicate multisignature output key is found";
+          return std::error_code();
+        }
+        if (std::find(temp_keys.begin(), temp_keys.end(), key) != temp_keys.end()) {
+          m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": the same multisignature output key is present more than once";
+          return std::error_code();
         }
+        temp_keys.push_back(key);
       }
       info.amount = amount;
       info.requiredSignatures = out.requiredSignatureCount;
@@ -479,15 +482,21 @@ std::error_code TransfersConsumer::createTransfers(
     transfers.push_back(info);
   }
 
-  transactions_hash_seen.emplace(txHash);
-  std::copy(temp_keys.begin(), temp_keys.end(), std::inserter(public_keys_seen, public_keys_seen.end()));
+  for (const auto& key : temp_keys) {
+    m_seenOutputKeys.emplace(key, txHash);
+  }
 
   return std::error_code();
 }
 
 std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info) {
-  std::unordered_map<PublicKey, std::vector<uint32_t>> outputs;
-  findMyOutputs(tx, m_viewSecret, m_spendKeys, outputs);
+  OutputScanner::Outputs outputs;
+  m_outputScanner.scan(tx, outputs);
+  return preprocessOutputs(blockInfo, tx, outputs, info);
+}
+
+std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx,
+  const OutputScanner::Outputs& outputs, PreprocessInfo& info) {
   if (outputs.empty()) {
     return std::error_code();
   }
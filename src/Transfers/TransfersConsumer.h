@@ -21,14 +21,19 @@
 
 #include "IBlockchainSynchronizer.h"
 #include "ITransfersSynchronizer.h"
+#include "OutputScanner.h"
 #include "TransfersSubscription.h"
 #include "TypeHelpers.h"
 
+#include "Common/BlockingQueue.h"
 #include "crypto/crypto.h"
 #include "Logging/LoggerRef.h"
 
 #include "IObservableImpl.h"
 
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <unordered_set>
 
 namespace CryptoNote {
@@ -39,6 +44,7 @@ class TransfersConsumer: public IObservableImpl<IBlockchainConsumerObserver, IBl
 public:
 
   TransfersConsumer(const CryptoNote::Currency& currency, INode& node, Logging::ILogger& logger, const Crypto::SecretKey& viewSecret);
+  ~TransfersConsumer();
 
   ITransfersSubscription& addSubscription(const AccountSubscription& subscription);
   // returns true if no subscribers left
@@ -73,7 +79,21 @@ private:
     std::vector<uint32_t> globalIdxs;
   };
 
+  // consecutive transactions of the blocks passed to onNewBlocks, preprocessed by one scan worker
+  struct ScanBatch {
+    std::vector<TransactionBlockInfo> blockInfos;
+    std::vector<const ITransactionReader*> transactions;
+    std::vector<PreprocessInfo> infos;
+    std::error_code error;
+    bool ready = false;
+  };
+
+  void startScanWorkers();
+  void scanBatch(ScanBatch& batch);
+
   std::error_code preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info);
+  std::error_code preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx,
+    const OutputScanner::Outputs& outputs, PreprocessInfo& info);
   std::error_code processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx);
   void processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, const PreprocessInfo& info);
   void processOutputs(const TransactionBlockInfo& blockInfo, TransfersSubscription& sub, const ITransactionReader& tx,
@@ -88,12 +108,18 @@ private:
   const Crypto::SecretKey m_viewSecret;
   // map { spend public key -> subscription }
   std::unordered_map<Crypto::PublicKey, std::unique_ptr<TransfersSubscription>> m_subscriptions;
-  std::unordered_set<Crypto::PublicKey> m_spendKeys;
+  OutputScanner m_outputScanner;
   std::unordered_set<Crypto::Hash> m_poolTxs;
+  // own output key -> transaction which created it, other transactions reusing the key are rejected
+  std::unordered_map<Crypto::PublicKey, Crypto::Hash> m_seenOutputKeys;
+  std::mutex m_seenOutputKeysMutex;
 
   INode& m_node;
   const CryptoNote::Currency& m_currency;
   Logging::LoggerRef m_logger;
+
+  BlockingQueue<std::function<void()>> m_scanTasks;
+  std::vector<std::thread> m_scanWorkers;
 };
 
 }
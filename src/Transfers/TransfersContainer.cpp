@@ -44,6 +44,8 @@ void serialize(TransactionInformation& ti, CryptoNote::ISerializer& s) {
 }
 
 const uint32_t TRANSFERS_CONTAINER_STORAGE_VERSION = 0;
+// unlock height of the available outputs whose state is checked again on every height change
+const uint64_t TIME_LOCKED_OUTPUT_UNLOCK_HEIGHT = std::numeric_limits<uint64_t>::max();
 
 namespace {
   template<typename TIterator>
@@ -205,7 +207,7 @@ bool TransfersContainer::addTransaction(const TransactionBlockInfo& block, const
     }
 
     if (block.height != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
-      m_currentHeight = block.height;
+      setCurrentHeight(block.height);
     }
 
     return added;
@@ -243,6 +245,7 @@ void TransfersContainer::addTransaction(const TransactionBlockInfo& block, const
   auto result = m_transactions.emplace(std::move(txInfo));
   (void)result; // Disable unused warning
   assert(result.second);
+  markTransactionChanged(txHash);
 }
 
 /**
@@ -313,11 +316,13 @@ bool TransfersContainer::addTransactionOutputs(const TransactionBlockInfo& block
         }
       }
 
-      auto result = m_availableTransfers.emplace(std::move(info));
+      auto result = m_availableTransfers.insert(makeAvailableOutput(info));
       (void)result; // Disable unused warning
       assert(result.second);
     }
 
+    markTransactionChanged(txHash);
+
     if (info.type == TransactionTypes::OutputType::Key) {
       updateTransfersVisibility(info.keyImage);
     }
@@ -461,6 +466,7 @@ bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& bl
   txInfo.blockHeight = block.height;
   txInfo.timestamp = block.timestamp;
   m_transactions.replace(transactionIt, txInfo);
+  markTransactionChanged(transactionHash);
 
   auto availableRange = m_unconfirmedTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
   for (auto transferIt = availableRange.first; transferIt != availableRange.second; ) {
@@ -488,7 +494,7 @@ bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& bl
       }
     }
 
-    auto result = m_availableTransfers.emplace(std::move(transfer));
+    auto result = m_availableTransfers.insert(makeAvailableOutput(transfer));
     (void)result; // Disable unused warning
     assert(result.second);
 
@@ -507,6 +513,7 @@ bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& bl
 
     transfer.spendingBlock = block;
     spendingTransactionIndex.replace(transferIt, transfer);
+    markTransactionChanged(transfer.transactionHash);
   }
 
   return true;
@@ -516,14 +523,17 @@ bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& bl
  * \pre m_mutex is locked.
  */
 void TransfersContainer::deleteTransactionTransfers(const Hash& transactionHash) {
+  markTransactionChanged(transactionHash);
+
   auto& spendingTransactionIndex = m_spentTransfers.get<SpendingTransactionIndex>();
   auto spentTransfersRange = spendingTransactionIndex.equal_range(transactionHash);
   for (auto it = spentTransfersRange.first; it != spentTransfersRange.second;) {
     assert(it->blockHeight != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT);
     assert(it->globalOutputIndex != UNCONFIRMED_TRANSACTION_GLOBAL_OUTPUT_INDEX);
 
-    auto result = m_availableTransfers.emplace(static_cast<const TransactionOutputInformationEx&>(*it));
+    auto result = m_availableTransfers.insert(makeAvailableOutput(*it));
     assert(result.second);
+    markTransactionChanged(it->transactionHash);
     it = spendingTransactionIndex.erase(it);
 
     if (result.first->type == TransactionTypes::OutputType::Key) {
@@ -571,6 +581,7 @@ void TransfersContainer::copyToSpent(const TransactionBlockInfo& block, const IT
   auto result = m_spentTransfers.emplace(std::move(spentOutput));
   (void)result; // Disable unused warning
   assert(result.second);
+  markTransactionChanged(output.transactionHash);
 }
 
 std::vector<Hash> TransfersContainer::detach(uint32_t height) {
@@ -609,18 +620,21 @@ std::vector<Hash> TransfersContainer::detach(uint32_t height) {
   }
 
   // TODO: notification on detach
-  m_currentHeight = height == 0 ? 0 : height - 1;
+  setCurrentHeight(height == 0 ? 0 : height - 1);
 
   return deletedTransactions;
 }
 
 namespace {
   template<typename C, typename T>
-  void updateVisibility(C& collection, const T& range, bool visible) {
+  void updateVisibility(C& collection, const T& range, bool visible, std::unordered_set<Hash>& changedTransactions) {
     for (auto it = range.first; it != range.second; ++it) {
-      auto updated = *it;
-      updated.visible = visible;
-      collection.replace(it, updated);
+      if (it->visible != visible) {
+        auto updated = *it;
+        updated.visible = visible;
+        collection.replace(it, updated);
+        changedTransactions.insert(updated.transactionHash);
+      }
     }
   }
 }
@@ -644,12 +658,12 @@ void TransfersContainer::updateTransfersVisibility(const KeyImage& keyImage) {
   assert(spentCount == 0 || spentCount == 1);
 
   if (spentCount > 0) {
-    updateVisibility(unconfirmedIndex, unconfirmedRange, false);
-    updateVisibility(availableIndex, availableRange, false);
-    updateVisibility(spentIndex, spentRange, true);
+    updateVisibility(unconfirmedIndex, unconfirmedRange, false, m_changedTransactions);
+    updateVisibility(availableIndex, availableRange, false, m_changedTransactions);
+    updateVisibility(spentIndex, spentRange, true, m_changedTransactions);
   } else if (availableCount > 0) {
-    updateVisibility(unconfirmedIndex, unconfirmedRange, false);
-    updateVisibility(availableIndex, availableRange, false);
+    updateVisibility(unconfirmedIndex, unconfirmedRange, false, m_changedTransactions);
+    updateVisibility(availableIndex, availableRange, false, m_changedTransactions);
 
     auto iteratorList = createTransferIteratorList(availableRange);
     auto earliestTransferIt = iteratorList.minElement();
@@ -658,8 +672,9 @@ void TransfersContainer::updateTransfersVisibility(const KeyImage& keyImage) {
     auto earliestTransfer = *earliestTransferIt;
     earliestTransfer.visible = true;
     availableIndex.replace(earliestTransferIt, earliestTransfer);
+    markTransactionChanged(earliestTransfer.transactionHash);
   } else {
-    updateVisibility(unconfirmedIndex, unconfirmedRange, unconfirmedCount == 1);
+    updateVisibility(unconfirmedIndex, unconfirmedRange, unconfirmedCount == 1, m_changedTransactions);
   }
 }
 
@@ -667,13 +682,25 @@ bool TransfersContainer::advanceHeight(uint32_t height) {
   std::lock_guard<std::mutex> lk(m_mutex);
 
   if (m_currentHeight <= height) {
-    m_currentHeight = height;
+    setCurrentHeight(height);
     return true;
   }
 
   return false;
 }
 
+/**
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::markTransactionChanged(const Hash& transactionHash) {
+  m_changedTransactions.insert(transactionHash);
+}
+
+bool TransfersContainer::hasChanges() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return !m_changedTransactions.empty();
+}
+
 size_t TransfersContainer::transfersCount() const {
   std::lock_guard<std::mutex> lk(m_mutex);
   return m_unconfirmedTransfers.size() + m_availableTransfers.size() + m_spentTransfers.size();
@@ -722,6 +749,58 @@ void TransfersContainer::getOutputs(std::vector<TransactionOutputInformation>& t
   }
 }
 
+void TransfersContainer::visitOutputs(uint64_t minAmount, uint64_t maxAmount, uint32_t flags, const OutputVisitor& visitor) const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (minAmount > maxAmount) {
+    return;
+  }
+
+  const auto& amountIndex = m_availableTransfers.get<AmountIndex>();
+  auto end = amountIndex.upper_bound(maxAmount);
+  for (auto it = amountIndex.lower_bound(minAmount); it != end; ++it) {
+    if (it->visible && isIncluded(*it, flags) && !visitor(*it)) {
+      return;
+    }
+  }
+
+  if ((flags & IncludeStateLocked) != 0) {
+    for (const auto& t : m_unconfirmedTransfers) {
+      if (t.visible && t.amount >= minAmount && t.amount <= maxAmount && isIncluded(t.type, IncludeStateLocked, flags) && !visitor(t)) {
+        return;
+      }
+    }
+  }
+}
+
+size_t TransfersContainer::unlockedKeyOutputsCount(uint64_t minAmount, uint64_t maxAmount) const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (minAmount > maxAmount) {
+    return 0;
+  }
+
+  const auto& unlockedAmountIndex = m_availableTransfers.get<UnlockedKeyOutputAmountIndex>();
+  return unlockedAmountIndex.upper_bound_rank(boost::make_tuple(true, maxAmount)) -
+    unlockedAmountIndex.lower_bound_rank(boost::make_tuple(true, minAmount));
+}
+
+void TransfersContainer::visitUnlockedKeyOutputs(uint64_t minAmount, uint64_t maxAmount, const std::vector<size_t>& positions,
+  const OutputVisitor& visitor) const {
+
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (minAmount > maxAmount) {
+    return;
+  }
+
+  const auto& unlockedAmountIndex = m_availableTransfers.get<UnlockedKeyOutputAmountIndex>();
+  size_t beginRank = unlockedAmountIndex.lower_bound_rank(boost::make_tuple(true, minAmount));
+  size_t count = unlockedAmountIndex.upper_bound_rank(boost::make_tuple(true, maxAmount)) - beginRank;
+  for (size_t position : positions) {
+    if (position < count && !visitor(*unlockedAmountIndex.nth(beginRank + position))) {
+      return;
+    }
+  }
+}
+
 bool TransfersContainer::getTransactionInformation(const Hash& transactionHash, TransactionInformation& info, uint64_t* amountIn, uint64_t* amountOut) const {
   std::lock_guard<std::mutex> lk(m_mutex);
   auto it = m_transactions.find(transactionHash);
@@ -859,7 +938,7 @@ void TransfersContainer::save(std::ostream& os) {
   s(m_currentHeight, "height");
   writeSequence<TransactionInformation>(m_transactions.begin(), m_transactions.end(), "transactions", s);
   writeSequence<TransactionOutputInformationEx>(m_unconfirmedTransfers.begin(), m_unconfirmedTransfers.end(), "unconfirmedTransfers", s);
-  writeSequence<TransactionOutputInformationEx>(m_availableTransfers.begin(), m_availableTransfers.end(), "availableTransfers", s);
+  writeSequence<AvailableTransactionOutput>(m_availableTransfers.begin(), m_availableTransfers.end(), "availableTransfers", s);
   writeSequence<SpentTransactionOutput>(m_spentTransfers.begin(), m_spentTransfers.end(), "spentTransfers", s);
 }
 
@@ -880,25 +959,133 @@ void TransfersContainer::load(std::istream& in) {
   uint32_t currentHeight = 0;
   TransactionMultiIndex transactions;
   UnconfirmedTransfersMultiIndex unconfirmedTransfers;
-  AvailableTransfersMultiIndex availableTransfers;
+  std::vector<TransactionOutputInformationEx> availableTransfers;
   SpentTransfersMultiIndex spentTransfers;
 
   s(currentHeight, "height");
   readSequence<TransactionInformation>(std::inserter(transactions, transactions.end()), "transactions", s);
   readSequence<TransactionOutputInformationEx>(std::inserter(unconfirmedTransfers, unconfirmedTransfers.end()), "unconfirmedTransfers", s);
-  readSequence<TransactionOutputInformationEx>(std::inserter(availableTransfers, availableTransfers.end()), "availableTransfers", s);
+  readSequence<TransactionOutputInformationEx>(std::back_inserter(availableTransfers), "availableTransfers", s);
   readSequence<SpentTransactionOutput>(std::inserter(spentTransfers, spentTransfers.end()), "spentTransfers", s);
 
   m_currentHeight = currentHeight;
+  m_changedTransactions.clear();
   m_transactions = std::move(transactions);
   m_unconfirmedTransfers = std::move(unconfirmedTransfers);
-  m_availableTransfers = std::move(availableTransfers);
+  m_availableTransfers.clear();
+  for (const auto& transfer : availableTransfers) {
+    m_availableTransfers.insert(makeAvailableOutput(transfer));
+  }
+
   m_spentTransfers = std::move(spentTransfers);
 
   // Repair the container if it was broken while handling addTransaction() in previous version of the code
   repair();
 }
 
+void TransfersContainer::saveChanges(std::ostream& os) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  StdOutputStream stream(os);
+  CryptoNote::BinaryOutputStreamSerializer s(stream);
+
+  s(m_currentHeight, "height");
+
+  size_t count = m_changedTransactions.size();
+  s.beginArray(count, "transactions");
+  for (const Hash& transactionHash : m_changedTransactions) {
+    s.beginObject("");
+    s(const_cast<Hash&>(transactionHash), "hash");
+
+    // a deleted transaction is written with no information and no transfers
+    auto transactionIt = m_transactions.find(transactionHash);
+    auto transactionEnd = transactionIt == m_transactions.end() ? transactionIt : std::next(transactionIt);
+    writeSequence<TransactionInformation>(transactionIt, transactionEnd, "transaction", s);
+
+    auto unconfirmedRange = m_unconfirmedTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
+    writeSequence<TransactionOutputInformationEx>(unconfirmedRange.first, unconfirmedRange.second, "unconfirmedTransfers", s);
+    auto availableRange = m_availableTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
+    writeSequence<AvailableTransactionOutput>(availableRange.first, availableRange.second, "availableTransfers", s);
+    auto spentRange = m_spentTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
+    writeSequence<SpentTransactionOutput>(spentRange.first, spentRange.second, "spentTransfers", s);
+    s.endObject();
+  }
+
+  s.endArray();
+
+  m_changedTransactions.clear();
+}
+
+void TransfersContainer::loadChanges(std::istream& in) {
+  StdInputStream stream(in);
+  CryptoNote::BinaryInputStreamSerializer s(stream);
+
+  uint32_t currentHeight = 0;
+  std::vector<Hash> changedTransactions;
+  std::vector<TransactionInformation> transactions;
+  std::vector<TransactionOutputInformationEx> unconfirmedTransfers;
+  std::vector<TransactionOutputInformationEx> availableTransfers;
+  std::vector<SpentTransactionOutput> spentTransfers;
+
+  s(currentHeight, "height");
+
+  size_t count = 0;
+  s.beginArray(count, "transactions");
+  while (count--) {
+    s.beginObject("");
+    Hash transactionHash;
+    s(transactionHash, "hash");
+    changedTransactions.push_back(transactionHash);
+    readSequence<TransactionInformation>(std::back_inserter(transactions), "transaction", s);
+    readSequence<TransactionOutputInformationEx>(std::back_inserter(unconfirmedTransfers), "unconfirmedTransfers", s);
+    readSequence<TransactionOutputInformationEx>(std::back_inserter(availableTransfers), "availableTransfers", s);
+    readSequence<SpentTransactionOutput>(std::back_inserter(spentTransfers), "spentTransfers", s);
+    s.endObject();
+  }
+
+  s.endArray();
+
+  std::lock_guard<std::mutex> lk(m_mutex);
+
+  // everything the changed transactions contain is replaced at once, so the unique indices see the saved state only
+  for (const Hash& transactionHash : changedTransactions) {
+    m_transactions.erase(transactionHash);
+    m_unconfirmedTransfers.get<ContainingTransactionIndex>().erase(transactionHash);
+    m_availableTransfers.get<ContainingTransactionIndex>().erase(transactionHash);
+    m_spentTransfers.get<ContainingTransactionIndex>().erase(transactionHash);
+  }
+
+  // the available transfers inserted below get their state at the saved height
+  setCurrentHeight(currentHeight);
+
+  bool inserted = true;
+  for (auto& transaction : transactions) {
+    inserted &= m_transactions.insert(std::move(transaction)).second;
+  }
+
+  for (auto& transfer : unconfirmedTransfers) {
+    inserted &= m_unconfirmedTransfers.insert(std::move(transfer)).second;
+  }
+
+  for (const auto& transfer : availableTransfers) {
+    inserted &= m_availableTransfers.insert(makeAvailableOutput(transfer)).second;
+  }
+
+  for (auto& transfer : spentTransfers) {
+    inserted &= m_spentTransfers.insert(std::move(transfer)).second;
+  }
+
+  if (!inserted) {
+    auto message = "Failed to load changes: transfers don't match the container";
+    m_logger(ERROR, BRIGHT_RED) << message;
+    throw std::runtime_error(message);
+  }
+}
+
+void TransfersContainer::markSaved() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_changedTransactions.clear();
+}
+
 void TransfersContainer::repair() {
   size_t deletedInputCount = 0;
   for (auto it = m_spentTransfers.begin(); it != m_spentTransfers.end();) {
@@ -919,7 +1106,7 @@ void TransfersContainer::repair() {
         ", transaction hash " << it->transactionHash <<
         ", output " << std::setw(2) << it->outputInTransaction;
 
-      auto result = m_availableTransfers.emplace(static_cast<const TransactionOutputInformationEx&>(*it));
+      auto result = m_availableTransfers.insert(makeAvailableOutput(*it));
       assert(result.second);
       it = m_spentTransfers.erase(it);
 
@@ -1006,6 +1193,45 @@ bool TransfersContainer::isSpendTimeUnlocked(uint64_t unlockTime) const {
   return false;
 }
 
+uint64_t TransfersContainer::getUnlockHeight(const TransactionOutputInformationEx& info) const {
+  if (info.blockHeight == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT || info.unlockTime >= m_currency.maxBlockHeight()) {
+    return TIME_LOCKED_OUTPUT_UNLOCK_HEIGHT;
+  }
+
+  // see isIncluded() and isSpendTimeUnlocked()
+  uint64_t spendTimeUnlockHeight = info.unlockTime > m_currency.lockedTxAllowedDeltaBlocks() ?
+    info.unlockTime - m_currency.lockedTxAllowedDeltaBlocks() : 0;
+  return std::max(static_cast<uint64_t>(info.blockHeight) + m_transactionSpendableAge, spendTimeUnlockHeight);
+}
+
+AvailableTransactionOutput TransfersContainer::makeAvailableOutput(const TransactionOutputInformationEx& info) const {
+  return AvailableTransactionOutput(info, getUnlockHeight(info), isIncluded(info, IncludeAllUnlocked));
+}
+
+/**
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::setCurrentHeight(uint32_t height) {
+  uint32_t previousHeight = m_currentHeight;
+  m_currentHeight = height;
+
+  typedef AvailableTransfersMultiIndex::index<UnlockHeightIndex>::type::iterator UnlockHeightIterator;
+  auto& unlockHeightIndex = m_availableTransfers.get<UnlockHeightIndex>();
+  auto updateUnlocked = [this, &unlockHeightIndex](UnlockHeightIterator begin, UnlockHeightIterator end) {
+    for (auto it = begin; it != end; ++it) {
+      bool unlocked = isIncluded(*it, IncludeAllUnlocked);
+      if (it->unlocked != unlocked) {
+        unlockHeightIndex.modify(it, [unlocked](AvailableTransactionOutput& output) { output.unlocked = unlocked; });
+      }
+    }
+  };
+
+  // only the outputs unlocked by a height between the previous and the new one and the time locked ones change their state
+  updateUnlocked(unlockHeightIndex.upper_bound(std::min(previousHeight, height)), unlockHeightIndex.upper_bound(std::max(previousHeight, height)));
+  auto timeLockedRange = unlockHeightIndex.equal_range(TIME_LOCKED_OUTPUT_UNLOCK_HEIGHT);
+  updateUnlocked(timeLockedRange.first, timeLockedRange.second);
+}
+
 bool TransfersContainer::isIncluded(const TransactionOutputInformationEx& info, uint32_t flags) const {
   uint32_t state;
   if (info.blockHeight == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT || !isSpendTimeUnlocked(info.unlockTime)) {
@@ -19,13 +19,16 @@
 
 #include <cstdint>
 #include <unordered_map>
+#include <unordered_set>
 #include <mutex>
 
 #include <boost/multi_index_container.hpp>
+#include <boost/multi_index/composite_key.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/mem_fun.hpp>
 #include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/ranked_index.hpp>
 
 #include "crypto/crypto.h"
 #include "CryptoNoteCore/CryptoNoteBasic.h"
@@ -86,6 +89,7 @@ struct TransactionOutputInformationEx : public TransactionOutputInformationIn {
 
   SpentOutputDescriptor getSpentOutputDescriptor() const { return SpentOutputDescriptor(*this); }
   const Crypto::Hash& getTransactionHash() const { return transactionHash; }
+  uint64_t getAmount() const { return amount; }
 
   void serialize(CryptoNote::ISerializer& s) {
     s(reinterpret_cast<uint8_t&>(type), "type");
@@ -138,6 +142,18 @@ struct SpentTransactionOutput : TransactionOutputInformationEx {
   }
 };
 
+struct AvailableTransactionOutput : TransactionOutputInformationEx {
+  // the height the output gets unlocked at, TIME_LOCKED_OUTPUT_UNLOCK_HEIGHT if it is locked by time or unconfirmed
+  uint64_t unlockHeight;
+  bool unlocked;
+
+  AvailableTransactionOutput(const TransactionOutputInformationEx& output, uint64_t unlockHeight, bool unlocked) :
+    TransactionOutputInformationEx(output), unlockHeight(unlockHeight), unlocked(unlocked) {
+  }
+
+  bool isUnlockedKeyOutput() const { return visible && unlocked && type == TransactionTypes::OutputType::Key; }
+};
+
 enum class KeyImageState {
   Unconfirmed,
   Confirmed,
@@ -160,6 +176,13 @@ public:
   std::vector<Crypto::Hash> detach(uint32_t height);
   bool advanceHeight(uint32_t height);
 
+  bool hasChanges() const;
+  // Writes the transactions and transfers changed since the last markSaved() or saveChanges() call, grouped by the
+  // transaction that contains them. loadChanges() applies such records in the order they were written on top of load().
+  void saveChanges(std::ostream& os);
+  void loadChanges(std::istream& in);
+  void markSaved();
+
   // ITransfersContainer
   virtual size_t transfersCount() const override;
   virtual size_t transactionsCount() const override;
@@ -172,6 +195,10 @@ public:
   virtual std::vector<TransactionOutputInformation> getTransactionInputs(const Crypto::Hash& transactionHash, uint32_t flags) const override;
   virtual void getUnconfirmedTransactions(std::vector<Crypto::Hash>& transactions) const override;
   virtual std::vector<TransactionSpentOutputInformation> getSpentOutputs() const override;
+  virtual void visitOutputs(uint64_t minAmount, uint64_t maxAmount, uint32_t flags, const OutputVisitor& visitor) const override;
+  virtual size_t unlockedKeyOutputsCount(uint64_t minAmount, uint64_t maxAmount) const override;
+  virtual void visitUnlockedKeyOutputs(uint64_t minAmount, uint64_t maxAmount, const std::vector<size_t>& positions,
+    const OutputVisitor& visitor) const override;
 
   // IStreamSerializable
   virtual void save(std::ostream& os) override;
@@ -181,6 +208,9 @@ private:
   struct ContainingTransactionIndex { };
   struct SpendingTransactionIndex { };
   struct SpentOutputDescriptorIndex { };
+  struct AmountIndex { };
+  struct UnlockHeightIndex { };
+  struct UnlockedKeyOutputAmountIndex { };
 
   typedef boost::multi_index_container<
     TransactionInformation,
@@ -212,7 +242,7 @@ private:
   > UnconfirmedTransfersMultiIndex;
 
   typedef boost::multi_index_container<
-    TransactionOutputInformationEx,
+    AvailableTransactionOutput,
     boost::multi_index::indexed_by<
       boost::multi_index::hashed_non_unique<
         boost::multi_index::tag<SpentOutputDescriptorIndex>,
@@ -228,6 +258,32 @@ private:
           TransactionOutputInformationEx,
           const Crypto::Hash&,
           &TransactionOutputInformationEx::getTransactionHash>
+      >,
+      boost::multi_index::ordered_non_unique<
+        boost::multi_index::tag<AmountIndex>,
+        boost::multi_index::const_mem_fun<
+          TransactionOutputInformationEx,
+          uint64_t,
+          &TransactionOutputInformationEx::getAmount>
+      >,
+      boost::multi_index::ordered_non_unique<
+        boost::multi_index::tag<UnlockHeightIndex>,
+        BOOST_MULTI_INDEX_MEMBER(AvailableTransactionOutput, uint64_t, unlockHeight)
+      >,
+      // ranks give the number of unlocked key outputs in an amount range and the output at a position of it
+      boost::multi_index::ranked_non_unique<
+        boost::multi_index::tag<UnlockedKeyOutputAmountIndex>,
+        boost::multi_index::composite_key<
+          AvailableTransactionOutput,
+          boost::multi_index::const_mem_fun<
+            AvailableTransactionOutput,
+            bool,
+            &AvailableTransactionOutput::isUnlockedKeyOutput>,
+          boost::multi_index::const_mem_fun<
+            TransactionOutputInformationEx,
+            uint64_t,
+            &TransactionOutputInformationEx::getAmount>
+        >
       >
     >
   > AvailableTransfersMultiIndex;
@@ -267,9 +323,13 @@ private:
   bool addTransactionInputs(const TransactionBlockInfo& block, const ITransactionReader& tx);
   void deleteTransactionTransfers(const Crypto::Hash& transactionHash);
   bool isSpendTimeUnlocked(uint64_t unlockTime) const;
+  uint64_t getUnlockHeight(const TransactionOutputInformationEx& info) const;
+  AvailableTransactionOutput makeAvailableOutput(const TransactionOutputInformationEx& info) const;
+  void setCurrentHeight(uint32_t height);
   bool isIncluded(const TransactionOutputInformationEx& info, uint32_t flags) const;
   static bool isIncluded(TransactionTypes::OutputType type, uint32_t state, uint32_t flags);
   void updateTransfersVisibility(const Crypto::KeyImage& keyImage);
+  void markTransactionChanged(const Crypto::Hash& transactionHash);
 
   void copyToSpent(const TransactionBlockInfo& block, const ITransactionReader& tx, size_t inputIndex, const TransactionOutputInformationEx& output);
   void repair();
@@ -281,6 +341,8 @@ private:
   SpentTransfersMultiIndex m_spentTransfers;
 
   uint32_t m_currentHeight; // current height is needed to check if a transfer is unlocked
+  // transactions whose information or transfers changed since the last save
+  std::unordered_set<Crypto::Hash> m_changedTransactions;
   size_t m_transactionSpendableAge;
   const CryptoNote::Currency& m_currency;
   mutable std::mutex m_mutex;
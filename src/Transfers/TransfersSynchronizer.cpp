@@ -19,10 +19,15 @@
 
 #include "TransfersSynchronizer.h"
 #include "TransfersConsumer.h"
+#include "SynchronizationState.h"
+
+#include <limits>
+#include <sstream>
 
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
 #include "CryptoNoteCore/CryptoNoteBasicImpl.h"
+#include "CryptoNoteCore/CryptoNoteSerialization.h"
 #include "Serialization/BinaryInputStreamSerializer.h"
 #include "Serialization/BinaryOutputStreamSerializer.h"
 
@@ -32,6 +37,10 @@ using namespace Crypto;
 namespace CryptoNote {
 
 const uint32_t TRANSFERS_STORAGE_ARCHIVE_VERSION = 0;
+const uint32_t TRANSFERS_CHANGES_ARCHIVE_VERSION = 1;
+
+// a consumer that detached deeper than this since the last save writes all its known blocks again
+const size_t SAVED_BLOCKS_TAIL_SIZE = 64;
 
 TransfersSyncronizer::TransfersSyncronizer(const CryptoNote::Currency& currency, Logging::ILogger& logger, IBlockchainSynchronizer& sync, INode& node) :
   m_currency(currency), m_logger(logger, "TransfersSyncronizer"), m_sync(sync), m_node(node) {
@@ -75,6 +84,7 @@ bool TransfersSyncronizer::removeSubscription(const AccountPublicAddress& acc) {
     m_consumers.erase(it);
 
     m_subscribers.erase(acc.viewPublicKey);
+    m_savedStates.erase(acc.viewPublicKey);
   }
 
   return true;
@@ -221,6 +231,28 @@ void setObjectState(IStreamSerializable& obj, const std::string& state) {
   obj.load(stream);
 }
 
+// consumers keep TransfersSubscription objects only
+TransfersSubscription& getTransfersSubscription(ITransfersSubscription& subscription) {
+  return static_cast<TransfersSubscription&>(subscription);
+}
+
+TransfersContainer& getTransfersContainer(ITransfersSubscription& subscription) {
+  return static_cast<TransfersContainer&>(subscription.getContainer());
+}
+
+// Block hashes commit to the previous ones, so the known blocks are kept up to the last saved block still there.
+// blocks start where lastBlocks do.
+uint32_t getKeptBlockCount(const std::vector<Hash>& lastBlocks, uint32_t savedCount, const std::vector<Hash>& blocks) {
+  uint32_t firstSaved = savedCount - static_cast<uint32_t>(lastBlocks.size());
+  for (size_t count = std::min(lastBlocks.size(), blocks.size()); count > 0; --count) {
+    if (blocks[count - 1] == lastBlocks[count - 1]) {
+      return firstSaved + static_cast<uint32_t>(count);
+    }
+  }
+
+  return 0;
+}
+
 }
 
 void TransfersSyncronizer::load(std::istream& is) {
@@ -320,6 +352,182 @@ void TransfersSyncronizer::load(std::istream& is) {
 
 }
 
+void TransfersSyncronizer::saveChanges(std::ostream& os) {
+  StdOutputStream stream(os);
+  CryptoNote::BinaryOutputStreamSerializer s(stream);
+  s(const_cast<uint32_t&>(TRANSFERS_CHANGES_ARCHIVE_VERSION), "version");
+
+  size_t consumerCount = m_consumers.size();
+  s.beginArray(consumerCount, "consumers");
+
+  for (const auto& consumer : m_consumers) {
+    s.beginObject("");
+    s(const_cast<PublicKey&>(consumer.first), "view_key");
+
+    // only the blocks from the saved tail on are read, unless the consumer detached below it
+    SavedConsumerState& saved = m_savedStates[consumer.first];
+    uint32_t firstIndex = saved.blockCount - static_cast<uint32_t>(saved.lastBlocks.size());
+    uint32_t knownBlockCount = 0;
+    std::vector<Hash> blocks = m_sync.getConsumerKnownBlocks(*consumer.second, firstIndex, knownBlockCount);
+    uint32_t keptCount = getKeptBlockCount(saved.lastBlocks, saved.blockCount, blocks);
+    if (keptCount == 0 && firstIndex != 0) {
+      firstIndex = 0;
+      blocks = m_sync.getConsumerKnownBlocks(*consumer.second, firstIndex, knownBlockCount);
+    }
+
+    std::vector<Hash> newBlocks(blocks.begin() + (keptCount - firstIndex), blocks.end());
+    s(keptCount, "kept_block_count");
+    s(newBlocks, "new_blocks");
+
+    saved.blockCount = knownBlockCount;
+    saved.lastBlocks.assign(blocks.end() - std::min(blocks.size(), SAVED_BLOCKS_TAIL_SIZE), blocks.end());
+
+    std::vector<AccountPublicAddress> subscriptions;
+    consumer.second->getSubscriptions(subscriptions);
+    std::vector<std::pair<AccountPublicAddress, std::string>> changes;
+    for (auto& addr : subscriptions) {
+      auto sub = consumer.second->getSubscription(addr);
+      if (sub != nullptr && getTransfersContainer(*sub).hasChanges()) {
+        std::stringstream containerChanges;
+        getTransfersContainer(*sub).saveChanges(containerChanges);
+        changes.emplace_back(addr, containerChanges.str());
+      }
+    }
+
+    size_t subCount = changes.size();
+    s.beginArray(subCount, "subscriptions");
+    for (auto& change : changes) {
+      s.beginObject("");
+      s(change.first, "address");
+      s(change.second, "changes");
+      s.endObject();
+    }
+
+    s.endArray();
+    s.endObject();
+  }
+
+  s.endArray();
+}
+
+void TransfersSyncronizer::loadChanges(const std::vector<std::string>& changes) {
+  // the known blocks are folded and loaded once, the containers apply the records one by one
+  std::unordered_map<PublicKey, std::vector<Hash>> consumerBlocks;
+  for (const auto& change : changes) {
+    std::stringstream is(change);
+    StdInputStream inputStream(is);
+    CryptoNote::BinaryInputStreamSerializer s(inputStream);
+    uint32_t version = 0;
+    s(version, "version");
+    if (version > TRANSFERS_CHANGES_ARCHIVE_VERSION) {
+      throw std::runtime_error("TransfersSyncronizer changes version mismatch");
+    }
+
+    size_t consumerCount = 0;
+    s.beginArray(consumerCount, "consumers");
+    while (consumerCount--) {
+      s.beginObject("");
+      PublicKey viewKey;
+      s(viewKey, "view_key");
+
+      uint32_t keptCount = 0;
+      std::vector<Hash> newBlocks;
+      s(keptCount, "kept_block_count");
+      s(newBlocks, "new_blocks");
+
+      auto consumerIt = m_consumers.find(viewKey);
+      if (consumerIt != m_consumers.end()) {
+        auto blocksIt = consumerBlocks.find(viewKey);
+        if (blocksIt == consumerBlocks.end()) {
+          blocksIt = consumerBlocks.emplace(viewKey, m_sync.getConsumerKnownBlocks(*consumerIt->second)).first;
+        }
+
+        std::vector<Hash>& blocks = blocksIt->second;
+        if (keptCount > blocks.size()) {
+          throw std::runtime_error("TransfersSyncronizer changes don't match the known blocks");
+        }
+
+        blocks.resize(keptCount);
+        blocks.insert(blocks.end(), newBlocks.begin(), newBlocks.end());
+      } else {
+        m_logger(Logging::DEBUGGING) << "Consumer not found: " << viewKey;
+      }
+
+      size_t subCount = 0;
+      s.beginArray(subCount, "subscriptions");
+      while (subCount--) {
+        s.beginObject("");
+        AccountPublicAddress acc;
+        std::string state;
+        s(acc, "address");
+        // the first version wrote whole containers
+        if (version == 0) {
+          s(state, "state");
+        } else {
+          s(state, "changes");
+        }
+
+        auto sub = consumerIt != m_consumers.end() ? consumerIt->second->getSubscription(acc) : nullptr;
+        if (sub == nullptr) {
+          m_logger(Logging::DEBUGGING) << "Subscription not found: " << m_currency.accountAddressAsString(acc);
+        } else if (version == 0) {
+          setObjectState(sub->getContainer(), state);
+        } else {
+          std::stringstream containerChanges(state);
+          getTransfersContainer(*sub).loadChanges(containerChanges);
+        }
+
+        s.endObject();
+      }
+
+      s.endArray();
+      s.endObject();
+    }
+
+    s.endArray();
+  }
+
+  for (auto& blocks : consumerBlocks) {
+    auto& consumer = m_consumers.find(blocks.first)->second;
+    if (blocks.second.empty()) {
+      throw std::runtime_error("TransfersSyncronizer changes drop the genesis block");
+    }
+
+    SynchronizationState state(blocks.second.front());
+    state.addBlocks(blocks.second.data() + 1, 1, static_cast<uint32_t>(blocks.second.size() - 1));
+    setObjectState(*m_sync.getConsumerState(consumer.get()), getObjectState(state));
+
+    // advancing the height isn't saved as a change, containers catch up with the known blocks here
+    std::vector<AccountPublicAddress> subscriptions;
+    consumer->getSubscriptions(subscriptions);
+    for (auto& addr : subscriptions) {
+      getTransfersSubscription(*consumer->getSubscription(addr)).advanceHeight(static_cast<uint32_t>(blocks.second.size() - 1));
+    }
+  }
+}
+
+void TransfersSyncronizer::markSaved() {
+  m_savedStates.clear();
+  for (const auto& consumer : m_consumers) {
+    uint32_t knownBlockCount = 0;
+    m_sync.getConsumerKnownBlocks(*consumer.second, std::numeric_limits<uint32_t>::max(), knownBlockCount);
+    uint32_t firstIndex = knownBlockCount - static_cast<uint32_t>(std::min<size_t>(knownBlockCount, SAVED_BLOCKS_TAIL_SIZE));
+
+    SavedConsumerState& saved = m_savedStates[consumer.first];
+    saved.lastBlocks = m_sync.getConsumerKnownBlocks(*consumer.second, firstIndex, knownBlockCount);
+    saved.blockCount = knownBlockCount;
+
+    std::vector<AccountPublicAddress> subscriptions;
+    consumer.second->getSubscriptions(subscriptions);
+    for (auto& addr : subscriptions) {
+      auto sub = consumer.second->getSubscription(addr);
+      if (sub != nullptr) {
+        getTransfersContainer(*sub).markSaved();
+      }
+    }
+  }
+}
+
 bool TransfersSyncronizer::findViewKeyForConsumer(IBlockchainConsumer* consumer, Crypto::PublicKey& viewKey) const {
   //since we have only couple of consumers linear complexity is fine
   auto it = std::find_if(m_consumers.begin(), m_consumers.end(), [consumer] (const ConsumersContainer::value_type& subscription) {
@@ -27,6 +27,7 @@
 #include <unordered_map>
 #include <memory>
 #include <cstring>
+#include <vector>
 
 #include "Logging/LoggerRef.h"
 
@@ -62,6 +63,14 @@ public:
   virtual void save(std::ostream& os) override;
   virtual void load(std::istream& in) override;
 
+  // Writes what changed since the last markSaved() or saveChanges() call: the blocks every consumer added or
+  // detached and the transfers that changed in its containers. loadChanges() applies such records in the order
+  // they were written on top of the state load() restored.
+  void saveChanges(std::ostream& os);
+  void loadChanges(const std::vector<std::string>& changes);
+  // Makes the current state the one the next saveChanges() call compares with
+  void markSaved();
+
 private:
   Logging::LoggerRef m_logger;
 
@@ -73,6 +82,15 @@ private:
   typedef std::unordered_map<Crypto::PublicKey, std::unique_ptr<SubscribersNotifier>> SubscribersContainer;
   SubscribersContainer m_subscribers;
 
+  // the known blocks saveChanges() compares with, kept for every consumer
+  struct SavedConsumerState {
+    uint32_t blockCount;
+    std::vector<Crypto::Hash> lastBlocks; // the tail of the known blocks, ending at blockCount
+  };
+
+  // map { view public key -> saved state }
+  std::unordered_map<Crypto::PublicKey, SavedConsumerState> m_savedStates;
+
   // std::unordered_map<AccountAddress, std::unique_ptr<TransfersConsumer>> m_subscriptions;
   IBlockchainSynchronizer& m_sync;
   INode& m_node;
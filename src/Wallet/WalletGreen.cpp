@@ -23,6 +23,7 @@
 #include <ctime>
 #include <cassert>
 #include <fstream>
+#include <limits>
 #include <numeric>
 #include <random>
 #include <set>
@@ -38,7 +39,6 @@
 #include "ITransaction.h"
 
 #include "Common/ScopeExit.h"
-#include "Common/ShuffleGenerator.h"
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
 #include "Common/StreamTools.h"
@@ -65,6 +65,13 @@ using namespace Logging;
 
 namespace {
 
+// container caches of this version and later are a full save followed by the changes appended to it
+const uint8_t CONTAINER_JOURNAL_VERSION = 7;
+
+// the cache is saved whole again once the changes appended to it outgrow the full save
+const uint64_t CONTAINER_JOURNAL_COMPACTION_RATIO = 2;
+const uint64_t CONTAINER_JOURNAL_MIN_COMPACTION_SIZE = 1024 * 1024;
+
 void asyncRequestCompletion(System::Event& requestFinished) {
   requestFinished.set();
 }
@@ -147,6 +154,9 @@ WalletGreen::WalletGreen(System::Dispatcher& dispatcher, const Currency& currenc
   m_eventOccurred(m_dispatcher),
   m_readyEvent(m_dispatcher),
   m_state(WalletState::NOT_INITIALIZED),
+  m_fullSaveNeeded(true),
+  m_containerSnapshotSize(0),
+  m_compactionSnapshotSize(0),
   m_actualBalance(0),
   m_pendingBalance(0),
   m_transactionSoftLockTime(transactionSoftLockTime)
@@ -204,6 +214,8 @@ void WalletGreen::shutdown() {
 }
 
 void WalletGreen::doShutdown() {
+  finishCompaction();
+
   if (m_walletsContainer.size() != 0) {
     m_synchronizer.unsubscribeConsumerNotifications(m_viewPublicKey, this);
   }
@@ -222,6 +234,9 @@ void WalletGreen::doShutdown() {
 }
 
 void WalletGreen::clearCaches(bool clearTransactions, bool clearCachedData) {
+  m_changedTransactions.clear();
+  m_fullSaveNeeded = true;
+
   if (clearTransactions) {
     m_transactions.clear();
     m_transfers.clear();
@@ -406,17 +421,20 @@ void WalletGreen::save(WalletSaveLevel saveLevel, const std::string& extra) {
   throwIfNotInitialized();
   throwIfStopped();
 
-  stopBlockchainSynchronizer();
+  finishCompaction();
 
   try {
-    saveWalletCache(m_containerStorage, m_key, saveLevel, extra);
+    if (isFullSaveNeeded(saveLevel)) {
+      saveWalletCache(m_containerStorage, m_key, saveLevel, extra);
+    } else {
+      saveWalletCacheChanges(extra);
+    }
   } catch (const std::exception& e) {
     m_logger(ERROR, BRIGHT_RED) << "Failed to save container: " << e.what();
-    startBlockchainSynchronizer();
+    m_fullSaveNeeded = true;
     throw;
   }
 
-  startBlockchainSynchronizer();
   m_logger(INFO, BRIGHT_WHITE) << "Container saved";
 }
 
@@ -426,8 +444,6 @@ void WalletGreen::exportWallet(const std::string& path, bool encrypt, WalletSave
   throwIfNotInitialized();
   throwIfStopped();
 
-  stopBlockchainSynchronizer();
-
   try {
     bool storageCreated = false;
     Tools::ScopeExit failExitHandler([path, &storageCreated] {
@@ -458,11 +474,9 @@ void WalletGreen::exportWallet(const std::string& path, bool encrypt, WalletSave
     m_logger(DEBUGGING) << "Container export finished";
   } catch (const std::exception& e) {
     m_logger(ERROR, BRIGHT_RED) << "Failed to export container: " << e.what();
-    startBlockchainSynchronizer();
     throw;
   }
 
-  startBlockchainSynchronizer();
   m_logger(INFO, BRIGHT_WHITE) << "Container exported";
 }
 
@@ -610,8 +624,17 @@ void WalletGreen::loadContainerStorage(const std::string& path) {
 void WalletGreen::loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKeys, std::unordered_set<Crypto::PublicKey>& deletedKeys, std::string& extra) {
   assert(m_containerStorage.isOpened());
 
-  BinaryArray contanerData;
-  loadAndDecryptContainerData(m_containerStorage, m_key, contanerData);
+  uint8_t version = reinterpret_cast<const ContainerStoragePrefix*>(m_containerStorage.prefix())->version;
+  std::vector<BinaryArray> records;
+  if (version >= CONTAINER_JOURNAL_VERSION) {
+    loadAndDecryptContainerRecords(m_containerStorage, m_key, records);
+    if (records.empty()) {
+      throw std::runtime_error("Container cache has no valid records");
+    }
+  } else {
+    records.resize(1);
+    loadAndDecryptContainerData(m_containerStorage, m_key, records.front());
+  }
 
   WalletSerializerV2 s(
     *this,
@@ -629,17 +652,83 @@ void WalletGreen::loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKe
     m_transactionSoftLockTime
   );
 
-  Common::MemoryInputStream containerStream(contanerData.data(), contanerData.size());
-  s.load(containerStream, reinterpret_cast<const ContainerStoragePrefix*>(m_containerStorage.prefix())->version);
+  Common::MemoryInputStream containerStream(records.front().data(), records.front().size());
+  s.load(containerStream, version);
+  m_containerSnapshotSize = sizeof(ContainerRecordHeader) + records.front().size();
+
+  records.erase(records.begin());
+  if (!records.empty()) {
+    s.loadChanges(records);
+  }
+
   addedKeys = std::move(s.addedKeys());
   deletedKeys = std::move(s.deletedKeys());
 
-  m_logger(DEBUGGING) << "Container cache loaded";
+  // saved changes refer to the transactions by their ids, so deleted transactions are kept in the cache and
+  // dropped here, the next save is a full one then
+  bool hasDeletedTransactions = std::any_of(m_transactions.begin(), m_transactions.end(), [](const WalletTransaction& tx) {
+    return tx.state == WalletTransactionState::DELETED;
+  });
+
+  if (hasDeletedTransactions) {
+    WalletTransactions transactions;
+    WalletTransfers transfers;
+    filterOutTransactions(transactions, transfers, [](const WalletTransaction& tx) {
+      return tx.state == WalletTransactionState::DELETED;
+    });
+
+    m_transactions.swap(transactions);
+    m_transfers.swap(transfers);
+  }
+
+  m_changedTransactions.clear();
+  m_fullSaveNeeded = version < CONTAINER_JOURNAL_VERSION || s.loadedSaveLevel() != WalletSaveLevel::SAVE_ALL || hasDeletedTransactions;
+  m_synchronizer.markSaved();
+
+  m_logger(DEBUGGING) << "Container cache loaded, " << records.size() << " saved changes applied";
 }
 
 void WalletGreen::saveWalletCache(ContainerStorage& storage, const Crypto::chacha8_key& key, WalletSaveLevel saveLevel, const std::string& extra) {
   m_logger(DEBUGGING) << "Saving cache...";
 
+  std::string containerData;
+  m_blockchainSynchronizer.runWithConsumersLocked([this, &storage, saveLevel, &extra, &containerData] {
+    containerData = serializeWalletCache(saveLevel, extra);
+    // an exported container doesn't change what the changes saved to this one apply to
+    if (&storage == &m_containerStorage) {
+      m_synchronizer.markSaved();
+    }
+  });
+
+  std::string record = encryptContainerRecord(storage, key, containerData.data(), containerData.size());
+
+  ContainerStoragePrefix* prefix = reinterpret_cast<ContainerStoragePrefix*>(storage.prefix());
+  uint8_t version = prefix->version;
+  prefix->version = WalletSerializerV2::SERIALIZATION_VERSION;
+  try {
+    storage.resizeSuffix(record.size());
+  } catch (...) {
+    reinterpret_cast<ContainerStoragePrefix*>(storage.prefix())->version = version;
+    throw;
+  }
+
+  std::copy(record.begin(), record.end(), storage.suffix());
+  storage.flush();
+
+  if (&storage == &m_containerStorage) {
+    m_changedTransactions.clear();
+    m_fullSaveNeeded = saveLevel != WalletSaveLevel::SAVE_ALL;
+    m_containerSnapshotSize = record.size();
+  }
+
+  m_extra = extra;
+
+  m_logger(DEBUGGING) << "Container saving finished";
+}
+
+/// \pre the consumers of m_blockchainSynchronizer are locked
+std::string WalletGreen::serializeWalletCache(WalletSaveLevel saveLevel, const std::string& extra) {
+  // SAVE_ALL keeps deleted transactions, the changes saved after it refer to the transactions by their ids
   WalletTransactions transactions;
   WalletTransfers transfers;
 
@@ -654,10 +743,6 @@ void WalletGreen::saveWalletCache(ContainerStorage& storage, const Crypto::chach
         tx.blockHeight = WALLET_UNCONFIRMED_TRANSACTION_HEIGHT;
       });
     }
-  } else if (saveLevel == WalletSaveLevel::SAVE_ALL) {
-    filterOutTransactions(transactions, transfers, [](const WalletTransaction& tx) {
-      return tx.state == WalletTransactionState::DELETED;
-    });
   }
 
   std::string containerData;
@@ -672,8 +757,8 @@ void WalletGreen::saveWalletCache(ContainerStorage& storage, const Crypto::chach
     m_walletsContainer,
     m_synchronizer,
     m_unlockTransactionsJob,
-    transactions,
-    transfers,
+    saveLevel == WalletSaveLevel::SAVE_ALL ? m_transactions : transactions,
+    saveLevel == WalletSaveLevel::SAVE_ALL ? m_transfers : transfers,
     m_uncommitedTransactions,
     const_cast<std::string&>(extra),
     m_transactionSoftLockTime
@@ -681,12 +766,146 @@ void WalletGreen::saveWalletCache(ContainerStorage& storage, const Crypto::chach
 
   s.save(containerStream, saveLevel);
 
-  encryptAndSaveContainerData(storage, key, containerData.data(), containerData.size());
-  storage.flush();
+  return containerData;
+}
+
+void WalletGreen::saveWalletCacheChanges(const std::string& extra) {
+  m_logger(DEBUGGING) << "Saving cache changes, " << m_changedTransactions.size() << " transactions changed...";
+
+  std::string containerData;
+  std::string snapshotData;
+  m_blockchainSynchronizer.runWithConsumersLocked([this, &extra, &containerData, &snapshotData] {
+    containerData = serializeWalletCacheChanges(extra);
+
+    // the snapshot is taken together with the changes, the container stays whole if the compaction fails
+    uint64_t journalSize = m_containerStorage.suffixSize() + sizeof(ContainerRecordHeader) + containerData.size();
+    if (isCompactionNeeded(journalSize)) {
+      snapshotData = serializeWalletCache(WalletSaveLevel::SAVE_ALL, extra);
+      m_synchronizer.markSaved();
+    }
+  });
+
+  std::string record = encryptContainerRecord(m_containerStorage, m_key, containerData.data(), containerData.size());
+  // the advanced IV is stored before the record, a record lost in a crash doesn't get its IV used again
+  m_containerStorage.flush();
+  m_containerStorage.appendSuffix(reinterpret_cast<const uint8_t*>(record.data()), record.size());
 
+  m_changedTransactions.clear();
   m_extra = extra;
 
-  m_logger(DEBUGGING) << "Container saving finished";
+  m_logger(DEBUGGING) << "Container cache changes saved, " << record.size() << " bytes";
+
+  if (!snapshotData.empty()) {
+    startCompaction(std::move(snapshotData));
+  }
+}
+
+/// \pre the consumers of m_blockchainSynchronizer are locked
+std::string WalletGreen::serializeWalletCacheChanges(const std::string& extra) {
+  std::string containerData;
+  Common::StringOutputStream containerStream(containerData);
+
+  WalletSerializerV2 s(
+    *this,
+    m_viewPublicKey,
+    m_viewSecretKey,
+    m_actualBalance,
+    m_pendingBalance,
+    m_walletsContainer,
+    m_synchronizer,
+    m_unlockTransactionsJob,
+    m_transactions,
+    m_transfers,
+    m_uncommitedTransactions,
+    const_cast<std::string&>(extra),
+    m_transactionSoftLockTime
+  );
+
+  s.saveChanges(containerStream, m_changedTransactions);
+
+  return containerData;
+}
+
+void WalletGreen::startCompaction(std::string&& snapshotData) {
+  assert(m_compaction == nullptr);
+
+  // the IV is reserved here, the compacted container gets the prefix that has it used
+  ContainerStoragePrefix* prefix = reinterpret_cast<ContainerStoragePrefix*>(m_containerStorage.prefix());
+  Crypto::chacha8_iv iv = prefix->nextIv;
+  incIv(prefix->nextIv);
+  m_containerStorage.flush();
+
+  std::vector<uint8_t> prefixData(m_containerStorage.prefix(), m_containerStorage.prefix() + m_containerStorage.prefixSize());
+  std::vector<EncryptedWalletRecord> keys(m_containerStorage.begin(), m_containerStorage.end());
+  std::string path = boost::filesystem::unique_path(m_path + ".tmp.%%%%-%%%%").string();
+  Crypto::chacha8_key key = m_key;
+  auto data = std::make_shared<std::string>(std::move(snapshotData));
+
+  m_compactionPath = path;
+  m_compactionSnapshotSize = sizeof(ContainerRecordHeader) + data->size();
+  m_compaction.reset(new System::RemoteContext<void>(m_dispatcher, [path, prefixData, keys, key, iv, data] {
+    writeCompactedContainer(path, prefixData, keys, key, iv, *data);
+  }));
+
+  m_logger(DEBUGGING) << "Container cache compaction started, " << m_compactionSnapshotSize << " bytes";
+}
+
+void WalletGreen::writeCompactedContainer(const std::string& path, const std::vector<uint8_t>& prefixData, const std::vector<EncryptedWalletRecord>& keys,
+  const Crypto::chacha8_key& key, const Crypto::chacha8_iv& iv, const std::string& snapshotData) {
+
+  std::string record = encryptContainerRecord(key, iv, snapshotData.data(), snapshotData.size());
+
+  ContainerStorage storage(path, FileMappedVectorOpenMode::CREATE, prefixData.size());
+  storage.setAutoFlush(false);
+  storage.reserve(keys.size());
+  std::copy(prefixData.begin(), prefixData.end(), storage.prefix());
+  for (const auto& encryptedKeys : keys) {
+    storage.push_back(encryptedKeys);
+  }
+
+  storage.appendSuffix(reinterpret_cast<const uint8_t*>(record.data()), record.size());
+  storage.flush();
+}
+
+void WalletGreen::finishCompaction() {
+  if (m_compaction == nullptr) {
+    return;
+  }
+
+  m_compaction->wait();
+  if (m_compaction == nullptr) {
+    // another context finished it while this one waited
+    return;
+  }
+
+  std::unique_ptr<System::RemoteContext<void>> compaction(std::move(m_compaction));
+  try {
+    compaction->get();
+
+    ContainerStorage compactedStorage(m_compactionPath, FileMappedVectorOpenMode::OPEN, sizeof(ContainerStoragePrefix));
+    m_containerStorage.replace(compactedStorage);
+    m_containerSnapshotSize = m_compactionSnapshotSize;
+
+    m_logger(DEBUGGING) << "Container cache compacted";
+  } catch (const std::exception& e) {
+    // the container keeps the appended changes, the next save starts the compaction again
+    m_logger(WARNING, BRIGHT_YELLOW) << "Failed to compact container cache: " << e.what();
+
+    boost::system::error_code ignore;
+    boost::filesystem::remove(m_compactionPath, ignore);
+  }
+}
+
+bool WalletGreen::isFullSaveNeeded(WalletSaveLevel saveLevel) const {
+  if (m_fullSaveNeeded || saveLevel != WalletSaveLevel::SAVE_ALL || m_containerStorage.suffixSize() == 0) {
+    return true;
+  }
+
+  return reinterpret_cast<const ContainerStoragePrefix*>(m_containerStorage.prefix())->version < CONTAINER_JOURNAL_VERSION;
+}
+
+bool WalletGreen::isCompactionNeeded(uint64_t journalSize) const {
+  return journalSize > std::max(CONTAINER_JOURNAL_COMPACTION_RATIO * m_containerSnapshotSize, CONTAINER_JOURNAL_MIN_COMPACTION_SIZE);
 }
 
 void WalletGreen::copyContainerStorageKeys(ContainerStorage& src, const chacha8_key& srcKey, ContainerStorage& dst, const chacha8_key& dstKey) {
@@ -761,6 +980,55 @@ void WalletGreen::loadAndDecryptContainerData(ContainerStorage& storage, const C
   chacha8(encryptedContainer.data(), encryptedContainer.size(), key, suffixIv, reinterpret_cast<char*>(containerData.data()));
 }
 
+std::string WalletGreen::encryptContainerRecord(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* recordData, size_t recordDataSize) {
+  ContainerStoragePrefix* prefix = reinterpret_cast<ContainerStoragePrefix*>(storage.prefix());
+
+  Crypto::chacha8_iv iv = prefix->nextIv;
+  incIv(prefix->nextIv);
+
+  return encryptContainerRecord(key, iv, recordData, recordDataSize);
+}
+
+std::string WalletGreen::encryptContainerRecord(const Crypto::chacha8_key& key, const Crypto::chacha8_iv& iv, const void* recordData, size_t recordDataSize) {
+  ContainerRecordHeader header;
+  header.size = recordDataSize;
+  header.iv = iv;
+
+  std::string record(sizeof(header) + recordDataSize, '\0');
+  char* encryptedData = &record[sizeof(header)];
+  chacha8(recordData, recordDataSize, key, header.iv, encryptedData);
+  header.checksum = cn_fast_hash(encryptedData, recordDataSize);
+  std::memcpy(&record[0], &header, sizeof(header));
+
+  return record;
+}
+
+void WalletGreen::loadAndDecryptContainerRecords(ContainerStorage& storage, const Crypto::chacha8_key& key, std::vector<BinaryArray>& records) {
+  const uint8_t* suffix = storage.suffix();
+  uint64_t suffixSize = storage.suffixSize();
+
+  uint64_t offset = 0;
+  while (suffixSize - offset >= sizeof(ContainerRecordHeader)) {
+    ContainerRecordHeader header;
+    std::memcpy(&header, suffix + offset, sizeof(header));
+
+    const uint8_t* encryptedData = suffix + offset + sizeof(header);
+    if (header.size > suffixSize - offset - sizeof(header) || cn_fast_hash(encryptedData, header.size) != header.checksum) {
+      break;
+    }
+
+    BinaryArray record(header.size);
+    chacha8(encryptedData, header.size, key, header.iv, reinterpret_cast<char*>(record.data()));
+    records.emplace_back(std::move(record));
+    offset += sizeof(header) + header.size;
+  }
+
+  if (offset != suffixSize) {
+    m_logger(WARNING, BRIGHT_YELLOW) << "Container cache ends with a damaged record, " << suffixSize - offset << " bytes dropped";
+    storage.resizeSuffix(offset);
+  }
+}
+
 void WalletGreen::initTransactionPool() {
   std::unordered_set<Crypto::Hash> uncommitedTransactionsSet;
   std::transform(m_uncommitedTransactions.begin(), m_uncommitedTransactions.end(), std::inserter(uncommitedTransactionsSet, uncommitedTransactionsSet.end()),
@@ -936,15 +1204,30 @@ void WalletGreen::changePassword(const std::string& oldPassword, const std::stri
     return;
   }
 
+  finishCompaction();
+
   Crypto::cn_context cnContext;
   Crypto::chacha8_key newKey;
   Crypto::generate_chacha8_key(cnContext, newPassword, newKey);
 
-  m_containerStorage.atomicUpdate([this, newKey](ContainerStorage& newStorage) {
+  std::vector<BinaryArray> records;
+  if (reinterpret_cast<const ContainerStoragePrefix*>(m_containerStorage.prefix())->version >= CONTAINER_JOURNAL_VERSION) {
+    loadAndDecryptContainerRecords(m_containerStorage, m_key, records);
+  }
+
+  m_containerStorage.atomicUpdate([this, newKey, &records](ContainerStorage& newStorage) {
     copyContainerStoragePrefix(m_containerStorage, m_key, newStorage, newKey);
     copyContainerStorageKeys(m_containerStorage, m_key, newStorage, newKey);
 
-    if (m_containerStorage.suffixSize() > 0) {
+    if (!records.empty()) {
+      std::string suffix;
+      for (const auto& record : records) {
+        suffix += encryptContainerRecord(newStorage, newKey, record.data(), record.size());
+      }
+
+      newStorage.resizeSuffix(suffix.size());
+      std::copy(suffix.begin(), suffix.end(), newStorage.suffix());
+    } else if (m_containerStorage.suffixSize() > 0) {
       BinaryArray containerData;
       loadAndDecryptContainerData(m_containerStorage, m_key, containerData);
       encryptAndSaveContainerData(newStorage, newKey, containerData.data(), containerData.size());
@@ -1086,6 +1369,8 @@ std::vector<std::string> WalletGreen::doCreateAddressList(const std::vector<NewA
   throwIfNotInitialized();
   throwIfStopped();
 
+  finishCompaction();
+
   stopBlockchainSynchronizer();
 
   std::vector<std::string> addresses;
@@ -1203,6 +1488,8 @@ void WalletGreen::deleteAddress(const std::string& address) {
   throwIfNotInitialized();
   throwIfStopped();
 
+  finishCompaction();
+
   CryptoNote::AccountPublicAddress pubAddr = parseAddress(address);
 
   auto it = m_walletsContainer.get<KeysIndex>().find(pubAddr.spendPublicKey);
@@ -1375,7 +1662,7 @@ size_t WalletGreen::transfer(const TransactionParameters& transactionParameters,
   return id;
 }
 
-void WalletGreen::prepareTransaction(std::vector<WalletOuts>&& wallets,
+void WalletGreen::prepareTransaction(std::vector<WalletRecord*>&& wallets,
   const std::vector<WalletOrder>& orders,
   uint64_t fee,
   uint64_t mixIn,
@@ -1614,7 +1901,7 @@ size_t WalletGreen::doTransfer(const TransactionParameters& transactionParameter
   CryptoNote::AccountPublicAddress changeDestination = getChangeDestination(transactionParameters.changeDestination, transactionParameters.sourceAddresses);
   m_logger(DEBUGGING) << "Change address " << m_currency.accountAddressAsString(changeDestination);
 
-  std::vector<WalletOuts> wallets;
+  std::vector<WalletRecord*> wallets;
   if (!transactionParameters.sourceAddresses.empty()) {
     wallets = pickWallets(transactionParameters.sourceAddresses);
   } else {
@@ -1670,7 +1957,7 @@ size_t WalletGreen::makeTransaction(const TransactionParameters& sendingTransact
   CryptoNote::AccountPublicAddress changeDestination = getChangeDestination(sendingTransaction.changeDestination, sendingTransaction.sourceAddresses);
   m_logger(DEBUGGING) << "Change address " << m_currency.accountAddressAsString(changeDestination);
 
-  std::vector<WalletOuts> wallets;
+  std::vector<WalletRecord*> wallets;
   if (!sendingTransaction.sourceAddresses.empty()) {
     wallets = pickWallets(sendingTransaction.sourceAddresses);
   } else {
@@ -1772,6 +2059,8 @@ void WalletGreen::pushBackOutgoingTransfers(size_t txId, const std::vector<Walle
 
     m_transfers.emplace_back(txId, std::move(d));
   }
+
+  m_changedTransactions.insert(txId);
 }
 
 size_t WalletGreen::insertOutgoingTransactionAndPushEvent(const Hash& transactionHash, uint64_t fee, const BinaryArray& extra, uint64_t unlockTimestamp, Crypto::SecretKey& txSecretKey) {
@@ -1790,6 +2079,7 @@ size_t WalletGreen::insertOutgoingTransactionAndPushEvent(const Hash& transactio
 
   size_t txId = m_transactions.get<RandomAccessIndex>().size();
   m_transactions.get<RandomAccessIndex>().push_back(std::move(insertTx));
+  m_changedTransactions.insert(txId);
 
   pushEvent(makeTransactionCreatedEvent(txId));
 
@@ -1803,6 +2093,7 @@ void WalletGreen::updateTransactionStateAndPushEvent(size_t transactionId, Walle
     m_transactions.get<RandomAccessIndex>().modify(it, [state](WalletTransaction& tx) {
       tx.state = state;
     });
+    m_changedTransactions.insert(transactionId);
 
     pushEvent(makeTransactionUpdatedEvent(transactionId));
     m_logger(DEBUGGING) << "Transaction state changed, ID " << transactionId << ", hash " << it->hash << ", new state " << it->state;
@@ -2263,83 +2554,75 @@ uint64_t WalletGreen::selectTransfers(
   uint64_t neededMoney,
   bool dust,
   uint64_t dustThreshold,
-  std::vector<WalletOuts>&& wallets,
+  std::vector<WalletRecord*>&& wallets,
   std::vector<OutputToTransfer>& selectedTransfers) {
 
-  uint64_t foundMoney = 0;
+  uint64_t foundMoney = pickRandomOutputs(wallets, dustThreshold + 1, std::numeric_limits<uint64_t>::max(), nullptr,
+    neededMoney, std::numeric_limits<size_t>::max(), selectedTransfers);
 
-  typedef std::pair<WalletRecord*, TransactionOutputInformation> OutputData;
-  std::vector<OutputData> dustOutputs;
-  std::vector<OutputData> walletOuts;
-  for (auto walletIt = wallets.begin(); walletIt != wallets.end(); ++walletIt) {
-    for (auto outIt = walletIt->outs.begin(); outIt != walletIt->outs.end(); ++outIt) {
-      if (outIt->amount > dustThreshold) {
-        walletOuts.emplace_back(std::piecewise_construct, std::forward_as_tuple(walletIt->wallet), std::forward_as_tuple(*outIt));
-      } else if (dust) {
-        dustOutputs.emplace_back(std::piecewise_construct, std::forward_as_tuple(walletIt->wallet), std::forward_as_tuple(*outIt));
-      }
-    }
+  if (dust && foundMoney < neededMoney) {
+    foundMoney += pickRandomOutputs(wallets, 0, dustThreshold, nullptr, neededMoney - foundMoney, std::numeric_limits<size_t>::max(),
+      selectedTransfers);
   }
 
-  ShuffleGenerator<size_t, Crypto::random_engine<size_t>> indexGenerator(walletOuts.size());
-  while (foundMoney < neededMoney && !indexGenerator.empty()) {
-    auto& out = walletOuts[indexGenerator()];
-    foundMoney += out.second.amount;
-    selectedTransfers.emplace_back(OutputToTransfer{ std::move(out.second), std::move(out.first) });
+  return foundMoney;
+};
+
+// Picks unlocked outputs in random order, see visitRandomOutputs(), until neededMoney is found or maxCount outputs are
+// picked. Outputs that aren't applicable are skipped.
+uint64_t WalletGreen::pickRandomOutputs(const std::vector<WalletRecord*>& wallets, uint64_t minAmount, uint64_t maxAmount,
+  const std::function<bool(uint64_t)>& isApplicable, uint64_t neededMoney, size_t maxCount,
+  std::vector<OutputToTransfer>& pickedOutputs) const {
+
+  uint64_t foundMoney = 0;
+  if (neededMoney == 0 || maxCount == 0) {
+    return foundMoney;
   }
 
-  if (dust && !dustOutputs.empty()) {
-    ShuffleGenerator<size_t, Crypto::random_engine<size_t>> dustIndexGenerator(dustOutputs.size());
-    do {
-      auto& out = dustOutputs[dustIndexGenerator()];
-      foundMoney += out.second.amount;
-      selectedTransfers.emplace_back(OutputToTransfer{ std::move(out.second), std::move(out.first) });
-    } while (foundMoney < neededMoney && !dustIndexGenerator.empty());
+  std::vector<const ITransfersContainer*> containers;
+  containers.reserve(wallets.size());
+  for (WalletRecord* wallet : wallets) {
+    containers.push_back(wallet->container);
   }
 
+  size_t pickedCount = 0;
+  visitRandomOutputs(containers, minAmount, maxAmount, [&](size_t walletIndex, const TransactionOutputInformation& out) {
+    if (isApplicable && !isApplicable(out.amount)) {
+      return true;
+    }
+
+    foundMoney += out.amount;
+    pickedOutputs.push_back(OutputToTransfer{ out, wallets[walletIndex] });
+    return foundMoney < neededMoney && ++pickedCount < maxCount;
+  });
+
   return foundMoney;
-};
+}
 
-std::vector<WalletGreen::WalletOuts> WalletGreen::pickWalletsWithMoney() const {
+std::vector<WalletRecord*> WalletGreen::pickWalletsWithMoney() const {
   auto& walletsIndex = m_walletsContainer.get<RandomAccessIndex>();
 
-  std::vector<WalletOuts> walletOuts;
+  std::vector<WalletRecord*> wallets;
   for (const auto& wallet: walletsIndex) {
     if (wallet.actualBalance == 0) {
       continue;
     }
 
-    ITransfersContainer* container = wallet.container;
-
-    WalletOuts outs;
-    container->getOutputs(outs.outs, ITransfersContainer::IncludeKeyUnlocked);
-    outs.wallet = const_cast<WalletRecord *>(&wallet);
-
-    walletOuts.push_back(std::move(outs));
+    wallets.push_back(const_cast<WalletRecord *>(&wallet));
   };
 
-  return walletOuts;
-}
-
-WalletGreen::WalletOuts WalletGreen::pickWallet(const std::string& address) const {
-  const auto& wallet = getWalletRecord(address);
-
-  ITransfersContainer* container = wallet.container;
-  WalletOuts outs;
-  container->getOutputs(outs.outs, ITransfersContainer::IncludeKeyUnlocked);
-  outs.wallet = const_cast<WalletRecord *>(&wallet);
-
-  return outs;
+  return wallets;
 }
 
-std::vector<WalletGreen::WalletOuts> WalletGreen::pickWallets(const std::vector<std::string>& addresses) const {
-  std::vector<WalletOuts> wallets;
+std::vector<WalletRecord*> WalletGreen::pickWallets(const std::vector<std::string>& addresses) const {
+  std::vector<WalletRecord*> wallets;
   wallets.reserve(addresses.size());
 
   for (const auto& address: addresses) {
-    WalletOuts wallet = pickWallet(address);
-    if (!wallet.outs.empty()) {
-      wallets.emplace_back(std::move(wallet));
+    const auto& wallet = getWalletRecord(address);
+
+    if (wallet.container->unlockedKeyOutputsCount(0, std::numeric_limits<uint64_t>::max()) > 0) {
+      wallets.push_back(const_cast<WalletRecord *>(&wallet));
     }
   }
 
@@ -2776,6 +3059,10 @@ void WalletGreen::transactionUpdated(const TransactionInformation& transactionIn
     static_cast<int64_t>(transactionInfo.totalAmountOut));
   updated |= transfersUpdated;
 
+  if (isNew || updated) {
+    m_changedTransactions.insert(transactionId);
+  }
+
   if (isNew) {
     const auto& tx = m_transactions[transactionId];
     m_logger(INFO, BRIGHT_WHITE) << "New transaction received, ID " << transactionId <<
@@ -2853,6 +3140,7 @@ void WalletGreen::transactionDeleted(ITransfersSubscription* object, const Hash&
 
   if (updated) {
     auto transactionId = getTransactionId(transactionHash);
+    m_changedTransactions.insert(transactionId);
     auto tx = m_transactions[transactionId];
     m_logger(INFO, BRIGHT_WHITE) << "Transaction deleted, ID " << transactionId <<
       ", hash " << transactionHash <<
@@ -3204,19 +3492,21 @@ IFusionManager::EstimateResult WalletGreen::estimate(uint64_t threshold, const s
   validateSourceAddresses(sourceAddresses);
 
   IFusionManager::EstimateResult result{0, 0};
-  auto walletOuts = sourceAddresses.empty() ? pickWalletsWithMoney() : pickWallets(sourceAddresses);
+  auto wallets = sourceAddresses.empty() ? pickWalletsWithMoney() : pickWallets(sourceAddresses);
+  uint32_t height = m_node.getLastKnownBlockHeight();
   std::array<size_t, std::numeric_limits<uint64_t>::digits10 + 1> bucketSizes;
   bucketSizes.fill(0);
-  for (size_t walletIndex = 0; walletIndex < walletOuts.size(); ++walletIndex) {
-    for (auto& out : walletOuts[walletIndex].outs) {
+  for (WalletRecord* wallet : wallets) {
+    wallet->container->visitOutputs(0, std::numeric_limits<uint64_t>::max(), ITransfersContainer::IncludeKeyUnlocked, [&](const TransactionOutputInformation& out) {
       uint8_t powerOfTen = 0;
-      if (m_currency.isAmountApplicableInFusionTransactionInput(out.amount, threshold, powerOfTen, m_node.getLastKnownBlockHeight())) {
+      if (m_currency.isAmountApplicableInFusionTransactionInput(out.amount, threshold, powerOfTen, height)) {
         assert(powerOfTen < std::numeric_limits<uint64_t>::digits10 + 1);
         bucketSizes[powerOfTen]++;
       }
-    }
 
-    result.totalOutputCount += walletOuts[walletIndex].outs.size();
+      ++result.totalOutputCount;
+      return true;
+    });
   }
 
   for (auto bucketSize : bucketSizes) {
@@ -3231,18 +3521,22 @@ IFusionManager::EstimateResult WalletGreen::estimate(uint64_t threshold, const s
 std::vector<WalletGreen::OutputToTransfer> WalletGreen::pickRandomFusionInputs(const std::vector<std::string>& addresses,
   uint64_t threshold, size_t minInputCount, size_t maxInputCount) {
 
-  std::vector<WalletGreen::OutputToTransfer> allFusionReadyOuts;
-  auto walletOuts = addresses.empty() ? pickWalletsWithMoney() : pickWallets(addresses);
+  auto wallets = addresses.empty() ? pickWalletsWithMoney() : pickWallets(addresses);
+  uint32_t height = m_node.getLastKnownBlockHeight();
   std::array<size_t, std::numeric_limits<uint64_t>::digits10 + 1> bucketSizes;
   bucketSizes.fill(0);
-  for (size_t walletIndex = 0; walletIndex < walletOuts.size(); ++walletIndex) {
-    for (auto& out : walletOuts[walletIndex].outs) {
-      uint8_t powerOfTen = 0;
-      if (m_currency.isAmountApplicableInFusionTransactionInput(out.amount, threshold, powerOfTen, m_node.getLastKnownBlockHeight())) {
-        allFusionReadyOuts.push_back({std::move(out), walletOuts[walletIndex].wallet});
-        assert(powerOfTen < std::numeric_limits<uint64_t>::digits10 + 1);
-        bucketSizes[powerOfTen]++;
-      }
+  if (threshold != 0) {
+    for (WalletRecord* wallet : wallets) {
+      // amounts from the threshold on are never applicable, the visit skips them
+      wallet->container->visitOutputs(0, threshold - 1, ITransfersContainer::IncludeKeyUnlocked, [&](const TransactionOutputInformation& out) {
+        uint8_t powerOfTen = 0;
+        if (m_currency.isAmountApplicableInFusionTransactionInput(out.amount, threshold, powerOfTen, height)) {
+          assert(powerOfTen < std::numeric_limits<uint64_t>::digits10 + 1);
+          bucketSizes[powerOfTen]++;
+        }
+
+        return true;
+      });
     }
   }
 
@@ -3271,30 +3565,18 @@ std::vector<WalletGreen::OutputToTransfer> WalletGreen::pickRandomFusionInputs(c
 
   uint64_t upperBound = selectedBucket == std::numeric_limits<uint64_t>::digits10 ? UINT64_MAX : lowerBound * 10;
   std::vector<WalletGreen::OutputToTransfer> selectedOuts;
-  selectedOuts.reserve(bucketSizes[selectedBucket]);
-  for (size_t outIndex = 0; outIndex < allFusionReadyOuts.size(); ++outIndex) {
-    if (allFusionReadyOuts[outIndex].out.amount >= lowerBound && allFusionReadyOuts[outIndex].out.amount < upperBound) {
-      selectedOuts.push_back(std::move(allFusionReadyOuts[outIndex]));
-    }
-  }
-
-  assert(selectedOuts.size() >= minInputCount);
-
-  auto outputsSortingFunction = [](const OutputToTransfer& l, const OutputToTransfer& r) { return l.out.amount < r.out.amount; };
-  if (selectedOuts.size() <= maxInputCount) {
-    std::sort(selectedOuts.begin(), selectedOuts.end(), outputsSortingFunction);
-    return selectedOuts;
-  }
+  selectedOuts.reserve(std::min(bucketSizes[selectedBucket], maxInputCount));
+  pickRandomOutputs(wallets, lowerBound, upperBound - 1, [this, threshold, height](uint64_t amount) {
+    return m_currency.isAmountApplicableInFusionTransactionInput(amount, threshold, height);
+  }, std::numeric_limits<uint64_t>::max(), maxInputCount, selectedOuts);
 
-  ShuffleGenerator<size_t, Crypto::random_engine<size_t>> generator(selectedOuts.size());
-  std::vector<WalletGreen::OutputToTransfer> trimmedSelectedOuts;
-  trimmedSelectedOuts.reserve(maxInputCount);
-  for (size_t i = 0; i < maxInputCount; ++i) {
-    trimmedSelectedOuts.push_back(std::move(selectedOuts[generator()]));
+  // outputs spent since the buckets were counted aren't there to pick
+  if (selectedOuts.size() < minInputCount) {
+    return {};
   }
 
-  std::sort(trimmedSelectedOuts.begin(), trimmedSelectedOuts.end(), outputsSortingFunction);
-  return trimmedSelectedOuts;
+  std::sort(selectedOuts.begin(), selectedOuts.end(), [](const OutputToTransfer& l, const OutputToTransfer& r) { return l.out.amount < r.out.amount; });
+  return selectedOuts;
 }
 
 std::vector<TransactionsInBlockInfo> WalletGreen::getTransactionsInBlocks(uint32_t blockIndex, size_t count) const {
@@ -3427,6 +3709,9 @@ void WalletGreen::deleteContainerFromUnlockTransactionJobs(const ITransfersConta
 std::vector<size_t> WalletGreen::deleteTransfersForAddress(const std::string& address, std::vector<size_t>& deletedTransactions) {
   assert(!address.empty());
 
+  // transfers are dropped and renumbered, which the saved changes don't describe
+  m_fullSaveNeeded = true;
+
   int64_t deletedInputs = 0;
   int64_t deletedOutputs = 0;
 
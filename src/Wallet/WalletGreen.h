@@ -21,6 +21,7 @@
 #include "IWallet.h"
 
 #include <queue>
+#include <set>
 #include <unordered_map>
 
 #include "IFusionManager.h"
@@ -29,6 +30,7 @@
 #include "Logging/LoggerRef.h"
 #include <System/Dispatcher.h>
 #include <System/Event.h>
+#include <System/RemoteContext.h>
 #include "Transfers/TransfersSynchronizer.h"
 #include "Transfers/BlockchainSynchronizer.h"
 #include "../CryptoNoteConfig.h"
@@ -146,11 +148,6 @@ protected:
     std::vector<uint64_t> amounts;
   };
 
-  struct WalletOuts {
-    WalletRecord* wallet;
-    std::vector<TransactionOutputInformation> outs;
-  };
-
   typedef std::pair<WalletTransfers::const_iterator, WalletTransfers::const_iterator> TransfersRange;
 
   struct AddressAmounts {
@@ -169,6 +166,13 @@ protected:
     Crypto::chacha8_iv nextIv;
     EncryptedWalletRecord encryptedViewKeys;
   };
+
+  // Record of the container cache, followed by its encrypted data
+  struct ContainerRecordHeader {
+    uint64_t size;
+    Crypto::Hash checksum; // of the encrypted data, a record torn by a crash doesn't match it
+    Crypto::chacha8_iv iv;
+  };
 #pragma pack(pop)
 
   typedef std::unordered_map<std::string, AddressAmounts> TransfersMap;
@@ -201,9 +205,12 @@ protected:
   virtual void onTransactionDeleteEnd(const Crypto::PublicKey& viewPublicKey, Crypto::Hash transactionHash) override;
   void transactionDeleteEnd(Crypto::Hash transactionHash);
 
-  std::vector<WalletOuts> pickWalletsWithMoney() const;
-  WalletOuts pickWallet(const std::string& address) const;
-  std::vector<WalletOuts> pickWallets(const std::vector<std::string>& addresses) const;
+  // Wallets to spend from, their outputs stay in the transfers containers until they are picked
+  std::vector<WalletRecord*> pickWalletsWithMoney() const;
+  std::vector<WalletRecord*> pickWallets(const std::vector<std::string>& addresses) const;
+  uint64_t pickRandomOutputs(const std::vector<WalletRecord*>& wallets, uint64_t minAmount, uint64_t maxAmount,
+    const std::function<bool(uint64_t)>& isApplicable, uint64_t neededMoney, size_t maxCount,
+    std::vector<OutputToTransfer>& pickedOutputs) const;
 
   void updateBalance(CryptoNote::ITransfersContainer* container);
   void unlockBalances(uint32_t height);
@@ -226,7 +233,7 @@ protected:
     uint64_t changeAmount;
   };
 
-  void prepareTransaction(std::vector<WalletOuts>&& wallets,
+  void prepareTransaction(std::vector<WalletRecord*>&& wallets,
     const std::vector<WalletOrder>& orders,
     uint64_t fee,
     uint64_t mixIn,
@@ -262,7 +269,7 @@ protected:
   uint64_t selectTransfers(uint64_t needeMoney,
     bool dust,
     uint64_t dustThreshold,
-    std::vector<WalletOuts>&& wallets,
+    std::vector<WalletRecord*>&& wallets,
     std::vector<OutputToTransfer>& selectedTransfers);
 
   std::vector<ReceiverAmounts> splitDestinations(const std::vector<WalletTransfer>& destinations,
@@ -303,11 +310,23 @@ protected:
   void deleteOrphanTransactions(const std::unordered_set<Crypto::PublicKey>& deletedKeys);
   static void encryptAndSaveContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* containerData, size_t containerDataSize);
   static void loadAndDecryptContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, BinaryArray& containerData);
+  static std::string encryptContainerRecord(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* recordData, size_t recordDataSize);
+  static std::string encryptContainerRecord(const Crypto::chacha8_key& key, const Crypto::chacha8_iv& iv, const void* recordData, size_t recordDataSize);
+  void loadAndDecryptContainerRecords(ContainerStorage& storage, const Crypto::chacha8_key& key, std::vector<BinaryArray>& records);
   void initTransactionPool();
   void loadSpendKeys();
   void loadContainerStorage(const std::string& path);
   void loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKeys, std::unordered_set<Crypto::PublicKey>& deletedKeys, std::string& extra);
   void saveWalletCache(ContainerStorage& storage, const Crypto::chacha8_key& key, WalletSaveLevel saveLevel, const std::string& extra);
+  void saveWalletCacheChanges(const std::string& extra);
+  std::string serializeWalletCache(WalletSaveLevel saveLevel, const std::string& extra);
+  std::string serializeWalletCacheChanges(const std::string& extra);
+  bool isFullSaveNeeded(WalletSaveLevel saveLevel) const;
+  bool isCompactionNeeded(uint64_t journalSize) const;
+  void startCompaction(std::string&& snapshotData);
+  static void writeCompactedContainer(const std::string& path, const std::vector<uint8_t>& prefixData, const std::vector<EncryptedWalletRecord>& keys,
+    const Crypto::chacha8_key& key, const Crypto::chacha8_iv& iv, const std::string& snapshotData);
+  void finishCompaction();
   void subscribeWallets();
 
   std::vector<OutputToTransfer> pickRandomFusionInputs(const std::vector<std::string>& addresses,
@@ -370,6 +389,14 @@ protected:
   std::string m_path;
   std::string m_extra; // workaround for wallet reset
 
+  std::set<size_t> m_changedTransactions; // written by the next save that appends the changes to the container cache
+  bool m_fullSaveNeeded;
+  uint64_t m_containerSnapshotSize; // of the full save the container cache starts with
+  // the compacted container is written in the background, it replaces the container before the container is changed again
+  std::unique_ptr<System::RemoteContext<void>> m_compaction;
+  std::string m_compactionPath;
+  uint64_t m_compactionSnapshotSize;
+
   Crypto::PublicKey m_viewPublicKey;
   Crypto::SecretKey m_viewSecretKey;
 
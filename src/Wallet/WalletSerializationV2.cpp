@@ -18,6 +18,11 @@
 
 #include "WalletSerializationV2.h"
 
+#include <algorithm>
+#include <limits>
+#include <map>
+
+#include "Common/MemoryInputStream.h"
 #include "CryptoNoteCore/CryptoNoteSerialization.h"
 #include "Serialization/BinaryInputStreamSerializer.h"
 #include "Serialization/BinaryOutputStreamSerializer.h"
@@ -117,6 +122,42 @@ void serialize(WalletTransferDtoV2& value, CryptoNote::ISerializer& serializer)
   serializer(value.type, "type");
 }
 
+CryptoNote::WalletTransaction makeTransaction(const WalletTransactionDtoV2& dto) {
+  CryptoNote::WalletTransaction tx;
+  tx.state = dto.state;
+  tx.timestamp = dto.timestamp;
+  tx.blockHeight = dto.blockHeight;
+  tx.hash = dto.hash;
+  tx.totalAmount = dto.totalAmount;
+  tx.fee = dto.fee;
+  tx.creationTime = dto.creationTime;
+  tx.unlockTime = dto.unlockTime;
+  tx.extra = dto.extra;
+  tx.isBase = dto.isBase;
+  if (dto.secretKey)
+    tx.secretKey = reinterpret_cast<const Crypto::SecretKey&>(dto.secretKey.get());
+
+  return tx;
+}
+
+CryptoNote::WalletTransfer makeTransfer(const WalletTransferDtoV2& dto) {
+  CryptoNote::WalletTransfer tr;
+  tr.address = dto.address;
+  tr.amount = dto.amount;
+  tr.type = static_cast<CryptoNote::WalletTransferType>(dto.type);
+  return tr;
+}
+
+struct TransactionIdLess {
+  bool operator()(const CryptoNote::TransactionTransferPair& pair, size_t id) const {
+    return pair.first < id;
+  }
+
+  bool operator()(size_t id, const CryptoNote::TransactionTransferPair& pair) const {
+    return id < pair.first;
+  }
+};
+
 }
 
 namespace CryptoNote {
@@ -146,7 +187,8 @@ WalletSerializerV2::WalletSerializerV2(
   m_transfers(transfers),
   m_uncommitedTransactions(uncommitedTransactions),
   m_extra(extra),
-  m_transactionSoftLockTime(transactionSoftLockTime)
+  m_transactionSoftLockTime(transactionSoftLockTime),
+  m_loadedSaveLevel(WalletSaveLevel::SAVE_ALL)
 {
 }
 
@@ -156,6 +198,7 @@ void WalletSerializerV2::load(Common::IInputStream& source, uint8_t version) {
   uint8_t saveLevelValue;
   s(saveLevelValue, "saveLevel");
   WalletSaveLevel saveLevel = static_cast<WalletSaveLevel>(saveLevelValue);
+  m_loadedSaveLevel = saveLevel;
 
   loadKeyListAndBanalces(s, saveLevel == WalletSaveLevel::SAVE_ALL);
 
@@ -195,6 +238,144 @@ void WalletSerializerV2::save(Common::IOutputStream& destination, WalletSaveLeve
   s(m_extra, "extra");
 }
 
+void WalletSerializerV2::saveChanges(Common::IOutputStream& destination, const std::set<size_t>& changedTransactions) {
+  CryptoNote::BinaryOutputStreamSerializer s(destination);
+
+  saveKeyListAndBanalces(s, true);
+
+  uint64_t transactionCount = m_transactions.size();
+  s(transactionCount, "transactionCount");
+
+  uint64_t changedCount = changedTransactions.size();
+  s(changedCount, "changedTransactionCount");
+
+  auto& index = m_transactions.get<RandomAccessIndex>();
+  for (size_t id : changedTransactions) {
+    assert(id < index.size());
+
+    uint64_t txId = id;
+    WalletTransactionDtoV2 dto(index[id]);
+    s(txId, "transactionId");
+    s(dto, "transaction");
+
+    auto range = std::equal_range(m_transfers.begin(), m_transfers.end(), id, TransactionIdLess());
+    uint64_t transferCount = std::distance(range.first, range.second);
+    s(transferCount, "transferCount");
+    for (auto it = range.first; it != range.second; ++it) {
+      WalletTransferDtoV2 tr(it->second);
+      s(tr, "transfer");
+    }
+  }
+
+  std::stringstream stream;
+  m_synchronizer.saveChanges(stream);
+  std::string transfersSynchronizerChanges = stream.str();
+  s(transfersSynchronizerChanges, "transfersSynchronizerChanges");
+
+  saveUnlockTransactionsJobs(s);
+  s(m_uncommitedTransactions, "uncommitedTransactions");
+  s(m_extra, "extra");
+}
+
+void WalletSerializerV2::loadChanges(const std::vector<BinaryArray>& changes) {
+  auto& index = m_transactions.get<RandomAccessIndex>();
+
+  // transfers of a changed transaction replace all its transfers, they are merged once all the records are read
+  std::map<size_t, std::vector<WalletTransfer>> changedTransfers;
+  std::vector<std::string> transfersSynchronizerChanges;
+
+  for (const auto& change : changes) {
+    Common::MemoryInputStream source(change.data(), change.size());
+    CryptoNote::BinaryInputStreamSerializer s(source);
+
+    m_addedKeys.clear();
+    loadKeyListAndBanalces(s, true);
+
+    uint64_t transactionCount = 0;
+    s(transactionCount, "transactionCount");
+
+    uint64_t changedCount = 0;
+    s(changedCount, "changedTransactionCount");
+
+    for (uint64_t i = 0; i < changedCount; ++i) {
+      uint64_t txId = 0;
+      WalletTransactionDtoV2 dto;
+      s(txId, "transactionId");
+      s(dto, "transaction");
+
+      bool applied;
+      if (txId < index.size()) {
+        applied = index.replace(std::next(index.begin(), txId), makeTransaction(dto));
+      } else if (txId == index.size()) {
+        applied = index.push_back(makeTransaction(dto)).second;
+      } else {
+        applied = false;
+      }
+
+      if (!applied) {
+        throw std::runtime_error("Failed to apply saved changes of transaction " + std::to_string(txId));
+      }
+
+      uint64_t transferCount = 0;
+      s(transferCount, "transferCount");
+
+      std::vector<WalletTransfer>& transfers = changedTransfers[txId];
+      transfers.clear();
+      transfers.reserve(transferCount);
+      for (uint64_t j = 0; j < transferCount; ++j) {
+        WalletTransferDtoV2 tr;
+        s(tr, "transfer");
+        transfers.emplace_back(makeTransfer(tr));
+      }
+    }
+
+    if (index.size() != transactionCount) {
+      throw std::runtime_error("Saved changes don't match the transaction count");
+    }
+
+    std::string synchronizerChanges;
+    s(synchronizerChanges, "transfersSynchronizerChanges");
+    transfersSynchronizerChanges.emplace_back(std::move(synchronizerChanges));
+
+    m_unlockTransactions.clear();
+    loadUnlockTransactionsJobs(s);
+
+    m_uncommitedTransactions.clear();
+    s(m_uncommitedTransactions, "uncommitedTransactions");
+    s(m_extra, "extra");
+  }
+
+  if (!changedTransfers.empty()) {
+    WalletTransfers transfers;
+    transfers.reserve(m_transfers.size());
+
+    auto changedIt = changedTransfers.begin();
+    auto appendChangedTransfers = [&changedIt, &changedTransfers, &transfers](size_t lastId) {
+      for (; changedIt != changedTransfers.end() && changedIt->first <= lastId; ++changedIt) {
+        for (auto& transfer : changedIt->second) {
+          transfers.emplace_back(changedIt->first, std::move(transfer));
+        }
+      }
+    };
+
+    for (auto& transfer : m_transfers) {
+      appendChangedTransfers(transfer.first);
+      if (changedTransfers.count(transfer.first) == 0) {
+        transfers.emplace_back(std::move(transfer));
+      }
+    }
+
+    appendChangedTransfers(std::numeric_limits<size_t>::max());
+    m_transfers.swap(transfers);
+  }
+
+  m_synchronizer.loadChanges(transfersSynchronizerChanges);
+}
+
+WalletSaveLevel WalletSerializerV2::loadedSaveLevel() const {
+  return m_loadedSaveLevel;
+}
+
 std::unordered_set<Crypto::PublicKey>& WalletSerializerV2::addedKeys() {
   return m_addedKeys;
 }
@@ -270,21 +451,7 @@ void WalletSerializerV2::loadTransactions(CryptoNote::ISerializer& serializer) {
     WalletTransactionDtoV2 dto;
     serializer(dto, "transaction");
 
-    WalletTransaction tx;
-    tx.state = dto.state;
-    tx.timestamp = dto.timestamp;
-    tx.blockHeight = dto.blockHeight;
-    tx.hash = dto.hash;
-    tx.totalAmount = dto.totalAmount;
-    tx.fee = dto.fee;
-    tx.creationTime = dto.creationTime;
-    tx.unlockTime = dto.unlockTime;
-    tx.extra = dto.extra;
-    tx.isBase = dto.isBase;
-    if (dto.secretKey)
-      tx.secretKey = reinterpret_cast<const Crypto::SecretKey&>(dto.secretKey.get());
-
-    m_transactions.get<RandomAccessIndex>().emplace_back(std::move(tx));
+    m_transactions.get<RandomAccessIndex>().emplace_back(makeTransaction(dto));
   }
 }
 
@@ -311,12 +478,7 @@ void WalletSerializerV2::loadTransfers(CryptoNote::ISerializer& serializer) {
     WalletTransferDtoV2 dto;
     serializer(dto, "transfer");
 
-    WalletTransfer tr;
-    tr.address = dto.address;
-    tr.amount = dto.amount;
-    tr.type = static_cast<WalletTransferType>(dto.type);
-
-    m_transfers.emplace_back(std::piecewise_construct, std::forward_as_tuple(txId), std::forward_as_tuple(std::move(tr)));
+    m_transfers.emplace_back(std::piecewise_construct, std::forward_as_tuple(txId), std::forward_as_tuple(makeTransfer(dto)));
   }
 }
 
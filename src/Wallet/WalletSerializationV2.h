@@ -17,6 +17,9 @@
 
 #pragma once
 
+#include <set>
+#include <vector>
+
 #include "Common/IInputStream.h"
 #include "Common/IOutputStream.h"
 #include "Serialization/ISerializer.h"
@@ -46,11 +49,21 @@ public:
   void load(Common::IInputStream& source, uint8_t version);
   void save(Common::IOutputStream& destination, WalletSaveLevel saveLevel);
 
+  // Writes the key list with balances, the given transactions with all their transfers and what changed in the
+  // synchronizer since its last saved state. loadChanges() applies such records in the order they were written
+  // on top of a SAVE_ALL save loaded by load().
+  void saveChanges(Common::IOutputStream& destination, const std::set<size_t>& changedTransactions);
+  void loadChanges(const std::vector<BinaryArray>& changes);
+
+  // Save level of the data the last load() call read
+  WalletSaveLevel loadedSaveLevel() const;
+
   std::unordered_set<Crypto::PublicKey>& addedKeys();
   std::unordered_set<Crypto::PublicKey>& deletedKeys();
 
   static const uint8_t MIN_VERSION = 6;
-  static const uint8_t SERIALIZATION_VERSION = 6;
+  // since version 7 the container cache is a journal: a full save followed by the changes saved after it
+  static const uint8_t SERIALIZATION_VERSION = 7;
 
 private:
   void loadKeyListAndBanalces(CryptoNote::ISerializer& serializer, bool saveCache);
@@ -79,6 +92,7 @@ private:
   UncommitedTransactions& m_uncommitedTransactions;
   std::string& m_extra;
   uint32_t m_transactionSoftLockTime;
+  WalletSaveLevel m_loadedSaveLevel;
 
   std::unordered_set<Crypto::PublicKey> m_addedKeys;
   std::unordered_set<Crypto::PublicKey> m_deletedKeys;
@@ -17,12 +17,24 @@
 
 #include "WalletUtils.h"
 
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+
 #include "CryptoNote.h"
+#include "Common/ShuffleGenerator.h"
 #include "crypto/crypto.h"
 #include "Wallet/WalletErrors.h"
 
 namespace CryptoNote {
 
+namespace {
+
+// random outputs are looked up in batches starting with this many, every next batch is twice as large
+const size_t RANDOM_OUTPUTS_FIRST_BATCH_SIZE = 16;
+
+}
+
 void throwIfKeysMissmatch(const Crypto::SecretKey& secretKey, const Crypto::PublicKey& expectedPublicKey, const std::string& message) {
   Crypto::PublicKey pub;
   bool r = Crypto::secret_key_to_public_key(secretKey, pub);
@@ -36,6 +48,69 @@ bool validateAddress(const std::string& address, const CryptoNote::Currency& cur
   return currency.parseAccountAddressString(address, ignore);
 }
 
+void visitRandomOutputs(const std::vector<const ITransfersContainer*>& containers, uint64_t minAmount, uint64_t maxAmount,
+  const std::function<bool(size_t containerIndex, const TransactionOutputInformation& output)>& visitor) {
+
+  std::vector<size_t> containerOffsets;
+  containerOffsets.reserve(containers.size() + 1);
+  size_t outputCount = 0;
+  for (const ITransfersContainer* container : containers) {
+    containerOffsets.push_back(outputCount);
+    outputCount += container->unlockedKeyOutputsCount(minAmount, maxAmount);
+  }
+
+  containerOffsets.push_back(outputCount);
+
+  std::unordered_set<Crypto::PublicKey> visitedKeys;
+  ShuffleGenerator<size_t, Crypto::random_engine<size_t>> indexGenerator(outputCount);
+  size_t batchSize = RANDOM_OUTPUTS_FIRST_BATCH_SIZE;
+  while (!indexGenerator.empty()) {
+    // output number and the order it was drawn in
+    std::vector<std::pair<size_t, size_t>> batch;
+    while (batch.size() < batchSize && !indexGenerator.empty()) {
+      batch.emplace_back(indexGenerator(), batch.size());
+    }
+
+    std::sort(batch.begin(), batch.end());
+
+    // container index and output in the order they were drawn in, containers.size() for the outputs not found
+    std::vector<std::pair<size_t, TransactionOutputInformation>> batchOutputs(batch.size(),
+      std::make_pair(containers.size(), TransactionOutputInformation()));
+    auto next = batch.begin();
+    for (size_t containerIndex = 0; next != batch.end(); ++containerIndex) {
+      size_t containerBegin = containerOffsets[containerIndex];
+      size_t containerEnd = containerOffsets[containerIndex + 1];
+      std::vector<size_t> positions;
+      auto containerBatchEnd = next;
+      for (; containerBatchEnd != batch.end() && containerBatchEnd->first < containerEnd; ++containerBatchEnd) {
+        positions.push_back(containerBatchEnd->first - containerBegin);
+      }
+
+      // outputs spent since they were counted leave the last positions behind, as the positions ascend
+      containers[containerIndex]->visitUnlockedKeyOutputs(minAmount, maxAmount, positions, [&](const TransactionOutputInformation& out) {
+        batchOutputs[next->second] = std::make_pair(containerIndex, out);
+        ++next;
+        return true;
+      });
+
+      next = containerBatchEnd;
+    }
+
+    for (const auto& output : batchOutputs) {
+      // outputs moved between the visits may turn up twice
+      if (output.first == containers.size() || !visitedKeys.insert(output.second.outputKey).second) {
+        continue;
+      }
+
+      if (!visitor(output.first, output.second)) {
+        return;
+      }
+    }
+
+    batchSize *= 2;
+  }
+}
+
 std::ostream& operator<<(std::ostream& os, CryptoNote::WalletTransactionState state) {
   switch (state) {
   case CryptoNote::WalletTransactionState::SUCCEEDED:
@@ -17,8 +17,11 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
+#include <vector>
 
+#include "ITransfersContainer.h"
 #include "IWallet.h"
 #include "CryptoNoteCore/Currency.h"
 #include "Wallet/WalletGreen.h"
@@ -28,6 +31,14 @@ namespace CryptoNote {
 void throwIfKeysMissmatch(const Crypto::SecretKey& secretKey, const Crypto::PublicKey& expectedPublicKey, const std::string& message = "");
 bool validateAddress(const std::string& address, const CryptoNote::Currency& currency);
 
+// Visits the unlocked key outputs of the containers with amounts from minAmount to maxAmount in the order shuffling all of
+// them would give, until the visitor returns false. The outputs are numbered container after container in ascending order
+// of amounts; the numbers are drawn in batches and each batch is looked up by positions in the containers, so visiting k
+// outputs takes O(k log n) and copies only them. Outputs spent since they were counted are skipped and each output is
+// visited once. The visitor is called with the containers unlocked.
+void visitRandomOutputs(const std::vector<const ITransfersContainer*>& containers, uint64_t minAmount, uint64_t maxAmount,
+  const std::function<bool(size_t containerIndex, const TransactionOutputInformation& output)>& visitor);
+
 std::ostream& operator<<(std::ostream& os, CryptoNote::WalletTransactionState state);
 std::ostream& operator<<(std::ostream& os, CryptoNote::WalletTransferType type);
 std::ostream& operator<<(std::ostream& os, CryptoNote::WalletGreen::WalletState state);
@@ -21,13 +21,18 @@
 #ifndef __FreeBSD__
   #include <alloca.h>
 #endif
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <list>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "Common/Varint.h"
 #include "crypto.h"
@@ -143,6 +148,34 @@ namespace Crypto {
     return true;
   }
 
+  void crypto_ops::generate_key_derivations(const PublicKey *keys, size_t count, const SecretKey &sec,
+    KeyDerivation *derivations, bool *results) {
+    assert(sc_check(reinterpret_cast<const unsigned char*>(&sec)) == 0);
+    std::vector<ge_p2> points(count);
+    std::vector<size_t> indexes;
+    indexes.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      ge_p3 point;
+      ge_p1p1 point2;
+      results[i] = ge_frombytes_vartime(&point, reinterpret_cast<const unsigned char*>(&keys[i])) == 0;
+      if (!results[i]) {
+        continue;
+      }
+      ge_p2 &point3 = points[indexes.size()];
+      ge_scalarmult(&point3, reinterpret_cast<const unsigned char*>(&sec), &point);
+      ge_mul8(&point2, &point3);
+      ge_p1p1_to_p2(&point3, &point2);
+      indexes.push_back(i);
+    }
+
+    std::vector<KeyDerivation> encoded(indexes.size());
+    std::unique_ptr<fe[]> tmp(new fe[indexes.size()]);
+    ge_p2_batch_tobytes(reinterpret_cast<unsigned char*>(encoded.data()), points.data(), tmp.get(), indexes.size());
+    for (size_t i = 0; i < indexes.size(); i++) {
+      derivations[indexes[i]] = encoded[i];
+    }
+  }
+
   static void derivation_to_scalar(const KeyDerivation &derivation, size_t output_index, EllipticCurveScalar &res) {
     struct {
       KeyDerivation derivation;
@@ -288,6 +321,38 @@ namespace Crypto {
   }
 
 
+  void crypto_ops::underive_public_keys(const KeyDerivation *const *derivations, const size_t *output_indexes,
+    const PublicKey *derived_keys, size_t count, PublicKey *bases, bool *results) {
+    std::vector<ge_p2> points(count);
+    std::vector<size_t> indexes;
+    indexes.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      EllipticCurveScalar scalar;
+      ge_p3 point1;
+      ge_p3 point2;
+      ge_cached point3;
+      ge_p1p1 point4;
+      results[i] = ge_frombytes_vartime(&point1, reinterpret_cast<const unsigned char*>(&derived_keys[i])) == 0;
+      if (!results[i]) {
+        continue;
+      }
+      derivation_to_scalar(*derivations[i], output_indexes[i], scalar);
+      ge_scalarmult_base(&point2, reinterpret_cast<unsigned char*>(&scalar));
+      ge_p3_to_cached(&point3, &point2);
+      ge_sub(&point4, &point1, &point3);
+      ge_p1p1_to_p2(&points[indexes.size()], &point4);
+      indexes.push_back(i);
+    }
+
+    std::vector<PublicKey> encoded(indexes.size());
+    std::unique_ptr<fe[]> tmp(new fe[indexes.size()]);
+    ge_p2_batch_tobytes(reinterpret_cast<unsigned char*>(encoded.data()), points.data(), tmp.get(), indexes.size());
+    for (size_t i = 0; i < indexes.size(); i++) {
+      bases[indexes[i]] = encoded[i];
+    }
+  }
+
+
   struct s_comm {
     Hash h;
     EllipticCurvePoint key;
@@ -634,4 +699,159 @@ namespace Crypto {
     sc_sub(reinterpret_cast<unsigned char*>(&h), reinterpret_cast<unsigned char*>(&h), reinterpret_cast<unsigned char*>(&sum));
     return sc_isnonzero(reinterpret_cast<unsigned char*>(&h)) == 0;
   }
+
+  struct ring_key_cache::ring_key {
+    ge_dsmp key_pre;    /* P, 3P, 5P, ..., 15P */
+    ge_dsmp hashed_pre; /* the same multiples of hash_to_ec(P) */
+  };
+
+  struct ring_key_cache::state {
+    explicit state(size_t capacity) : capacity(capacity) {
+    }
+
+    size_t capacity;
+    mutable mutex lock;
+    std::list<PublicKey> order; /* most recently used first */
+    std::unordered_map<PublicKey, std::pair<std::shared_ptr<const ring_key>, std::list<PublicKey>::iterator>> keys;
+  };
+
+  ring_key_cache::ring_key_cache(size_t capacity) : m_state(new state(capacity)) {
+  }
+
+  ring_key_cache::~ring_key_cache() {
+  }
+
+  size_t ring_key_cache::size() const {
+    lock_guard<mutex> lock(m_state->lock);
+    return m_state->keys.size();
+  }
+
+  void ring_key_cache::clear() {
+    lock_guard<mutex> lock(m_state->lock);
+    m_state->keys.clear();
+    m_state->order.clear();
+  }
+
+  std::shared_ptr<const ring_key_cache::ring_key> ring_key_cache::get(const PublicKey &pub) {
+    {
+      lock_guard<mutex> lock(m_state->lock);
+      auto it = m_state->keys.find(pub);
+      if (it != m_state->keys.end()) {
+        m_state->order.splice(m_state->order.begin(), m_state->order, it->second.second);
+        return it->second.first;
+      }
+    }
+
+    /* tables are computed without holding the lock, a key missed by two threads at once is computed twice */
+    std::shared_ptr<ring_key> key = std::make_shared<ring_key>();
+    ge_p3 point;
+    if (ge_frombytes_vartime(&point, reinterpret_cast<const unsigned char*>(&pub)) != 0) {
+      abort();
+    }
+    ge_dsm_precomp(key->key_pre, &point);
+    hash_to_ec(pub, point);
+    ge_dsm_precomp(key->hashed_pre, &point);
+
+    lock_guard<mutex> lock(m_state->lock);
+    if (m_state->capacity == 0) {
+      return key;
+    }
+
+    auto inserted = m_state->keys.emplace(pub, std::make_pair(std::shared_ptr<const ring_key>(key), m_state->order.end()));
+    if (!inserted.second) {
+      m_state->order.splice(m_state->order.begin(), m_state->order, inserted.first->second.second);
+      return inserted.first->second.first;
+    }
+
+    m_state->order.push_front(pub);
+    inserted.first->second.second = m_state->order.begin();
+    if (m_state->keys.size() > m_state->capacity) {
+      m_state->keys.erase(m_state->order.back());
+      m_state->order.pop_back();
+    }
+
+    return key;
+  }
+
+  bool crypto_ops::check_ring_signatures(const ring_signature_check *checks, size_t count,
+    ring_key_cache *cache, size_t *failed) {
+    size_t i, j;
+    size_t points_count = 0;
+    size_t max_pubs_count = 0;
+    for (i = 0; i < count; i++) {
+      points_count += 2 * checks[i].pubs_count;
+      max_pubs_count = std::max(max_pubs_count, checks[i].pubs_count);
+    }
+
+    std::unique_ptr<ring_key_cache> local_cache;
+    if (cache == nullptr) {
+      local_cache.reset(new ring_key_cache(points_count / 2));
+      cache = local_cache.get();
+    }
+
+    /* Both points of every ring member of every signature are computed first, so that all of them
+     * are encoded with a single field inversion. Checks before malformed one are well formed. */
+    std::vector<ge_p2> points(points_count);
+    size_t point = 0;
+    size_t malformed = count;
+    for (i = 0; i < count && malformed == count; i++) {
+      const ring_signature_check &check = checks[i];
+      ge_p3 image_unp;
+      ge_dsmp image_pre;
+      if (ge_frombytes_vartime(&image_unp, reinterpret_cast<const unsigned char*>(&check.image)) != 0) {
+        malformed = i;
+        break;
+      }
+      ge_dsm_precomp(image_pre, &image_unp);
+      for (j = 0; j < check.pubs_count; j++) {
+        const unsigned char *c = reinterpret_cast<const unsigned char*>(&check.sig[j]);
+        const unsigned char *r = c + 32;
+        if (sc_check(c) != 0 || sc_check(r) != 0) {
+          malformed = i;
+          break;
+        }
+        std::shared_ptr<const ring_key_cache::ring_key> key = cache->get(*check.pubs[j]);
+        ge_double_scalarmult_base_precomp_vartime(&points[point++], c, key->key_pre, r);
+        ge_double_scalarmult_precomp_vartime2(&points[point++], r, key->hashed_pre, c, image_pre);
+      }
+    }
+
+    std::vector<EllipticCurvePoint> encoded(point);
+    std::unique_ptr<fe[]> tmp(new fe[point]);
+    ge_p2_batch_tobytes(reinterpret_cast<unsigned char*>(encoded.data()), points.data(), tmp.get(), point);
+
+    std::vector<uint8_t> comm_data(rs_comm_size(max_pubs_count));
+    rs_comm *const buf = reinterpret_cast<rs_comm *>(comm_data.data());
+    point = 0;
+    for (i = 0; i < malformed; i++) {
+      const ring_signature_check &check = checks[i];
+      EllipticCurveScalar sum, h;
+      sc_0(reinterpret_cast<unsigned char*>(&sum));
+      for (j = 0; j < check.pubs_count; j++) {
+        sc_add(reinterpret_cast<unsigned char*>(&sum), reinterpret_cast<unsigned char*>(&sum), reinterpret_cast<const unsigned char*>(&check.sig[j]));
+      }
+      buf->h = check.prefix_hash;
+      if (check.pubs_count != 0) {
+        memcpy(buf->ab, &encoded[point], 2 * check.pubs_count * sizeof(EllipticCurvePoint));
+      }
+      point += 2 * check.pubs_count;
+      hash_to_scalar(buf, rs_comm_size(check.pubs_count), h);
+      sc_sub(reinterpret_cast<unsigned char*>(&h), reinterpret_cast<unsigned char*>(&h), reinterpret_cast<unsigned char*>(&sum));
+      if (sc_isnonzero(reinterpret_cast<unsigned char*>(&h)) != 0) {
+        if (failed != nullptr) {
+          *failed = i;
+        }
+        return false;
+      }
+    }
+
+    if (malformed != count) {
+      if (failed != nullptr) {
+        *failed = malformed;
+      }
+      return false;
+    }
+
+    return true;
+  }
 }
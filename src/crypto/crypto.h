@@ -22,6 +22,7 @@
 
 #include <cstddef>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <type_traits>
 #include <vector>
@@ -47,6 +48,42 @@ struct EllipticCurveScalar {
   uint8_t data[32];
 };
 
+  /* Ring signature passed to check_ring_signatures, arguments as for check_ring_signature.
+   */
+  struct ring_signature_check {
+    Hash prefix_hash;
+    KeyImage image;
+    const PublicKey *const *pubs;
+    size_t pubs_count;
+    const Signature *sig;
+  };
+
+  /* Least recently used ring member keys with their precomputed scalar multiplication tables.
+   * Outputs are reused as mixins by many rings, and a transaction is checked once on mempool
+   * admission and again in its block, so keeping the tables saves decompressing and hashing
+   * the key to a point on every check. Can be shared by several threads.
+   */
+  class ring_key_cache {
+  public:
+    explicit ring_key_cache(size_t capacity);
+    ~ring_key_cache();
+
+    size_t size() const;
+    void clear();
+
+  private:
+    ring_key_cache(const ring_key_cache &);
+    void operator=(const ring_key_cache &);
+
+    friend class crypto_ops;
+    struct ring_key;
+    struct state;
+
+    std::shared_ptr<const ring_key> get(const PublicKey &);
+
+    std::unique_ptr<state> m_state;
+  };
+
   class crypto_ops {
     crypto_ops();
     crypto_ops(const crypto_ops &);
@@ -65,6 +102,8 @@ struct EllipticCurveScalar {
     friend bool secret_key_to_public_key(const SecretKey &, PublicKey &);
     static bool generate_key_derivation(const PublicKey &, const SecretKey &, KeyDerivation &);
     friend bool generate_key_derivation(const PublicKey &, const SecretKey &, KeyDerivation &);
+    static void generate_key_derivations(const PublicKey *, size_t, const SecretKey &, KeyDerivation *, bool *);
+    friend void generate_key_derivations(const PublicKey *, size_t, const SecretKey &, KeyDerivation *, bool *);
     static bool derive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     friend bool derive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     friend bool derive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
@@ -83,6 +122,8 @@ struct EllipticCurveScalar {
     friend bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     static bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
     friend bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
+    static void underive_public_keys(const KeyDerivation *const *, const size_t *, const PublicKey *, size_t, PublicKey *, bool *);
+    friend void underive_public_keys(const KeyDerivation *const *, const size_t *, const PublicKey *, size_t, PublicKey *, bool *);
     static void generate_signature(const Hash &, const PublicKey &, const SecretKey &, Signature &);
     friend void generate_signature(const Hash &, const PublicKey &, const SecretKey &, Signature &);
     static bool check_signature(const Hash &, const PublicKey &, const Signature &);
@@ -105,6 +146,8 @@ struct EllipticCurveScalar {
       const PublicKey *const *, size_t, const Signature *);
     friend bool check_ring_signature(const Hash &, const KeyImage &,
       const PublicKey *const *, size_t, const Signature *);
+    static bool check_ring_signatures(const ring_signature_check *, size_t, ring_key_cache *, size_t *);
+    friend bool check_ring_signatures(const ring_signature_check *, size_t, ring_key_cache *, size_t *);
   };
 
   /* Generate a value filled with random bytes.
@@ -182,6 +225,14 @@ struct EllipticCurveScalar {
     return crypto_ops::generate_key_derivation(key1, key2, derivation);
   }
 
+  /* Same as generate_key_derivation for count keys and one secret key, results[i] tells if derivations[i] was generated.
+   * The derivations are encoded with a single field inversion, which makes batches cheaper than separate calls.
+   */
+  inline void generate_key_derivations(const PublicKey *keys, size_t count, const SecretKey &sec,
+    KeyDerivation *derivations, bool *results) {
+    crypto_ops::generate_key_derivations(keys, count, sec, derivations, results);
+  }
+
   inline bool derive_public_key(const KeyDerivation &derivation, size_t output_index,
     const PublicKey &base, const uint8_t* prefix, size_t prefixLength, PublicKey &derived_key) {
     return crypto_ops::derive_public_key(derivation, output_index, base, prefix, prefixLength, derived_key);
@@ -221,6 +272,14 @@ struct EllipticCurveScalar {
     return crypto_ops::underive_public_key(derivation, output_index, derived_key, base);
   }
 
+  /* underive_public_key for count outputs at once, output i is derived with *derivations[i] and output_indexes[i].
+   * results[i] tells if bases[i] was computed. All bases are encoded with a single field inversion.
+   */
+  inline void underive_public_keys(const KeyDerivation *const *derivations, const size_t *output_indexes,
+    const PublicKey *derived_keys, size_t count, PublicKey *bases, bool *results) {
+    crypto_ops::underive_public_keys(derivations, output_indexes, derived_keys, count, bases, results);
+  }
+
   /* Generation and checking of a standard signature.
    */
   inline void generate_signature(const Hash &prefix_hash, const PublicKey &pub, const SecretKey &sec, Signature &sig) {
@@ -270,6 +329,15 @@ struct EllipticCurveScalar {
     return crypto_ops::check_ring_signature(prefix_hash, image, pubs, pubs_count, sig);
   }
 
+  /* Checks several ring signatures at once. Keys found in cache are not processed again, without
+   * a cache the keys are still shared between the checks of one call. Returns false if any
+   * signature is invalid and stores the index of the first invalid one into failed if not NULL.
+   */
+  inline bool check_ring_signatures(const ring_signature_check *checks, size_t count,
+    ring_key_cache *cache = nullptr, size_t *failed = nullptr) {
+    return crypto_ops::check_ring_signatures(checks, count, cache, failed);
+  }
+
   /* Variants with vector<const PublicKey *> parameters.
    */
   inline void generate_ring_signature(const Hash &prefix_hash, const KeyImage &image,
@@ -283,6 +351,10 @@ struct EllipticCurveScalar {
     const Signature *sig) {
     return check_ring_signature(prefix_hash, image, pubs.data(), pubs.size(), sig);
   }
+  inline bool check_ring_signatures(const std::vector<ring_signature_check> &checks,
+    ring_key_cache *cache = nullptr, size_t *failed = nullptr) {
+    return check_ring_signatures(checks.data(), checks.size(), cache, failed);
+  }
 
 }
 
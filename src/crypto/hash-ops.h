@@ -60,12 +60,34 @@ void hash_process(union hash_state *state, const uint8_t *buf, size_t count);
 enum {
   HASH_SIZE = 32,
   HASH_DATA_AREA = 136,
-  SLOW_HASH_CONTEXT_SIZE = 2097552
+  SLOW_HASH_CONTEXT_SIZE = 2097552,
+  SLOW_HASH_MAX_WAYS = 4,
+  SLOW_HASH_SCRATCHPAD_SIZE = 1 << 21
 };
 
 void cn_fast_hash(const void *data, size_t length, char *hash);
 
 void cn_slow_hash(const void *data, size_t length, char *hash);
+// Computes count independent hashes, up to SLOW_HASH_MAX_WAYS of them interleaved on one thread.
+// hash receives count * HASH_SIZE bytes.
+void cn_slow_hash_multi(const void *const *data, const size_t *length, size_t count, char *hash);
+
+enum {
+  SLOW_HASH_PAGES_REGULAR = 0,
+  SLOW_HASH_PAGES_HUGE = 1,
+  SLOW_HASH_PAGES_TRANSPARENT_HUGE = 2
+};
+
+// Allocates ways consecutive cn_slow_hash scratchpads on huge pages when the OS provides them,
+// otherwise on transparent huge pages or regular memory. pages receives SLOW_HASH_PAGES_*,
+// SLOW_HASH_PAGES_TRANSPARENT_HUGE means the kernel accepted the request, not that it was met.
+// The memory is not touched, it lands on the NUMA node of the thread that hashes first.
+void *slow_hash_allocate_scratchpad(size_t ways, int *pages);
+void slow_hash_free_scratchpad(void *scratchpad, size_t ways, int pages);
+// As cn_slow_hash and cn_slow_hash_multi, the way i uses scratchpads[i] instead of thread local buffers.
+void cn_slow_hash_scratchpad(const void *data, size_t length, char *hash, void *scratchpad);
+void cn_slow_hash_multi_scratchpad(const void *const *data, const size_t *length, size_t count, char *hash,
+  void *const *scratchpads);
 
 void hash_extra_blake(const void *data, size_t length, char *hash);
 void hash_extra_groestl(const void *data, size_t length, char *hash);
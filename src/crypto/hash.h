@@ -42,6 +42,9 @@ namespace Crypto {
     return h;
   }
 
+  // Owns the scratchpads of the slow hash, allocated on huge pages where the OS allows it.
+  // The scratchpads of the extra ways of cn_slow_hash_multi are allocated on first use.
+  // Pages are first touched by the hashing thread, so they are local to its NUMA node.
   class cn_context {
   public:
 
@@ -52,14 +55,31 @@ namespace Crypto {
     void operator=(const cn_context &) = delete;
 #endif
 
+    // True if every scratchpad allocated so far is on reserved huge pages
+    bool hugePages() const;
+    // True if some scratchpad asked for transparent huge pages instead and none is on regular pages.
+    // The kernel backs those with huge pages only when it finds free 2MB frames.
+    bool transparentHugePages() const;
+
   private:
 
+    void *const *scratchpads();
+
     void *data;
+    int dataPages;
+    void *multiData;
+    int multiDataPages;
+    void *pads[SLOW_HASH_MAX_WAYS];
     friend inline void cn_slow_hash(cn_context &, const void *, size_t, Hash &);
+    friend inline void cn_slow_hash_multi(cn_context &, const void *const *, const size_t *, size_t, Hash *);
   };
 
   inline void cn_slow_hash(cn_context &context, const void *data, size_t length, Hash &hash) {
-	cn_slow_hash(data, length, reinterpret_cast<char *>(&hash));
+    cn_slow_hash_scratchpad(data, length, reinterpret_cast<char *>(&hash), context.data);
+  }
+
+  inline void cn_slow_hash_multi(cn_context &context, const void *const *data, const size_t *length, size_t count, Hash *hashes) {
+    cn_slow_hash_multi_scratchpad(data, length, count, reinterpret_cast<char *>(hashes), context.scratchpads());
   }
 
   inline void tree_hash(const Hash *hashes, size_t count, Hash &root_hash) {
@@ -55,6 +55,8 @@
 
 #include <emmintrin.h>
 
+#define HAVE_INTERLEAVED_SLOW_HASH
+
 #if defined(_MSC_VER)
 #include <intrin.h>
 #include <windows.h>
@@ -73,6 +75,7 @@
 #endif
 #else
 #include <wmmintrin.h>
+#include <stdio.h>
 #include <sys/mman.h>
 #define STATIC static
 #define INLINE inline
@@ -157,6 +160,9 @@ union cn_slow_hash_state
 
 THREADV uint8_t *hp_state = NULL;
 THREADV int hp_allocated = 0;
+// scratchpads of the ways of cn_slow_hash_multi after the first one
+THREADV uint8_t *hp_state_multi = NULL;
+THREADV int hp_multi_allocated = 0;
 
 #if defined(_MSC_VER)
 #define cpuid(info,x)    __cpuidex(info,x,0)
@@ -422,47 +428,145 @@ BOOL SetLockPagesPrivilege(HANDLE hProcess, BOOL bEnable)
 }
 #endif
 
+#if defined(MADV_HUGEPAGE)
 /**
- * @brief allocate the 2MB scratch buffer using OS support for huge pages, if available
+ * @brief checks that transparent huge pages are not disabled with "never"
  *
- * This function tries to allocate the 2MB scratch buffer using a single
- * 2MB "huge page" (instead of the usual 4KB page sizes) to reduce TLB misses
- * during the random accesses to the scratch buffer.  This is one of the
- * important speed optimizations needed to make CryptoNight faster.
+ * madvise(MADV_HUGEPAGE) succeeds even then, the kernel just never backs the range with huge pages.
+ */
+
+STATIC int transparent_huge_pages_enabled(void)
+{
+    char mode[64];
+    size_t length;
+    FILE *file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if(file == NULL)
+        return 0;
+
+    length = fread(mode, 1, sizeof(mode) - 1, file);
+    fclose(file);
+    mode[length] = 0;
+    return strstr(mode, "[never]") == NULL;
+}
+
+/**
+ * @brief maps <size> bytes aligned to 2MB and asks for transparent huge pages
  *
- * No parameters.  Updates a thread-local pointer, hp_state, to point to
- * the allocated buffer.
+ * Used when no explicit huge pages are reserved (MAP_HUGETLB fails).  The kernel backs the
+ * aligned range with huge pages when it can find free 2MB frames at fault time, with ordinary
+ * pages otherwise, so the result is only a request.  The pages are not touched here, so they
+ * are placed on the NUMA node of the thread which first writes them.  Returns NULL if
+ * transparent huge pages are disabled or madvise fails.
  */
 
-void slow_hash_allocate_state(void)
+STATIC uint8_t *map_transparent_huge_pages(size_t size)
 {
-    if(hp_state != NULL)
-        return;
+    uint8_t *buffer, *aligned;
+    size_t head;
+
+    if(!transparent_huge_pages_enabled())
+        return NULL;
+
+    buffer = mmap(0, size + MEMORY, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(buffer == MAP_FAILED)
+        return NULL;
+
+    aligned = (uint8_t *) (((uintptr_t) buffer + MEMORY - 1) & ~((uintptr_t) MEMORY - 1));
+    head = aligned - buffer;
+    if(head > 0)
+        munmap(buffer, head);
+    if(MEMORY - head > 0)
+        munmap(aligned + size, MEMORY - head);
+
+    if(madvise(aligned, size, MADV_HUGEPAGE) != 0)
+    {
+        munmap(aligned, size);
+        return NULL;
+    }
+
+    return aligned;
+}
+#endif
+
+/**
+ * @brief allocates a scratch buffer of <size> bytes using OS support for huge pages, if available
+ *
+ * @param size the size of the buffer, a multiple of the 2MB huge page size
+ * @param allocated set to one of SLOW_HASH_PAGES_*, SLOW_HASH_PAGES_REGULAR if the buffer came from malloc
+ */
+
+STATIC uint8_t *allocate_huge_pages(size_t size, int *allocated)
+{
+    uint8_t *buffer;
 
 #if defined(_MSC_VER) || defined(__MINGW32__)
     SetLockPagesPrivilege(GetCurrentProcess(), TRUE);
-    hp_state = (uint8_t *) VirtualAlloc(hp_state, MEMORY, MEM_LARGE_PAGES |
-                                        MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    buffer = (uint8_t *) VirtualAlloc(NULL, size, MEM_LARGE_PAGES |
+                                      MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
 #else
 #if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
   defined(__DragonFly__)
-    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANON, 0, 0);
+    /* a plain anonymous mapping is no better than malloc, which is reported as regular pages */
+    buffer = MAP_FAILED;
 #else
-    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, 0, 0);
+    buffer = mmap(0, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, 0, 0);
 #endif
-    if(hp_state == MAP_FAILED)
-        hp_state = NULL;
+    if(buffer == MAP_FAILED)
+        buffer = NULL;
 #endif
-    hp_allocated = 1;
-    if(hp_state == NULL)
+    *allocated = SLOW_HASH_PAGES_HUGE;
+#if defined(MADV_HUGEPAGE)
+    if(buffer == NULL)
+    {
+        *allocated = SLOW_HASH_PAGES_TRANSPARENT_HUGE;
+        buffer = map_transparent_huge_pages(size);
+    }
+#endif
+    if(buffer == NULL)
+    {
+        *allocated = SLOW_HASH_PAGES_REGULAR;
+        buffer = (uint8_t *) malloc(size);
+    }
+
+    return buffer;
+}
+
+STATIC void free_huge_pages(uint8_t *buffer, size_t size, int allocated)
+{
+    if(allocated == SLOW_HASH_PAGES_REGULAR)
+        free(buffer);
+    else
     {
-        hp_allocated = 0;
-        hp_state = (uint8_t *) malloc(MEMORY);
+#if defined(_MSC_VER) || defined(__MINGW32__)
+        VirtualFree(buffer, 0, MEM_RELEASE);
+#else
+        munmap(buffer, size);
+#endif
     }
 }
 
+/**
+ * @brief allocate the 2MB scratch buffer using OS support for huge pages, if available
+ *
+ * This function tries to allocate the 2MB scratch buffer using a single
+ * 2MB "huge page" (instead of the usual 4KB page sizes) to reduce TLB misses
+ * during the random accesses to the scratch buffer.  This is one of the
+ * important speed optimizations needed to make CryptoNight faster.
+ *
+ * No parameters.  Updates a thread-local pointer, hp_state, to point to
+ * the allocated buffer.
+ */
+
+void slow_hash_allocate_state(void)
+{
+    if(hp_state != NULL)
+        return;
+
+    hp_state = allocate_huge_pages(MEMORY, &hp_allocated);
+}
+
 /**
  *@brief frees the state allocated by slow_hash_allocate_state
  */
@@ -472,19 +576,133 @@ void slow_hash_free_state(void)
     if(hp_state == NULL)
         return;
 
-    if(!hp_allocated)
-        free(hp_state);
+    free_huge_pages(hp_state, MEMORY, hp_allocated);
+    hp_state = NULL;
+    hp_allocated = 0;
+}
+
+/**
+ * @brief allocate the scratch buffers of the additional ways of cn_slow_hash_multi
+ */
+
+void slow_hash_allocate_multi_state(void)
+{
+    if(hp_state_multi != NULL)
+        return;
+
+    hp_state_multi = allocate_huge_pages((SLOW_HASH_MAX_WAYS - 1) * MEMORY, &hp_multi_allocated);
+}
+
+void slow_hash_free_multi_state(void)
+{
+    if(hp_state_multi == NULL)
+        return;
+
+    free_huge_pages(hp_state_multi, (SLOW_HASH_MAX_WAYS - 1) * MEMORY, hp_multi_allocated);
+    hp_state_multi = NULL;
+    hp_multi_allocated = 0;
+}
+
+/**
+ * @brief allocates <ways> consecutive 2MB scratchpads for cn_slow_hash_scratchpad and
+ * cn_slow_hash_multi_scratchpad, on huge pages if the OS provides them
+ */
+
+void *slow_hash_allocate_scratchpad(size_t ways, int *pages)
+{
+    return allocate_huge_pages(ways * MEMORY, pages);
+}
+
+void slow_hash_free_scratchpad(void *scratchpad, size_t ways, int pages)
+{
+    if(scratchpad == NULL)
+        return;
+
+    free_huge_pages((uint8_t *) scratchpad, ways * MEMORY, pages);
+}
+
+static void (*const extra_hashes[4])(const void *, size_t, char *) =
+{
+    hash_extra_blake, hash_extra_groestl, hash_extra_jh, hash_extra_skein
+};
+
+/**
+ * @brief CryptoNight steps 1 and 2: initialize the state from the data and fill the scratchpad
+ */
+
+STATIC INLINE void cn_explode_scratchpad(const void *data, size_t length, union cn_slow_hash_state *state,
+                                         uint8_t *text, uint8_t *pad, int useAes)
+{
+    RDATA_ALIGN16 uint8_t expandedKey[240];
+    oaes_ctx *aes_ctx;
+    size_t i, j;
+
+    hash_process(&state->hs, data, length);
+    memcpy(text, state->init, INIT_SIZE_BYTE);
+
+    if(useAes)
+    {
+        aes_expand_key(state->hs.b, expandedKey);
+        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
+        {
+            aes_pseudo_round(text, text, expandedKey, INIT_SIZE_BLK);
+            memcpy(&pad[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
+        }
+    }
     else
     {
-#if defined(_MSC_VER) || defined(__MINGW32__)
-        VirtualFree(hp_state, 0, MEM_RELEASE);
-#else
-        munmap(hp_state, MEMORY);
-#endif
+        aes_ctx = (oaes_ctx *) oaes_alloc();
+        oaes_key_import_data(aes_ctx, state->hs.b, AES_KEY_SIZE);
+        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
+        {
+            for(j = 0; j < INIT_SIZE_BLK; j++)
+                aesb_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], aes_ctx->key->exp_data);
+
+            memcpy(&pad[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
+        }
+        oaes_free((OAES_CTX **) &aes_ctx);
     }
+}
 
-    hp_state = NULL;
-    hp_allocated = 0;
+/**
+ * @brief CryptoNight steps 4 and 5: mix the scratchpad back into the state and compute the final hash
+ */
+
+STATIC INLINE void cn_implode_scratchpad(union cn_slow_hash_state *state, uint8_t *text, const uint8_t *pad,
+                                         int useAes, char *hash)
+{
+    RDATA_ALIGN16 uint8_t expandedKey[240];
+    oaes_ctx *aes_ctx;
+    size_t i, j;
+
+    memcpy(text, state->init, INIT_SIZE_BYTE);
+    if(useAes)
+    {
+        aes_expand_key(&state->hs.b[32], expandedKey);
+        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
+        {
+            // add the xor to the pseudo round
+            aes_pseudo_round_xor(text, text, expandedKey, &pad[i * INIT_SIZE_BYTE], INIT_SIZE_BLK);
+        }
+    }
+    else
+    {
+        aes_ctx = (oaes_ctx *) oaes_alloc();
+        oaes_key_import_data(aes_ctx, &state->hs.b[32], AES_KEY_SIZE);
+        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
+        {
+            for(j = 0; j < INIT_SIZE_BLK; j++)
+            {
+                xor_blocks(&text[j * AES_BLOCK_SIZE], &pad[i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE]);
+                aesb_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], aes_ctx->key->exp_data);
+            }
+        }
+        oaes_free((OAES_CTX **) &aes_ctx);
+    }
+
+    memcpy(state->init, text, INIT_SIZE_BYTE);
+    hash_permutation(&state->hs);
+    extra_hashes[state->hs.b[0] & 3](state, 200, hash);
 }
 
 /**
@@ -516,13 +734,12 @@ void slow_hash_free_state(void)
  * @param data the data to hash
  * @param length the length in bytes of the data
  * @param hash a pointer to a buffer in which the final 256 bit hash will be stored
+ * @param hp_state the 2MB scratchpad.  The parameter is named hp_state on purpose, pre_aes()
+ * and post_aes() address the scratchpad through that name.
  */
 
-
-void cn_slow_hash(const void *data, size_t length, char *hash)
+STATIC void cn_slow_hash_pad(const void *data, size_t length, char *hash, uint8_t *hp_state)
 {
-    RDATA_ALIGN16 uint8_t expandedKey[240];  /* These buffers are aligned to use later with SSE functions */
-
     uint8_t text[INIT_SIZE_BYTE];
     RDATA_ALIGN16 uint64_t a[2];
     RDATA_ALIGN16 uint64_t b[2];
@@ -533,50 +750,14 @@ void cn_slow_hash(const void *data, size_t length, char *hash)
 
     size_t i, j;
     uint64_t *p = NULL;
-    oaes_ctx *aes_ctx = NULL;
     int useAes = !force_software_aes() && check_aes_hw();
 
-    static void (*const extra_hashes[4])(const void *, size_t, char *) =
-    {
-        hash_extra_blake, hash_extra_groestl, hash_extra_jh, hash_extra_skein
-    };
-
-	// hp_state is supposed to be managed externally with respect to the 2MB scratchpad reusage logic.
-	// However, if it is not managed, it needs to be locally allocated/freed.
-    int bLocalStateAllocation = (hp_state == NULL);
-	if (bLocalStateAllocation)
-        slow_hash_allocate_state();
-
-    /* CryptoNight Step 1:  Use Keccak1600 to initialize the 'state' (and 'text') buffers from the data. */
-
-    hash_process(&state.hs, data, length);
-    memcpy(text, state.init, INIT_SIZE_BYTE);
-
-    /* CryptoNight Step 2:  Iteratively encrypt the results from Keccak to fill
+    /* CryptoNight Step 1:  Use Keccak1600 to initialize the 'state' (and 'text') buffers from the data.
+     * CryptoNight Step 2:  Iteratively encrypt the results from Keccak to fill
      * the 2MB large random access buffer.
      */
 
-    if(useAes)
-    {
-        aes_expand_key(state.hs.b, expandedKey);
-        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
-        {
-            aes_pseudo_round(text, text, expandedKey, INIT_SIZE_BLK);
-            memcpy(&hp_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
-        }
-    }
-    else
-    {
-        aes_ctx = (oaes_ctx *) oaes_alloc();
-        oaes_key_import_data(aes_ctx, state.hs.b, AES_KEY_SIZE);
-        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
-        {
-            for(j = 0; j < INIT_SIZE_BLK; j++)
-                aesb_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], aes_ctx->key->exp_data);
-
-            memcpy(&hp_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
-        }
-    }
+    cn_explode_scratchpad(data, length, &state, text, hp_state, useAes);
 
     U64(a)[0] = U64(&state.k[0])[0] ^ U64(&state.k[32])[0];
     U64(a)[1] = U64(&state.k[0])[1] ^ U64(&state.k[32])[1];
@@ -612,45 +793,151 @@ void cn_slow_hash(const void *data, size_t length, char *hash)
 
     /* CryptoNight Step 4:  Sequentially pass through the mixing buffer and use 10 rounds
      * of AES encryption to mix the random data back into the 'text' buffer.  'text'
-     * was originally created with the output of Keccak1600. */
+     * was originally created with the output of Keccak1600.
+     * CryptoNight Step 5:  Apply Keccak to the state again, and then
+     * use the resulting data to select which of four finalizer
+     * hash functions to apply to the data (Blake, Groestl, JH, or Skein).
+     * Use this hash to squeeze the state array down
+     * to the final 256 bit hash output.
+     */
+
+    cn_implode_scratchpad(&state, text, hp_state, useAes, hash);
+}
+
+void cn_slow_hash(const void *data, size_t length, char *hash)
+{
+	// hp_state is supposed to be managed externally with respect to the 2MB scratchpad reusage logic.
+	// However, if it is not managed, it needs to be locally allocated/freed.
+    int bLocalStateAllocation = (hp_state == NULL);
+	if (bLocalStateAllocation)
+        slow_hash_allocate_state();
+
+    cn_slow_hash_pad(data, length, hash, hp_state);
+
+	if (bLocalStateAllocation)
+		slow_hash_free_state();
+}
+
+void cn_slow_hash_scratchpad(const void *data, size_t length, char *hash, void *scratchpad)
+{
+    cn_slow_hash_pad(data, length, hash, (uint8_t *) scratchpad);
+}
+
+/*
+ * One iteration of CryptoNight step 3 for way w of cn_slow_hash_multi, the same computation
+ * as pre_aes(), the AES round and post_aes() on the scratchpad and registers of that way.
+ */
+#define multi_round(w, aes_round) \
+  { \
+    RDATA_ALIGN16 uint64_t b[2]; \
+    RDATA_ALIGN16 uint64_t c[2]; \
+    uint64_t hi, lo, *p; \
+    size_t j = state_index(ma[w]); \
+    __m128i _a = _mm_load_si128(R128(ma[w])); \
+    __m128i _c = _mm_load_si128(R128(&pads[w][j])); \
+    aes_round; \
+    _mm_store_si128(R128(c), _c); \
+    mb[w] = _mm_xor_si128(mb[w], _c); \
+    _mm_store_si128(R128(&pads[w][j]), mb[w]); \
+    j = state_index(c); \
+    p = U64(&pads[w][j]); \
+    b[0] = p[0]; b[1] = p[1]; \
+    __mul(); \
+    ma[w][0] += hi; ma[w][1] += lo; \
+    p[0] = ma[w][0]; p[1] = ma[w][1]; \
+    ma[w][0] ^= b[0]; ma[w][1] ^= b[1]; \
+    mb[w] = _c; \
+  }
+
+/**
+ * @brief computes up to SLOW_HASH_MAX_WAYS CryptoNight hashes at once
+ *
+ * The scratchpad accesses of step 3 form one long chain of dependent loads per hash, so a single
+ * hash leaves the core waiting on memory most of the time.  The ways are advanced round by round,
+ * each on its own 2MB scratchpad, which lets the loads of independent hashes overlap.
+ */
+
+STATIC void cn_slow_hash_ways(const void *const *data, const size_t *length, size_t ways, char *hash,
+                              uint8_t *const *pads)
+{
+    uint8_t text[INIT_SIZE_BYTE];
+    union cn_slow_hash_state state[SLOW_HASH_MAX_WAYS];
+    RDATA_ALIGN16 uint64_t ma[SLOW_HASH_MAX_WAYS][2];
+    __m128i mb[SLOW_HASH_MAX_WAYS];
+    size_t i, w;
+    int useAes = !force_software_aes() && check_aes_hw();
+
+    for(w = 0; w < ways; w++)
+    {
+        cn_explode_scratchpad(data[w], length[w], &state[w], text, pads[w], useAes);
+
+        ma[w][0] = U64(&state[w].k[0])[0] ^ U64(&state[w].k[32])[0];
+        ma[w][1] = U64(&state[w].k[0])[1] ^ U64(&state[w].k[32])[1];
+        mb[w] = _mm_set_epi64x(U64(&state[w].k[16])[1] ^ U64(&state[w].k[48])[1],
+                               U64(&state[w].k[16])[0] ^ U64(&state[w].k[48])[0]);
+    }
 
-    memcpy(text, state.init, INIT_SIZE_BYTE);
     if(useAes)
     {
-        aes_expand_key(&state.hs.b[32], expandedKey);
-        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
-        {
-            // add the xor to the pseudo round
-            aes_pseudo_round_xor(text, text, expandedKey, &hp_state[i * INIT_SIZE_BYTE], INIT_SIZE_BLK);
-        }
+        for(i = 0; i < ITER / 2; i++)
+            for(w = 0; w < ways; w++)
+                multi_round(w, _c = _mm_aesenc_si128(_c, _a));
     }
     else
     {
-        oaes_key_import_data(aes_ctx, &state.hs.b[32], AES_KEY_SIZE);
-        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
-        {
-            for(j = 0; j < INIT_SIZE_BLK; j++)
-            {
-                xor_blocks(&text[j * AES_BLOCK_SIZE], &hp_state[i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE]);
-                aesb_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], aes_ctx->key->exp_data);
-            }
-        }
-        oaes_free((OAES_CTX **) &aes_ctx);
+        for(i = 0; i < ITER / 2; i++)
+            for(w = 0; w < ways; w++)
+                multi_round(w, aesb_single_round((uint8_t *) &_c, (uint8_t *) &_c, (uint8_t *) &_a));
     }
 
-    /* CryptoNight Step 5:  Apply Keccak to the state again, and then
-     * use the resulting data to select which of four finalizer
-     * hash functions to apply to the data (Blake, Groestl, JH, or Skein).
-     * Use this hash to squeeze the state array down
-     * to the final 256 bit hash output.
-     */
+    for(w = 0; w < ways; w++)
+        cn_implode_scratchpad(&state[w], text, pads[w], useAes, hash + w * HASH_SIZE);
+}
 
-    memcpy(state.init, text, INIT_SIZE_BYTE);
-    hash_permutation(&state.hs);
-    extra_hashes[state.hs.b[0] & 3](&state, 200, hash);
+void cn_slow_hash_multi_scratchpad(const void *const *data, const size_t *length, size_t count, char *hash,
+                                   void *const *scratchpads)
+{
+    size_t ways;
 
-	if (bLocalStateAllocation)
-		slow_hash_free_state();
+    for(; count > 0; data += ways, length += ways, hash += ways * HASH_SIZE, count -= ways)
+    {
+        ways = count < SLOW_HASH_MAX_WAYS ? count : SLOW_HASH_MAX_WAYS;
+        if(ways == 1)
+            cn_slow_hash_pad(data[0], length[0], hash, (uint8_t *) scratchpads[0]);
+        else
+            cn_slow_hash_ways(data, length, ways, hash, (uint8_t *const *) scratchpads);
+    }
+}
+
+/**
+ * @brief cn_slow_hash_multi_scratchpad on the thread local scratchpads
+ *
+ * The first way uses hp_state, the others hp_state_multi.  Both are allocated and freed
+ * around the call unless managed by the thread.
+ */
+
+void cn_slow_hash_multi(const void *const *data, const size_t *length, size_t count, char *hash)
+{
+    void *pads[SLOW_HASH_MAX_WAYS];
+    size_t w;
+
+    int bLocalStateAllocation = (hp_state == NULL);
+    int bLocalMultiStateAllocation = (hp_state_multi == NULL && count > 1);
+    if (bLocalStateAllocation)
+        slow_hash_allocate_state();
+    if (bLocalMultiStateAllocation)
+        slow_hash_allocate_multi_state();
+
+    pads[0] = hp_state;
+    for(w = 1; w < SLOW_HASH_MAX_WAYS; w++)
+        pads[w] = hp_state_multi != NULL ? &hp_state_multi[(w - 1) * MEMORY] : NULL;
+
+    cn_slow_hash_multi_scratchpad(data, length, count, hash, pads);
+
+    if (bLocalMultiStateAllocation)
+        slow_hash_free_multi_state();
+    if (bLocalStateAllocation)
+        slow_hash_free_state();
 }
 
 #elif !defined NO_AES && (defined(__arm__) || defined(__aarch64__))
@@ -1047,7 +1334,11 @@ STATIC INLINE void xor_blocks(uint8_t* a, const uint8_t* b)
   U64(a)[1] ^= U64(b)[1];
 }
 
-void cn_slow_hash(const void *data, size_t length, char *hash)
+/*
+ * The scratchpad parameter is named hp_state on purpose: pre_aes() and post_aes() address
+ * the scratchpad through that name, so they work on the buffer given by the caller.
+ */
+STATIC void cn_slow_hash_pad(const void *data, size_t length, char *hash, uint8_t *hp_state)
 {
     uint8_t text[INIT_SIZE_BYTE];
     uint8_t a[AES_BLOCK_SIZE];
@@ -1281,4 +1572,49 @@ void cn_slow_hash(const void *data, size_t length, char *hash) {
   free(long_state);
 }
 
+#endif
+
+#if !defined(HAVE_INTERLEAVED_SLOW_HASH)
+void slow_hash_allocate_multi_state(void)
+{
+  return;
+}
+
+void slow_hash_free_multi_state(void)
+{
+  return;
+}
+
+// Hashes are computed one after another where no interleaved implementation exists
+void cn_slow_hash_multi(const void *const *data, const size_t *length, size_t count, char *hash)
+{
+  size_t i;
+
+  for (i = 0; i < count; i++) {
+    cn_slow_hash(data[i], length[i], hash + i * HASH_SIZE);
+  }
+}
+
+// These implementations keep their own scratchpad, the given one is not used
+void *slow_hash_allocate_scratchpad(size_t ways, int *pages)
+{
+  *pages = SLOW_HASH_PAGES_REGULAR;
+  return malloc(ways * MEMORY);
+}
+
+void slow_hash_free_scratchpad(void *scratchpad, size_t ways, int pages)
+{
+  free(scratchpad);
+}
+
+void cn_slow_hash_scratchpad(const void *data, size_t length, char *hash, void *scratchpad)
+{
+  cn_slow_hash(data, length, hash);
+}
+
+void cn_slow_hash_multi_scratchpad(const void *const *data, const size_t *length, size_t count, char *hash,
+                                   void *const *scratchpads)
+{
+  cn_slow_hash_multi(data, length, count, hash);
+}
 #endif
\ No newline at end of file
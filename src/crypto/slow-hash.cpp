@@ -19,56 +19,51 @@
 
 #include "hash.h"
 
-#ifdef _WIN32
-#include <Windows.h>
-#else
-#include <sys/mman.h>
-#endif
-
 using std::bad_alloc;
 
 namespace Crypto {
 
-  enum {
-    MAP_SIZE = SLOW_HASH_CONTEXT_SIZE + ((-SLOW_HASH_CONTEXT_SIZE) & 0xfff)
-  };
-
-#ifdef _WIN32
-
-  cn_context::cn_context() {
-    data = VirtualAlloc(nullptr, MAP_SIZE, MEM_COMMIT, PAGE_READWRITE);
+  // The scratchpad is not populated nor locked here: its pages get faulted in by the thread
+  // that hashes, which places them on that thread's NUMA node.
+  cn_context::cn_context() : multiData(nullptr), multiDataPages(SLOW_HASH_PAGES_REGULAR) {
+    data = slow_hash_allocate_scratchpad(1, &dataPages);
     if (data == nullptr) {
       throw bad_alloc();
     }
+
+    pads[0] = data;
+    for (size_t i = 1; i < SLOW_HASH_MAX_WAYS; ++i) {
+      pads[i] = nullptr;
+    }
   }
 
   cn_context::~cn_context() {
-    if (!VirtualFree(data, 0, MEM_RELEASE)) {
-      throw bad_alloc();
-    }
+    slow_hash_free_scratchpad(multiData, SLOW_HASH_MAX_WAYS - 1, multiDataPages);
+    slow_hash_free_scratchpad(data, 1, dataPages);
   }
 
-#else
+  bool cn_context::hugePages() const {
+    return dataPages == SLOW_HASH_PAGES_HUGE && (multiData == nullptr || multiDataPages == SLOW_HASH_PAGES_HUGE);
+  }
 
-  cn_context::cn_context() {
-#if !defined(__APPLE__) && !defined(__FreeBSD__)
-    data = mmap(nullptr, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
-#else
-    data = mmap(nullptr, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
-#endif
-    if (data == MAP_FAILED) {
-      throw bad_alloc();
-    }
-    mlock(data, MAP_SIZE);
+  bool cn_context::transparentHugePages() const {
+    bool regular = dataPages == SLOW_HASH_PAGES_REGULAR || (multiData != nullptr && multiDataPages == SLOW_HASH_PAGES_REGULAR);
+    return !regular && !hugePages();
   }
 
-  cn_context::~cn_context() {
-    if (munmap(data, MAP_SIZE) != 0) {
-    //  throw bad_alloc();
-		std::terminate();
+  void *const *cn_context::scratchpads() {
+    if (multiData == nullptr) {
+      multiData = slow_hash_allocate_scratchpad(SLOW_HASH_MAX_WAYS - 1, &multiDataPages);
+      if (multiData == nullptr) {
+        throw bad_alloc();
+      }
+
+      for (size_t i = 1; i < SLOW_HASH_MAX_WAYS; ++i) {
+        pads[i] = static_cast<char *>(multiData) + (i - 1) * SLOW_HASH_SCRATCHPAD_SIZE;
+      }
     }
-  }
 
-#endif
+    return pads;
+  }
 
 }
@@ -35,6 +35,7 @@ class test_check_ring_signature : private multi_tx_test_base<a_ring_size>
 public:
   static const size_t loop_count = a_ring_size < 100 ? 100 : 10;
   static const size_t ring_size = a_ring_size;
+  static const size_t items_per_call = 1;
 
   typedef multi_tx_test_base<a_ring_size> base_class;
 
@@ -50,7 +51,7 @@ public:
     std::vector<TransactionDestinationEntry> destinations;
     destinations.push_back(TransactionDestinationEntry(this->m_source_amount, m_alice.getAccountKeys().address));
 
-    if (!constructTransaction(this->m_miners[this->real_source_idx].getAccountKeys(), this->m_sources, destinations, std::vector<uint8_t>(), m_tx, 0, this->m_logger))
+    if (!constructTransaction(this->m_miners[this->real_source_idx].getAccountKeys(), this->m_sources, destinations, std::vector<uint8_t>(), m_tx, 0, m_tx_key, this->m_logger))
       return false;
 
     getObjectHash(*static_cast<TransactionPrefix*>(&m_tx), m_tx_prefix_hash);
@@ -67,5 +68,62 @@ public:
 private:
   CryptoNote::AccountBase m_alice;
   CryptoNote::Transaction m_tx;
+  Crypto::SecretKey m_tx_key;
   Crypto::Hash m_tx_prefix_hash;
 };
+
+// Rings of a batch have no common members, so the keys shared within a batch give no advantage
+template<size_t a_ring_size, size_t a_batch_size>
+class test_check_ring_signatures
+{
+  static_assert(0 < a_ring_size, "ring_size must be greater than 0");
+  static_assert(0 < a_batch_size, "batch_size must be greater than 0");
+
+public:
+  static const size_t loop_count = a_batch_size < 100 ? 1000 / a_batch_size : 5;
+  static const size_t ring_size = a_ring_size;
+  static const size_t batch_size = a_batch_size;
+  static const size_t items_per_call = a_batch_size;
+
+  bool init()
+  {
+    m_public_keys.resize(batch_size * ring_size);
+    m_public_key_ptrs.resize(batch_size * ring_size);
+    m_signatures.resize(batch_size * ring_size);
+    m_checks.resize(batch_size);
+
+    for (size_t i = 0; i < batch_size; ++i)
+    {
+      Crypto::SecretKey secret_key;
+      for (size_t j = 0; j < ring_size; ++j)
+      {
+        size_t key = i * ring_size + j;
+        Crypto::generate_keys(m_public_keys[key], secret_key);
+        m_public_key_ptrs[key] = &m_public_keys[key];
+      }
+
+      Crypto::ring_signature_check& check = m_checks[i];
+      check.prefix_hash = Crypto::rand<Crypto::Hash>();
+      check.pubs = &m_public_key_ptrs[i * ring_size];
+      check.pubs_count = ring_size;
+      check.sig = &m_signatures[i * ring_size];
+
+      // the key generated last is the real one
+      Crypto::generate_key_image(m_public_keys[i * ring_size + ring_size - 1], secret_key, check.image);
+      Crypto::generate_ring_signature(check.prefix_hash, check.image, check.pubs, ring_size, secret_key, ring_size - 1, &m_signatures[i * ring_size]);
+    }
+
+    return true;
+  }
+
+  bool test()
+  {
+    return Crypto::check_ring_signatures(m_checks);
+  }
+
+private:
+  std::vector<Crypto::PublicKey> m_public_keys;
+  std::vector<const Crypto::PublicKey*> m_public_key_ptrs;
+  std::vector<Crypto::Signature> m_signatures;
+  std::vector<Crypto::ring_signature_check> m_checks;
+};
@@ -55,11 +55,12 @@ public:
 
   bool test()
   {
-    return CryptoNote::constructTransaction(this->m_miners[this->real_source_idx].getAccountKeys(), this->m_sources, m_destinations, std::vector<uint8_t>(), m_tx, 0, this->m_logger);
+    return CryptoNote::constructTransaction(this->m_miners[this->real_source_idx].getAccountKeys(), this->m_sources, m_destinations, std::vector<uint8_t>(), m_tx, 0, m_tx_key, this->m_logger);
   }
 
 private:
   CryptoNote::AccountBase m_alice;
   std::vector<CryptoNote::TransactionDestinationEntry> m_destinations;
   CryptoNote::Transaction m_tx;
+  Crypto::SecretKey m_tx_key;
 };
@@ -17,9 +17,13 @@
 
 #pragma once
 
+#include <algorithm>
+
 #include "Common/StringTools.h"
 #include "crypto/crypto.h"
+#include "CryptoNoteConfig.h"
 #include "CryptoNoteCore/CryptoNoteBasic.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 
 class test_cn_slow_hash {
 public:
@@ -57,3 +61,105 @@ private:
   Crypto::Hash m_expected_hash;
   Crypto::cn_context m_context;
 };
+
+// Hashes the four test vectors of tests/Hash/tests-slow.txt, SLOW_HASH_MAX_WAYS per call, in groups of
+// ways inputs per cn_slow_hash_multi call. Times per call compare directly across ways, as the proof of
+// work check of downloaded blocks hashes distinct inputs the same way.
+template <size_t ways>
+class test_cn_slow_hash_multi {
+public:
+  static const size_t loop_count = 10;
+
+  bool init() {
+    static const char* const VECTORS[][2] = {
+      { "6465206f6d6e69627573206475626974616e64756d", "2f8e3df40bd11f9ac90c743ca8e32bb391da4fb98612aa3b6cdc639ee00b31f5" },
+      { "6162756e64616e732063617574656c61206e6f6e206e6f636574", "722fa8ccd594d40e4a41f3822734304c8d5eff7e1b528408e2229da38ba553c4" },
+      { "63617665617420656d70746f72", "bbec2cacf69866a8e740380fe7b818fc78f8571221742d729d9d02d7f8989b87" },
+      { "6578206e6968696c6f206e6968696c20666974", "b1257de4efc5ce28c6b40ceb1c6c8f812a64634eb3e81c5220bee9b2b76a6f05" }
+    };
+
+    static_assert(sizeof(VECTORS) / sizeof(VECTORS[0]) == Crypto::SLOW_HASH_MAX_WAYS, "One test vector per way expected");
+    for (size_t i = 0; i < Crypto::SLOW_HASH_MAX_WAYS; ++i) {
+      size_t size;
+      if (!Common::fromHex(VECTORS[i][0], m_data[i], sizeof(m_data[i]), m_sizes[i]) ||
+          !Common::fromHex(VECTORS[i][1], &m_expected_hashes[i], sizeof(m_expected_hashes[i]), size) || size != sizeof(m_expected_hashes[i])) {
+        return false;
+      }
+
+      m_pointers[i] = m_data[i];
+    }
+
+    return true;
+  }
+
+  bool test() {
+    Crypto::Hash hashes[Crypto::SLOW_HASH_MAX_WAYS];
+    for (size_t i = 0; i < Crypto::SLOW_HASH_MAX_WAYS; i += ways) {
+      size_t count = std::min(ways, Crypto::SLOW_HASH_MAX_WAYS - i);
+      Crypto::cn_slow_hash_multi(m_context, m_pointers + i, m_sizes + i, count, hashes + i);
+    }
+
+    return std::equal(hashes, hashes + Crypto::SLOW_HASH_MAX_WAYS, m_expected_hashes);
+  }
+
+private:
+  char m_data[Crypto::SLOW_HASH_MAX_WAYS][64];
+  const void* m_pointers[Crypto::SLOW_HASH_MAX_WAYS];
+  size_t m_sizes[Crypto::SLOW_HASH_MAX_WAYS];
+  Crypto::Hash m_expected_hashes[Crypto::SLOW_HASH_MAX_WAYS];
+  Crypto::cn_context m_context;
+};
+
+// The miner workload: one block template hashed with SLOW_HASH_MAX_WAYS consecutive nonces per call,
+// ways nonces per cn_slow_hash_multi call. Results are checked against single hashes computed in init().
+template <size_t ways>
+class test_miner_long_hash {
+public:
+  static const size_t loop_count = 10;
+
+  bool init() {
+    m_block.majorVersion = CryptoNote::BLOCK_MAJOR_VERSION_1;
+    m_block.minorVersion = 0;
+    m_block.timestamp = 1500000000;
+    m_block.previousBlockHash = Crypto::cn_fast_hash("previous", 8);
+    m_block.baseTransaction.version = 1;
+    m_block.baseTransaction.unlockTime = 10;
+
+    for (uint32_t i = 0; i < Crypto::SLOW_HASH_MAX_WAYS; ++i) {
+      m_block.nonce = i;
+      if (!CryptoNote::get_block_longhash(m_context, m_block, m_expected_hashes[i])) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool test() {
+    const void* pointers[Crypto::SLOW_HASH_MAX_WAYS];
+    size_t sizes[Crypto::SLOW_HASH_MAX_WAYS];
+    Crypto::Hash hashes[Crypto::SLOW_HASH_MAX_WAYS];
+    for (uint32_t i = 0; i < Crypto::SLOW_HASH_MAX_WAYS; ++i) {
+      m_block.nonce = i;
+      if (!CryptoNote::get_block_longhash_blob(m_block, m_blobs[i])) {
+        return false;
+      }
+
+      pointers[i] = m_blobs[i].data();
+      sizes[i] = m_blobs[i].size();
+    }
+
+    for (size_t i = 0; i < Crypto::SLOW_HASH_MAX_WAYS; i += ways) {
+      size_t count = std::min(ways, Crypto::SLOW_HASH_MAX_WAYS - i);
+      Crypto::cn_slow_hash_multi(m_context, pointers + i, sizes + i, count, hashes + i);
+    }
+
+    return std::equal(hashes, hashes + Crypto::SLOW_HASH_MAX_WAYS, m_expected_hashes);
+  }
+
+private:
+  CryptoNote::Block m_block;
+  CryptoNote::BinaryArray m_blobs[Crypto::SLOW_HASH_MAX_WAYS];
+  Crypto::Hash m_expected_hashes[Crypto::SLOW_HASH_MAX_WAYS];
+  Crypto::cn_context m_context;
+};
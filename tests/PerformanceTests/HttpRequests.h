@@ -0,0 +1,104 @@
+// Copyright (c) 2017-2018 Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "HTTP/HttpParser.h"
+#include "HTTP/HttpRequestParser.h"
+
+// Serves requestCount pipelined JSON RPC requests from memory the way HttpServer does, either through iostreams and
+// HttpParser like before or through HttpRequestParser and gathered response buffers. Reports requests per second.
+template <size_t requestCount, bool useBuffers>
+class test_http_requests {
+public:
+  static const size_t loop_count = 100000 / requestCount;
+  static const size_t items_per_call = requestCount;
+
+  bool init() {
+    const std::string body = "{\"jsonrpc\":\"2.0\",\"id\":\"0\",\"method\":\"getblockcount\",\"params\":{}}";
+    std::ostringstream request;
+    request << "POST /json_rpc HTTP/1.1\r\n"
+      "Host: 127.0.0.1:32348\r\n"
+      "User-Agent: benchmark\r\n"
+      "Accept: */*\r\n"
+      "Content-Type: application/json\r\n"
+      "Content-Length: " << body.size() << "\r\n\r\n" << body;
+
+    for (size_t i = 0; i < requestCount; ++i) {
+      m_input += request.str();
+    }
+
+    m_responseBody = "{\"id\":\"0\",\"jsonrpc\":\"2.0\",\"result\":{\"count\":123456,\"status\":\"OK\"}}";
+    return true;
+  }
+
+  bool test() {
+    return useBuffers ? serveFromBuffer() : serveFromStream();
+  }
+
+private:
+  bool serveFromStream() {
+    std::stringstream stream(m_input);
+    std::ostringstream output;
+    CryptoNote::HttpParser parser;
+    for (size_t i = 0; i < requestCount; ++i) {
+      CryptoNote::HttpRequest request;
+      CryptoNote::HttpResponse response;
+      response.addHeader("content-type", "application/json");
+      parser.receiveRequest(stream, request);
+      response.setBody(m_responseBody);
+      output << response;
+    }
+
+    return output.tellp() > 0;
+  }
+
+  bool serveFromBuffer() {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(m_input.data());
+    size_t begin = 0;
+    size_t written = 0;
+    CryptoNote::HttpRequestParser parser;
+    CryptoNote::HttpRequest request;
+    for (size_t i = 0; i < requestCount; ++i) {
+      CryptoNote::HttpResponse response;
+      response.addHeader("content-type", "application/json");
+      if (!parser.parse(data + begin, m_input.size() - begin)) {
+        return false;
+      }
+
+      parser.fillRequest(request);
+      begin += parser.getRequestSize();
+      parser.reset();
+      response.setBody(m_responseBody);
+
+      // stands in for the gathered write, the body is referenced rather than copied
+      m_head.clear();
+      response.writeHead(m_head);
+      written += m_head.size() + response.getBody().size();
+    }
+
+    return written > 0;
+  }
+
+  std::string m_input;
+  std::string m_responseBody;
+  std::string m_head;
+};
@@ -0,0 +1,100 @@
+// Copyright (c) 2017-2018 Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+
+#include "Common/JsonValue.h"
+#include "Rpc/CoreRpcServerCommandsDefinitions.h"
+#include "Serialization/JsonInputBufferSerializer.h"
+#include "Serialization/JsonInputValueSerializer.h"
+#include "Serialization/JsonOutputBufferSerializer.h"
+#include "Serialization/JsonOutputStreamSerializer.h"
+#include "Serialization/SerializationTools.h"
+
+// Writes an f_block_json response with transactionCount transactions and reads a k_transactions_by_payment_id
+// response with the same transactions, either through a JsonValue like before or straight from and to the text
+// buffers. The block itself is not read back, JsonInputValueSerializer can't read its penalty as a double.
+template <size_t transactionCount, bool useBuffers>
+class test_json_serialization {
+public:
+  static const size_t loop_count = 100000 / (transactionCount + 10);
+  static const size_t items_per_call = 1;
+
+  bool init() {
+    CryptoNote::f_block_details_response& block = m_response.block;
+    block.major_version = 4;
+    block.minor_version = 0;
+    block.timestamp = 1520000000;
+    block.prev_hash = std::string(64, 'a');
+    block.nonce = 3141592653;
+    block.orphan_status = false;
+    block.height = 123456;
+    block.depth = 7;
+    block.hash = std::string(64, 'b');
+    block.difficulty = 98765432;
+    block.cumulativeDifficulty = 123456789012345;
+    block.reward = 14500000000000;
+    block.blockSize = 5120;
+    block.sizeMedian = 20000;
+    block.effectiveSizeMedian = 100000;
+    block.transactionsCumulativeSize = 4800;
+    block.alreadyGeneratedCoins = "9876543210000000";
+    block.alreadyGeneratedTransactions = 654321;
+    block.baseReward = 14400000000000;
+    block.penalty = 0.125;
+    block.totalFeeAmount = 100000000000;
+    for (size_t i = 0; i < transactionCount; ++i) {
+      CryptoNote::f_transaction_short_response transaction;
+      transaction.hash = std::string(64, static_cast<char>('0' + i % 10));
+      transaction.fee = 1000000000 * i;
+      transaction.amount_out = 123456789 * (i + 1);
+      transaction.size = 400 + i;
+      block.transactions.push_back(transaction);
+    }
+
+    m_response.status = CORE_RPC_STATUS_OK;
+
+    CryptoNote::K_COMMAND_RPC_GET_TRANSACTIONS_BY_PAYMENT_ID::response transactions;
+    transactions.transactions = block.transactions;
+    transactions.status = CORE_RPC_STATUS_OK;
+    m_transactionsJson = CryptoNote::storeToJsonValue(transactions).toString();
+    return true;
+  }
+
+  bool test() {
+    std::string json;
+    CryptoNote::K_COMMAND_RPC_GET_TRANSACTIONS_BY_PAYMENT_ID::response loaded;
+    if (useBuffers) {
+      json = CryptoNote::storeToJson(m_response);
+      if (!CryptoNote::loadFromJson(loaded, m_transactionsJson)) {
+        return false;
+      }
+    } else {
+      json = CryptoNote::storeToJsonValue(m_response).toString();
+      CryptoNote::JsonInputValueSerializer s(Common::JsonValue::fromString(m_transactionsJson));
+      CryptoNote::serialize(loaded, s);
+    }
+
+    return !json.empty() && loaded.transactions.size() == transactionCount;
+  }
+
+private:
+  CryptoNote::F_COMMAND_RPC_GET_BLOCK_DETAILS::response m_response;
+  std::string m_transactionsJson;
+};
@@ -0,0 +1,67 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstring>
+
+#include "crypto/crypto.h"
+#include "CryptoNoteConfig.h"
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+
+// One miner hash of a block template with txCount transactions. The nonce is either set on the block,
+// which serializes the header and recomputes the transaction tree hash, or patched into a hashing
+// blob built once, as miner::worker_thread does.
+template <size_t txCount, bool patchNonce>
+class test_miner_hashing_blob {
+public:
+  static const size_t loop_count = 10;
+
+  bool init() {
+    m_block.majorVersion = CryptoNote::BLOCK_MAJOR_VERSION_1;
+    m_block.minorVersion = 0;
+    m_block.timestamp = 1500000000;
+    m_block.nonce = 0;
+    m_block.previousBlockHash = Crypto::cn_fast_hash("previous", 8);
+    m_block.baseTransaction.version = 1;
+    m_block.baseTransaction.unlockTime = 10;
+    for (uint32_t i = 0; i < txCount; ++i) {
+      m_block.transactionHashes.push_back(Crypto::cn_fast_hash(&i, sizeof(i)));
+    }
+
+    return CryptoNote::get_block_longhash_blob(m_block, m_blob, m_nonceOffset);
+  }
+
+  bool test() {
+    ++m_block.nonce;
+    if (patchNonce) {
+      memcpy(m_blob.data() + m_nonceOffset, &m_block.nonce, sizeof(m_block.nonce));
+      Crypto::cn_slow_hash(m_context, m_blob.data(), m_blob.size(), m_hash);
+      return true;
+    }
+
+    return CryptoNote::get_block_longhash(m_context, m_block, m_hash);
+  }
+
+private:
+  CryptoNote::Block m_block;
+  CryptoNote::BinaryArray m_blob;
+  size_t m_nonceOffset;
+  Crypto::Hash m_hash;
+  Crypto::cn_context m_context;
+};
@@ -19,6 +19,7 @@
 
 #include <iostream>
 #include <stdint.h>
+#include <type_traits>
 
 #include <boost/chrono.hpp>
 
@@ -108,6 +109,33 @@ private:
   int m_elapsed;
 };
 
+/**
+ * Tests which process several items per call, e.g. signatures in a batch, declare their number
+ * as items_per_call and get their throughput reported.
+ */
+template <typename T>
+class has_items_per_call
+{
+  template <typename U> static char check(decltype(&U::items_per_call));
+  template <typename U> static long check(...);
+
+public:
+  static const bool value = sizeof(check<T>(nullptr)) == sizeof(char);
+};
+
+template <typename T>
+typename std::enable_if<has_items_per_call<T>::value>::type print_throughput(int elapsed_ms)
+{
+  double items = static_cast<double>(T::loop_count) * T::items_per_call;
+  std::cout << "  items per call: " << T::items_per_call << '\n';
+  std::cout << "  throughput:     " << static_cast<uint64_t>(items * 1000 / (elapsed_ms == 0 ? 1 : elapsed_ms)) << " items/sec\n";
+}
+
+template <typename T>
+typename std::enable_if<!has_items_per_call<T>::value>::type print_throughput(int)
+{
+}
+
 template <typename T>
 void run_test(const char* test_name)
 {
@@ -117,7 +145,9 @@ void run_test(const char* test_name)
     std::cout << test_name << " - OK:\n";
     std::cout << "  loop count:    " << T::loop_count << '\n';
     std::cout << "  elapsed:       " << runner.elapsed_time() << " ms\n";
-    std::cout << "  time per call: " << runner.time_per_call() << " ms/call\n" << std::endl;
+    std::cout << "  time per call: " << runner.time_per_call() << " ms/call\n";
+    print_throughput<T>(runner.elapsed_time());
+    std::cout << std::endl;
   }
   else
   {
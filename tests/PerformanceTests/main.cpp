@@ -27,7 +27,10 @@
 #include "GenerateKeyDerivation.h"
 #include "GenerateKeyImage.h"
 #include "GenerateKeyImageHelper.h"
+#include "HttpRequests.h"
 #include "IsOutToAccount.h"
+#include "JsonSerialization.h"
+#include "MinerHashingBlob.h"
 
 int main(int argc, char** argv)
 {
@@ -62,6 +65,12 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE1(test_check_ring_signature, 2);
   TEST_PERFORMANCE1(test_check_ring_signature, 10);
   TEST_PERFORMANCE1(test_check_ring_signature, 100);
+  TEST_PERFORMANCE2(test_check_ring_signatures, 2, 1);
+  TEST_PERFORMANCE2(test_check_ring_signatures, 2, 1000);
+  TEST_PERFORMANCE2(test_check_ring_signatures, 10, 1);
+  TEST_PERFORMANCE2(test_check_ring_signatures, 10, 10);
+  TEST_PERFORMANCE2(test_check_ring_signatures, 10, 100);
+  TEST_PERFORMANCE2(test_check_ring_signatures, 10, 1000);
 
   TEST_PERFORMANCE0(test_is_out_to_acc);
   TEST_PERFORMANCE0(test_generate_key_image_helper);
@@ -71,6 +80,26 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE0(test_derive_secret_key);
 
   TEST_PERFORMANCE0(test_cn_slow_hash);
+  TEST_PERFORMANCE1(test_cn_slow_hash_multi, 1);
+  TEST_PERFORMANCE1(test_cn_slow_hash_multi, 2);
+  TEST_PERFORMANCE1(test_cn_slow_hash_multi, 4);
+  TEST_PERFORMANCE1(test_miner_long_hash, 1);
+  TEST_PERFORMANCE1(test_miner_long_hash, 2);
+  TEST_PERFORMANCE1(test_miner_long_hash, 4);
+  TEST_PERFORMANCE2(test_miner_hashing_blob, 10, false);
+  TEST_PERFORMANCE2(test_miner_hashing_blob, 10, true);
+  TEST_PERFORMANCE2(test_miner_hashing_blob, 1000, false);
+  TEST_PERFORMANCE2(test_miner_hashing_blob, 1000, true);
+
+  TEST_PERFORMANCE2(test_http_requests, 1, false);
+  TEST_PERFORMANCE2(test_http_requests, 1, true);
+  TEST_PERFORMANCE2(test_http_requests, 100, false);
+  TEST_PERFORMANCE2(test_http_requests, 100, true);
+
+  TEST_PERFORMANCE2(test_json_serialization, 10, false);
+  TEST_PERFORMANCE2(test_json_serialization, 10, true);
+  TEST_PERFORMANCE2(test_json_serialization, 1000, false);
+  TEST_PERFORMANCE2(test_json_serialization, 1000, true);
 
   std::cout << "Tests finished. Elapsed time: " << timer.elapsed_ms() / 1000 << " sec" << std::endl;
 
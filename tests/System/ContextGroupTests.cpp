@@ -399,3 +399,54 @@ TEST(ContextGroupTests, ContextGroupIsWaitingNestedSpawnsEvenThoughItWasInterrup
   ASSERT_FALSE(contextFinished);
   ASSERT_TRUE(nestedContextFinished);
 }
+
+TEST(ContextGroupTests, ContextGroupSpawnTakesStackSize) {
+  Dispatcher dispatcher;
+
+  size_t used = 0;
+  ContextGroup cg1(dispatcher);
+  cg1.spawn([&] {
+    // needs more than the default 512 KB stack
+    std::function<void(size_t)> recurse = [&](size_t depth) {
+      volatile uint8_t frame[16 * 1024];
+      frame[0] = static_cast<uint8_t>(depth);
+      used += sizeof(frame);
+      if (depth > 0) {
+        recurse(depth - 1);
+      }
+
+      frame[1] = frame[0];
+    };
+
+    recurse(100);
+  }, 4 * 1024 * 1024);
+
+  cg1.wait();
+  ASSERT_GE(used, 1600 * 1024);
+}
+
+TEST(ContextGroupTests, DispatcherCountsLiveAndPeakContexts) {
+  Dispatcher dispatcher;
+  Event event(dispatcher);
+
+  ContextGroup cg1(dispatcher);
+  for (size_t i = 0; i < 300; ++i) {
+    cg1.spawn([&] {
+      event.wait();
+    });
+  }
+
+  dispatcher.yield();
+  ASSERT_EQ(300, dispatcher.getLiveContextCount());
+  ASSERT_EQ(300, dispatcher.getPeakContextCount());
+
+  event.set();
+  cg1.wait();
+  ASSERT_EQ(0, dispatcher.getLiveContextCount());
+  ASSERT_EQ(300, dispatcher.getPeakContextCount());
+
+  cg1.spawn([] {});
+  cg1.wait();
+  ASSERT_EQ(0, dispatcher.getLiveContextCount());
+  ASSERT_EQ(300, dispatcher.getPeakContextCount());
+}
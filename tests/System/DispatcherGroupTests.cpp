@@ -0,0 +1,103 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <System/ContextGroup.h>
+#include <System/Dispatcher.h>
+#include <System/DispatcherGroup.h>
+#include <System/Event.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+using namespace System;
+
+TEST(DispatcherGroupTests, loopsRunOnTheirOwnThreads) {
+  Dispatcher dispatcher;
+  DispatcherGroup group(2);
+  ASSERT_EQ(2, group.size());
+  ASSERT_EQ(nullptr, group.getCurrentDispatcher());
+
+  std::thread::id ids[2];
+  for (size_t i = 0; i < group.size(); ++i) {
+    remoteCall(dispatcher, group.getDispatcher(i), [&] {
+      ids[i] = std::this_thread::get_id();
+      ASSERT_EQ(&group.getDispatcher(i), group.getCurrentDispatcher());
+    });
+  }
+
+  ASSERT_NE(std::this_thread::get_id(), ids[0]);
+  ASSERT_NE(std::this_thread::get_id(), ids[1]);
+  ASSERT_NE(ids[0], ids[1]);
+}
+
+TEST(DispatcherGroupTests, remoteCallRethrows) {
+  Dispatcher dispatcher;
+  DispatcherGroup group(1);
+  ASSERT_THROW(remoteCall(dispatcher, group.getDispatcher(0), [] { throw std::runtime_error("failed"); }), std::runtime_error);
+}
+
+TEST(DispatcherGroupTests, spawnRunsInPinnedGroup) {
+  Dispatcher dispatcher;
+  DispatcherGroup group(2);
+  ContextGroup contextGroup(group.getDispatcher(1));
+
+  std::atomic<size_t> onLoop(0);
+  for (size_t i = 0; i < 100; ++i) {
+    group.spawn(1, contextGroup, [&] {
+      if (group.getCurrentDispatcher() == &group.getDispatcher(1)) {
+        ++onLoop;
+      }
+    });
+  }
+
+  remoteCall(dispatcher, group.getDispatcher(1), [&] {
+    contextGroup.wait();
+  });
+
+  ASSERT_EQ(100, onLoop);
+}
+
+TEST(DispatcherGroupTests, remoteSpawnFromManyThreads) {
+  const size_t THREADS = 4;
+  const size_t SPAWNS = 2000;
+
+  Dispatcher dispatcher;
+  Event done(dispatcher);
+  size_t count = 0;
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < THREADS; ++i) {
+    threads.emplace_back([&] {
+      for (size_t j = 0; j < SPAWNS; ++j) {
+        dispatcher.remoteSpawn([&] {
+          if (++count == THREADS * SPAWNS) {
+            done.set();
+          }
+        });
+      }
+    });
+  }
+
+  done.wait();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(THREADS * SPAWNS, count);
+}
@@ -275,6 +275,59 @@ TEST_F(TcpConnectionTests, sendBigChunk) {
   ASSERT_EQ(buf, incoming);
 }
 
+TEST_F(TcpConnectionTests, sendBigChunkInBuffers) {
+  connect();
+
+  const size_t bufsize = 15 * 1024 * 1024; // 15MB
+  std::vector<uint8_t> buf;
+  buf.resize(bufsize);
+  fillRandomBuf(buf);
+
+  std::vector<uint8_t> incoming;
+  Event readComplete(dispatcher);
+
+  contextGroup.spawn([&]{
+    uint8_t readBuf[1024];
+    size_t readSize;
+    while ((readSize = connection2.read(readBuf, sizeof(readBuf))) > 0) {
+      incoming.insert(incoming.end(), readBuf, readBuf + readSize);
+    }
+
+    readComplete.set();
+  });
+
+  contextGroup.spawn([&]{
+    // uneven and empty buffers, more of them than one send takes
+    std::vector<TcpConnection::Buffer> buffers;
+    for (size_t offset = 0, i = 0; offset < bufsize; ++i) {
+      size_t size = std::min(bufsize - offset, i % 7 == 0 ? size_t(0) : i % 1000);
+      buffers.push_back({&buf[offset], size});
+      offset += size;
+    }
+
+    size_t index = 0;
+    while (index < buffers.size()) {
+      size_t transferred = connection1.writeBuffers(&buffers[index], buffers.size() - index);
+      while (index < buffers.size() && transferred >= buffers[index].size) {
+        transferred -= buffers[index].size;
+        ++index;
+      }
+
+      if (transferred != 0) {
+        buffers[index].data += transferred;
+        buffers[index].size -= transferred;
+      }
+    }
+
+    connection1 = TcpConnection(); // close connection
+  });
+
+  readComplete.wait();
+
+  ASSERT_EQ(bufsize, incoming.size());
+  ASSERT_EQ(buf, incoming);
+}
+
 TEST_F(TcpConnectionTests, writeWhenReadWaiting) {
   connect();
 
@@ -122,3 +122,9 @@ TEST_F(TcpListenerTests, tcpListener3) {
   contextGroup.wait();
   ASSERT_TRUE(stopped);
 }
+
+TEST_F(TcpListenerTests, reusePortListenersShareAPort) {
+  TcpListener first(dispatcher, Ipv4Address("127.0.0.1"), 6667, true);
+  TcpListener second(dispatcher, Ipv4Address("127.0.0.1"), 6667, true);
+  ASSERT_THROW(TcpListener(dispatcher, Ipv4Address("127.0.0.1"), 6667), std::runtime_error);
+}
@@ -0,0 +1,185 @@
+// Copyright (c) 2017-2018 Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <Logging/AsyncLogger.h>
+#include <Logging/LoggerRef.h>
+#include <Logging/StreamLogger.h>
+
+using namespace Logging;
+
+namespace {
+
+class RecordingLogger : public ILogger {
+public:
+  RecordingLogger(Level maxLevel = TRACE) : maxLevel(maxLevel), flushCount(0), blocked(false) {
+  }
+
+  virtual void operator()(const std::string& category, Level level, boost::posix_time::ptime time, const std::string& body) override {
+    std::unique_lock<std::mutex> lock(mutex);
+    unblocked.wait(lock, [this] { return !blocked; });
+    messages[category].push_back(body);
+  }
+
+  virtual Level getMaxLevel() const override {
+    return maxLevel;
+  }
+
+  virtual void flush() override {
+    std::unique_lock<std::mutex> lock(mutex);
+    ++flushCount;
+  }
+
+  void block() {
+    std::unique_lock<std::mutex> lock(mutex);
+    blocked = true;
+  }
+
+  void unblock() {
+    std::unique_lock<std::mutex> lock(mutex);
+    blocked = false;
+    unblocked.notify_all();
+  }
+
+  Level maxLevel;
+  size_t flushCount;
+  bool blocked;
+  std::mutex mutex;
+  std::condition_variable unblocked;
+  std::map<std::string, std::vector<std::string>> messages;
+};
+
+}
+
+TEST(AsyncLogger, keepsTheOrderOfEveryThread) {
+  const size_t threadCount = 4;
+  const size_t messageCount = 10000;
+
+  RecordingLogger sink;
+  {
+    AsyncLogger logger(sink, 64, AsyncLogger::BLOCK);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threadCount; ++i) {
+      threads.emplace_back([&logger, i] {
+        for (size_t j = 0; j < messageCount; ++j) {
+          logger(std::to_string(i), INFO, boost::posix_time::ptime(), std::to_string(j));
+        }
+      });
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    logger.flush();
+    ASSERT_EQ(0, logger.getDroppedCount());
+  }
+
+  ASSERT_EQ(threadCount, sink.messages.size());
+  for (auto& thread : sink.messages) {
+    ASSERT_EQ(messageCount, thread.second.size());
+    for (size_t j = 0; j < messageCount; ++j) {
+      ASSERT_EQ(std::to_string(j), thread.second[j]);
+    }
+  }
+
+  ASSERT_LT(0, sink.flushCount);
+}
+
+TEST(AsyncLogger, countsDroppedMessages) {
+  RecordingLogger sink;
+  AsyncLogger logger(sink, 8, AsyncLogger::DROP);
+
+  // the writer takes one message and stalls in the sink, the ring holds eight more
+  sink.block();
+  logger("test", INFO, boost::posix_time::ptime(), "first");
+  while (logger.getDroppedCount() == 0) {
+    logger("test", INFO, boost::posix_time::ptime(), "next");
+  }
+
+  sink.unblock();
+  logger.flush();
+
+  ASSERT_LT(0, logger.getDroppedCount());
+  ASSERT_EQ(1, sink.messages["logging"].size());
+  ASSERT_LE(sink.messages["test"].size(), 10);
+}
+
+TEST(AsyncLogger, appliesNewQueueSizeAndPolicy) {
+  RecordingLogger sink;
+  AsyncLogger logger(sink, 8, AsyncLogger::DROP);
+  logger("test", INFO, boost::posix_time::ptime(), "0");
+
+  // the messages left in the old ring are written before the ones logged into the new ring
+  logger.setQueueSize(16);
+  logger.setOverflowPolicy(AsyncLogger::BLOCK);
+  for (size_t i = 1; i < 1000; ++i) {
+    logger("test", INFO, boost::posix_time::ptime(), std::to_string(i));
+  }
+
+  logger.flush();
+  ASSERT_EQ(0, logger.getDroppedCount());
+
+  std::unique_lock<std::mutex> lock(sink.mutex);
+  ASSERT_EQ(1000, sink.messages["test"].size());
+  for (size_t i = 0; i < 1000; ++i) {
+    ASSERT_EQ(std::to_string(i), sink.messages["test"][i]);
+  }
+}
+
+TEST(AsyncLogger, flushWaitsForQueuedMessages) {
+  RecordingLogger sink;
+  AsyncLogger logger(sink);
+  logger("test", INFO, boost::posix_time::ptime(), "message");
+  logger.flush();
+
+  std::unique_lock<std::mutex> lock(sink.mutex);
+  ASSERT_EQ(1, sink.messages["test"].size());
+}
+
+TEST(LoggerRef, disabledLevelsAreNotPassedOn) {
+  RecordingLogger sink(INFO);
+  LoggerRef logger(sink, "test");
+  logger(DEBUGGING) << "skipped " << 1;
+  logger(INFO) << "kept " << 2;
+
+  ASSERT_EQ(1, sink.messages["test"].size());
+  ASSERT_EQ(DEFAULT + "kept 2\n", sink.messages["test"][0]);
+}
+
+TEST(CommonLogger, formatsPatternLikeStreams) {
+  std::ostringstream output;
+  StreamLogger logger(output, TRACE);
+  logger.setPattern("%D %T %L [%C] %%");
+
+  boost::posix_time::ptime time(boost::gregorian::date(2018, 3, 7), boost::posix_time::time_duration(9, 5, 3) + boost::posix_time::microseconds(42));
+  logger("category", WARNING, time, "message\n");
+  logger("category", INFO, time - boost::posix_time::microseconds(42), "message\n");
+
+  std::ostringstream expected;
+  expected << time.date() << ' ' << time.time_of_day() << " WARNING [category] %message\n";
+  expected << time.date() << ' ' << (time - boost::posix_time::microseconds(42)).time_of_day() << " INFO    [category] %message\n";
+  ASSERT_EQ(expected.str(), output.str());
+}
@@ -0,0 +1,67 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include "CryptoNoteCore/BlockBlobsCache.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+std::shared_ptr<const BlockBlobs> makeBlobs(uint32_t i) {
+  std::shared_ptr<BlockBlobs> blobs = std::make_shared<BlockBlobs>();
+  blobs->id = Crypto::cn_fast_hash(&i, sizeof(i));
+  blobs->timestamp = i;
+  return blobs;
+}
+
+TEST(BlockBlobsCache, findsInsertedBlobs) {
+  BlockBlobsCache cache(4);
+  auto blobs = makeBlobs(1);
+  ASSERT_EQ(nullptr, cache.find(blobs->id));
+
+  cache.insert(blobs);
+  ASSERT_EQ(blobs, cache.find(blobs->id));
+  ASSERT_EQ(1, cache.size());
+
+  cache.insert(makeBlobs(1));
+  ASSERT_EQ(1, cache.size());
+}
+
+TEST(BlockBlobsCache, evictsLeastRecentlyUsed) {
+  BlockBlobsCache cache(2);
+  auto first = makeBlobs(1);
+  auto second = makeBlobs(2);
+  auto third = makeBlobs(3);
+
+  cache.insert(first);
+  cache.insert(second);
+  ASSERT_NE(nullptr, cache.find(first->id));
+
+  cache.insert(third);
+  ASSERT_EQ(2, cache.size());
+  ASSERT_NE(nullptr, cache.find(first->id));
+  ASSERT_EQ(nullptr, cache.find(second->id));
+  ASSERT_NE(nullptr, cache.find(third->id));
+
+  cache.clear();
+  ASSERT_EQ(0, cache.size());
+  ASSERT_EQ(nullptr, cache.find(first->id));
+}
+
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <boost/filesystem.hpp>
+
+#include "gtest/gtest.h"
+
+#include "CryptoNoteCore/BlockMetadataIndex.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const std::string TEST_FILE_NAME = "BlockMetadataIndexTest.dat";
+
+void fill(BlockMetadataIndex& index, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    index.push(1000 + i * 60, 100 + i, (i + 1) * 10, (i + 1) * 50, 50 + i);
+  }
+}
+
+class BlockMetadataIndexTest : public ::testing::Test {
+protected:
+  virtual void SetUp() override {
+    boost::filesystem::remove(TEST_FILE_NAME);
+    index.open(TEST_FILE_NAME);
+  }
+
+  virtual void TearDown() override {
+    index.close();
+    boost::filesystem::remove(TEST_FILE_NAME);
+  }
+
+  BlockMetadataIndex index;
+};
+
+TEST_F(BlockMetadataIndexTest, columnsFollowPushAndPop) {
+  fill(index, 5);
+
+  ASSERT_EQ(5, index.size());
+  ASSERT_EQ(1000 + 4 * 60, index.timestamp(4));
+  ASSERT_EQ(103, index.blockCumulativeSize(3));
+  ASSERT_EQ(30, index.cumulativeDifficulty(2));
+  ASSERT_EQ(100, index.alreadyGeneratedCoins(1));
+
+  index.pop();
+  ASSERT_EQ(4, index.size());
+
+  index.push(7, 8, 9, 10, 11);
+  ASSERT_EQ(7, index.timestamp(4));
+  ASSERT_EQ(11, index.baseTransactionAmountSum(4, 5));
+}
+
+TEST_F(BlockMetadataIndexTest, baseTransactionAmountSumMatchesRange) {
+  fill(index, 10);
+
+  ASSERT_EQ(0, index.baseTransactionAmountSum(3, 3));
+  ASSERT_EQ(50, index.baseTransactionAmountSum(0, 1));
+  ASSERT_EQ(52 + 53 + 54, index.baseTransactionAmountSum(2, 5));
+
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < 10; ++i) {
+    total += 50 + i;
+  }
+
+  ASSERT_EQ(total, index.baseTransactionAmountSum(0, 10));
+}
+
+TEST_F(BlockMetadataIndexTest, rangesAreAppended) {
+  fill(index, 6);
+
+  std::vector<uint64_t> timestamps(1, 0);
+  index.getTimestamps(2, 4, timestamps);
+  ASSERT_EQ(std::vector<uint64_t>({ 0, 1120, 1180 }), timestamps);
+
+  std::vector<difficulty_type> difficulties;
+  index.getCumulativeDifficulties(4, 6, difficulties);
+  ASSERT_EQ(std::vector<difficulty_type>({ 50, 60 }), difficulties);
+
+  std::vector<size_t> sizes;
+  index.getBlockCumulativeSizes(0, 2, sizes);
+  ASSERT_EQ(std::vector<size_t>({ 100, 101 }), sizes);
+}
+
+TEST_F(BlockMetadataIndexTest, reopenKeepsRows) {
+  fill(index, 8);
+  index.flush();
+  index.close();
+
+  BlockMetadataIndex loaded;
+  loaded.open(TEST_FILE_NAME);
+  ASSERT_EQ(8, loaded.size());
+  for (uint32_t i = 0; i < loaded.size(); ++i) {
+    ASSERT_EQ(1000 + i * 60, loaded.timestamp(i));
+    ASSERT_EQ((i + 1) * 10, loaded.cumulativeDifficulty(i));
+    ASSERT_EQ(50 * (i + 1) + i * (i + 1) / 2, loaded.baseTransactionAmountSum(0, i + 1));
+  }
+
+  loaded.truncate(5);
+  ASSERT_EQ(5, loaded.size());
+  ASSERT_EQ(1000 + 4 * 60, loaded.timestamp(4));
+  loaded.close();
+}
+
+}
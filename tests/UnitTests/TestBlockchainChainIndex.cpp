@@ -0,0 +1,203 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <fstream>
+#include <memory>
+
+#include <boost/filesystem.hpp>
+
+#include "gtest/gtest.h"
+
+#include "CryptoNoteCore/Account.h"
+#include "CryptoNoteCore/Blockchain.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/TransactionPool.h"
+#include "CryptoNoteCore/VerificationContext.h"
+#include "Logging/ConsoleLogger.h"
+
+#include "../TestGenerator/TestGenerator.h"
+#include "ICoreStub.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const std::string TEST_DIRECTORY = "BlockchainChainIndexTest";
+const std::string CRASH_DIRECTORY = "BlockchainChainIndexTestCrash";
+
+// Blockchain together with the pool it depends on, both refer to each other like in core
+struct TestBlockchain {
+  TestBlockchain(const Currency& currency, Logging::ILogger& logger) :
+    pool(currency, blockchain, core, timeProvider, logger, false),
+    blockchain(currency, pool, logger, false) {
+  }
+
+  ICoreStub core;
+  RealTimeProvider timeProvider;
+  tx_memory_pool pool;
+  Blockchain blockchain;
+};
+
+class BlockchainChainIndexTest : public ::testing::Test {
+public:
+  BlockchainChainIndexTest() :
+    logger(Logging::ERROR),
+    currency(CurrencyBuilder(logger).currency()),
+    generator(currency) {
+    miner.generate();
+    std::vector<size_t> blockSizes;
+    generator.addBlock(currency.genesisBlock(), 0, 0, blockSizes, 0);
+    lastBlock = currency.genesisBlock();
+  }
+
+protected:
+  virtual void SetUp() override {
+    boost::filesystem::remove_all(TEST_DIRECTORY);
+    boost::filesystem::remove_all(CRASH_DIRECTORY);
+  }
+
+  virtual void TearDown() override {
+    boost::filesystem::remove_all(TEST_DIRECTORY);
+    boost::filesystem::remove_all(CRASH_DIRECTORY);
+  }
+
+  Block makeNextBlock(Blockchain& blockchain) {
+    Block block;
+    EXPECT_TRUE(generator.constructBlockManually(block, lastBlock, miner, test_generator::bf_diffic, 0, 0, 0, Crypto::Hash(),
+      blockchain.getDifficultyForNextBlock()));
+    return block;
+  }
+
+  // Same block as makeNextBlock would produce, except that the miner claims twice the reward
+  Block makeNextBlockWithBigReward(Blockchain& blockchain) {
+    Block block = makeNextBlock(blockchain);
+    Transaction minerTx = block.baseTransaction;
+    minerTx.outputs[0].amount *= 2;
+    EXPECT_TRUE(generator.constructBlockManually(block, lastBlock, miner, test_generator::bf_miner_tx | test_generator::bf_diffic,
+      0, 0, 0, Crypto::Hash(), blockchain.getDifficultyForNextBlock(), minerTx));
+    return block;
+  }
+
+  // Same block as makeNextBlock would produce, except that the extra of the miner transaction makes it too big
+  Block makeNextOversizedBlock(Blockchain& blockchain) {
+    Block block = makeNextBlock(blockchain);
+    Transaction minerTx = block.baseTransaction;
+    minerTx.extra.resize(minerTx.extra.size() + currency.maxBlockCumulativeSize(get_block_height(block)), 0);
+    EXPECT_TRUE(generator.constructBlockManually(block, lastBlock, miner, test_generator::bf_miner_tx | test_generator::bf_diffic,
+      0, 0, 0, Crypto::Hash(), blockchain.getDifficultyForNextBlock(), minerTx));
+    return block;
+  }
+
+  void addBlocks(Blockchain& blockchain, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      Block block = makeNextBlock(blockchain);
+      block_verification_context bvc = boost::value_initialized<block_verification_context>();
+      ASSERT_TRUE(blockchain.addNewBlock(block, bvc));
+      ASSERT_TRUE(bvc.m_added_to_main_chain);
+      lastBlock = block;
+    }
+  }
+
+  uint32_t readChainIndexStateHeight(const std::string& directory) {
+    // the state file starts with the version followed by the flushed height
+    std::ifstream stateFile(directory + "/" + currency.chainIndexFileName() + ".state", std::ios::binary);
+    uint32_t header[2] = { 0, 0 };
+    stateFile.read(reinterpret_cast<char*>(header), sizeof(header));
+    EXPECT_TRUE(stateFile.good());
+    return header[1];
+  }
+
+  void copyDirectory(const std::string& from, const std::string& to) {
+    boost::filesystem::create_directory(to);
+    for (boost::filesystem::directory_iterator it(from); it != boost::filesystem::directory_iterator(); ++it) {
+      boost::filesystem::copy_file(it->path(), boost::filesystem::path(to) / it->path().filename());
+    }
+  }
+
+  Logging::ConsoleLogger logger;
+  Currency currency;
+  test_generator generator;
+  AccountBase miner;
+  Block lastBlock;
+};
+
+TEST_F(BlockchainChainIndexTest, rejectedBlockKeepsChainIndexHeight) {
+  {
+    TestBlockchain chain(currency, logger);
+    ASSERT_TRUE(chain.blockchain.init(TEST_DIRECTORY, false));
+    addBlocks(chain.blockchain, 5);
+    ASSERT_TRUE(chain.blockchain.deinit());
+  }
+
+  TestBlockchain chain(currency, logger);
+  ASSERT_TRUE(chain.blockchain.init(TEST_DIRECTORY, true));
+  ASSERT_EQ(5, chain.blockchain.getCurrentBlockchainHeight() - 1);
+  ASSERT_EQ(6, readChainIndexStateHeight(TEST_DIRECTORY));
+
+  Block badBlock = makeNextBlockWithBigReward(chain.blockchain);
+  block_verification_context bvc = boost::value_initialized<block_verification_context>();
+  ASSERT_FALSE(chain.blockchain.addNewBlock(badBlock, bvc));
+  ASSERT_TRUE(bvc.m_verification_failed);
+  ASSERT_EQ(6, readChainIndexStateHeight(TEST_DIRECTORY));
+
+  // reload the chain index the way it is found after a crash right after the rejected block
+  copyDirectory(TEST_DIRECTORY, CRASH_DIRECTORY);
+  TestBlockchain reloaded(currency, logger);
+  ASSERT_TRUE(reloaded.blockchain.init(CRASH_DIRECTORY, true));
+  ASSERT_EQ(chain.blockchain.getCurrentBlockchainHeight(), reloaded.blockchain.getCurrentBlockchainHeight());
+  ASSERT_EQ(get_block_hash(lastBlock), reloaded.blockchain.getTailId());
+  ASSERT_FALSE(reloaded.blockchain.haveBlock(get_block_hash(badBlock)));
+
+  addBlocks(reloaded.blockchain, 1);
+  ASSERT_EQ(get_block_hash(lastBlock), reloaded.blockchain.getTailId());
+  ASSERT_TRUE(reloaded.blockchain.deinit());
+  ASSERT_TRUE(chain.blockchain.deinit());
+}
+
+TEST_F(BlockchainChainIndexTest, oversizedBlockLeavesNoTransactions) {
+  {
+    TestBlockchain chain(currency, logger);
+    ASSERT_TRUE(chain.blockchain.init(TEST_DIRECTORY, false));
+    addBlocks(chain.blockchain, 5);
+    ASSERT_TRUE(chain.blockchain.deinit());
+  }
+
+  TestBlockchain chain(currency, logger);
+  ASSERT_TRUE(chain.blockchain.init(TEST_DIRECTORY, true));
+
+  Block bigBlock = makeNextOversizedBlock(chain.blockchain);
+  block_verification_context bvc = boost::value_initialized<block_verification_context>();
+  ASSERT_FALSE(chain.blockchain.addNewBlock(bigBlock, bvc));
+  ASSERT_TRUE(bvc.m_verification_failed);
+  ASSERT_FALSE(chain.blockchain.haveTransaction(getObjectHash(bigBlock.baseTransaction)));
+  ASSERT_EQ(6, readChainIndexStateHeight(TEST_DIRECTORY));
+
+  // nothing of the rejected block reaches the chain index either
+  copyDirectory(TEST_DIRECTORY, CRASH_DIRECTORY);
+  TestBlockchain reloaded(currency, logger);
+  ASSERT_TRUE(reloaded.blockchain.init(CRASH_DIRECTORY, true));
+  ASSERT_EQ(get_block_hash(lastBlock), reloaded.blockchain.getTailId());
+  ASSERT_FALSE(reloaded.blockchain.haveTransaction(getObjectHash(bigBlock.baseTransaction)));
+
+  addBlocks(chain.blockchain, 1);
+  ASSERT_EQ(get_block_hash(lastBlock), chain.blockchain.getTailId());
+  ASSERT_TRUE(reloaded.blockchain.deinit());
+  ASSERT_TRUE(chain.blockchain.deinit());
+}
+
+}
@@ -0,0 +1,160 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "gtest/gtest.h"
+
+#include "CryptoNoteCore/Account.h"
+#include "CryptoNoteCore/Blockchain.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/TransactionPool.h"
+#include "CryptoNoteCore/VerificationContext.h"
+#include "Logging/ConsoleLogger.h"
+
+#include "../TestGenerator/TestGenerator.h"
+#include "ICoreStub.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const std::string TEST_DIRECTORY = "BlockchainMinimalFeeTest";
+const std::string UNCACHED_DIRECTORY = "BlockchainMinimalFeeTestUncached";
+
+// the minimal fees are memoized once the chain is 4 weeks of blocks long, 56 blocks with these many blocks per day
+const size_t TEST_BLOCKS_PER_DAY = 2;
+
+// The minimal fee is capped until the block reward drops to the tail emission, so this currency reaches it in a few dozen
+// blocks. The genesis block is hardcoded, its reward has to stay the same. The short unlagged difficulty window lets
+// faster blocks raise the difficulty, and the fee with it, right away.
+Currency makeFastEmissionCurrency(Logging::ILogger& logger) {
+  uint64_t genesisReward = get_outs_money_amount(CurrencyBuilder(logger).currency().genesisBlock().baseTransaction);
+  const unsigned int emissionSpeedFactor = 2;
+  return CurrencyBuilder(logger).
+    expectedNumberOfBlocksPerDay(TEST_BLOCKS_PER_DAY).
+    difficultyWindow(8).
+    difficultyCut(0).
+    difficultyLag(0).
+    emissionSpeedFactor(emissionSpeedFactor).
+    moneySupply(genesisReward << emissionSpeedFactor).
+    currency();
+}
+
+// Blockchain together with the pool it depends on, both refer to each other like in core
+struct TestBlockchain {
+  TestBlockchain(const Currency& currency, Logging::ILogger& logger) :
+    pool(currency, blockchain, core, timeProvider, logger, false),
+    blockchain(currency, pool, logger, false) {
+  }
+
+  ICoreStub core;
+  RealTimeProvider timeProvider;
+  tx_memory_pool pool;
+  Blockchain blockchain;
+};
+
+class BlockchainMinimalFeeTest : public ::testing::Test {
+public:
+  BlockchainMinimalFeeTest() :
+    logger(Logging::ERROR),
+    currency(makeFastEmissionCurrency(logger)),
+    generator(currency) {
+    miner.generate();
+    std::vector<size_t> blockSizes;
+    generator.addBlock(currency.genesisBlock(), 0, 0, blockSizes, 0);
+    blocks.push_back(currency.genesisBlock());
+  }
+
+protected:
+  virtual void SetUp() override {
+    boost::filesystem::remove_all(TEST_DIRECTORY);
+    boost::filesystem::remove_all(UNCACHED_DIRECTORY);
+  }
+
+  virtual void TearDown() override {
+    boost::filesystem::remove_all(TEST_DIRECTORY);
+    boost::filesystem::remove_all(UNCACHED_DIRECTORY);
+  }
+
+  // timestampStep of 0 keeps the difficulty target between the blocks
+  void addBlocks(Blockchain& blockchain, size_t count, uint64_t timestampStep = 0) {
+    for (size_t i = 0; i < count; ++i) {
+      const Block& lastBlock = blocks.back();
+      Block block;
+      ASSERT_TRUE(generator.constructBlockManually(block, lastBlock, miner, test_generator::bf_diffic | test_generator::bf_timestamp,
+        0, 0, lastBlock.timestamp + (timestampStep == 0 ? currency.difficultyTarget() : timestampStep), Crypto::Hash(),
+        blockchain.getDifficultyForNextBlock()));
+
+      block_verification_context bvc = boost::value_initialized<block_verification_context>();
+      ASSERT_TRUE(blockchain.addNewBlock(block, bvc));
+      ASSERT_TRUE(bvc.m_added_to_main_chain);
+      blocks.push_back(block);
+    }
+  }
+
+  Logging::ConsoleLogger logger;
+  Currency currency;
+  test_generator generator;
+  AccountBase miner;
+  std::vector<Block> blocks;
+};
+
+TEST_F(BlockchainMinimalFeeTest, feeRecomputedAfterPopBelowMemoizedHeightEqualsUncachedFee) {
+  const uint32_t ROLLBACK_HEIGHT = 59;
+
+  TestBlockchain chain(currency, logger);
+  ASSERT_TRUE(chain.blockchain.init(TEST_DIRECTORY, false));
+  addBlocks(chain.blockchain, 90);
+
+  uint32_t height = chain.blockchain.getCurrentBlockchainHeight();
+  ASSERT_LE(TEST_BLOCKS_PER_DAY * 7 * 4, height);
+  for (uint32_t h = 1; h < height; ++h) {
+    chain.blockchain.getMinimalFee(h);
+  }
+
+  // the chain stays long enough to memoize, so the fees below the new tail are kept and the ones above are dropped
+  chain.blockchain.rollbackBlockchainTo(ROLLBACK_HEIGHT);
+  ASSERT_EQ(ROLLBACK_HEIGHT + 1, chain.blockchain.getCurrentBlockchainHeight());
+  blocks.resize(ROLLBACK_HEIGHT + 1);
+
+  // blocks twice as fast as the target raise the difficulty, so the fees at the popped memoized heights change
+  addBlocks(chain.blockchain, 16, currency.difficultyTarget() / 2);
+  height = chain.blockchain.getCurrentBlockchainHeight();
+
+  TestBlockchain uncached(currency, logger);
+  ASSERT_TRUE(uncached.blockchain.init(UNCACHED_DIRECTORY, false));
+  for (size_t i = 1; i < blocks.size(); ++i) {
+    block_verification_context bvc = boost::value_initialized<block_verification_context>();
+    ASSERT_TRUE(uncached.blockchain.addNewBlock(blocks[i], bvc));
+    ASSERT_TRUE(bvc.m_added_to_main_chain);
+  }
+
+  ASSERT_EQ(chain.blockchain.getTailId(), uncached.blockchain.getTailId());
+  for (uint32_t h = 1; h < height + 2; ++h) {
+    ASSERT_EQ(uncached.blockchain.getMinimalFee(h), chain.blockchain.getMinimalFee(h)) << "height " << h;
+  }
+
+  ASSERT_TRUE(uncached.blockchain.deinit());
+  ASSERT_TRUE(chain.blockchain.deinit());
+}
+
+}
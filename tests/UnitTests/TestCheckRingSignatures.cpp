@@ -0,0 +1,134 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "crypto/crypto.h"
+
+using namespace Crypto;
+
+namespace {
+
+struct Ring {
+  Hash prefixHash;
+  KeyImage image;
+  std::vector<PublicKey> keys;
+  std::vector<const PublicKey*> keyPointers;
+  std::vector<Signature> signatures;
+};
+
+// Rings are built over the same keys, so that they share members like rings of real transactions do
+void makeRings(size_t count, size_t ringSize, std::vector<Ring>& rings) {
+  std::vector<PublicKey> publicKeys(ringSize + count);
+  std::vector<SecretKey> secretKeys(ringSize + count);
+  for (size_t i = 0; i < publicKeys.size(); ++i) {
+    generate_keys(publicKeys[i], secretKeys[i]);
+  }
+
+  rings.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    Ring& ring = rings[i];
+    ring.prefixHash = rand<Hash>();
+    ring.keys.assign(publicKeys.begin() + i, publicKeys.begin() + i + ringSize);
+    for (const PublicKey& key : ring.keys) {
+      ring.keyPointers.push_back(&key);
+    }
+
+    size_t realIndex = i % ringSize;
+    generate_key_image(ring.keys[realIndex], secretKeys[i + realIndex], ring.image);
+    ring.signatures.resize(ringSize);
+    generate_ring_signature(ring.prefixHash, ring.image, ring.keyPointers, secretKeys[i + realIndex], realIndex, ring.signatures.data());
+  }
+}
+
+std::vector<ring_signature_check> makeChecks(const std::vector<Ring>& rings) {
+  std::vector<ring_signature_check> checks;
+  for (const Ring& ring : rings) {
+    ring_signature_check check;
+    check.prefix_hash = ring.prefixHash;
+    check.image = ring.image;
+    check.pubs = ring.keyPointers.data();
+    check.pubs_count = ring.keyPointers.size();
+    check.sig = ring.signatures.data();
+    checks.push_back(check);
+  }
+
+  return checks;
+}
+
+TEST(CheckRingSignatures, acceptsValidSignatures) {
+  std::vector<Ring> rings;
+  makeRings(20, 5, rings);
+  for (const Ring& ring : rings) {
+    ASSERT_TRUE(check_ring_signature(ring.prefixHash, ring.image, ring.keyPointers, ring.signatures.data()));
+  }
+
+  ASSERT_TRUE(check_ring_signatures(makeChecks(rings)));
+  ASSERT_TRUE(check_ring_signatures(nullptr, 0));
+}
+
+TEST(CheckRingSignatures, reportsFirstInvalidSignature) {
+  std::vector<Ring> rings;
+  makeRings(20, 3, rings);
+  rings[7].prefixHash.data[0] ^= 1;
+  rings[12].signatures[1].data[5] ^= 1;
+
+  size_t failed = 0;
+  ASSERT_FALSE(check_ring_signatures(makeChecks(rings), nullptr, &failed));
+  ASSERT_EQ(7, failed);
+
+  rings[7].prefixHash.data[0] ^= 1;
+  ASSERT_FALSE(check_ring_signatures(makeChecks(rings), nullptr, &failed));
+  ASSERT_EQ(12, failed);
+}
+
+TEST(CheckRingSignatures, rejectsMalformedSignature) {
+  std::vector<Ring> rings;
+  makeRings(10, 3, rings);
+  // scalars above the group order are rejected before the ring equations are computed
+  std::memset(rings[4].signatures[2].data + 32, 0xff, 32);
+
+  size_t failed = 0;
+  ASSERT_FALSE(check_ring_signature(rings[4].prefixHash, rings[4].image, rings[4].keyPointers, rings[4].signatures.data()));
+  ASSERT_FALSE(check_ring_signatures(makeChecks(rings), nullptr, &failed));
+  ASSERT_EQ(4, failed);
+}
+
+TEST(CheckRingSignatures, cacheKeepsRecentlyUsedKeys) {
+  std::vector<Ring> rings;
+  makeRings(10, 4, rings);
+  std::vector<ring_signature_check> checks = makeChecks(rings);
+
+  ring_key_cache cache(8);
+  ASSERT_TRUE(check_ring_signatures(checks, &cache));
+  ASSERT_EQ(8, cache.size());
+  // a second pass over the cached keys gives the same results
+  ASSERT_TRUE(check_ring_signatures(checks, &cache));
+
+  rings[9].signatures[0].data[0] ^= 1;
+  size_t failed = 0;
+  ASSERT_FALSE(check_ring_signatures(checks, &cache, &failed));
+  ASSERT_EQ(9, failed);
+
+  cache.clear();
+  ASSERT_EQ(0, cache.size());
+}
+
+}
@@ -0,0 +1,149 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "gtest/gtest.h"
+
+#include "Common/FileMappedHashMap.h"
+#include "crypto/hash.h"
+
+using namespace Common;
+
+namespace {
+
+const std::string TEST_FILE_NAME = "FileMappedHashMapTest.dat";
+
+typedef FileMappedHashMap<Crypto::Hash, uint32_t> TestMap;
+
+Crypto::Hash makeKey(uint32_t i) {
+  Crypto::Hash key;
+  Crypto::cn_fast_hash(&i, sizeof(i), key);
+  return key;
+}
+
+class FileMappedHashMapTest : public ::testing::Test {
+protected:
+  virtual void SetUp() override {
+    clean();
+  }
+
+  virtual void TearDown() override {
+    clean();
+  }
+
+  void clean() {
+    boost::filesystem::remove(TEST_FILE_NAME);
+    boost::filesystem::remove(TEST_FILE_NAME + ".bak");
+    boost::filesystem::remove(TEST_FILE_NAME + ".tmp");
+  }
+};
+
+TEST_F(FileMappedHashMapTest, insertFindErase) {
+  TestMap map;
+  map.open(TEST_FILE_NAME);
+  ASSERT_TRUE(map.empty());
+
+  ASSERT_TRUE(map.insert(makeKey(1), 10));
+  ASSERT_FALSE(map.insert(makeKey(1), 11));
+  ASSERT_TRUE(map.insert(makeKey(2), 20));
+
+  ASSERT_EQ(2, map.size());
+  ASSERT_EQ(10, map.at(makeKey(1)));
+  ASSERT_EQ(20, *map.find(makeKey(2)));
+  ASSERT_EQ(nullptr, map.find(makeKey(3)));
+
+  ASSERT_EQ(1, map.erase(makeKey(1)));
+  ASSERT_EQ(0, map.erase(makeKey(1)));
+  ASSERT_EQ(0, map.count(makeKey(1)));
+  ASSERT_EQ(1, map.count(makeKey(2)));
+  ASSERT_EQ(1, map.size());
+}
+
+TEST_F(FileMappedHashMapTest, growsAndKeepsEntries) {
+  TestMap map;
+  map.open(TEST_FILE_NAME);
+
+  const uint32_t count = static_cast<uint32_t>(TestMap::INITIAL_CAPACITY * 3);
+  for (uint32_t i = 0; i < count; ++i) {
+    ASSERT_TRUE(map.insert(makeKey(i), i));
+  }
+
+  ASSERT_EQ(count, map.size());
+  ASSERT_LT(map.size(), map.capacity());
+  for (uint32_t i = 0; i < count; ++i) {
+    ASSERT_EQ(i, map.at(makeKey(i)));
+  }
+}
+
+TEST_F(FileMappedHashMapTest, erasedSlotsAreReused) {
+  TestMap map;
+  map.open(TEST_FILE_NAME);
+
+  for (uint32_t round = 0; round < 10; ++round) {
+    for (uint32_t i = 0; i < TestMap::INITIAL_CAPACITY / 2; ++i) {
+      ASSERT_TRUE(map.insert(makeKey(i), round));
+    }
+
+    for (uint32_t i = 0; i < TestMap::INITIAL_CAPACITY / 2; ++i) {
+      ASSERT_EQ(1, map.erase(makeKey(i)));
+    }
+  }
+
+  ASSERT_TRUE(map.empty());
+  ASSERT_EQ(TestMap::INITIAL_CAPACITY, map.capacity());
+}
+
+TEST_F(FileMappedHashMapTest, reopenKeepsEntries) {
+  {
+    TestMap map;
+    map.open(TEST_FILE_NAME);
+    for (uint32_t i = 0; i < 2000; ++i) {
+      map.insert(makeKey(i), i);
+    }
+
+    map.erase(makeKey(7));
+    map.flush();
+  }
+
+  TestMap map;
+  map.open(TEST_FILE_NAME);
+  ASSERT_EQ(1999, map.size());
+  ASSERT_EQ(0, map.count(makeKey(7)));
+  ASSERT_EQ(1500, map.at(makeKey(1500)));
+}
+
+TEST_F(FileMappedHashMapTest, eraseIfRemovesMatchingEntries) {
+  TestMap map;
+  map.open(TEST_FILE_NAME);
+  for (uint32_t i = 0; i < 100; ++i) {
+    map.insert(makeKey(i), i);
+  }
+
+  ASSERT_EQ(40, map.eraseIf([](const Crypto::Hash&, uint32_t value) { return value >= 60; }));
+  ASSERT_EQ(60, map.size());
+  ASSERT_EQ(1, map.count(makeKey(59)));
+  ASSERT_EQ(0, map.count(makeKey(60)));
+
+  map.clear();
+  ASSERT_TRUE(map.empty());
+  ASSERT_EQ(0, map.count(makeKey(1)));
+}
+
+}
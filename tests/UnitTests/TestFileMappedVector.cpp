@@ -1025,6 +1025,80 @@ TEST_F(FileMappedVectorTest, resizeSuffixCanAddSuffixIfItDidNotExist) {
   ASSERT_LE(0, vec.capacity());
 }
 
+TEST_F(FileMappedVectorTest, appendSuffixAppendsDataToSuffix) {
+  createTestFileWithPrefixAndSuffix(TEST_FILE_NAME);
+
+  const std::string appendedData = "appended";
+  {
+    FileMappedVector<char> vec(TEST_FILE_NAME, FileMappedVectorOpenMode::OPEN, TEST_FILE_PREFIX.size());
+    vec.appendSuffix(reinterpret_cast<const uint8_t*>(appendedData.data()), appendedData.size());
+
+    ASSERT_EQ(TEST_FILE_SUFFIX.size() + appendedData.size(), vec.suffixSize());
+    ASSERT_EQ(TEST_FILE_SUFFIX + appendedData, std::string(vec.suffix(), vec.suffix() + vec.suffixSize()));
+    ASSERT_FALSE(boost::filesystem::exists(TEST_FILE_NAME_BAK));
+  }
+
+  FileMappedVector<char> vec(TEST_FILE_NAME, FileMappedVectorOpenMode::OPEN, TEST_FILE_PREFIX.size());
+  ASSERT_EQ(TEST_FILE_SUFFIX + appendedData, std::string(vec.suffix(), vec.suffix() + vec.suffixSize()));
+  ASSERT_EQ(TEST_VECTOR_SIZE, vec.size());
+  ASSERT_EQ(TEST_VECTOR_CAPACITY, vec.capacity());
+  ASSERT_EQ(TEST_VECTOR_DATA, std::string(vec.data(), vec.size()));
+  ASSERT_EQ(TEST_FILE_PREFIX, std::string(vec.prefix(), vec.prefix() + vec.prefixSize()));
+}
+
+TEST_F(FileMappedVectorTest, appendSuffixKeepsSuffixWhenVectorGrows) {
+  FileMappedVector<char> vec(TEST_FILE_NAME, FileMappedVectorOpenMode::CREATE, 0);
+  vec.appendSuffix(reinterpret_cast<const uint8_t*>(TEST_FILE_SUFFIX.data()), TEST_FILE_SUFFIX.size());
+  vec.appendSuffix(reinterpret_cast<const uint8_t*>(TEST_FILE_SUFFIX.data()), TEST_FILE_SUFFIX.size());
+
+  for (char c : TEST_VECTOR_DATA) {
+    vec.push_back(c);
+  }
+
+  ASSERT_EQ(TEST_VECTOR_DATA, std::string(vec.data(), vec.size()));
+  ASSERT_EQ(TEST_FILE_SUFFIX + TEST_FILE_SUFFIX, std::string(vec.suffix(), vec.suffix() + vec.suffixSize()));
+}
+
+TEST_F(FileMappedVectorTest, replaceMovesOtherFileInPlace) {
+  FileMappedVector<char> vec(TEST_FILE_NAME);
+  vec.push_back('a');
+
+  FileMappedVector<char> other(TEST_FILE_NAME_2, FileMappedVectorOpenMode::CREATE, TEST_FILE_PREFIX.size());
+  std::copy(TEST_FILE_PREFIX.begin(), TEST_FILE_PREFIX.end(), other.prefix());
+  other.insert(other.end(), TEST_VECTOR_DATA.begin(), TEST_VECTOR_DATA.end());
+  other.appendSuffix(reinterpret_cast<const uint8_t*>(TEST_FILE_SUFFIX.data()), TEST_FILE_SUFFIX.size());
+
+  vec.replace(other);
+
+  ASSERT_FALSE(other.isOpened());
+  ASSERT_FALSE(boost::filesystem::exists(TEST_FILE_NAME_2));
+  ASSERT_FALSE(boost::filesystem::exists(TEST_FILE_NAME_BAK));
+  ASSERT_EQ(TEST_VECTOR_DATA, std::string(vec.data(), vec.size()));
+
+  vec.close();
+  vec.open(TEST_FILE_NAME, FileMappedVectorOpenMode::OPEN, TEST_FILE_PREFIX.size());
+  ASSERT_EQ(TEST_FILE_PREFIX, std::string(vec.prefix(), vec.prefix() + vec.prefixSize()));
+  ASSERT_EQ(TEST_VECTOR_DATA, std::string(vec.data(), vec.size()));
+  ASSERT_EQ(TEST_FILE_SUFFIX, std::string(vec.suffix(), vec.suffix() + vec.suffixSize()));
+}
+
+TEST_F(FileMappedVectorTest, replaceFailureKeepsBothFiles) {
+  FileMappedVector<char> vec(TEST_FILE_NAME);
+  vec.push_back('a');
+
+  FileMappedVector<char> other(TEST_FILE_NAME_2);
+  other.push_back('b');
+
+  boost::filesystem::create_directory(TEST_FILE_NAME_BAK);
+  boost::filesystem::create_directory(boost::filesystem::path(TEST_FILE_NAME_BAK) / TEST_FILE_NAME);
+  ASSERT_ANY_THROW(vec.replace(other));
+
+  ASSERT_EQ(1, vec.size());
+  ASSERT_EQ('a', vec[0]);
+  ASSERT_TRUE(other.isOpened());
+  ASSERT_EQ('b', other[0]);
+}
+
 TEST_F(FileMappedVectorTest, atomicUpdateThrowsExceptionIfFailedToRemoveExistentBakFile) {
   FileMappedVector<char> vec(TEST_FILE_NAME);
   vec.push_back('a');
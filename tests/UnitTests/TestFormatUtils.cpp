@@ -200,3 +200,45 @@ TEST(validate_parse_amount_case, validate_parse_amount)
   r = currency.parseAmount("1 00.00 00", res);
   ASSERT_FALSE(r);
 }
+
+namespace {
+
+void checkPatchedNonce(CryptoNote::Block& block) {
+  block.nonce = 0x01020304;
+  CryptoNote::BinaryArray blob;
+  size_t nonceOffset;
+  ASSERT_TRUE(CryptoNote::get_block_longhash_blob(block, blob, nonceOffset));
+
+  block.nonce = 0xfffefdfc;
+  CryptoNote::BinaryArray expectedBlob;
+  ASSERT_TRUE(CryptoNote::get_block_longhash_blob(block, expectedBlob));
+
+  memcpy(blob.data() + nonceOffset, &block.nonce, sizeof(block.nonce));
+  ASSERT_EQ(expectedBlob, blob);
+}
+
+}
+
+TEST(get_block_longhash_blob, patches_nonce_of_block_v1)
+{
+  CryptoNote::Block block = AUTO_VAL_INIT(block);
+  block.majorVersion = CryptoNote::BLOCK_MAJOR_VERSION_1;
+  block.timestamp = 1500000000;
+  block.transactionHashes.resize(3);
+  checkPatchedNonce(block);
+}
+
+TEST(get_block_longhash_blob, patches_nonce_of_merge_mined_block)
+{
+  CryptoNote::Block block = AUTO_VAL_INIT(block);
+  block.majorVersion = CryptoNote::BLOCK_MAJOR_VERSION_2;
+  block.timestamp = 1500000000;
+  block.parentBlock.majorVersion = CryptoNote::BLOCK_MAJOR_VERSION_1;
+  block.parentBlock.transactionCount = 1;
+
+  CryptoNote::TransactionExtraMergeMiningTag mmTag;
+  mmTag.depth = 0;
+  ASSERT_TRUE(CryptoNote::get_aux_block_header_hash(block, mmTag.merkleRoot));
+  ASSERT_TRUE(CryptoNote::appendMergeMiningTagToExtra(block.parentBlock.baseTransaction.extra, mmTag));
+  checkPatchedNonce(block);
+}
@@ -0,0 +1,142 @@
+// Copyright (c) 2017-2018 Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <string>
+#include <system_error>
+
+#include <gtest/gtest.h>
+
+#include <HTTP/HttpParserErrorCodes.h>
+#include <HTTP/HttpRequestParser.h>
+
+using namespace CryptoNote;
+
+namespace {
+
+const std::string GET_INFO_REQUEST =
+  "POST /json_rpc HTTP/1.1\r\n"
+  "Host: 127.0.0.1\r\n"
+  "Content-Type:application/json\r\n"
+  "Content-Length: 14\r\n"
+  "\r\n"
+  "{\"id\":\"getin\"}";
+
+bool parse(HttpRequestParser& parser, const std::string& data) {
+  return parser.parse(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+std::error_code parseError(const std::string& data) {
+  HttpRequestParser parser(1024);
+  try {
+    parse(parser, data);
+  } catch (std::system_error& e) {
+    return e.code();
+  }
+
+  return std::error_code();
+}
+
+}
+
+TEST(HttpRequestParser, parsesCompleteRequest) {
+  HttpRequestParser parser;
+  ASSERT_TRUE(parse(parser, GET_INFO_REQUEST));
+
+  ASSERT_EQ(GET_INFO_REQUEST.size(), parser.getRequestSize());
+  ASSERT_EQ("POST", std::string(parser.getMethod()));
+  ASSERT_EQ("/json_rpc", std::string(parser.getUrl()));
+  ASSERT_EQ("{\"id\":\"getin\"}", std::string(parser.getBody()));
+  ASSERT_EQ(1, parser.getMinorVersion());
+  ASSERT_EQ(3, parser.getHeaders().size());
+  ASSERT_EQ("application/json", std::string(parser.getHeader("content-type")));
+  ASSERT_EQ("127.0.0.1", std::string(parser.getHeader("HOST")));
+  ASSERT_TRUE(parser.getHeader("authorization").isNil());
+  ASSERT_TRUE(parser.isKeepAlive());
+}
+
+TEST(HttpRequestParser, viewsPointIntoTheBuffer) {
+  HttpRequestParser parser;
+  ASSERT_TRUE(parse(parser, GET_INFO_REQUEST));
+
+  ASSERT_EQ(GET_INFO_REQUEST.data(), parser.getMethod().getData());
+  ASSERT_EQ(GET_INFO_REQUEST.data() + GET_INFO_REQUEST.size() - 14, parser.getBody().getData());
+}
+
+TEST(HttpRequestParser, waitsForEveryByte) {
+  HttpRequestParser parser;
+  for (size_t size = 0; size < GET_INFO_REQUEST.size(); ++size) {
+    ASSERT_FALSE(parse(parser, GET_INFO_REQUEST.substr(0, size))) << size;
+  }
+
+  ASSERT_TRUE(parse(parser, GET_INFO_REQUEST));
+  ASSERT_EQ("{\"id\":\"getin\"}", std::string(parser.getBody()));
+}
+
+TEST(HttpRequestParser, parsesPipelinedRequests) {
+  std::string data = GET_INFO_REQUEST + "GET /getheight HTTP/1.1\r\nConnection: close\r\n\r\n";
+  HttpRequestParser parser;
+  ASSERT_TRUE(parse(parser, data));
+  size_t first = parser.getRequestSize();
+  ASSERT_EQ(GET_INFO_REQUEST.size(), first);
+
+  parser.reset();
+  std::string second = data.substr(first);
+  ASSERT_TRUE(parse(parser, second));
+  ASSERT_EQ("GET", std::string(parser.getMethod()));
+  ASSERT_EQ("/getheight", std::string(parser.getUrl()));
+  ASSERT_TRUE(parser.getBody().isEmpty());
+  ASSERT_EQ(second.size(), parser.getRequestSize());
+  ASSERT_FALSE(parser.isKeepAlive());
+}
+
+TEST(HttpRequestParser, http10ClosesUnlessKeepAliveIsAsked) {
+  HttpRequestParser parser;
+  ASSERT_TRUE(parse(parser, "GET / HTTP/1.0\r\n\r\n"));
+  ASSERT_EQ(0, parser.getMinorVersion());
+  ASSERT_FALSE(parser.isKeepAlive());
+
+  parser.reset();
+  ASSERT_TRUE(parse(parser, "GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n"));
+  ASSERT_TRUE(parser.isKeepAlive());
+}
+
+TEST(HttpRequestParser, fillsRequest) {
+  HttpRequestParser parser;
+  ASSERT_TRUE(parse(parser, GET_INFO_REQUEST));
+
+  HttpRequest request;
+  parser.fillRequest(request);
+  ASSERT_EQ("POST", request.getMethod());
+  ASSERT_EQ("/json_rpc", request.getUrl());
+  ASSERT_EQ("{\"id\":\"getin\"}", request.getBody());
+  ASSERT_TRUE(request.getHeaders().empty());
+}
+
+TEST(HttpRequestParser, rejectsMalformedRequests) {
+  ASSERT_EQ(make_error_code(error::UNEXPECTED_SYMBOL), parseError("POST /json_rpc\r\n\r\n"));
+  ASSERT_EQ(make_error_code(error::UNEXPECTED_SYMBOL), parseError("POST /json_rpc HTTP/2.0\r\n\r\n"));
+  ASSERT_EQ(make_error_code(error::UNEXPECTED_SYMBOL), parseError("GET / HTTP/1.1\r\nHost 127.0.0.1\r\n\r\n"));
+  ASSERT_EQ(make_error_code(error::EMPTY_HEADER), parseError("GET / HTTP/1.1\r\n: value\r\n\r\n"));
+  ASSERT_EQ(make_error_code(error::UNEXPECTED_SYMBOL), parseError("POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n"));
+  ASSERT_EQ(make_error_code(error::UNEXPECTED_SYMBOL), parseError("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"));
+}
+
+TEST(HttpRequestParser, rejectsOversizedRequests) {
+  ASSERT_EQ(make_error_code(error::BODY_TOO_LARGE), parseError("POST / HTTP/1.1\r\nContent-Length: 1025\r\n\r\n"));
+  ASSERT_EQ(make_error_code(error::HEADERS_TOO_LARGE),
+    parseError("GET / HTTP/1.1\r\nX: " + std::string(HttpRequestParser::MAX_HEAD_SIZE, 'x')));
+}
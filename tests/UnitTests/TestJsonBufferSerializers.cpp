@@ -0,0 +1,193 @@
+// Copyright (c) 2017-2018 Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <limits>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "Common/JsonValue.h"
+#include "Common/StringTools.h"
+#include "Rpc/CoreRpcServerCommandsDefinitions.h"
+#include "Serialization/JsonInputBufferSerializer.h"
+#include "Serialization/JsonOutputBufferSerializer.h"
+#include "Serialization/SerializationTools.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+struct NumberStruct {
+  uint8_t u8;
+  int16_t i16;
+  uint32_t u32;
+  int64_t i64;
+  uint64_t u64;
+  double real;
+  bool flag;
+
+  void serialize(ISerializer& s) {
+    KV_MEMBER(u8)
+    KV_MEMBER(i16)
+    KV_MEMBER(u32)
+    KV_MEMBER(i64)
+    KV_MEMBER(u64)
+    KV_MEMBER(real)
+    KV_MEMBER(flag)
+  }
+};
+
+F_COMMAND_RPC_GET_BLOCK_DETAILS::response makeBlockDetails(size_t transactionCount) {
+  F_COMMAND_RPC_GET_BLOCK_DETAILS::response response;
+  f_block_details_response& block = response.block;
+  block.major_version = 4;
+  block.minor_version = 0;
+  block.timestamp = 1520000000;
+  block.prev_hash = std::string(64, 'a');
+  block.nonce = 3141592653;
+  block.orphan_status = false;
+  block.height = 123456;
+  block.depth = 7;
+  block.hash = std::string(64, 'b');
+  block.difficulty = 98765432;
+  block.cumulativeDifficulty = 123456789012345;
+  block.reward = 14500000000000;
+  block.blockSize = 5120;
+  block.sizeMedian = 20000;
+  block.effectiveSizeMedian = 100000;
+  block.transactionsCumulativeSize = 4800;
+  block.alreadyGeneratedCoins = "9876543210000000";
+  block.alreadyGeneratedTransactions = 654321;
+  block.baseReward = 14400000000000;
+  block.penalty = 0.125;
+  block.totalFeeAmount = 100000000000;
+  for (size_t i = 0; i < transactionCount; ++i) {
+    f_transaction_short_response transaction;
+    transaction.hash = std::string(64, static_cast<char>('0' + i % 10));
+    transaction.fee = 1000000000 * i;
+    transaction.amount_out = 123456789 * (i + 1);
+    transaction.size = 400 + i;
+    block.transactions.push_back(transaction);
+  }
+
+  response.status = CORE_RPC_STATUS_OK;
+  return response;
+}
+
+// JsonValue prints members sorted, reparsing the streamed text makes both outputs comparable
+template <typename T>
+void assertSameAsJsonValue(T& value) {
+  std::string streamed = storeToJson(value);
+  std::string printed = storeToJsonValue(value).toString();
+  ASSERT_EQ(printed, Common::JsonValue::fromString(streamed).toString());
+}
+
+}
+
+TEST(JsonOutputBufferSerializer, writesWhatJsonValuePrints) {
+  F_COMMAND_RPC_GET_BLOCK_DETAILS::response response = makeBlockDetails(5);
+  assertSameAsJsonValue(response);
+
+  F_COMMAND_RPC_GET_BLOCK_DETAILS::response empty = makeBlockDetails(0);
+  assertSameAsJsonValue(empty);
+
+  NumberStruct numbers{255, -32768, 4294967295, std::numeric_limits<int64_t>::min(), 12345678901234567890ull, -1.5, true};
+  assertSameAsJsonValue(numbers);
+}
+
+TEST(JsonOutputBufferSerializer, writesIntegersAndBinary) {
+  NumberStruct numbers{0, -1, 10, -9223372036854775807ll, 0, 2.0, false};
+  ASSERT_EQ("{\"u8\":0,\"i16\":-1,\"u32\":10,\"i64\":-9223372036854775807,\"u64\":0,\"real\":2.0,\"flag\":false}", storeToJson(numbers));
+
+  JsonOutputBufferSerializer s;
+  Crypto::Hash hash;
+  for (size_t i = 0; i < sizeof(hash.data); ++i) {
+    hash.data[i] = static_cast<uint8_t>(i * 9);
+  }
+
+  s.binary(hash.data, sizeof(hash.data), "hash");
+  ASSERT_EQ("{\"hash\":\"" + Common::podToHex(hash) + "\"}", s.getJson());
+}
+
+TEST(JsonInputBufferSerializer, readsWhatOutputWrites) {
+  F_COMMAND_RPC_GET_BLOCK_DETAILS::response response = makeBlockDetails(5);
+  std::string json = storeToJson(response);
+
+  F_COMMAND_RPC_GET_BLOCK_DETAILS::response loaded;
+  ASSERT_TRUE(loadFromJson(loaded, json));
+  ASSERT_EQ(json, storeToJson(loaded));
+
+  NumberStruct numbers{255, -32768, 4294967295, std::numeric_limits<int64_t>::min(), 12345678901234567890ull, -1.5, true};
+  NumberStruct loadedNumbers;
+  ASSERT_TRUE(loadFromJson(loadedNumbers, storeToJson(numbers)));
+  ASSERT_EQ(numbers.i16, loadedNumbers.i16);
+  ASSERT_EQ(numbers.u32, loadedNumbers.u32);
+  ASSERT_EQ(numbers.i64, loadedNumbers.i64);
+  ASSERT_EQ(numbers.u64, loadedNumbers.u64);
+  ASSERT_EQ(numbers.real, loadedNumbers.real);
+  ASSERT_EQ(numbers.flag, loadedNumbers.flag);
+}
+
+TEST(JsonInputBufferSerializer, readsLikeJsonValue) {
+  JsonInputBufferSerializer s(" { \"a\" : [ 1 , { \"b\" : \"x\\\"y\" } ] , \"c\" : 2 , \"c\" : 3e2 , \"d\" : null } ");
+
+  size_t size;
+  ASSERT_TRUE(s.beginArray(size, "a"));
+  ASSERT_EQ(2, size);
+  uint64_t number;
+  ASSERT_TRUE(s(number, ""));
+  ASSERT_EQ(1, number);
+  ASSERT_TRUE(s.beginObject(""));
+  std::string text;
+  ASSERT_TRUE(s(text, "b"));
+  ASSERT_EQ("x\\\"y", text);
+  ASSERT_FALSE(s(text, "missing"));
+  s.endObject();
+  s.endArray();
+
+  double real;
+  ASSERT_TRUE(s(real, "c"));
+  ASSERT_EQ(300.0, real);
+  ASSERT_ANY_THROW(s(number, "c"));
+
+  ASSERT_TRUE(s.getRawValue("d", text));
+  ASSERT_EQ("null", text);
+  ASSERT_ANY_THROW(s(text, "d"));
+}
+
+TEST(JsonInputBufferSerializer, rejectsBadText) {
+  const char* patterns[] = {
+    "",
+    "100",
+    "[]",
+    "{",
+    "{\"a\":}",
+    "{\"a\" 1}",
+    "{a:1}",
+    "{\"a\":1,}",
+    "{\"a\":01}",
+    "{\"a\":1..2}",
+    "{\"a\":\"}",
+    "{\"a\":tru}",
+  };
+
+  for (const char* pattern : patterns) {
+    ASSERT_ANY_THROW(JsonInputBufferSerializer s(pattern)) << pattern;
+  }
+
+  ASSERT_ANY_THROW(JsonInputBufferSerializer s("{\"a\":" + std::string(1000, '[') + std::string(1000, ']') + "}"));
+}
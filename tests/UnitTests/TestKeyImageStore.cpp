@@ -0,0 +1,193 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "gtest/gtest.h"
+
+#include "CryptoNoteCore/KeyImageStore.h"
+#include "crypto/hash.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const std::string TEST_FILE_NAME = "KeyImageStoreTest.dat";
+
+Crypto::KeyImage makeImage(uint32_t i) {
+  Crypto::Hash hash;
+  Crypto::cn_fast_hash(&i, sizeof(i), hash);
+  Crypto::KeyImage image;
+  static_assert(sizeof(image) == sizeof(hash), "Unexpected key image size");
+  std::memcpy(&image, &hash, sizeof(image));
+  return image;
+}
+
+class KeyImageStoreTest : public ::testing::Test {
+protected:
+  virtual void SetUp() override {
+    removeFiles();
+  }
+
+  virtual void TearDown() override {
+    removeFiles();
+  }
+
+  void removeFiles() {
+    boost::filesystem::remove(TEST_FILE_NAME);
+    boost::filesystem::remove(TEST_FILE_NAME + ".buckets");
+    boost::filesystem::remove(TEST_FILE_NAME + ".bloom");
+  }
+};
+
+TEST_F(KeyImageStoreTest, insertContainsErase) {
+  KeyImageStore store;
+  store.open(TEST_FILE_NAME);
+
+  ASSERT_TRUE(store.insert(makeImage(1)));
+  ASSERT_FALSE(store.insert(makeImage(1)));
+  ASSERT_TRUE(store.insert(makeImage(2)));
+  ASSERT_TRUE(store.insert(makeImage(3)));
+
+  ASSERT_TRUE(store.contains(makeImage(1)));
+  ASSERT_FALSE(store.contains(makeImage(4)));
+
+  ASSERT_TRUE(store.erase(makeImage(1)));
+  ASSERT_FALSE(store.erase(makeImage(1)));
+  ASSERT_FALSE(store.contains(makeImage(1)));
+  ASSERT_TRUE(store.contains(makeImage(2)));
+  ASSERT_TRUE(store.contains(makeImage(3)));
+  ASSERT_EQ(2, store.size());
+
+  ASSERT_TRUE(store.insert(makeImage(1)));
+  ASSERT_TRUE(store.contains(makeImage(1)));
+}
+
+TEST_F(KeyImageStoreTest, growsAndKeepsImages) {
+  KeyImageStore store;
+  store.open(TEST_FILE_NAME);
+
+  for (uint32_t i = 0; i < 20000; ++i) {
+    ASSERT_TRUE(store.insert(makeImage(i)));
+  }
+
+  for (uint32_t i = 0; i < 20000; ++i) {
+    ASSERT_TRUE(store.contains(makeImage(i)));
+  }
+
+  for (uint32_t i = 20000; i < 21000; ++i) {
+    ASSERT_FALSE(store.contains(makeImage(i)));
+  }
+}
+
+TEST_F(KeyImageStoreTest, batchLookupMatchesSingleLookups) {
+  KeyImageStore store;
+  store.open(TEST_FILE_NAME);
+  for (uint32_t i = 0; i < 1000; i += 2) {
+    store.insert(makeImage(i));
+  }
+
+  std::vector<Crypto::KeyImage> images;
+  for (uint32_t i = 0; i < 100; ++i) {
+    images.push_back(makeImage(i));
+  }
+
+  std::vector<bool> found;
+  ASSERT_EQ(50, store.contains(images, found));
+  ASSERT_EQ(images.size(), found.size());
+  for (uint32_t i = 0; i < 100; ++i) {
+    ASSERT_EQ(i % 2 == 0, found[i]);
+  }
+}
+
+TEST_F(KeyImageStoreTest, reopenAndTruncate) {
+  {
+    KeyImageStore store;
+    store.open(TEST_FILE_NAME);
+    for (uint32_t i = 0; i < 3000; ++i) {
+      store.insert(makeImage(i));
+    }
+
+    store.flush();
+  }
+
+  KeyImageStore store;
+  store.open(TEST_FILE_NAME);
+  ASSERT_EQ(3000, store.size());
+  ASSERT_TRUE(store.contains(makeImage(2999)));
+
+  store.truncate(1000);
+  ASSERT_EQ(1000, store.size());
+  ASSERT_TRUE(store.contains(makeImage(999)));
+  ASSERT_FALSE(store.contains(makeImage(1000)));
+
+  store.clear();
+  ASSERT_EQ(0, store.size());
+  ASSERT_FALSE(store.contains(makeImage(0)));
+}
+
+TEST_F(KeyImageStoreTest, reopenUsesFlushedIndex) {
+  {
+    KeyImageStore store;
+    store.open(TEST_FILE_NAME);
+    for (uint32_t i = 0; i < 3000; ++i) {
+      store.insert(makeImage(i));
+    }
+
+    for (uint32_t i = 0; i < 3000; i += 3) {
+      store.erase(makeImage(i));
+    }
+
+    store.flush();
+    store.close();
+  }
+
+  KeyImageStore store;
+  store.open(TEST_FILE_NAME);
+  ASSERT_EQ(2000, store.size());
+  for (uint32_t i = 0; i < 3000; ++i) {
+    ASSERT_EQ(i % 3 != 0, store.contains(makeImage(i)));
+  }
+
+  ASSERT_TRUE(store.insert(makeImage(0)));
+  ASSERT_FALSE(store.insert(makeImage(1)));
+}
+
+TEST_F(KeyImageStoreTest, missingIndexIsRebuilt) {
+  {
+    KeyImageStore store;
+    store.open(TEST_FILE_NAME);
+    for (uint32_t i = 0; i < 1000; ++i) {
+      store.insert(makeImage(i));
+    }
+
+    store.flush();
+    store.close();
+  }
+
+  boost::filesystem::remove(TEST_FILE_NAME + ".buckets");
+
+  KeyImageStore store;
+  store.open(TEST_FILE_NAME);
+  ASSERT_EQ(1000, store.size());
+  ASSERT_TRUE(store.contains(makeImage(999)));
+  ASSERT_FALSE(store.contains(makeImage(1000)));
+}
+
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2017-2018 Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+
+#include <System/ContextGroup.h>
+#include <System/Dispatcher.h>
+#include <System/Ipv4Address.h>
+#include <System/TcpConnection.h>
+#include <System/TcpConnector.h>
+#include <System/TcpListener.h>
+
+#include "P2p/LevinProtocol.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const System::Ipv4Address LISTEN_ADDRESS("127.0.0.1");
+const uint16_t LISTEN_PORT = 6667;
+
+BinaryArray makeBody(size_t size, uint8_t seed) {
+  BinaryArray body(size);
+  for (size_t i = 0; i < size; ++i) {
+    body[i] = static_cast<uint8_t>(seed + i);
+  }
+
+  return body;
+}
+
+}
+
+class LevinProtocolTest : public testing::Test {
+public:
+  LevinProtocolTest() : listener(dispatcher, LISTEN_ADDRESS, LISTEN_PORT), contextGroup(dispatcher) {
+  }
+
+  void connect() {
+    writer = System::TcpConnector(dispatcher).connect(LISTEN_ADDRESS, LISTEN_PORT);
+    reader = listener.accept();
+  }
+
+protected:
+  System::Dispatcher dispatcher;
+  System::TcpListener listener;
+  System::TcpConnection writer;
+  System::TcpConnection reader;
+  System::ContextGroup contextGroup;
+};
+
+TEST_F(LevinProtocolTest, queuedFramesAreReadBackInOrder) {
+  connect();
+
+  std::vector<BinaryArray> bodies = { makeBody(10, 1), BinaryArray(), makeBody(300 * 1024, 2), makeBody(1, 3) };
+  contextGroup.spawn([&] {
+    LevinProtocol proto(writer);
+    proto.queueMessage(1, bodies[0], false);
+    proto.queueMessage(2, bodies[1], true);
+    proto.queueReply(3, bodies[2], 7);
+    proto.queueMessage(4, bodies[3], false);
+    proto.flush();
+    writer = System::TcpConnection();
+  });
+
+  std::vector<LevinProtocol::Command> commands;
+  contextGroup.spawn([&] {
+    // protocols sharing the read buffer see the same stream, as short lived ones do on a peer connection
+    LevinProtocol::ReadBuffer readBuffer;
+    LevinProtocol::Command cmd;
+    while (LevinProtocol(reader, &readBuffer).readCommand(cmd)) {
+      commands.push_back(cmd);
+    }
+  });
+
+  contextGroup.wait();
+
+  ASSERT_EQ(4, commands.size());
+  for (size_t i = 0; i < commands.size(); ++i) {
+    ASSERT_EQ(i + 1, commands[i].command);
+    ASSERT_EQ(bodies[i], commands[i].buf);
+  }
+
+  ASSERT_TRUE(commands[0].isNotify);
+  ASSERT_TRUE(commands[1].needReply());
+  ASSERT_TRUE(commands[2].isResponse);
+}
@@ -0,0 +1,216 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <fstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "gtest/gtest.h"
+
+#include "CryptoNoteCore/MappedBlockStore.h"
+#include "Serialization/ISerializer.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const std::string TEST_STORE_FILE_NAME = "MappedBlockStoreTest.dat";
+const std::string TEST_INDEX_FILE_NAME = "MappedBlockStoreTestIndex.dat";
+
+struct TestItem {
+  uint64_t value;
+  std::string payload;
+
+  void serialize(ISerializer& s) {
+    s(value, "value");
+    s(payload, "payload");
+  }
+};
+
+struct TestHeader {
+  uint64_t value;
+  uint32_t payloadSize;
+};
+
+typedef MappedBlockStore<TestItem, TestHeader> TestStore;
+
+class MappedBlockStoreTest : public ::testing::Test {
+protected:
+  virtual void SetUp() override {
+    clean();
+  }
+
+  virtual void TearDown() override {
+    clean();
+  }
+
+  void clean() {
+    for (size_t segment = 0; segment < 4; ++segment) {
+      boost::filesystem::remove(TEST_STORE_FILE_NAME + "." + std::to_string(segment));
+    }
+
+    boost::filesystem::remove(TEST_INDEX_FILE_NAME);
+  }
+
+  void push(TestStore& store, uint64_t value, size_t payloadSize = 16) {
+    TestItem item = { value, std::string(payloadSize, static_cast<char>('a' + value % 26)) };
+    TestHeader header = { value, static_cast<uint32_t>(payloadSize) };
+    store.push_back(item, header);
+  }
+};
+
+TEST_F(MappedBlockStoreTest, itemsAndHeadersAreReadBack) {
+  TestStore store;
+  ASSERT_TRUE(store.open(TEST_STORE_FILE_NAME, TEST_INDEX_FILE_NAME));
+  ASSERT_TRUE(store.empty());
+
+  for (uint64_t i = 0; i < 10; ++i) {
+    push(store, i);
+  }
+
+  ASSERT_EQ(10, store.size());
+  for (uint64_t i = 0; i < 10; ++i) {
+    ASSERT_EQ(i, store[i].value);
+    ASSERT_EQ(std::string(16, static_cast<char>('a' + i)), store[i].payload);
+    ASSERT_EQ(i, store.header(i).value);
+  }
+
+  ASSERT_EQ(9, store.backHeader().value);
+  ASSERT_EQ(9, store.back().value);
+}
+
+TEST_F(MappedBlockStoreTest, reopenKeepsItems) {
+  {
+    TestStore store;
+    ASSERT_TRUE(store.open(TEST_STORE_FILE_NAME, TEST_INDEX_FILE_NAME));
+    for (uint64_t i = 0; i < 5; ++i) {
+      push(store, i);
+    }
+
+    store.flush();
+  }
+
+  TestStore store;
+  ASSERT_TRUE(store.open(TEST_STORE_FILE_NAME, TEST_INDEX_FILE_NAME));
+  ASSERT_EQ(5, store.size());
+  for (uint64_t i = 0; i < 5; ++i) {
+    ASSERT_EQ(i, store[i].value);
+    ASSERT_EQ(i, store.header(i).value);
+  }
+}
+
+TEST_F(MappedBlockStoreTest, itemsWrittenAfterFlushAreVerifiedOnOpen) {
+  uint64_t tornOffset = 0;
+  {
+    TestStore store;
+    ASSERT_TRUE(store.open(TEST_STORE_FILE_NAME, TEST_INDEX_FILE_NAME));
+    for (uint64_t i = 0; i < 2; ++i) {
+      push(store, i);
+    }
+
+    store.flush();
+    push(store, 2);
+    push(store, 3);
+
+    size_t size;
+    tornOffset = store.rawItem(3, size) - store.rawItem(0, size);
+  }
+
+  {
+    TestStore store;
+    ASSERT_TRUE(store.open(TEST_STORE_FILE_NAME, TEST_INDEX_FILE_NAME));
+    ASSERT_EQ(4, store.size());
+  }
+
+  {
+    // the data of the last item did not reach the disk
+    std::fstream segment(TEST_STORE_FILE_NAME + ".0", std::ios::in | std::ios::out | std::ios::binary);
+    segment.seekp(tornOffset);
+    segment.put(0);
+  }
+
+  TestStore store;
+  ASSERT_TRUE(store.open(TEST_STORE_FILE_NAME, TEST_INDEX_FILE_NAME));
+  ASSERT_EQ(3, store.size());
+  ASSERT_EQ(2, store[2].value);
+}
+
+TEST_F(MappedBlockStoreTest, popBackAllowsOverwrite) {
+  TestStore store;
+  ASSERT_TRUE(store.open(TEST_STORE_FILE_NAME, TEST_INDEX_FILE_NAME));
+  for (uint64_t i = 0; i < 3; ++i) {
+    push(store, i);
+  }
+
+  store.pop_back();
+  store.pop_back();
+  ASSERT_EQ(1, store.size());
+
+  push(store, 7, 100);
+  ASSERT_EQ(2, store.size());
+  ASSERT_EQ(0, store[0].value);
+  ASSERT_EQ(7, store[1].value);
+  ASSERT_EQ(100, store[1].payload.size());
+  ASSERT_EQ(100, store.backHeader().payloadSize);
+}
+
+TEST_F(MappedBlockStoreTest, itemLargerThanSegmentStartsNewSegment) {
+  TestStore store;
+  ASSERT_TRUE(store.open(TEST_STORE_FILE_NAME, TEST_INDEX_FILE_NAME));
+  push(store, 1);
+  push(store, 2, static_cast<size_t>(TestStore::SEGMENT_SIZE));
+  push(store, 3);
+
+  ASSERT_EQ(3, store.size());
+  ASSERT_EQ(1, store[0].value);
+  ASSERT_EQ(TestStore::SEGMENT_SIZE, store[1].payload.size());
+  ASSERT_EQ(3, store[2].value);
+  ASSERT_TRUE(boost::filesystem::exists(TEST_STORE_FILE_NAME + ".1"));
+}
+
+TEST_F(MappedBlockStoreTest, iteratorsVisitAllItems) {
+  TestStore store;
+  ASSERT_TRUE(store.open(TEST_STORE_FILE_NAME, TEST_INDEX_FILE_NAME));
+  for (uint64_t i = 0; i < 6; ++i) {
+    push(store, i);
+  }
+
+  uint64_t expected = 0;
+  for (auto it = store.begin(); it != store.end(); ++it) {
+    ASSERT_EQ(expected++, it->value);
+  }
+
+  ASSERT_EQ(6, expected);
+}
+
+TEST_F(MappedBlockStoreTest, rawItemIsSerializedItem) {
+  TestStore store;
+  ASSERT_TRUE(store.open(TEST_STORE_FILE_NAME, TEST_INDEX_FILE_NAME));
+  for (uint64_t i = 0; i < 3; ++i) {
+    push(store, i, 10 + i);
+  }
+
+  size_t size;
+  const uint8_t* data = store.rawItem(1, size);
+  ASSERT_EQ(2 + 11, size); // varint value, varint payload size and the payload
+  ASSERT_EQ(1, data[0]);
+  ASSERT_EQ(11, data[1]);
+  ASSERT_EQ(std::string(11, 'b'), std::string(reinterpret_cast<const char*>(data) + 2, 11));
+}
+
+}
@@ -0,0 +1,140 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "CryptoNoteCore/TransactionApi.h"
+#include "Transfers/OutputScanner.h"
+
+#include "TransactionApiHelpers.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+AccountKeys accountKeysWithViewKey(const AccountKeys& keys) {
+  KeyPair viewKeys;
+  viewKeys.publicKey = keys.address.viewPublicKey;
+  viewKeys.secretKey = keys.viewSecretKey;
+  KeyPair spendKeys;
+  Crypto::generate_keys(spendKeys.publicKey, spendKeys.secretKey);
+  return accountKeysFromKeypairs(viewKeys, spendKeys);
+}
+
+class OutputScannerTest : public ::testing::Test {
+public:
+  OutputScannerTest() :
+    m_account(generateAccountKeys()),
+    m_secondAccount(accountKeysWithViewKey(m_account)),
+    m_scanner(m_account.viewSecretKey) {
+    m_scanner.addSpendKey(m_account.address.spendPublicKey);
+    m_scanner.addSpendKey(m_secondAccount.address.spendPublicKey);
+  }
+
+protected:
+  AccountKeys m_account;
+  AccountKeys m_secondAccount;
+  OutputScanner m_scanner;
+};
+
+TEST_F(OutputScannerTest, findsOutputsOfAllSpendKeys) {
+  std::unique_ptr<ITransaction> tx = createTransaction();
+  tx->addOutput(100, generateAddress());
+  tx->addOutput(200, m_account.address);
+  tx->addOutput(300, m_secondAccount.address);
+  tx->addOutput(400, m_account.address);
+
+  OutputScanner::Outputs outputs;
+  m_scanner.scan(*tx, outputs);
+
+  ASSERT_EQ(2, outputs.size());
+  ASSERT_EQ(std::vector<uint32_t>({ 1, 3 }), outputs[m_account.address.spendPublicKey]);
+  ASSERT_EQ(std::vector<uint32_t>({ 2 }), outputs[m_secondAccount.address.spendPublicKey]);
+}
+
+TEST_F(OutputScannerTest, batchScanMatchesSingleScans) {
+  std::vector<std::unique_ptr<ITransaction>> transactions;
+  std::vector<const ITransactionReader*> readers;
+  for (size_t i = 0; i < 20; ++i) {
+    transactions.push_back(createTransaction());
+    transactions.back()->addOutput(100, generateAddress());
+    if (i % 3 == 0) {
+      transactions.back()->addOutput(100, m_account.address);
+    }
+    if (i % 4 == 0) {
+      transactions.back()->addOutput(100, m_secondAccount.address);
+    }
+    readers.push_back(transactions.back().get());
+  }
+
+  std::vector<OutputScanner::Outputs> outputs;
+  m_scanner.scan(readers.data(), readers.size(), outputs);
+  ASSERT_EQ(readers.size(), outputs.size());
+
+  for (size_t i = 0; i < readers.size(); ++i) {
+    OutputScanner::Outputs single;
+    m_scanner.scan(*readers[i], single);
+    ASSERT_EQ(single, outputs[i]);
+    ASSERT_EQ(i % 3 == 0, outputs[i].count(m_account.address.spendPublicKey) != 0);
+    ASSERT_EQ(i % 4 == 0, outputs[i].count(m_secondAccount.address.spendPublicKey) != 0);
+  }
+}
+
+TEST_F(OutputScannerTest, removedSpendKeyIsNotMatched) {
+  std::unique_ptr<ITransaction> tx = createTransaction();
+  tx->addOutput(100, m_account.address);
+  tx->addOutput(100, m_secondAccount.address);
+
+  m_scanner.removeSpendKey(m_account.address.spendPublicKey);
+  ASSERT_FALSE(m_scanner.hasSpendKey(m_account.address.spendPublicKey));
+  ASSERT_TRUE(m_scanner.hasSpendKey(m_secondAccount.address.spendPublicKey));
+  ASSERT_EQ(1, m_scanner.spendKeyCount());
+
+  OutputScanner::Outputs outputs;
+  m_scanner.scan(*tx, outputs);
+  ASSERT_EQ(1, outputs.size());
+  ASSERT_EQ(std::vector<uint32_t>({ 1 }), outputs[m_secondAccount.address.spendPublicKey]);
+}
+
+TEST(OutputScanner, keepsManySpendKeys) {
+  AccountKeys account = generateAccountKeys();
+  OutputScanner scanner(account.viewSecretKey);
+  std::vector<Crypto::PublicKey> keys;
+  for (size_t i = 0; i < 1000; ++i) {
+    Crypto::SecretKey secretKey;
+    keys.emplace_back();
+    Crypto::generate_keys(keys.back(), secretKey);
+    scanner.addSpendKey(keys.back());
+  }
+
+  ASSERT_EQ(1000, scanner.spendKeyCount());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (i % 2 == 0) {
+      scanner.removeSpendKey(keys[i]);
+    }
+  }
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(i % 2 != 0, scanner.hasSpendKey(keys[i]));
+  }
+  ASSERT_FALSE(scanner.hasSpendKey(account.address.spendPublicKey));
+}
+
+}
@@ -0,0 +1,174 @@
+// Copyright (c) 2017-2018 The Balkancoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstring>
+#include <set>
+
+#include <boost/filesystem.hpp>
+
+#include "gtest/gtest.h"
+
+#include "CryptoNoteCore/RandomOutputsIndex.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const uint64_t AMOUNT = 1000;
+const std::string JOURNAL_FILE_NAME = "RandomOutputsIndexTest.outputs";
+const std::string POSITIONS_FILE_NAME = "RandomOutputsIndexTest.positions";
+
+RandomOutputsIndex::Output makeOutput(uint32_t height, uint64_t unlockTime = 0, uint64_t amount = AMOUNT) {
+  RandomOutputsIndex::Output output;
+  std::memset(&output, 0, sizeof(output));
+  std::memcpy(&output.key, &height, sizeof(height));
+  output.amount = amount;
+  output.unlockTime = unlockTime;
+  output.height = height;
+  return output;
+}
+
+class RandomOutputsIndexTest : public ::testing::Test {
+protected:
+  virtual void SetUp() override {
+    removeFiles();
+    index.open(JOURNAL_FILE_NAME, POSITIONS_FILE_NAME);
+  }
+
+  virtual void TearDown() override {
+    index.close();
+    removeFiles();
+  }
+
+  void removeFiles() {
+    boost::filesystem::remove(JOURNAL_FILE_NAME);
+    boost::filesystem::remove(POSITIONS_FILE_NAME);
+  }
+
+  RandomOutputsIndex index;
+};
+
+bool alwaysUnlocked(uint64_t) {
+  return true;
+}
+
+TEST_F(RandomOutputsIndexTest, unknownAmount) {
+  std::vector<std::pair<uint32_t, Crypto::PublicKey>> outputs;
+  ASSERT_FALSE(index.select(AMOUNT, 10, 100, alwaysUnlocked, outputs));
+  ASSERT_TRUE(outputs.empty());
+}
+
+TEST_F(RandomOutputsIndexTest, returnsAllOutputsBelowHeightLimitWhenFew) {
+  for (uint32_t height = 0; height < 10; ++height) {
+    index.push(makeOutput(height, height == 3 ? 1 : 0));
+  }
+
+  std::vector<std::pair<uint32_t, Crypto::PublicKey>> outputs;
+  ASSERT_TRUE(index.select(AMOUNT, 10, 8, [](uint64_t unlockTime) { return unlockTime == 0; }, outputs));
+  ASSERT_EQ(7, outputs.size());
+  for (const auto& output : outputs) {
+    ASSERT_LT(output.first, 8);
+    ASSERT_NE(3, output.first);
+    ASSERT_EQ(0, std::memcmp(&output.first, &output.second, sizeof(output.first)));
+  }
+}
+
+TEST_F(RandomOutputsIndexTest, selectsDistinctOutputs) {
+  for (uint32_t height = 0; height < 1000; ++height) {
+    index.push(makeOutput(height));
+  }
+
+  std::vector<std::pair<uint32_t, Crypto::PublicKey>> outputs;
+  ASSERT_TRUE(index.select(AMOUNT, 20, 990, alwaysUnlocked, outputs));
+  ASSERT_EQ(20, outputs.size());
+
+  std::set<uint32_t> indexes;
+  for (const auto& output : outputs) {
+    ASSERT_LT(output.first, 990);
+    indexes.insert(output.first);
+  }
+
+  ASSERT_EQ(20, indexes.size());
+}
+
+TEST_F(RandomOutputsIndexTest, popRemovesLastOutput) {
+  index.push(makeOutput(1));
+  index.push(makeOutput(2));
+  ASSERT_EQ(2, index.size(AMOUNT));
+
+  index.pop(AMOUNT);
+  ASSERT_EQ(1, index.size(AMOUNT));
+  index.pop(AMOUNT);
+  ASSERT_EQ(0, index.size(AMOUNT));
+
+  std::vector<std::pair<uint32_t, Crypto::PublicKey>> outputs;
+  ASSERT_FALSE(index.select(AMOUNT, 1, 100, alwaysUnlocked, outputs));
+}
+
+TEST_F(RandomOutputsIndexTest, amountsKeepTheirOwnIndexes) {
+  ASSERT_EQ(0, index.push(makeOutput(1, 0, AMOUNT)));
+  ASSERT_EQ(0, index.push(makeOutput(1, 0, AMOUNT + 1)));
+  ASSERT_EQ(1, index.push(makeOutput(2, 0, AMOUNT)));
+  ASSERT_EQ(2, index.push(makeOutput(3, 0, AMOUNT)));
+  ASSERT_EQ(3, index.size(AMOUNT));
+  ASSERT_EQ(1, index.size(AMOUNT + 1));
+  ASSERT_EQ(4, index.journalSize());
+
+  RandomOutputsIndex::Output output;
+  ASSERT_TRUE(index.get(AMOUNT, 1, output));
+  ASSERT_EQ(2, output.height);
+  ASSERT_TRUE(index.get(AMOUNT + 1, 0, output));
+  ASSERT_EQ(1, output.height);
+  ASSERT_FALSE(index.get(AMOUNT + 1, 1, output));
+}
+
+TEST_F(RandomOutputsIndexTest, reopenFindsOutputsWithoutLoading) {
+  for (uint32_t height = 0; height < 300; ++height) {
+    index.push(makeOutput(height, 0, AMOUNT + height % 3));
+  }
+
+  index.flush();
+  index.close();
+
+  RandomOutputsIndex reopened;
+  reopened.open(JOURNAL_FILE_NAME, POSITIONS_FILE_NAME);
+  ASSERT_EQ(100, reopened.size(AMOUNT));
+  ASSERT_EQ(100, reopened.size(AMOUNT + 2));
+
+  RandomOutputsIndex::Output output;
+  ASSERT_TRUE(reopened.get(AMOUNT + 1, 99, output));
+  ASSERT_EQ(298, output.height);
+  ASSERT_EQ(100, reopened.push(makeOutput(300, 0, AMOUNT)));
+  reopened.close();
+}
+
+TEST_F(RandomOutputsIndexTest, truncateDropsOutputsOfLaterBlocks) {
+  for (uint32_t height = 0; height < 30; ++height) {
+    index.push(makeOutput(height, 0, AMOUNT + height % 2));
+  }
+
+  index.truncate(25, 20);
+  ASSERT_EQ(20, index.journalSize());
+  ASSERT_EQ(10, index.size(AMOUNT));
+  ASSERT_EQ(10, index.size(AMOUNT + 1));
+
+  RandomOutputsIndex::Output output;
+  ASSERT_FALSE(index.get(AMOUNT, 10, output));
+  ASSERT_EQ(10, index.push(makeOutput(20, 0, AMOUNT)));
+}
+
+}
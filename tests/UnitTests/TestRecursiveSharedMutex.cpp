@@ -0,0 +1,108 @@
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "Common/RecursiveSharedMutex.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+
+using namespace Tools;
+
+TEST(RecursiveSharedMutex, exclusiveLockNests) {
+  RecursiveSharedMutex mutex;
+  std::lock_guard<RecursiveSharedMutex> outer(mutex);
+  {
+    std::lock_guard<RecursiveSharedMutex> inner(mutex);
+    ASSERT_TRUE(mutex.ownedByCurrentThread());
+  }
+
+  ASSERT_TRUE(mutex.ownedByCurrentThread());
+  ASSERT_FALSE(std::async(std::launch::async, [&mutex] { return mutex.try_lock(); }).get());
+}
+
+TEST(RecursiveSharedMutex, sharedLockNestsInExclusiveLock) {
+  RecursiveSharedMutex mutex;
+  {
+    std::lock_guard<RecursiveSharedMutex> exclusive(mutex);
+    boost::shared_lock<RecursiveSharedMutex> shared(mutex);
+    ASSERT_TRUE(mutex.ownedByCurrentThread());
+  }
+
+  ASSERT_FALSE(mutex.ownedByCurrentThread());
+  ASSERT_TRUE(std::async(std::launch::async, [&mutex] {
+    bool locked = mutex.try_lock();
+    if (locked) {
+      mutex.unlock();
+    }
+
+    return locked;
+  }).get());
+}
+
+TEST(RecursiveSharedMutex, readersRunTogether) {
+  RecursiveSharedMutex mutex;
+  std::promise<void> otherReaderLocked;
+  std::promise<void> done;
+
+  boost::shared_lock<RecursiveSharedMutex> lock(mutex);
+  auto otherReader = std::async(std::launch::async, [&] {
+    boost::shared_lock<RecursiveSharedMutex> otherLock(mutex);
+    otherReaderLocked.set_value();
+    done.get_future().wait();
+  });
+
+  ASSERT_EQ(std::future_status::ready, otherReaderLocked.get_future().wait_for(std::chrono::seconds(10)));
+  done.set_value();
+  otherReader.get();
+}
+
+TEST(RecursiveSharedMutex, readerLocksAgainWhileWriterWaits) {
+  RecursiveSharedMutex mutex;
+  std::unique_ptr<boost::shared_lock<RecursiveSharedMutex>> reader(new boost::shared_lock<RecursiveSharedMutex>(mutex));
+  auto writer = std::async(std::launch::async, [&mutex] {
+    std::lock_guard<RecursiveSharedMutex> lock(mutex);
+  });
+
+  ASSERT_EQ(std::future_status::timeout, writer.wait_for(std::chrono::milliseconds(50)));
+  {
+    boost::shared_lock<RecursiveSharedMutex> nested(mutex);
+  }
+
+  reader.reset();
+  ASSERT_EQ(std::future_status::ready, writer.wait_for(std::chrono::seconds(10)));
+}
+
+TEST(RecursiveSharedMutex, writerWaitsForReaders) {
+  RecursiveSharedMutex mutex;
+  std::atomic<bool> writerLocked(false);
+
+  std::unique_ptr<boost::shared_lock<RecursiveSharedMutex>> reader(new boost::shared_lock<RecursiveSharedMutex>(mutex));
+  auto writer = std::async(std::launch::async, [&] {
+    std::lock_guard<RecursiveSharedMutex> lock(mutex);
+    writerLocked = true;
+  });
+
+  ASSERT_EQ(std::future_status::timeout, writer.wait_for(std::chrono::milliseconds(50)));
+  ASSERT_FALSE(writerLocked);
+  reader.reset();
+  writer.get();
+  ASSERT_TRUE(writerLocked);
+}
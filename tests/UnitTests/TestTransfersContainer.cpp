@@ -15,6 +15,9 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <limits>
+#include <sstream>
+
 #include "gtest/gtest.h"
 
 #include "IWalletLegacy.h"
@@ -1131,3 +1134,240 @@ TEST_F(TransfersContainer_getOutputs, filtersByStateAndKeySimultaneously) {
   ASSERT_EQ(AMOUNT_1 + AMOUNT_2, transfers.front().amount);
 }
 
+
+//--------------------------------------------------------------------------- 
+// TransfersContainer_visitOutputs
+//--------------------------------------------------------------------------- 
+
+class TransfersContainer_visitOutputs : public TransfersContainerTest {
+public:
+  std::vector<uint64_t> visitAmounts(uint64_t minAmount, uint64_t maxAmount, uint32_t flags, size_t maxCount = 100) {
+    std::vector<uint64_t> amounts;
+    container.visitOutputs(minAmount, maxAmount, flags, [&](const TransactionOutputInformation& out) {
+      amounts.push_back(out.amount);
+      return amounts.size() < maxCount;
+    });
+
+    return amounts;
+  }
+};
+
+TEST_F(TransfersContainer_visitOutputs, visitsOutputsInRangeInAscendingOrderOfAmounts) {
+  addTransaction(TEST_BLOCK_HEIGHT, 30);
+  addTransaction(TEST_BLOCK_HEIGHT, 10);
+  addTransaction(TEST_BLOCK_HEIGHT, 40);
+  addTransaction(TEST_BLOCK_HEIGHT, 20);
+  container.advanceHeight(TEST_CONTAINER_CURRENT_HEIGHT);
+
+  ASSERT_EQ(std::vector<uint64_t>({ 10, 20, 30, 40 }), visitAmounts(0, std::numeric_limits<uint64_t>::max(), ITransfersContainer::IncludeAll));
+  ASSERT_EQ(std::vector<uint64_t>({ 20, 30 }), visitAmounts(15, 30, ITransfersContainer::IncludeAll));
+  ASSERT_TRUE(visitAmounts(31, 39, ITransfersContainer::IncludeAll).empty());
+  ASSERT_TRUE(visitAmounts(30, 20, ITransfersContainer::IncludeAll).empty());
+}
+
+TEST_F(TransfersContainer_visitOutputs, stopsWhenVisitorReturnsFalse) {
+  addTransaction(TEST_BLOCK_HEIGHT, 30);
+  addTransaction(TEST_BLOCK_HEIGHT, 10);
+  addTransaction(TEST_BLOCK_HEIGHT, 20);
+  container.advanceHeight(TEST_CONTAINER_CURRENT_HEIGHT);
+
+  ASSERT_EQ(std::vector<uint64_t>({ 10, 20 }), visitAmounts(0, std::numeric_limits<uint64_t>::max(), ITransfersContainer::IncludeAll, 2));
+}
+
+TEST_F(TransfersContainer_visitOutputs, filtersOutputsByStateAndVisitsUnconfirmedLast) {
+  addTransaction(TEST_CONTAINER_CURRENT_HEIGHT - TEST_TRANSACTION_SPENDABLE_AGE, 20);
+  addTransaction(TEST_CONTAINER_CURRENT_HEIGHT, 10);
+  addTransaction(WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT, 5);
+
+  ASSERT_EQ(std::vector<uint64_t>({ 10, 20, 5 }), visitAmounts(0, std::numeric_limits<uint64_t>::max(), ITransfersContainer::IncludeAll));
+  ASSERT_EQ(std::vector<uint64_t>({ 20 }), visitAmounts(0, std::numeric_limits<uint64_t>::max(), ITransfersContainer::IncludeKeyUnlocked));
+  ASSERT_EQ(std::vector<uint64_t>({ 10, 5 }), visitAmounts(0, std::numeric_limits<uint64_t>::max(), ITransfersContainer::IncludeKeyNotUnlocked));
+  ASSERT_TRUE(visitAmounts(6, 9, ITransfersContainer::IncludeAll).empty());
+}
+
+TEST_F(TransfersContainer_visitOutputs, skipsSpentOutputs) {
+  auto tx = addTransaction(TEST_BLOCK_HEIGHT, 100);
+  addTransaction(TEST_BLOCK_HEIGHT, 50);
+  addSpendingTransaction(tx->getTransactionHash(), TEST_BLOCK_HEIGHT + 1, TEST_TRANSACTION_OUTPUT_GLOBAL_INDEX, 70);
+  container.advanceHeight(TEST_CONTAINER_CURRENT_HEIGHT);
+
+  ASSERT_EQ(std::vector<uint64_t>({ 30, 50 }), visitAmounts(0, std::numeric_limits<uint64_t>::max(), ITransfersContainer::IncludeAll));
+}
+
+//--------------------------------------------------------------------------- 
+// TransfersContainer_unlockedKeyOutputs
+//--------------------------------------------------------------------------- 
+
+class TransfersContainer_unlockedKeyOutputs : public TransfersContainerTest {
+public:
+  std::vector<uint64_t> visitAmounts(uint64_t minAmount, uint64_t maxAmount, const std::vector<size_t>& positions) {
+    return visitAmounts(container, minAmount, maxAmount, positions);
+  }
+
+  static std::vector<uint64_t> visitAmounts(const TransfersContainer& container, uint64_t minAmount, uint64_t maxAmount,
+    const std::vector<size_t>& positions) {
+
+    std::vector<uint64_t> amounts;
+    container.visitUnlockedKeyOutputs(minAmount, maxAmount, positions, [&](const TransactionOutputInformation& out) {
+      amounts.push_back(out.amount);
+      return true;
+    });
+
+    return amounts;
+  }
+};
+
+TEST_F(TransfersContainer_unlockedKeyOutputs, countsOutputsInRange) {
+  addTransaction(TEST_BLOCK_HEIGHT, 30);
+  addTransaction(TEST_BLOCK_HEIGHT, 10);
+  addTransaction(TEST_BLOCK_HEIGHT, 40);
+  addTransaction(TEST_BLOCK_HEIGHT, 20);
+  container.advanceHeight(TEST_CONTAINER_CURRENT_HEIGHT);
+
+  ASSERT_EQ(4, container.unlockedKeyOutputsCount(0, std::numeric_limits<uint64_t>::max()));
+  ASSERT_EQ(2, container.unlockedKeyOutputsCount(15, 30));
+  ASSERT_EQ(0, container.unlockedKeyOutputsCount(31, 39));
+  ASSERT_EQ(0, container.unlockedKeyOutputsCount(30, 20));
+}
+
+TEST_F(TransfersContainer_unlockedKeyOutputs, visitsOutputsAtPositionsInAscendingOrderOfAmounts) {
+  addTransaction(TEST_BLOCK_HEIGHT, 30);
+  addTransaction(TEST_BLOCK_HEIGHT, 10);
+  addTransaction(TEST_BLOCK_HEIGHT, 40);
+  addTransaction(TEST_BLOCK_HEIGHT, 20);
+  container.advanceHeight(TEST_CONTAINER_CURRENT_HEIGHT);
+
+  ASSERT_EQ(std::vector<uint64_t>({ 10, 30, 40 }), visitAmounts(0, std::numeric_limits<uint64_t>::max(), { 0, 2, 3 }));
+  ASSERT_EQ(std::vector<uint64_t>({ 30, 20 }), visitAmounts(15, 30, { 1, 0 }));
+  ASSERT_EQ(std::vector<uint64_t>({ 40 }), visitAmounts(35, 100, { 0, 1, 5 }));
+  ASSERT_TRUE(visitAmounts(30, 20, { 0 }).empty());
+}
+
+TEST_F(TransfersContainer_unlockedKeyOutputs, stopsWhenVisitorReturnsFalse) {
+  addTransaction(TEST_BLOCK_HEIGHT, 30);
+  addTransaction(TEST_BLOCK_HEIGHT, 10);
+  container.advanceHeight(TEST_CONTAINER_CURRENT_HEIGHT);
+
+  size_t visited = 0;
+  container.visitUnlockedKeyOutputs(0, std::numeric_limits<uint64_t>::max(), { 0, 1 }, [&visited](const TransactionOutputInformation&) {
+    ++visited;
+    return false;
+  });
+
+  ASSERT_EQ(1, visited);
+}
+
+TEST_F(TransfersContainer_unlockedKeyOutputs, followsHeightChanges) {
+  addTransaction(TEST_CONTAINER_CURRENT_HEIGHT - TEST_TRANSACTION_SPENDABLE_AGE, 20);
+  addTransaction(TEST_CONTAINER_CURRENT_HEIGHT, 10);
+  addTransaction(WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT, 5);
+
+  ASSERT_EQ(1, container.unlockedKeyOutputsCount(0, std::numeric_limits<uint64_t>::max()));
+  ASSERT_EQ(std::vector<uint64_t>({ 20 }), visitAmounts(0, std::numeric_limits<uint64_t>::max(), { 0, 1 }));
+
+  container.advanceHeight(TEST_CONTAINER_CURRENT_HEIGHT + TEST_TRANSACTION_SPENDABLE_AGE);
+  ASSERT_EQ(2, container.unlockedKeyOutputsCount(0, std::numeric_limits<uint64_t>::max()));
+  ASSERT_EQ(std::vector<uint64_t>({ 10, 20 }), visitAmounts(0, std::numeric_limits<uint64_t>::max(), { 0, 1 }));
+
+  container.detach(TEST_CONTAINER_CURRENT_HEIGHT);
+  ASSERT_EQ(0, container.unlockedKeyOutputsCount(0, std::numeric_limits<uint64_t>::max()));
+}
+
+TEST_F(TransfersContainer_unlockedKeyOutputs, countsConfirmedTransactionOutputs) {
+  auto tx = addTransaction(WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT, 20);
+  container.advanceHeight(TEST_CONTAINER_CURRENT_HEIGHT);
+  ASSERT_EQ(0, container.unlockedKeyOutputsCount(0, std::numeric_limits<uint64_t>::max()));
+
+  ASSERT_TRUE(container.markTransactionConfirmed(blockInfo(TEST_BLOCK_HEIGHT), tx->getTransactionHash(), { TEST_TRANSACTION_OUTPUT_GLOBAL_INDEX }));
+  ASSERT_EQ(1, container.unlockedKeyOutputsCount(0, std::numeric_limits<uint64_t>::max()));
+}
+
+TEST_F(TransfersContainer_unlockedKeyOutputs, skipsSpentOutputs) {
+  auto tx = addTransaction(TEST_BLOCK_HEIGHT, 100);
+  addTransaction(TEST_BLOCK_HEIGHT, 50);
+  addSpendingTransaction(tx->getTransactionHash(), TEST_BLOCK_HEIGHT + 1, TEST_TRANSACTION_OUTPUT_GLOBAL_INDEX, 70);
+  container.advanceHeight(TEST_CONTAINER_CURRENT_HEIGHT);
+
+  ASSERT_EQ(2, container.unlockedKeyOutputsCount(0, std::numeric_limits<uint64_t>::max()));
+  ASSERT_EQ(std::vector<uint64_t>({ 30, 50 }), visitAmounts(0, std::numeric_limits<uint64_t>::max(), { 0, 1 }));
+}
+
+TEST_F(TransfersContainer_unlockedKeyOutputs, loadedContainerCountsOutputsAtSavedHeight) {
+  addTransaction(TEST_BLOCK_HEIGHT, 30);
+  addTransaction(TEST_CONTAINER_CURRENT_HEIGHT, 10);
+
+  std::stringstream stream;
+  container.save(stream);
+
+  TransfersContainer loaded(currency, logger, TEST_TRANSACTION_SPENDABLE_AGE);
+  loaded.load(stream);
+
+  ASSERT_EQ(1, loaded.unlockedKeyOutputsCount(0, std::numeric_limits<uint64_t>::max()));
+  ASSERT_EQ(std::vector<uint64_t>({ 30 }), visitAmounts(loaded, 0, std::numeric_limits<uint64_t>::max(), { 0, 1 }));
+
+  loaded.advanceHeight(TEST_CONTAINER_CURRENT_HEIGHT + TEST_TRANSACTION_SPENDABLE_AGE);
+  ASSERT_EQ(2, loaded.unlockedKeyOutputsCount(0, std::numeric_limits<uint64_t>::max()));
+}
+
+//--------------------------------------------------------------------------- 
+// TransfersContainer_saveChanges
+//--------------------------------------------------------------------------- 
+class TransfersContainer_saveChanges : public TransfersContainerTest {
+public:
+  TransfersContainer_saveChanges() : loaded(currency, logger, TEST_TRANSACTION_SPENDABLE_AGE) {
+  }
+
+  void expectSameContainers() {
+    EXPECT_EQ(container.transactionsCount(), loaded.transactionsCount());
+    EXPECT_EQ(container.transfersCount(), loaded.transfersCount());
+    EXPECT_EQ(container.getSpentOutputs().size(), loaded.getSpentOutputs().size());
+    EXPECT_EQ(container.balance(ITransfersContainer::IncludeAll), loaded.balance(ITransfersContainer::IncludeAll));
+    EXPECT_EQ(container.balance(ITransfersContainer::IncludeAllUnlocked), loaded.balance(ITransfersContainer::IncludeAllUnlocked));
+  }
+
+  TransfersContainer loaded;
+};
+
+TEST_F(TransfersContainer_saveChanges, writesChangedTransactionsOnly) {
+  addTransaction(TEST_BLOCK_HEIGHT);
+  container.markSaved();
+  ASSERT_FALSE(container.hasChanges());
+
+  addTransaction(TEST_BLOCK_HEIGHT + 1);
+  ASSERT_TRUE(container.hasChanges());
+
+  std::stringstream changes;
+  container.saveChanges(changes);
+  ASSERT_FALSE(container.hasChanges());
+
+  std::stringstream emptyChanges;
+  container.saveChanges(emptyChanges);
+  ASSERT_LT(emptyChanges.str().size(), changes.str().size());
+}
+
+TEST_F(TransfersContainer_saveChanges, loadChangesRestoresContainer) {
+  auto tx = addTransaction(TEST_BLOCK_HEIGHT);
+  auto detachedTx = addTransaction(TEST_BLOCK_HEIGHT + 5);
+  container.advanceHeight(TEST_BLOCK_HEIGHT + 5);
+
+  std::stringstream state;
+  container.save(state);
+  container.markSaved();
+  loaded.load(state);
+
+  std::stringstream changes1;
+  addSpendingTransaction(tx->getTransactionHash(), TEST_BLOCK_HEIGHT + 5, TEST_TRANSACTION_OUTPUT_GLOBAL_INDEX, TEST_OUTPUT_AMOUNT / 2);
+  container.saveChanges(changes1);
+
+  std::stringstream changes2;
+  container.detach(TEST_BLOCK_HEIGHT + 5);
+  addTransaction(WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT);
+  container.saveChanges(changes2);
+
+  loaded.loadChanges(changes1);
+  loaded.loadChanges(changes2);
+
+  expectSameContainers();
+  ASSERT_EQ(TEST_OUTPUT_AMOUNT * 2, loaded.balance(ITransfersContainer::IncludeAll));
+  ASSERT_EQ(2, loaded.transactionsCount());
+}
@@ -17,11 +17,14 @@
 
 #include "gtest/gtest.h"
 
+#include <algorithm>
 #include <chrono>
 #include <fstream>
+#include <limits>
 #include <numeric>
 #include <system_error>
 #include <tuple>
+#include <unordered_set>
 
 #include "Common/StringTools.h"
 #include "CryptoNoteCore/Currency.h"
@@ -976,6 +979,154 @@ TEST_F(WalletApi, transferCanSpendAllWalletOutputsIncludingDustOutputs) {
   ASSERT_EQ(sentMoney, wallet.getPendingBalance(dst));
 }
 
+TEST_F(WalletApi, transferSpendsOutputsPickedInSeveralBatches) {
+  // more outputs than the first batch of random outputs looks up
+  const size_t OUTPUT_COUNT = 40;
+  for (size_t i = 0; i < OUTPUT_COUNT; ++i) {
+    generator.getSingleOutputTransaction(parseAddress(aliceAddress), FEE);
+  }
+
+  generator.generateEmptyBlocks(11);
+  node.updateObservers();
+  waitForActualBalance(alice, OUTPUT_COUNT * FEE);
+
+  sendMoney(RANDOM_ADDRESS, (OUTPUT_COUNT - 1) * FEE, FEE);
+
+  ASSERT_EQ(0, alice.getActualBalance());
+  ASSERT_EQ(0, alice.getPendingBalance());
+}
+
+class UnlockedOutputsContainerStub : public ITransfersContainer {
+public:
+  // the outputs have amounts from 1 to outputCount, the count visitUnlockedKeyOutputs() sees may be changed by the test
+  explicit UnlockedOutputsContainerStub(size_t outputCount) {
+    for (size_t i = 0; i < outputCount; ++i) {
+      TransactionOutputInformation output;
+      output.type = TransactionTypes::OutputType::Key;
+      output.amount = i + 1;
+      Crypto::SecretKey ignore;
+      Crypto::generate_keys(output.outputKey, ignore);
+      countedOutputs.push_back(output);
+    }
+
+    visitedOutputs = countedOutputs;
+  }
+
+  virtual size_t transfersCount() const override { return countedOutputs.size(); }
+  virtual size_t transactionsCount() const override { return countedOutputs.size(); }
+  virtual uint64_t balance(uint32_t flags) const override { return 0; }
+  virtual void getOutputs(std::vector<TransactionOutputInformation>& transfers, uint32_t flags) const override { }
+  virtual bool getTransactionInformation(const Crypto::Hash& transactionHash, TransactionInformation& info,
+    uint64_t* amountIn, uint64_t* amountOut) const override { return false; }
+  virtual std::vector<TransactionOutputInformation> getTransactionOutputs(const Crypto::Hash& transactionHash, uint32_t flags) const override { return {}; }
+  virtual std::vector<TransactionOutputInformation> getTransactionInputs(const Crypto::Hash& transactionHash, uint32_t flags) const override { return {}; }
+  virtual void getUnconfirmedTransactions(std::vector<Crypto::Hash>& transactions) const override { }
+  virtual std::vector<TransactionSpentOutputInformation> getSpentOutputs() const override { return {}; }
+  virtual void visitOutputs(uint64_t minAmount, uint64_t maxAmount, uint32_t flags, const OutputVisitor& visitor) const override { }
+  virtual void save(std::ostream& os) override { }
+  virtual void load(std::istream& in) override { }
+
+  virtual size_t unlockedKeyOutputsCount(uint64_t minAmount, uint64_t maxAmount) const override {
+    return countedOutputs.size();
+  }
+
+  virtual void visitUnlockedKeyOutputs(uint64_t minAmount, uint64_t maxAmount, const std::vector<size_t>& positions,
+    const OutputVisitor& visitor) const override {
+
+    for (size_t position : positions) {
+      if (position < visitedOutputs.size() && !visitor(visitedOutputs[position])) {
+        break;
+      }
+    }
+
+    if (onVisited) {
+      onVisited();
+    }
+  }
+
+  std::vector<TransactionOutputInformation> countedOutputs;
+  mutable std::vector<TransactionOutputInformation> visitedOutputs;
+  std::function<void()> onVisited;
+};
+
+namespace {
+
+std::vector<std::pair<size_t, TransactionOutputInformation>> visitAllRandomOutputs(const std::vector<const ITransfersContainer*>& containers) {
+  std::vector<std::pair<size_t, TransactionOutputInformation>> outputs;
+  visitRandomOutputs(containers, 0, std::numeric_limits<uint64_t>::max(), [&outputs](size_t containerIndex, const TransactionOutputInformation& out) {
+    outputs.emplace_back(containerIndex, out);
+    return true;
+  });
+
+  return outputs;
+}
+
+bool containsOutput(const std::vector<TransactionOutputInformation>& outputs, const TransactionOutputInformation& output) {
+  return std::any_of(outputs.begin(), outputs.end(), [&output](const TransactionOutputInformation& out) { return out.outputKey == output.outputKey; });
+}
+
+}
+
+TEST_F(WalletApi, visitRandomOutputsVisitsEachOutputOnceInSeveralBatches) {
+  UnlockedOutputsContainerStub first(40);
+  UnlockedOutputsContainerStub second(30);
+
+  auto outputs = visitAllRandomOutputs({ &first, &second });
+
+  ASSERT_EQ(70, outputs.size());
+  std::unordered_set<Crypto::PublicKey> keys;
+  for (const auto& output : outputs) {
+    ASSERT_TRUE(keys.insert(output.second.outputKey).second);
+    ASSERT_TRUE(containsOutput(output.first == 0 ? first.countedOutputs : second.countedOutputs, output.second));
+  }
+}
+
+TEST_F(WalletApi, visitRandomOutputsStopsWhenVisitorReturnsFalse) {
+  UnlockedOutputsContainerStub container(40);
+
+  size_t visitedCount = 0;
+  visitRandomOutputs({ &container }, 0, std::numeric_limits<uint64_t>::max(), [&visitedCount](size_t, const TransactionOutputInformation&) {
+    return ++visitedCount < 20;
+  });
+
+  ASSERT_EQ(20, visitedCount);
+}
+
+TEST_F(WalletApi, visitRandomOutputsSkipsOutputsSpentSinceTheyWereCounted) {
+  UnlockedOutputsContainerStub container(40);
+  auto& visitedOutputs = container.visitedOutputs;
+  for (size_t i = 0; i < visitedOutputs.size(); i += 3) {
+    visitedOutputs.erase(visitedOutputs.begin() + i);
+  }
+
+  auto outputs = visitAllRandomOutputs({ &container });
+
+  ASSERT_EQ(visitedOutputs.size(), outputs.size());
+  std::unordered_set<Crypto::PublicKey> keys;
+  for (const auto& output : outputs) {
+    ASSERT_TRUE(keys.insert(output.second.outputKey).second);
+    ASSERT_TRUE(containsOutput(visitedOutputs, output.second));
+  }
+}
+
+TEST_F(WalletApi, visitRandomOutputsVisitsOutputsMovedBetweenBatchesOnce) {
+  UnlockedOutputsContainerStub container(40);
+  // outputs spent after the first batch move the next ones to lower positions, where they may be drawn again
+  container.onVisited = [&container] {
+    auto& visitedOutputs = container.visitedOutputs;
+    if (visitedOutputs.size() == container.countedOutputs.size()) {
+      visitedOutputs.erase(visitedOutputs.begin(), visitedOutputs.begin() + 10);
+    }
+  };
+
+  auto outputs = visitAllRandomOutputs({ &container });
+
+  std::unordered_set<Crypto::PublicKey> keys;
+  for (const auto& output : outputs) {
+    ASSERT_TRUE(keys.insert(output.second.outputKey).second);
+  }
+}
+
 TEST_F(WalletApi, balanceAfterTransfer) {
   generateAndUnlockMoney();
 
@@ -4267,6 +4418,88 @@ TEST_F(WalletApi, walletSavesAndLoadsExtra) {
   ASSERT_EQ(savedExtra, loadedExtra);
 }
 
+static std::string readFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+TEST_F(WalletApi, walletLoadsSavedChanges) {
+  alice.save(WalletSaveLevel::SAVE_ALL, "full");
+  std::string fullSave = readFile(ALICE_WALLET_PATH);
+
+  generateAndUnlockMoney();
+  alice.save(WalletSaveLevel::SAVE_ALL, "changes");
+
+  // the changes are appended, the full save stays in place
+  std::string savedChanges = readFile(ALICE_WALLET_PATH);
+  ASSERT_GT(savedChanges.size(), fullSave.size());
+  ASSERT_EQ(fullSave.substr(fullSave.size() - 32), savedChanges.substr(fullSave.size() - 32, 32));
+
+  boost::filesystem::copy(ALICE_WALLET_PATH, BOB_WALLET_PATH);
+
+  std::string loadedExtra;
+  WalletGreen bob(dispatcher, currency, node, logger, TRANSACTION_SOFTLOCK_TIME);
+  bob.load(BOB_WALLET_PATH, "pass", loadedExtra);
+
+  ASSERT_EQ("changes", loadedExtra);
+  ASSERT_EQ(alice.getTransactionCount(), bob.getTransactionCount());
+  ASSERT_EQ(alice.getActualBalance(), bob.getActualBalance());
+  ASSERT_EQ(alice.getPendingBalance(), bob.getPendingBalance());
+
+  bob.shutdown();
+  wait(100);
+}
+
+TEST_F(WalletApi, walletDropsTornSavedChanges) {
+  alice.save(WalletSaveLevel::SAVE_ALL, "full");
+
+  generateAndUnlockMoney();
+  alice.save(WalletSaveLevel::SAVE_ALL, "first changes");
+  uint64_t firstChangesSize = boost::filesystem::file_size(ALICE_WALLET_PATH);
+
+  generateAndUnlockMoney();
+  alice.save(WalletSaveLevel::SAVE_ALL, "second changes");
+  uint64_t secondChangesSize = boost::filesystem::file_size(ALICE_WALLET_PATH);
+  ASSERT_GT(secondChangesSize, firstChangesSize);
+
+  boost::filesystem::copy(ALICE_WALLET_PATH, BOB_WALLET_PATH);
+  boost::filesystem::resize_file(BOB_WALLET_PATH, secondChangesSize - 1);
+
+  std::string loadedExtra;
+  WalletGreen bob(dispatcher, currency, node, logger, TRANSACTION_SOFTLOCK_TIME);
+  bob.load(BOB_WALLET_PATH, "pass", loadedExtra);
+
+  ASSERT_EQ("first changes", loadedExtra);
+  ASSERT_EQ(firstChangesSize, boost::filesystem::file_size(BOB_WALLET_PATH));
+
+  bob.shutdown();
+  wait(100);
+}
+
+TEST_F(WalletApi, changePasswordReencryptsSavedChanges) {
+  alice.save(WalletSaveLevel::SAVE_ALL, "full");
+
+  generateAndUnlockMoney();
+  alice.save(WalletSaveLevel::SAVE_ALL, "changes");
+
+  ASSERT_NO_THROW(alice.changePassword("pass", "pass2"));
+  boost::filesystem::copy(ALICE_WALLET_PATH, BOB_WALLET_PATH);
+
+  WalletGreen carol(dispatcher, currency, node, logger, TRANSACTION_SOFTLOCK_TIME);
+  ASSERT_ANY_THROW(carol.load(BOB_WALLET_PATH, "pass"));
+
+  std::string loadedExtra;
+  WalletGreen bob(dispatcher, currency, node, logger, TRANSACTION_SOFTLOCK_TIME);
+  bob.load(BOB_WALLET_PATH, "pass2", loadedExtra);
+
+  ASSERT_EQ("changes", loadedExtra);
+  ASSERT_EQ(alice.getTransactionCount(), bob.getTransactionCount());
+  ASSERT_EQ(alice.getActualBalance(), bob.getActualBalance());
+
+  bob.shutdown();
+  wait(100);
+}
+
 TEST_F(WalletApi, walletHandlesResetAndSwitchingToAlternativeChain) {
   // Create transaction 1, that will be preserved
   generateBlockReward(aliceAddress);
@@ -54,6 +54,34 @@ class TransactionValidator : public CryptoNote::ITransactionValidator {
   }
 };
 
+class CountingTransactionValidator : public CryptoNote::ITransactionValidator {
+public:
+  CountingTransactionValidator() : inputChecks(0), spendChecks(0), spent(false) {
+  }
+
+  virtual bool checkTransactionInputs(const CryptoNote::Transaction& tx, BlockInfo& maxUsedBlock) override {
+    return true;
+  }
+
+  virtual bool checkTransactionInputs(const CryptoNote::Transaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) override {
+    ++inputChecks;
+    return !spent;
+  }
+
+  virtual bool haveSpentKeyImages(const CryptoNote::Transaction& tx) override {
+    ++spendChecks;
+    return spent;
+  }
+
+  virtual bool checkTransactionSize(size_t blobSize) override {
+    return true;
+  }
+
+  size_t inputChecks;
+  size_t spendChecks;
+  bool spent;
+};
+
 class FakeTimeProvider : public ITimeProvider {
 public:
   FakeTimeProvider(time_t currentTime = time(nullptr))
@@ -820,3 +848,42 @@ TEST_F(TxPool_FillBlockTemplate, TxPoolContinuesToAddOrdinaryTransactionsUpTo125
     TEST_MAX_TX_COUNT_PER_BLOCK - fusionTxCount,
     fusionTxCount));
 }
+
+TEST_F(tx_pool, readyTransactionsAreCheckedOnlyWhenChainChanges) {
+  TestPool<CountingTransactionValidator, RealTimeProvider> pool(currency, logger);
+
+  Transaction tx;
+  GenerateTransaction(currency, tx, currency.minimumFee(), 1);
+  Crypto::Hash txHash = getObjectHash(tx);
+
+  tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+  ASSERT_TRUE(pool.add_tx(tx, tvc, false));
+
+  std::vector<Crypto::Hash> newTxs;
+  std::vector<Crypto::Hash> deletedTxs;
+  pool.get_difference(std::vector<Crypto::Hash>(), newTxs, deletedTxs);
+  pool.get_difference(std::vector<Crypto::Hash>(), newTxs, deletedTxs);
+  ASSERT_EQ(std::vector<Crypto::Hash>{txHash}, newTxs);
+  ASSERT_EQ(1, pool.validator.inputChecks);
+  size_t spendChecks = pool.validator.spendChecks;
+
+  // a pushed block can only spend the inputs of a ready transaction
+  pool.on_blockchain_inc(1, NULL_HASH);
+  pool.get_difference(std::vector<Crypto::Hash>(), newTxs, deletedTxs);
+  ASSERT_EQ(std::vector<Crypto::Hash>{txHash}, newTxs);
+  ASSERT_EQ(1, pool.validator.inputChecks);
+  ASSERT_EQ(spendChecks + 1, pool.validator.spendChecks);
+
+  pool.validator.spent = true;
+  pool.on_blockchain_inc(2, NULL_HASH);
+  pool.get_difference(std::vector<Crypto::Hash>{txHash}, newTxs, deletedTxs);
+  ASSERT_TRUE(newTxs.empty());
+  ASSERT_EQ(std::vector<Crypto::Hash>{txHash}, deletedTxs);
+
+  // after a popped block everything is checked in full
+  pool.validator.spent = false;
+  pool.on_blockchain_dec(1, NULL_HASH);
+  pool.get_difference(std::vector<Crypto::Hash>(), newTxs, deletedTxs);
+  ASSERT_EQ(std::vector<Crypto::Hash>{txHash}, newTxs);
+  ASSERT_EQ(2, pool.validator.inputChecks);
+}